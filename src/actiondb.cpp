@@ -1,9 +1,14 @@
 #include <actiondb.h>
 #include <validation.h>
 #include <chainparams.h>
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
 #include <logging.h>
 #include <key_io.h>
+#include <random.h>
+#include <script/sigcache.h>
 #include <algorithm>
+#include <set>
 
 CAction MakeBindAction(const CKeyID& from, const CKeyID& to)
 {
@@ -72,21 +77,15 @@ CAction UnserializeAction(const std::vector<unsigned char>& vch) {
     return std::move(CAction(CNilAction{}));
 }
 
-CAction DecodeAction(const CTransactionRef& tx, std::vector<unsigned char>& vchSig)
+CAction DecodeAction(const CTransactionRef& tx, const CAmount fee, std::vector<unsigned char>& vchSig)
 {
     do {
         if (tx->IsCoinBase() || tx->IsNull() || tx->vout.size() != 2 
             || (tx->vout[0].nValue != 0 && tx->vout[1].nValue != 0)) 
             continue;
 
-        CAmount nAmount{ 0 };
-        for (auto vin : tx->vin) {
-            auto coin = pcoinsTip->AccessCoin(vin.prevout);
-            nAmount += coin.out.nValue;
-        }
-        auto outValue = tx->GetValueOut();
-        if (nAmount - outValue != Params().GetConsensus().nActionFee) {
-            LogPrintf("Action warning fees, fee=%u\n", nAmount - outValue);
+        if (fee != Params().GetConsensus().nActionFee) {
+            LogPrint(BCLog::RELATION, "Action warning fees, fee=%u\n", fee);
             continue;
         }
         for (auto vout : tx->vout) {
@@ -109,13 +108,82 @@ CAction DecodeAction(const CTransactionRef& tx, std::vector<unsigned char>& vchS
     return CAction(CNilAction{});
 }
 
+namespace {
+
+/** Hashes of (txid, action) pairs whose signature has been verified. */
+CuckooCache::cache<uint256, SignatureCacheHasher> actionCache;
+uint256 actionCacheNonce(GetRandHash());
+
+/** Actions are rare, a small cache suffices. */
+const size_t ACTION_CACHE_BYTES = 1 << 20;
+
+uint256 ComputeActionCacheEntry(const uint256& txid, const std::vector<unsigned char>& actionVch)
+{
+    uint256 entry;
+    CSHA256().Write(actionCacheNonce.begin(), 32).Write(txid.begin(), 32).Write(actionVch.data(), actionVch.size()).Finalize(entry.begin());
+    return entry;
+}
+
+} // namespace
+
+void InitActionCache()
+{
+    size_t nElems = actionCache.setup_bytes(ACTION_CACHE_BYTES);
+    LogPrintf("Using %zu KiB for action signature cache, able to store %zu elements\n",
+        (nElems * sizeof(uint256)) >> 10, nElems);
+}
+
+CAction CheckAction(const CTransactionRef& tx, const CAmount fee, bool store)
+{
+    std::vector<unsigned char> vchSig;
+    auto action = DecodeAction(tx, fee, vchSig);
+    if (action.type() == typeid(CNilAction)) {
+        return action;
+    }
+
+    // The cache is only written under cs_main while no block is being connected,
+    // so looking it up from the check threads is safe.
+    uint256 entry = ComputeActionCacheEntry(tx->GetHash(), SerializeAction(action));
+    if (actionCache.contains(entry, !store)) {
+        return action;
+    }
+    if (!VerifyAction(tx->vin[0].prevout, action, vchSig)) {
+        LogPrint(BCLog::RELATION, "VerifyAction failure: %s\n", tx->GetHash().GetHex());
+        return CAction(CNilAction{});
+    }
+    if (store) {
+        actionCache.insert(entry);
+    }
+    return action;
+}
+
+bool CActionCheck::operator()()
+{
+    *actionOut = CheckAction(tx, fee, false);
+    return true;
+}
 
 static const char DB_ACTIVE_ACTION_KEY = 'K';
 static const char DB_RELATIONID = 'P';
+static const char DB_RELATION_HISTORY = 'H';
+static const char DB_RELATION_HISTORY_INDEXED = 'I';
+
+namespace {
+
+typedef std::pair<char, std::pair<CKeyID, DBHeightKey>> CRelationHistoryKey;
+
+CRelationHistoryKey MakeHistoryKey(const CKeyID& from, const int height)
+{
+    return std::make_pair(DB_RELATION_HISTORY, std::make_pair(from, DBHeightKey(height)));
+}
+
+} // namespace
 
 CRelationView::CRelationView(size_t nCacheSize, bool fMemory, bool fWipe)
-    : CDBWrapper(GetDataDir() / "action" / "relation", nCacheSize, fMemory, fWipe) 
+    : CDBWrapper(GetDataDir() / "action" / "relation", nCacheSize, fMemory, fWipe),
+      fHistoryIndexed(false)
 {
+    Read(DB_RELATION_HISTORY_INDEXED, fHistoryIndexed);
 }
 
 CKeyID CRelationView::To(const uint160& from, uint64_t plotid, bool poc21) const
@@ -142,22 +210,55 @@ CKeyID CRelationView::To(const uint160& from, uint64_t plotid, bool poc21) const
     return std::move(value);
 }
 
-void CRelationView::addRelationHistory(const int height, const CKeyID& from, const CKeyID& to){
-    CPersonalRelationHistoryList personalRelationList;
-    auto iter = relationsHistoryMap.find(from);
-    if (iter != relationsHistoryMap.end()){
-        personalRelationList = relationsHistoryMap[from];
+bool CRelationView::GetRelationAt(const CKeyID& from, const int height, CKeyID& to, int& bindHeight)
+{
+    // Position on the first entry above the height, the entry before it is the latest action.
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(MakeHistoryKey(from, height + 1));
+    if (pcursor->Valid()) {
+        pcursor->Prev();
+    } else {
+        pcursor->SeekToLast();
+    }
+
+    CRelationHistoryKey key;
+    if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_RELATION_HISTORY || key.second.first != from) {
+        return false;
     }
+    if (!pcursor->GetValue(to)) {
+        return error("%s: failed to read relation history of %s", __func__, from.ToString());
+    }
+    bindHeight = key.second.second.height;
+    return true;
+}
+
+CPersonalRelationHistoryList CRelationView::GetRelationHistory(const CKeyID& from)
+{
+    CPersonalRelationHistoryList history;
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CRelationHistoryKey key;
+    for (pcursor->Seek(MakeHistoryKey(from, 0)); pcursor->Valid(); pcursor->Next()) {
+        if (!pcursor->GetKey(key) || key.first != DB_RELATION_HISTORY || key.second.first != from) {
+            break;
+        }
+        CKeyID to;
+        if (pcursor->GetValue(to)) {
+            history[key.second.second.height] = to;
+        }
+    }
+    return history;
+}
+
+void CRelationView::addRelationHistory(CDBBatch& batch, const int height, const CKeyID& from, const CKeyID& to){
     // For one person, 
     // One height only to One action
-    personalRelationList[height] = to;
-    relationsHistoryMap[from] = personalRelationList;
+    batch.Write(MakeHistoryKey(from, height), to);
 }
 
 bool CRelationView::AcceptAction(const int height, const uint256& txid, const CAction& action, std::vector<std::pair<uint256, CRelationActive>>& relations, bool poc21)
 {
     CDBBatch batch(*this);
-    LogPrintf("AcceptAction, tx:%s\n", txid.GetHex());
+    LogPrint(BCLog::RELATION, "AcceptAction, tx:%s\n", txid.GetHex());
     if (action.type() == typeid(CBindAction)) {
         auto ba = boost::get<CBindAction>(action);
         auto active = std::make_pair(txid, std::make_pair(ba.first, ba.second));
@@ -169,50 +270,45 @@ bool CRelationView::AcceptAction(const int height, const uint256& txid, const CA
             batch.Write(std::make_pair(DB_RELATIONID, ba.second.GetPlotID()), ba.second);
             // add new action at tip
             relationTip[ba.first.GetPlotID()] = ba.second.GetPlotID();
-            LogPrintf("bind action, from:%u, to:%u\n", ba.first.GetPlotID(), ba.second.GetPlotID());
+            LogPrint(BCLog::RELATION, "bind action, from:%u, to:%u\n", ba.first.GetPlotID(), ba.second.GetPlotID());
         }
         relationKeyIDTip[ba.first] = ba.second;
-        // use a cache map--personalRelationsMap to record each person relations history
-        addRelationHistory(height, ba.first, ba.second);
-        LogPrintf("POC2+ bind action, from address : %u, to address : %u\n", EncodeDestination(ba.first), EncodeDestination(ba.second));
+        // record each person relations history on disk
+        addRelationHistory(batch, height, ba.first, ba.second);
+        LogPrint(BCLog::RELATION, "POC2+ bind action, from address : %u, to address : %u\n", EncodeDestination(ba.first), EncodeDestination(ba.second));
     } else if (action.type() == typeid(CUnbindAction)) {
         auto from = boost::get<CUnbindAction>(action);
         auto active = std::make_pair(txid,std::make_pair(from, CKeyID()));
         relations.push_back(active);
         if (! poc21){
-            LogPrintf("unbind action, from plotid:%u\n", from.GetPlotID());
+            LogPrint(BCLog::RELATION, "unbind action, from plotid:%u\n", from.GetPlotID());
             auto key = relationTip.find(from.GetPlotID());
             if(key!=relationTip.end()){
                 relationTip.erase(key);
             }
         }
-        LogPrintf("POC2+ unbind action, from address : %u\n", EncodeDestination(from));
+        LogPrint(BCLog::RELATION, "POC2+ unbind action, from address : %u\n", EncodeDestination(from));
         auto key = relationKeyIDTip.find(from);
         if(key!=relationKeyIDTip.end()){
             relationKeyIDTip.erase(key);
         }
-        // use a cache map--personalRelationsMap to record each person relations history
-        addRelationHistory(height, from, CKeyID());
+        // record each person relations history on disk
+        addRelationHistory(batch, height, from, CKeyID());
     }
     return WriteBatch(batch);
 }
 
-void CRelationView::ConnectBlock(const int height, const CBlock &blk, bool poc21){
+void CRelationView::ConnectBlock(const int height, const CBlock &blk, const std::vector<CAction>& actions, bool poc21){
+    assert(actions.size() == blk.vtx.size());
     std::vector<std::pair<uint256, CRelationActive>> relations;
     //accept action
-    for (auto tx: blk.vtx) {
-        std::vector<unsigned char> vchSig;
-        auto action = DecodeAction(tx, vchSig);
+    for (size_t i = 0; i < blk.vtx.size(); i++) {
+        const auto& action = actions[i];
         if (action.type() != typeid(CNilAction)) {
-            LogPrintf("DecodeAction not nil action: %s\n", tx->GetHash().GetHex());
-            auto out = tx->vin[0].prevout;
-            if (VerifyAction(out, action, vchSig)) {
-                if (!AcceptAction(height, tx->GetHash(), action, relations, poc21)) {
-                    LogPrintf("AcceptAction failure: %s\n", tx->GetHash().GetHex());
-                }
-            }
-            else {
-                LogPrintf("VerifyAction failure: %s\n", tx->GetHash().GetHex());
+            const auto& tx = blk.vtx[i];
+            LogPrint(BCLog::RELATION, "DecodeAction not nil action: %s\n", tx->GetHash().GetHex());
+            if (!AcceptAction(height, tx->GetHash(), action, relations, poc21)) {
+                LogPrintf("AcceptAction failure: %s\n", tx->GetHash().GetHex());
             }
         }
     }
@@ -229,44 +325,25 @@ bool CRelationView::WriteRelationsToDisk(const int height, const std::vector<std
     return Write(std::make_pair(DB_ACTIVE_ACTION_KEY, height), relations);
 }
 
-bool sort_first_decline(const CPersonalHeightRelation & m1, const CPersonalHeightRelation & m2) {
-    // decline sort for the height
-    return m1.first > m2.first;
-}
-
 bool CRelationView::removeRelationHistory(const int height, const CKeyID& from, bool poc21){
-    // remove relationsHistoryMap entry for prev relation
-    CPersonalRelationHistoryList& personalRelationList = relationsHistoryMap[from];
-    for (auto iter = personalRelationList.begin(); iter != personalRelationList.end(); ){
-        if (iter->first >= height){
-            iter = personalRelationList.erase(iter);
-        }else{
-            ++iter;
+    // remove the history entries of "from" at or above the height
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CRelationHistoryKey key;
+    for (pcursor->Seek(MakeHistoryKey(from, height)); pcursor->Valid(); pcursor->Next()) {
+        if (!pcursor->GetKey(key) || key.first != DB_RELATION_HISTORY || key.second.first != from) {
+            break;
         }
+        batch.Erase(key);
     }
-
-    if (personalRelationList.size() == 0){
-        // the last relation has been removed,
-        // so after clearing the RelationTip, we finish the work.
-        relationsHistoryMap.erase(from);
-        // clear the relation
-        if(!poc21){
-            relationTip.erase(from.GetPlotID());
-        }
-        relationKeyIDTip.erase(from);
-        return true;
+    if (!WriteBatch(batch, true)) {
+        return false;
     }
 
-    // Now, we deal with the relationTip.
-    // sort and find the first prev relation
-    CPersonalHeightRelationVec vec;
-    copy(personalRelationList.begin(), personalRelationList.end(), std::back_inserter<CPersonalHeightRelationVec>(vec));
-    sort(vec.begin(), vec.end(), sort_first_decline); 
-    auto is_first_prev = [height](const CPersonalHeightRelation& personHeightRelation)->bool{
-        return (height > personHeightRelation.first);
-    };
-    auto prevRelationIter = find_if(vec.begin(), vec.end(), is_first_prev);
-    if (prevRelationIter == vec.end()){
+    // Now, we deal with the relationTip: restore the first prev relation.
+    CKeyID to;
+    int bindHeight;
+    if (!GetRelationAt(from, height - 1, to, bindHeight) || to == CKeyID()) {
         // clear the relation
         if(!poc21){
             relationTip.erase(from.GetPlotID());
@@ -275,9 +352,9 @@ bool CRelationView::removeRelationHistory(const int height, const CKeyID& from,
     }else{
         // update the tip
         if(!poc21){
-            relationTip[from.GetPlotID()] = prevRelationIter->second.GetPlotID();
+            relationTip[from.GetPlotID()] = to.GetPlotID();
         }
-        relationKeyIDTip[from] = prevRelationIter->second;
+        relationKeyIDTip[from] = to;
     }
     return true;
 }
@@ -287,14 +364,18 @@ void CRelationView::DisconnectBlock(const int height, const CBlock &blk, bool po
     // erase disk
     LogPrint(BCLog::RELATION, "%s: height:%d, block:%s\n", __func__, height, blk.GetHash().ToString());
     auto key = std::make_pair(DB_ACTIVE_ACTION_KEY, height);
+    std::vector<std::pair<uint256, CRelationActive>> relations;
+    if (Exists(key) && !Read(key, relations)) {
+        LogPrint(BCLog::RELATION, "%s: Read retrun false, height:%d\n", __func__, height);
+    }
     Erase(key, true);
 
-    for(auto historyEntry : relationsHistoryMap){
-        auto iter = historyEntry.second.find(height);
-        if (iter != historyEntry.second.end()){
-            CKeyID from = historyEntry.first;
-            removeRelationHistory(height, from, poc21);
-        }
+    std::set<CKeyID> froms;
+    for (const auto& relation : relations) {
+        froms.insert(relation.second.first);
+    }
+    for (const auto& from : froms) {
+        removeRelationHistory(height, from, poc21);
     }
 }
 
@@ -307,38 +388,116 @@ bool CRelationView::LoadRelationFromDisk(const int height, bool poc21)
             LogPrint(BCLog::RELATION, "%s: Read retrun false, height:%d\n", __func__, height);
             return false;
         }
+        CDBBatch batch(*this);
         for (auto relation : relations) {
             if (relation.second.second != CKeyID()) {
                 auto from = relation.second.first;
                 auto to   = relation.second.second;
                 if (! poc21){
                     relationTip[from.GetPlotID()] = to.GetPlotID();
-                    LogPrintf("bind action, from:%u, to:%u\n", from.GetPlotID(), to.GetPlotID());
+                    LogPrint(BCLog::RELATION, "bind action, from:%u, to:%u\n", from.GetPlotID(), to.GetPlotID());
                 }
                 relationKeyIDTip[from] = to;
-                addRelationHistory(height, from, to);
-                LogPrintf("POC2+ bind action, from : %u, to : %u\n", EncodeDestination(from), EncodeDestination(to));
+                if (!fHistoryIndexed) {
+                    addRelationHistory(batch, height, from, to);
+                }
+                LogPrint(BCLog::RELATION, "POC2+ bind action, from : %u, to : %u\n", EncodeDestination(from), EncodeDestination(to));
             } else if (relation.second.second == CKeyID()) {
                 auto from = relation.second.first;
                 if (! poc21){
-                    LogPrintf("unbind action, from:%u\n", from.GetPlotID());
+                    LogPrint(BCLog::RELATION, "unbind action, from:%u\n", from.GetPlotID());
                     auto key = relationTip.find(from.GetPlotID());
                     if(key!=relationTip.end()){
                         relationTip.erase(key);
                     }
                 }
-                LogPrintf("POC2+ unbind action, from : %u\n", EncodeDestination(from));
+                LogPrint(BCLog::RELATION, "POC2+ unbind action, from : %u\n", EncodeDestination(from));
                 auto key = relationKeyIDTip.find(from);
                 if(key!=relationKeyIDTip.end()){
                     relationKeyIDTip.erase(key);
                 }
-                addRelationHistory(height, from, CKeyID());
+                if (!fHistoryIndexed) {
+                    addRelationHistory(batch, height, from, CKeyID());
+                }
+            }
+        }
+        if (!fHistoryIndexed && !WriteBatch(batch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CRelationView::LoadRelationTip(const int height, const int poc21Height)
+{
+    assert(fHistoryIndexed);
+    relationTip.clear();
+    relationKeyIDTip.clear();
+
+    // The entries of one KeyID are iterated in height order, the last one applied is its latest action.
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CRelationHistoryKey key;
+    for (pcursor->Seek(MakeHistoryKey(CKeyID(), 0)); pcursor->Valid(); pcursor->Next()) {
+        if (!pcursor->GetKey(key) || key.first != DB_RELATION_HISTORY) {
+            break;
+        }
+        const CKeyID& from = key.second.first;
+        const int actionHeight = key.second.second.height;
+        if (actionHeight > height) {
+            continue;
+        }
+        CKeyID to;
+        if (!pcursor->GetValue(to)) {
+            return error("%s: failed to read relation history of %s", __func__, from.ToString());
+        }
+        if (to.IsNull()) {
+            if (actionHeight < poc21Height) {
+                relationTip.erase(from.GetPlotID());
             }
+            relationKeyIDTip.erase(from);
+        } else {
+            if (actionHeight < poc21Height) {
+                relationTip[from.GetPlotID()] = to.GetPlotID();
+            }
+            relationKeyIDTip[from] = to;
         }
     }
+    LogPrint(BCLog::RELATION, "%s: %u relations at height %d\n", __func__, relationKeyIDTip.size(), height);
     return true;
 }
 
+bool CRelationView::MarkHistoryIndexed()
+{
+    if (fHistoryIndexed) {
+        return true;
+    }
+    if (!Write(DB_RELATION_HISTORY_INDEXED, true, true)) {
+        return false;
+    }
+    fHistoryIndexed = true;
+    return true;
+}
+
+bool CRelationView::IsChainStateRecord(const std::vector<unsigned char>& key)
+{
+    return key.empty() || key[0] != DB_RELATIONID;
+}
+
+bool CRelationView::CheckPlotRecord(const std::vector<unsigned char>& key, const std::vector<unsigned char>& value)
+{
+    try {
+        CDataStream ssKey(key, SER_DISK, CLIENT_VERSION);
+        CDataStream ssValue(value, SER_DISK, CLIENT_VERSION);
+        std::pair<char, uint64_t> plotKey;
+        CKeyID keyID;
+        ssKey >> plotKey;
+        ssValue >> keyID;
+        return plotKey.first == DB_RELATIONID && ssKey.empty() && ssValue.empty() && keyID.GetPlotID() == plotKey.second;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
 CRelationVector CRelationView::ListRelations() const
 {
     CRelationVector vch;
@@ -1,6 +1,7 @@
 #ifndef LAVA_ACTION_DB_H
 #define LAVA_ACTION_DB_H
 
+#include <confidential_validation.h>
 #include <dbwrapper.h>
 #include <pubkey.h>
 #include <script/standard.h>
@@ -58,14 +59,47 @@ bool SignAction(const COutPoint& out, const CAction &action, const CKey& key, st
 
 bool VerifyAction(const COutPoint& out, const CAction& action, std::vector<unsigned char>& vchSig);
 
-CAction DecodeAction(const CTransactionRef& tx, std::vector<unsigned char>& vchSig);
+/**
+ * Decode the action carried by the transaction.
+ * @param[in]    fee     the fee paid by the transaction, an action has to pay exactly nActionFee.
+ * @param[out]   vchSig  the signature of the action.
+ */
+CAction DecodeAction(const CTransactionRef& tx, const CAmount fee, std::vector<unsigned char>& vchSig);
+
+/** Initializes the cache of verified actions. */
+void InitActionCache();
+
+/**
+ * Decode the action of the transaction and verify its signature, consulting
+ * the cache of actions already verified at mempool acceptance.
+ * @param[in]    fee     the fee paid by the transaction.
+ * @param[in]    store   whether to add a verified action to the cache (mempool
+ *                       acceptance) rather than consume its cache entry (block connection).
+ * @return       the action, or CNilAction if there is none or its signature is invalid.
+ */
+CAction CheckAction(const CTransactionRef& tx, const CAmount fee, bool store);
+
+/**
+ * Closure decoding and verifying the action of one block transaction on the
+ * script check threads. The result is written to the given slot, an invalid
+ * action does not make the block invalid, so this check never fails.
+ */
+class CActionCheck : public CCheck
+{
+private:
+    CTransactionRef tx;
+    CAmount fee;
+    CAction* actionOut;
+
+public:
+    CActionCheck(const CTransactionRef& txIn, const CAmount feeIn, CAction* actionOutIn) : tx(txIn), fee(feeIn), actionOut(actionOutIn) {}
+
+    bool operator()() override;
+};
 
 typedef std::pair<CKeyID, CKeyID> CRelation;
 typedef std::vector<CRelation> CRelationVector;
-typedef std::pair<int32_t, CKeyID> CPersonalHeightRelation;
-typedef std::vector<CPersonalHeightRelation> CPersonalHeightRelationVec;
 typedef std::map<int32_t, CKeyID> CPersonalRelationHistoryList;
-typedef std::map<CKeyID, CPersonalRelationHistoryList> CRelationsHistoryMap;
 typedef std::map<uint64_t,uint64_t> RelationMap;
 typedef std::map<CKeyID,CKeyID> RelationKeyIDMap;
 typedef std::pair<CKeyID, CKeyID> CRelationActive;
@@ -87,7 +121,22 @@ public:
      */
     CKeyID To(const uint160& from, uint64_t plotid, bool poc21) const;
 
-    void addRelationHistory(const int height, const CKeyID& from, const CKeyID& to);
+    /**
+     * Find the relation of "from" at a given height.
+     * @param[in]    from        the KeyID whose relation we want to get.
+     * @param[in]    height      the block height of the query.
+     * @param[out]   to          the target KeyID, null if "from" was unbound at that height.
+     * @param[out]   bindHeight  the height of the action which set the relation.
+     * @return       true if "from" has any action at or below the height.
+     */
+    bool GetRelationAt(const CKeyID& from, const int height, CKeyID& to, int& bindHeight);
+
+    /**
+     * Show every bind and unbind action of "from", by height. Unbind actions map to a null KeyID.
+     */
+    CPersonalRelationHistoryList GetRelationHistory(const CKeyID& from);
+
+    void addRelationHistory(CDBBatch& batch, const int height, const CKeyID& from, const CKeyID& to);
     bool removeRelationHistory(const int height, const CKeyID& from, bool poc21);
 
     /** 
@@ -105,8 +154,9 @@ public:
      * @param[in]    height  the block height, at which the connecttip function calls.
      * @param[in]    poc21   wether poc2+ is actived.
      * @param[out]   blk     the block.
+     * @param[in]    actions the verified action of each transaction of the block, see CheckAction.
      */
-    void ConnectBlock(const int height, const CBlock &blk, bool poc21);
+    void ConnectBlock(const int height, const CBlock &blk, const std::vector<CAction>& actions, bool poc21);
 
     void DisconnectBlock(const int height, const CBlock &blk, bool poc21);
     
@@ -123,6 +173,34 @@ public:
      */
     bool LoadRelationFromDisk(const int height, bool poc21);
 
+    /**
+     * Init the relation tip set from the per-KeyID history, without reading
+     * the actions of every height. Requires IsHistoryIndexed().
+     * @param[in]   height       the height of the chain tip, later history entries are ignored.
+     * @param[in]   poc21Height  the first height at which poc2+ is active.
+     * @return      true if loaded.
+     */
+    bool LoadRelationTip(const int height, const int poc21Height);
+
+    /** Whether the per-KeyID history entries on disk are complete. */
+    bool IsHistoryIndexed() const { return fHistoryIndexed; }
+
+    /**
+     * Called once all heights are loaded. Databases written before the history
+     * was kept on disk get their history entries during that first load.
+     */
+    bool MarkHistoryIndexed();
+
+    /**
+     * Whether a raw record of the database is part of the state that the blocks
+     * determine. The plot id records are a lookup table which disconnected
+     * blocks leave behind, they are checked with CheckPlotRecord instead.
+     */
+    static bool IsChainStateRecord(const std::vector<unsigned char>& key);
+
+    /** Whether a raw record that is not IsChainStateRecord maps a plot id to a KeyID of that plot. */
+    static bool CheckPlotRecord(const std::vector<unsigned char>& key, const std::vector<unsigned char>& value);
+
     /** 
     * An api call by wallet,
     * This api will show all the relation from the cache.
@@ -135,7 +213,8 @@ private:
     /** Relation KEYID tip set which is for POC21.*/
     RelationKeyIDMap relationKeyIDTip;
 
-    CRelationsHistoryMap relationsHistoryMap;
+    /** Whether the per-KeyID history entries on disk are complete.*/
+    bool fHistoryIndexed;
 };
 
 #endif
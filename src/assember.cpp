@@ -1,5 +1,6 @@
 #include <assember.h>
 #include <chainparams.h>
+#include <forgingstats.h>
 #include <logging.h>
 #include <miner.h>
 #include <poc.h>
@@ -22,37 +23,41 @@ bool CPOCBlockAssember::UpdateDeadline(const int height, const CKeyID& keyid, co
 {
     auto prevIndex = chainActive.Tip();
     if (prevIndex->nHeight != (height - 1)) {
-        LogPrintf("chainActive has been update, the new index is %uul, but the height to be produced is %uul\n", prevIndex->nHeight, height);
+        LogPrint(BCLog::POC, "chainActive has been update, the new index is %uul, but the height to be produced is %uul\n", prevIndex->nHeight, height);
         return false;
     }
     auto params = Params();
     if (deadline / prevIndex->nBaseTarget > params.TargetDeadline()) {
-        LogPrintf("Invalid deadline %ull\n", deadline);
+        LogPrint(BCLog::POC, "Invalid deadline %ull\n", deadline);
         return false;
     }
 
     if (this->deadline != 0 && deadline >= this->deadline) {
-        LogPrintf("Invalid deadline %ull\n", deadline);
+        LogPrint(BCLog::POC, "Invalid deadline %ull\n", deadline);
         return false;
     }
 
     auto plotID = keyid.GetPlotID();
+    const int64_t nTimeVerify = GetForgingTimeMicros();
     uint256 generationSignature;
+    uint64_t nCalcDeadline;
     if (height >= Params().GetConsensus().LVIP05Height){
         generationSignature = CalcGenerationSignature(prevIndex->genSign, prevIndex->nPublicKeyID);
-        if (CalcDeadline(generationSignature, height, uint160(keyid), nonce) != deadline) {
-            LogPrintf("POC2.x Deadline inconformity %uul\n", deadline);
-            return false;
-        }
+        nCalcDeadline = CalcDeadline(generationSignature, height, uint160(keyid), nonce);
     }else{
         generationSignature = CalcGenerationSignaturePoc2(prevIndex->genSign, prevIndex->nPlotID);
-        if (CalcDeadlinePoc2(generationSignature, height, plotID, nonce) != deadline) {
-            LogPrintf("POC2 Deadline inconformity %uul\n", deadline);
-            return false;
-        }
+        nCalcDeadline = CalcDeadlinePoc2(generationSignature, height, plotID, nonce);
+    }
+    // Rejected nonces cost the same verification, they are recorded as well
+    const int64_t nVerifyTime = GetForgingTimeMicros() - nTimeVerify;
+    g_forging_stats.Record(ForgingStage::NONCE_VERIFY, nVerifyTime);
+    LogPrint(BCLog::BENCH, "UpdateDeadline: nonce %u verified in %.2fms\n", nonce, 0.001 * nVerifyTime);
+    if (nCalcDeadline != deadline) {
+        LogPrint(BCLog::POC, "%s Deadline inconformity %uul\n", height >= Params().GetConsensus().LVIP05Height ? "POC2.x" : "POC2", deadline);
+        return false;
     }
     auto ts = (deadline / prevIndex->nBaseTarget);
-    LogPrintf("Update new deadline: %u, now: %u, target: %u\n", ts, GetTimeMillis() / 1000, prevIndex->nTime + ts);
+    LogPrint(BCLog::POC, "Update new deadline: %u, now: %u, target: %u\n", ts, GetTimeMillis() / 1000, prevIndex->nTime + ts);
 
     {
         boost::lock_guard<boost::mutex> lock(mtx);
@@ -69,7 +74,7 @@ bool CPOCBlockAssember::UpdateDeadline(const int height, const CKeyID& keyid, co
     return true;
 }
 
-void CPOCBlockAssember::CreateNewBlock()
+void CPOCBlockAssember::CreateNewBlock(int64_t nTimeMatured)
 {
     int height{ 0 };
     CKeyID from;
@@ -136,14 +141,25 @@ void CPOCBlockAssember::CreateNewBlock()
    
 CREATE_WITH_COLDFS:
     auto scriptPubKeyIn = GetScriptForDestination(CTxDestination(target));
-    auto blk = BlockAssembler(params).CreateNewBlock(scriptPubKeyIn, nonce, from, plotid, deadline, fstx);
+    const int64_t nTimeCreate = GetForgingTimeMicros();
+    BlockAssembler assembler(params);
+    auto blk = assembler.CreateNewBlock(scriptPubKeyIn, nonce, from, plotid, deadline, fstx);
     if (blk) {
+        // getblocktemplate and the test miners create blocks too, only forged ones are recorded
+        g_forging_stats.Record(ForgingStage::CREATE_BLOCK, GetForgingTimeMicros() - nTimeCreate);
+        g_forging_stats.Record(ForgingStage::TEST_VALIDITY, assembler.m_last_validity_micros);
         uint32_t extraNonce = 0;
         IncrementExtraNonce(&blk->block, chainActive.Tip(), extraNonce);
         auto pblk = std::make_shared<CBlock>(blk->block);
+        const int64_t nTimeProcess = GetForgingTimeMicros();
+        g_forging_stats.BlockForged(pblk->GetHash(), nTimeMatured);
         if (ProcessNewBlock(params, pblk, true, NULL) == false) {
             LogPrintf("ProcessNewBlock failed\n");
         }
+        const int64_t nTimeDone = GetForgingTimeMicros();
+        g_forging_stats.Record(ForgingStage::PROCESS_BLOCK, nTimeDone - nTimeProcess);
+        LogPrint(BCLog::BENCH, "Forged block %s at height %d: create %.2fms, process %.2fms (%.2fms after its deadline)\n", pblk->GetHash().ToString(), height,
+            0.001 * (nTimeProcess - nTimeCreate), 0.001 * (nTimeDone - nTimeProcess), 0.001 * (nTimeDone - nTimeMatured));
     } else {
         LogPrintf("CreateNewBlock failed\n");
     }
@@ -153,8 +169,14 @@ void CPOCBlockAssember::CheckDeadline()
 {
     if (dl == 0)
         return;
-    if (GetAdjustedTime() >= dl) {
-        CreateNewBlock();
+    // The deadline is in adjusted seconds, the poll delay is carried over to the monotonic clock
+    const int64_t nNow = GetForgingTimeMicros();
+    const int64_t nAdjustedNow = GetTimeMicros() + GetTimeOffset() * 1000000;
+    if (nAdjustedNow >= (int64_t)dl * 1000000) {
+        const int64_t nPollDelay = nAdjustedNow - (int64_t)dl * 1000000;
+        g_forging_stats.Record(ForgingStage::DEADLINE_POLL, nPollDelay);
+        LogPrint(BCLog::BENCH, "CheckDeadline: deadline %u polled %.2fms after maturity\n", dl, 0.001 * nPollDelay);
+        CreateNewBlock(nNow - nPollDelay);
         SetNull();
     }
 }
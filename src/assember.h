@@ -15,7 +15,8 @@ public:
 
     bool UpdateDeadline(const int height, const CKeyID& keyid, const uint64_t nonce, const uint64_t deadline, const CKey& key);
 
-    void CreateNewBlock();
+    /** Forge a block with the best deadline, which matured at nTimeMatured on the forging clock. */
+    void CreateNewBlock(int64_t nTimeMatured);
 
     void SetNull();
 
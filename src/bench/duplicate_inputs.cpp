@@ -32,6 +32,7 @@ static void DuplicateInputs(benchmark::State& state)
     SelectParams(CBaseChainParams::REGTEST);
 
     InitScriptExecutionCache();
+    InitActionCache();
 
     boost::thread_group thread_group;
     CScheduler scheduler;
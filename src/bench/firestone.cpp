@@ -0,0 +1,332 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <actiondb.h>
+#include <chainparams.h>
+#include <fspool.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <script/standard.h>
+#include <ticket.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <memory>
+#include <vector>
+
+/** Shape of the synthetic chains the firestone views are benchmarked on. */
+struct FirestoneChainConfig
+{
+    int slots;
+    int ticketsPerSlot;
+    /** Bind and unbind actions, one in four unbinding. */
+    int actionsPerSlot;
+    /** Fstx spending a firestone of the previous slot. */
+    int fstxPerSlot;
+    /** Addresses buying firestones and binding. */
+    int keys;
+};
+
+static const FirestoneChainConfig FIRESTONE_CHAIN{16, 256, 64, 32, 512};
+/** More firestones than a slot has blocks, every slot raising the price. */
+static const FirestoneChainConfig FIRESTONE_CHAIN_DENSE{16, 1024, 256, 128, 2048};
+
+static const CAmount FIRESTONE_PRICE = 3000 * COIN;
+
+namespace {
+
+/** Blocks of a regtest chain with firestones, actions and fstx spread over its slots. */
+struct FirestoneChain
+{
+    int slotLength;
+    std::vector<CKeyID> keys;
+    std::vector<CBlock> blocks;
+    /** The action of every transaction of every block, CNilAction if it has none. */
+    std::vector<std::vector<CAction>> actions;
+    std::vector<std::vector<CTransactionRef>> fstx;
+
+    explicit FirestoneChain(const FirestoneChainConfig& config);
+
+    int Height() const { return blocks.size() - 1; }
+};
+
+CMutableTransaction MakeDummyTx(FastRandomContext& rng)
+{
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(rng.rand256(), 0));
+    tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    return tx;
+}
+
+CTransactionRef MakeTicketTx(FastRandomContext& rng, const CKeyID& keyID, int lockHeight)
+{
+    const CScript redeemScript = GenerateTicketScript(keyID, lockHeight);
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(rng.rand256(), 0));
+    tx.vout.emplace_back(FIRESTONE_PRICE, GetScriptForDestination(CScriptID(redeemScript)));
+    tx.vout.emplace_back(0, CScript() << OP_RETURN << CTicket::VERSION << ToByteVector(redeemScript));
+    return MakeTransactionRef(std::move(tx));
+}
+
+FirestoneChain::FirestoneChain(const FirestoneChainConfig& config)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    slotLength = Params().SlotLength();
+
+    FastRandomContext rng(true);
+    for (int i = 0; i < config.keys; i++) {
+        const std::vector<unsigned char> id = rng.randbytes(20);
+        keys.emplace_back(uint160(id));
+    }
+
+    std::vector<CKeyID> bound;
+    const int height = config.slots * slotLength;
+    blocks.resize(height);
+    actions.resize(height);
+    fstx.resize(config.slots);
+    for (int h = 0; h < height; h++) {
+        const int slot = h / slotLength;
+        const int slotHeight = h % slotLength;
+        CBlock& block = blocks[h];
+        CMutableTransaction coinbase;
+        coinbase.vin.emplace_back(COutPoint());
+        coinbase.vin[0].scriptSig = CScript() << h << OP_0;
+        coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+        block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+
+        // Spread the firestones and actions of a slot evenly over its blocks
+        const int tickets = (slotHeight + 1) * config.ticketsPerSlot / slotLength - slotHeight * config.ticketsPerSlot / slotLength;
+        for (int i = 0; i < tickets; i++) {
+            block.vtx.push_back(MakeTicketTx(rng, keys[rng.randrange(keys.size())], (slot + 1) * slotLength - 1));
+        }
+        actions[h].resize(block.vtx.size(), CAction(CNilAction{}));
+
+        const int nActions = (slotHeight + 1) * config.actionsPerSlot / slotLength - slotHeight * config.actionsPerSlot / slotLength;
+        for (int i = 0; i < nActions; i++) {
+            block.vtx.push_back(MakeTransactionRef(MakeDummyTx(rng)));
+            if (!bound.empty() && rng.randrange(4) == 0) {
+                const size_t index = rng.randrange(bound.size());
+                actions[h].push_back(CAction(CUnbindAction(bound[index])));
+                bound.erase(bound.begin() + index);
+            } else {
+                const CKeyID& from = keys[rng.randrange(keys.size())];
+                actions[h].push_back(MakeBindAction(from, keys[rng.randrange(keys.size())]));
+                bound.push_back(from);
+            }
+        }
+    }
+
+    // The fstx of a slot spend firestones bought in the previous one
+    for (int slot = 1; slot < config.slots; slot++) {
+        std::vector<COutPoint> tickets;
+        for (int h = (slot - 1) * slotLength; h < slot * slotLength; h++) {
+            for (const auto& tx : blocks[h].vtx) {
+                if (tx->IsTicketTx()) tickets.emplace_back(tx->GetHash(), 0);
+            }
+        }
+        const size_t count = std::min<size_t>(config.fstxPerSlot, tickets.size());
+        for (size_t i = 0; i < count; i++) {
+            CMutableTransaction tx;
+            tx.vin.emplace_back(tickets[i * tickets.size() / count]);
+            tx.vout.emplace_back(FIRESTONE_PRICE, CScript() << OP_TRUE);
+            fstx[slot].push_back(MakeTransactionRef(std::move(tx)));
+        }
+    }
+}
+
+bool AcceptTicket(const int height, const CTicketRef& ticket)
+{
+    return true;
+}
+
+std::unique_ptr<CTicketView> ConnectTickets(const FirestoneChain& chain)
+{
+    std::unique_ptr<CTicketView> view(new CTicketView(0, true));
+    for (int h = 0; h <= chain.Height(); h++) {
+        view->ConnectBlock(h, chain.blocks[h], AcceptTicket);
+    }
+    return view;
+}
+
+std::unique_ptr<CRelationView> ConnectRelations(const FirestoneChain& chain, bool poc21)
+{
+    std::unique_ptr<CRelationView> view(new CRelationView(0, true));
+    for (int h = 0; h <= chain.Height(); h++) {
+        view->ConnectBlock(h, chain.blocks[h], chain.actions[h], poc21);
+    }
+    view->MarkHistoryIndexed();
+    return view;
+}
+
+std::unique_ptr<CFSPool> WriteFSPool(const FirestoneChain& chain)
+{
+    std::unique_ptr<CFSPool> pool(new CFSPool(0, true));
+    for (size_t slot = 0; slot < chain.fstx.size(); slot++) {
+        for (const auto& tx : chain.fstx[slot]) {
+            pool->WriteFstx(*tx, slot, tx->GetHash());
+        }
+    }
+    return pool;
+}
+
+} // namespace
+
+static void FirestoneTicketConnectBlock(benchmark::State& state, const FirestoneChainConfig& config)
+{
+    const FirestoneChain chain(config);
+    while (state.KeepRunning()) {
+        ConnectTickets(chain);
+    }
+}
+
+// Disconnecting reloads the firestones of every height below the tip
+static void FirestoneTicketDisconnectBlock(benchmark::State& state)
+{
+    const FirestoneChain chain(FIRESTONE_CHAIN);
+    std::unique_ptr<CTicketView> view = ConnectTickets(chain);
+    const int tip = chain.Height();
+    while (state.KeepRunning()) {
+        view->DisconnectBlock(tip, chain.blocks[tip]);
+        view->ConnectBlock(tip, chain.blocks[tip], AcceptTicket);
+    }
+}
+
+// LoadTicketView replay: disconnecting the empty block above the tip reloads the whole chain
+static void FirestoneLoadTicketView(benchmark::State& state, const FirestoneChainConfig& config)
+{
+    const FirestoneChain chain(config);
+    std::unique_ptr<CTicketView> view = ConnectTickets(chain);
+    const CBlock empty;
+    while (state.KeepRunning()) {
+        view->DisconnectBlock(chain.Height() + 1, empty);
+    }
+    assert(view->SlotIndex() == config.slots - 1);
+}
+
+static void FirestoneTicketPriceInSlot(benchmark::State& state)
+{
+    const FirestoneChain chain(FIRESTONE_CHAIN_DENSE);
+    std::unique_ptr<CTicketView> view = ConnectTickets(chain);
+    while (state.KeepRunning()) {
+        for (int slot = 0; slot <= view->SlotIndex(); slot++) {
+            view->TicketPriceInSlot(slot);
+        }
+    }
+}
+
+static void FirestoneFindeTickets(benchmark::State& state)
+{
+    const FirestoneChain chain(FIRESTONE_CHAIN);
+    std::unique_ptr<CTicketView> view = ConnectTickets(chain);
+    size_t found = 0;
+    while (state.KeepRunning()) {
+        for (const CKeyID& key : chain.keys) {
+            found += view->FindeTickets(key).size();
+        }
+    }
+    assert(found > 0);
+}
+
+static void FirestoneRelationConnectBlock(benchmark::State& state)
+{
+    const FirestoneChain chain(FIRESTONE_CHAIN_DENSE);
+    while (state.KeepRunning()) {
+        ConnectRelations(chain, true);
+    }
+}
+
+static void FirestoneRelationDisconnectBlock(benchmark::State& state)
+{
+    const FirestoneChain chain(FIRESTONE_CHAIN_DENSE);
+    std::unique_ptr<CRelationView> view = ConnectRelations(chain, true);
+    const int tip = chain.Height();
+    while (state.KeepRunning()) {
+        view->DisconnectBlock(tip, chain.blocks[tip], true);
+        view->ConnectBlock(tip, chain.blocks[tip], chain.actions[tip], true);
+    }
+}
+
+static void FirestoneLoadRelationView(benchmark::State& state)
+{
+    const FirestoneChain chain(FIRESTONE_CHAIN_DENSE);
+    std::unique_ptr<CRelationView> view = ConnectRelations(chain, true);
+    while (state.KeepRunning()) {
+        for (int h = 0; h <= chain.Height(); h++) {
+            view->LoadRelationFromDisk(h, true);
+        }
+    }
+}
+
+static void FirestoneRelationTo(benchmark::State& state, bool poc21)
+{
+    // Connected as before POC2+, so that both the KeyID and the plot ID relations are kept
+    const FirestoneChain chain(FIRESTONE_CHAIN_DENSE);
+    std::unique_ptr<CRelationView> view = ConnectRelations(chain, false);
+    size_t bound = 0;
+    while (state.KeepRunning()) {
+        for (const CKeyID& key : chain.keys) {
+            bound += !view->To(key, key.GetPlotID(), poc21).IsNull();
+        }
+    }
+    assert(bound > 0);
+}
+
+// The fstx lookup of CPOCBlockAssember::CreateNewBlock, for every slot
+static void FirestoneFSPoolLookup(benchmark::State& state)
+{
+    const FirestoneChain chain(FIRESTONE_CHAIN_DENSE);
+    std::unique_ptr<CTicketView> view = ConnectTickets(chain);
+    std::unique_ptr<CFSPool> pool = WriteFSPool(chain);
+    size_t found = 0;
+    while (state.KeepRunning()) {
+        for (int slot = 1; slot <= view->SlotIndex(); slot++) {
+            const std::vector<CTicketRef> tickets = view->GetTicketsBySlotIndex(slot - 1);
+            for (const auto& fstx : pool->GetFstxBySlotIndex(slot)) {
+                for (const auto& ticket : tickets) {
+                    if (fstx->vin[0].prevout.hash == ticket->out->hash) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    assert(found > 0);
+}
+
+static void FirestoneFSPoolRead(benchmark::State& state)
+{
+    const FirestoneChain chain(FIRESTONE_CHAIN_DENSE);
+    std::unique_ptr<CFSPool> pool = WriteFSPool(chain);
+    while (state.KeepRunning()) {
+        for (size_t slot = 0; slot < chain.fstx.size(); slot++) {
+            std::vector<CTransaction> txs;
+            pool->ReadFreshFstx(txs, slot);
+            assert(txs.size() == chain.fstx[slot].size());
+        }
+    }
+}
+
+static void FirestoneTicketConnectBlockSparse(benchmark::State& state) { FirestoneTicketConnectBlock(state, FIRESTONE_CHAIN); }
+static void FirestoneTicketConnectBlockDense(benchmark::State& state) { FirestoneTicketConnectBlock(state, FIRESTONE_CHAIN_DENSE); }
+static void FirestoneLoadTicketViewSparse(benchmark::State& state) { FirestoneLoadTicketView(state, FIRESTONE_CHAIN); }
+static void FirestoneLoadTicketViewDense(benchmark::State& state) { FirestoneLoadTicketView(state, FIRESTONE_CHAIN_DENSE); }
+static void FirestoneRelationToPoc2(benchmark::State& state) { FirestoneRelationTo(state, false); }
+static void FirestoneRelationToPoc21(benchmark::State& state) { FirestoneRelationTo(state, true); }
+
+BENCHMARK(FirestoneTicketConnectBlockSparse, 5);
+BENCHMARK(FirestoneTicketConnectBlockDense, 2);
+BENCHMARK(FirestoneTicketDisconnectBlock, 10);
+BENCHMARK(FirestoneLoadTicketViewSparse, 10);
+BENCHMARK(FirestoneLoadTicketViewDense, 5);
+BENCHMARK(FirestoneTicketPriceInSlot, 50000);
+BENCHMARK(FirestoneFindeTickets, 1000);
+BENCHMARK(FirestoneRelationConnectBlock, 10);
+BENCHMARK(FirestoneRelationDisconnectBlock, 1000);
+BENCHMARK(FirestoneLoadRelationView, 10);
+BENCHMARK(FirestoneRelationToPoc2, 50);
+BENCHMARK(FirestoneRelationToPoc21, 1000);
+BENCHMARK(FirestoneFSPoolLookup, 100);
+BENCHMARK(FirestoneFSPoolRead, 100);
@@ -5,9 +5,12 @@
 #include <blockfilter.h>
 #include <crypto/siphash.h>
 #include <hash.h>
+#include <issuance.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/standard.h>
 #include <streams.h>
+#include <ticket.h>
 
 /// SerType used to serialize parameters in GCS filter encoding.
 static constexpr int GCS_SER_TYPE = SER_NETWORK;
@@ -208,6 +211,35 @@ static GCSFilter::ElementSet BasicFilterElements(const CBlock& block,
             if (script.empty() || script[0] == OP_RETURN) continue;
             elements.emplace(script.begin(), script.end());
         }
+
+        // The owner of a firestone only appears in the redeem script carried
+        // by the ticket's OP_RETURN output, so add the owner's P2PKH script.
+        if (tx->IsTicketTx()) {
+            CTicketRef ticket = tx->Ticket();
+            if (ticket && !ticket->KeyID().IsNull()) {
+                const CScript owner_script = GetScriptForDestination(ticket->KeyID());
+                elements.emplace(owner_script.begin(), owner_script.end());
+            }
+        }
+
+        // Issued assets and their reissuance tokens, so light clients can
+        // follow the issuance history of an asset.
+        for (const CTxIn& txin : tx->vin) {
+            const CAssetIssuance& issuance = txin.assetIssuance;
+            if (issuance.IsNull()) continue;
+            CAsset asset;
+            if (issuance.assetBlindingNonce.IsNull()) {
+                uint256 entropy;
+                CAsset token;
+                GenerateAssetEntropy(entropy, txin.prevout, issuance.assetEntropy);
+                CalculateAsset(asset, entropy);
+                CalculateReissuanceToken(token, entropy, issuance.nAmount.IsCommitment());
+                elements.emplace(token.begin(), token.end());
+            } else {
+                CalculateAsset(asset, issuance.assetEntropy);
+            }
+            elements.emplace(asset.begin(), asset.end());
+        }
     }
 
     for (const CTxUndo& tx_undo : block_undo.vtxundo) {
@@ -242,6 +274,25 @@ BlockFilter::BlockFilter(BlockFilterType filter_type, const CBlock& block, const
     m_filter = GCSFilter(params, BasicFilterElements(block, block_undo));
 }
 
+const std::string& BlockFilterTypeName(BlockFilterType filter_type)
+{
+    static const std::string basic = "basic";
+    static const std::string unknown;
+    switch (filter_type) {
+    case BlockFilterType::BASIC: return basic;
+    }
+    return unknown;
+}
+
+bool BlockFilterTypeByName(const std::string& name, BlockFilterType& filter_type)
+{
+    if (name == BlockFilterTypeName(BlockFilterType::BASIC)) {
+        filter_type = BlockFilterType::BASIC;
+        return true;
+    }
+    return false;
+}
+
 bool BlockFilter::BuildParams(GCSFilter::Params& params) const
 {
     switch (m_filter_type) {
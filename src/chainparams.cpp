@@ -7,12 +7,14 @@
 
 #include <chainparamsseeds.h>
 #include <consensus/merkle.h>
+#include <poc.h>
 #include <tinyformat.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <versionbitsinfo.h>
 
 #include <assert.h>
+#include <limits>
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -69,6 +71,8 @@ public:
         consensus.BIP65Height = 0; // 000000000000000004c2b624ed5d7756c508d90fd0da2c7c679febfa6c4735f0
         consensus.BIP66Height = 0; // 00000000000000000379eaa19dce8c9b722d46ae6a57c2f1a988119488b50931
         consensus.LVIP05Height = 67584;
+        consensus.ConfidentialAmountsHeight = std::numeric_limits<int>::max(); // Not scheduled yet
+        consensus.nMaxBaseTarget = MAX_BASE_TARGET;
         consensus.powLimit = uint256S("00000000ffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
         consensus.nPowTargetTimespan = 14 * 24 * 60 * 60; // two weeks
         consensus.nPowTargetSpacing = 4 * 60;
@@ -205,6 +209,8 @@ public:
         consensus.BIP65Height = 0; // 00000000007f6655f22f98e72ed80d8b06dc761d5da09df0fa1dc4be4f861eb6
         consensus.BIP66Height = 0; // 000000002104c8c45e99a8853285a3b592602a3ccde2b832481da85e9e4ba182
         consensus.LVIP05Height = 13115;
+        consensus.ConfidentialAmountsHeight = std::numeric_limits<int>::max(); // Not scheduled yet
+        consensus.nMaxBaseTarget = MAX_BASE_TARGET;
         consensus.powLimit = uint256S("00000000ffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
         consensus.nPowTargetTimespan = 14 * 24 * 60 * 60; // two weeks
         consensus.nPowTargetSpacing = 10 * 60;
@@ -311,6 +317,11 @@ public:
         consensus.BIP34Hash = uint256();
         consensus.BIP65Height = 1351; // BIP65 activated on regtest (Used in functional tests)
         consensus.BIP66Height = 1251; // BIP66 activated on regtest (Used in functional tests)
+        consensus.LVIP05Height = 0;
+        consensus.ConfidentialAmountsHeight = 0; // Overridden by -confidentialamountsheight (Used in functional tests)
+        // A single plotted nonce forges at about the 4 minute target spacing, so that
+        // the in-memory plots of generatepoc can forge regtest chains.
+        consensus.nMaxBaseTarget = std::numeric_limits<uint64_t>::max() / (2 * 240);
         consensus.powLimit = uint256S("7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
         consensus.nPowTargetTimespan = 14 * 24 * 60 * 60; // two weeks
         consensus.nPowTargetSpacing = 10 * 60;
@@ -350,6 +361,7 @@ public:
         m_assumed_blockchain_size = 0;
         m_assumed_chain_state_size = 0;
 
+        UpdateActivationParametersFromArgs(args);
         UpdateVersionBitsParametersFromArgs(args);
 
         std::vector<unsigned char> scriptData(ParseHex("76a9141171f22512e85af9f6adbe69b562d32619693df888ac"));
@@ -405,8 +417,21 @@ public:
         consensus.vDeployments[d].nTimeout = nTimeout;
     }
     void UpdateVersionBitsParametersFromArgs(const ArgsManager& args);
+    void UpdateActivationParametersFromArgs(const ArgsManager& args);
 };
 
+void CRegTestParams::UpdateActivationParametersFromArgs(const ArgsManager& args)
+{
+    if (!args.IsArgSet("-confidentialamountsheight")) return;
+
+    const int64_t height = args.GetArg("-confidentialamountsheight", consensus.ConfidentialAmountsHeight);
+    if (height < 0 || height > std::numeric_limits<int>::max()) {
+        throw std::runtime_error(strprintf("Activation height %ld for the confidential amount checks is out of valid range.", height));
+    }
+    consensus.ConfidentialAmountsHeight = static_cast<int>(height);
+    LogPrintf("Setting the activation height of the confidential amount checks to %d\n", consensus.ConfidentialAmountsHeight);
+}
+
 void CRegTestParams::UpdateVersionBitsParametersFromArgs(const ArgsManager& args)
 {
     if (!args.IsArgSet("-vbparams")) return;
@@ -5,9 +5,13 @@
 #ifndef BITCOIN_CHECKQUEUE_H
 #define BITCOIN_CHECKQUEUE_H
 
+#include <logging.h>
 #include <sync.h>
+#include <util/time.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -16,6 +20,9 @@
 template <typename T>
 class CCheckQueueControl;
 
+/** Number of per-thread queues of a CCheckQueue, threads beyond that share them. */
+static const unsigned int MAX_CHECKQUEUE_SLOTS = 64;
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -25,12 +32,36 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every thread has its own queue, which the master spreads the checks over.
+  * A thread takes its batches from the back of its own queue, and once it is
+  * empty steals half of another one from the front. The queue locks are only
+  * contended when a thread steals; the shared mutex is only taken to sleep
+  * and to wake threads up.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    struct Slot
+    {
+        boost::mutex mutex;
+        std::deque<T> checks;
+        //! Statistics of the current round, read by the master in Wait
+        std::atomic<unsigned int> nChecked{0};
+        std::atomic<int64_t> nBusyTime{0};
+    };
+
+    //! Name used in the statistics
+    const char* const strName;
+
+    //! Per-thread queues, slot 0 belongs to the master
+    Slot slots[MAX_CHECKQUEUE_SLOTS];
+
+    //! The number of slots threads have been given
+    std::atomic<unsigned int> nSlots{1};
+
+    //! Mutex to sleep on, and to protect nWorkers
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,96 +70,150 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
-
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The number of worker threads that were started.
+    unsigned int nWorkers{0};
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk{true};
+
+    //! Number of verifications in the queues of the threads, updated with them under their locks.
+    std::atomic<unsigned int> nQueued{0};
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo{0};
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! Slot the next Add starts spreading the checks from
+    unsigned int nNextSlot{0};
+
+    //! Statistics of the current round, which starts with its first Add
+    int64_t nRoundStart{0};
+    std::atomic<unsigned int> nSteals{0};
+    std::atomic<unsigned int> nStolen{0};
+
+    /** Move up to nMax checks from the back (own queue) or the front (stolen) of slot into vChecks. */
+    void Take(Slot& slot, std::vector<T>& vChecks, unsigned int nMax, bool fSteal)
+    {
+        boost::unique_lock<boost::mutex> lock(slot.mutex);
+        const unsigned int nNow = std::min<size_t>(nMax, fSteal ? (slot.checks.size() + 1) / 2 : slot.checks.size());
+        if (nNow == 0) return;
+        nQueued.fetch_sub(nNow);
+        vChecks.resize(nNow);
+        for (unsigned int i = 0; i < nNow; i++) {
+            // Swap instead of copying to keep the lock short
+            if (fSteal) {
+                vChecks[i].swap(slot.checks.front());
+                slot.checks.pop_front();
+            } else {
+                vChecks[i].swap(slot.checks.back());
+                slot.checks.pop_back();
+            }
+        }
+    }
+
+    /** Get the next batch for the thread of slot nSlot, stealing if its own queue is empty. */
+    void NextBatch(unsigned int nSlot, std::vector<T>& vChecks)
+    {
+        // Aim for increasingly smaller batches so all workers finish approximately simultaneously.
+        const unsigned int nMax = std::max(1U, std::min(nBatchSize, nQueued.load(std::memory_order_relaxed) / (nSlots.load(std::memory_order_relaxed) + 1)));
+        Take(slots[nSlot], vChecks, nMax, false);
+        if (!vChecks.empty()) return;
+        const unsigned int n = nSlots.load(std::memory_order_acquire);
+        for (unsigned int i = 1; i < n && vChecks.empty(); i++) {
+            Take(slots[(nSlot + i) % n], vChecks, nMax, true);
+        }
+        if (!vChecks.empty()) {
+            nSteals.fetch_add(1, std::memory_order_relaxed);
+            nStolen.fetch_add(vChecks.size(), std::memory_order_relaxed);
+        }
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        unsigned int nSlot = 0;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (!fMaster) {
+                // Slots are never given back, the queue of a worker that stops is emptied by the others
+                nSlot = 1 + nWorkers % (MAX_CHECKQUEUE_SLOTS - 1);
+                nWorkers++;
+                nSlots.store(std::min(nWorkers + 1, MAX_CHECKQUEUE_SLOTS), std::memory_order_release);
+            }
+        }
+        Slot& slot = slots[nSlot];
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
+            NextBatch(nSlot, vChecks);
+            if (vChecks.empty()) {
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
+                // nQueued only counts checks that are in a queue, so they were
+                // queued after this thread looked there: take them. Otherwise
+                // wait, Add notifies under the mutex after queueing checks.
+                if (nQueued.load() != 0) continue;
+                if (fMaster && nTodo.load() == 0) {
+                    // reset the status for new work later
+                    return fAllOk.exchange(true);
                 }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                cond.wait(lock); // wait
+                continue;
             }
-            // execute work
+            const unsigned int nNow = vChecks.size();
+            // execute work, unless a check already failed
+            int64_t nStart = GetTimeMicros();
+            bool fOk = fAllOk.load(std::memory_order_relaxed);
             for (T& check : vChecks)
                 if (fOk)
                     fOk = check();
             vChecks.clear();
+            slot.nBusyTime.fetch_add(GetTimeMicros() - nStart, std::memory_order_relaxed);
+            slot.nChecked.fetch_add(nNow, std::memory_order_relaxed);
+            if (!fOk) fAllOk.store(false);
+            // The checks are destroyed before they are counted as done
+            if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+                // We processed the last element; inform the master it can exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
         } while (true);
     }
 
+    /** Log how the checks of the round were spread over the threads, and reset the statistics. */
+    void LogRound()
+    {
+        const unsigned int n = nSlots.load(std::memory_order_acquire);
+        const int64_t nTime = nRoundStart ? GetTimeMicros() - nRoundStart : 0;
+        unsigned int nChecks = 0, nBusiest = 0;
+        int64_t nBusyTime = 0;
+        for (unsigned int i = 0; i < n; i++) {
+            const unsigned int nChecked = slots[i].nChecked.exchange(0, std::memory_order_relaxed);
+            nChecks += nChecked;
+            nBusiest = std::max(nBusiest, nChecked);
+            nBusyTime += slots[i].nBusyTime.exchange(0, std::memory_order_relaxed);
+        }
+        const unsigned int nStealCount = nSteals.exchange(0, std::memory_order_relaxed);
+        const unsigned int nStolenCount = nStolen.exchange(0, std::memory_order_relaxed);
+        nRoundStart = 0;
+        if (nChecks == 0) return;
+        LogPrint(BCLog::BENCH, "    - %s checks: %u on %u threads in %.2fms, %.1f%% utilisation, busiest thread %.1f%%, %u stolen in %u steals\n",
+            strName, nChecks, n, nTime * 0.001, nTime ? 100.0 * nBusyTime / (nTime * n) : 0.0,
+            100.0 * nBusiest / nChecks, nStolenCount, nStealCount);
+    }
+
 public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn, const char* strNameIn = "Queued") : strName(strNameIn), nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
@@ -139,21 +224,37 @@ public:
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        bool fRet = Loop(true);
+        LogRound();
+        return fRet;
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        if (vChecks.empty()) return;
+        if (!nRoundStart) nRoundStart = GetTimeMicros();
+        // Spread the checks in contiguous runs over the queues, starting from
+        // a different one each time as the master adds few checks at once.
+        const unsigned int n = nSlots.load(std::memory_order_acquire);
+        const size_t nRun = (vChecks.size() + n - 1) / n;
+        nTodo.fetch_add(vChecks.size());
+        for (size_t nBegin = 0; nBegin < vChecks.size(); nBegin += nRun) {
+            const size_t nEnd = std::min(nBegin + nRun, vChecks.size());
+            Slot& slot = slots[nNextSlot++ % n];
+            {
+                boost::unique_lock<boost::mutex> lock(slot.mutex);
+                for (size_t i = nBegin; i < nEnd; i++) {
+                    slot.checks.emplace_back();
+                    vChecks[i].swap(slot.checks.back());
+                }
+                nQueued.fetch_add(nEnd - nBegin);
+            }
         }
-        nTodo += vChecks.size();
+        boost::unique_lock<boost::mutex> lock(mutex);
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
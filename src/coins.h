@@ -17,8 +17,254 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <memory>
+#include <string.h>
 #include <unordered_map>
 
+/**
+ * A confidential commitment of an output in the UTXO set, stored inline in
+ * place of the vector of CConfidentialCommitment. The first byte is the
+ * version, 0 for a null commitment.
+ */
+template<typename T>
+class CCompactCommitment
+{
+private:
+    unsigned char m_data[T::nCommittedSize];
+
+public:
+    CCompactCommitment() { SetNull(); }
+
+    void SetNull() { memset(m_data, 0, sizeof(m_data)); }
+    bool IsNull() const { return m_data[0] == 0; }
+    bool IsExplicit() const { return m_data[0] == 1; }
+
+    size_t size() const { return IsNull() ? 0 : IsExplicit() ? T::nExplicitSize : T::nCommittedSize; }
+
+    void Set(const T& commitment)
+    {
+        assert(commitment.vchCommitment.size() <= sizeof(m_data));
+        SetNull();
+        std::copy(commitment.vchCommitment.begin(), commitment.vchCommitment.end(), m_data);
+    }
+
+    T Get() const
+    {
+        T commitment;
+        commitment.vchCommitment.assign(m_data, m_data + size());
+        return commitment;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s.write((const char*)m_data, std::max<size_t>(size(), 1));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        T commitment;
+        ::Unserialize(s, commitment);
+        Set(commitment);
+    }
+
+    friend bool operator==(const CCompactCommitment& a, const CCompactCommitment& b)
+    {
+        return memcmp(a.m_data, b.m_data, sizeof(a.m_data)) == 0;
+    }
+};
+
+/**
+ * The unspent CTxOut of a Coin. The commitments of a confidential output
+ * (flags == 1) are kept in a block allocated for it only, and the range and
+ * surjection proofs are not kept at all: they are not needed to spend the
+ * output.
+ */
+class CCoinOut
+{
+private:
+    struct Commitments
+    {
+        CCompactCommitment<CConfidentialAsset> asset;
+        CCompactCommitment<CConfidentialValue> value;
+        CCompactCommitment<CConfidentialNonce> nonce;
+    };
+    std::unique_ptr<Commitments> m_commitments;
+
+    void SetCommitments(const CTxOut& txout)
+    {
+        m_commitments.reset();
+        if (txout.IsCA()) {
+            m_commitments.reset(new Commitments());
+            m_commitments->asset.Set(txout.nAsset);
+            m_commitments->value.Set(txout.nValueCA);
+            m_commitments->nonce.Set(txout.nNonce);
+        }
+    }
+
+public:
+    CAmount nValue;
+    CScript scriptPubKey;
+    unsigned char flags;
+
+    CCoinOut() { SetNull(); }
+
+    explicit CCoinOut(const CTxOut& txout) : nValue(txout.nValue), scriptPubKey(txout.scriptPubKey), flags(txout.flags)
+    {
+        SetCommitments(txout);
+    }
+
+    explicit CCoinOut(CTxOut&& txout) : nValue(txout.nValue), scriptPubKey(std::move(txout.scriptPubKey)), flags(txout.flags)
+    {
+        SetCommitments(txout);
+    }
+
+    CCoinOut(const CCoinOut& other) : nValue(other.nValue), scriptPubKey(other.scriptPubKey), flags(other.flags)
+    {
+        if (other.m_commitments) {
+            m_commitments.reset(new Commitments(*other.m_commitments));
+        }
+    }
+
+    CCoinOut(CCoinOut&& other) = default;
+
+    CCoinOut& operator=(const CCoinOut& other)
+    {
+        if (this != &other) {
+            *this = CCoinOut(other);
+        }
+        return *this;
+    }
+
+    CCoinOut& operator=(CCoinOut&& other) = default;
+
+    void SetNull()
+    {
+        nValue = -1;
+        scriptPubKey.clear();
+        flags = 0;
+        m_commitments.reset();
+    }
+
+    bool IsNull() const
+    {
+        return nValue == -1 && scriptPubKey.empty() && !m_commitments;
+    }
+
+    bool IsCA() const
+    {
+        return flags == 1;
+    }
+
+    CConfidentialAsset GetAssetCommitment() const { return m_commitments ? m_commitments->asset.Get() : CConfidentialAsset(); }
+    CConfidentialValue GetValueCommitment() const { return m_commitments ? m_commitments->value.Get() : CConfidentialValue(); }
+    CConfidentialNonce GetNonceCommitment() const { return m_commitments ? m_commitments->nonce.Get() : CConfidentialNonce(); }
+
+    /** The output as it is in the transaction, without its proofs. */
+    CTxOut GetTxOut() const
+    {
+        return CTxOut(nValue, scriptPubKey, GetAssetCommitment(), GetValueCommitment(), GetNonceCommitment(), flags);
+    }
+
+    std::string ToString() const { return GetTxOut().ToString(); }
+
+    /** The flags and the commitments of a confidential output, as appended by CTxOutCompressor. */
+    template<typename Stream>
+    void SerializeConfidential(Stream& s, CSerActionSerialize) const
+    {
+        ::Serialize(s, flags);
+        if (flags == 1) {
+            assert(m_commitments);
+            if (m_commitments->value.IsExplicit()) {
+                uint8_t b = 0;
+                ::Serialize(s, b);
+                uint64_t nVal = CompressAmount(m_commitments->value.Get().GetAmount());
+                ::Serialize(s, VARINT(nVal));
+            } else {
+                uint8_t b = 1;
+                ::Serialize(s, b);
+                ::Serialize(s, m_commitments->value);
+            }
+            ::Serialize(s, m_commitments->asset);
+        }
+    }
+
+    template<typename Stream>
+    void SerializeConfidential(Stream& s, CSerActionUnserialize)
+    {
+        ::Unserialize(s, flags);
+        m_commitments.reset();
+        if (flags == 1) {
+            m_commitments.reset(new Commitments());
+            uint8_t type = 0;
+            ::Unserialize(s, type);
+            if (type == 0) {
+                uint64_t nVal = 0;
+                ::Unserialize(s, VARINT(nVal));
+                m_commitments->value.Set(CConfidentialValue(DecompressAmount(nVal)));
+            } else {
+                ::Unserialize(s, m_commitments->value);
+            }
+            ::Unserialize(s, m_commitments->asset);
+        }
+    }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(scriptPubKey) + memusage::DynamicUsage(m_commitments);
+    }
+
+    friend bool operator==(const CCoinOut& a, const CCoinOut& b)
+    {
+        if (a.nValue != b.nValue || a.scriptPubKey != b.scriptPubKey || a.flags != b.flags) {
+            return false;
+        }
+        if (!a.m_commitments || !b.m_commitments) {
+            return !a.m_commitments && !b.m_commitments;
+        }
+        return a.m_commitments->asset == b.m_commitments->asset &&
+               a.m_commitments->value == b.m_commitments->value &&
+               a.m_commitments->nonce == b.m_commitments->nonce;
+    }
+
+    friend bool operator!=(const CCoinOut& a, const CCoinOut& b)
+    {
+        return !(a == b);
+    }
+};
+
+/** Same format as CTxOutCompressor, for a CCoinOut. */
+class CCoinOutCompressor
+{
+private:
+    CCoinOut &txout;
+
+public:
+    explicit CCoinOutCompressor(CCoinOut &txoutIn) : txout(txoutIn) { }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        if (!ser_action.ForRead()) {
+            uint64_t nVal = CompressAmount(txout.nValue);
+            READWRITE(VARINT(nVal));
+        } else {
+            uint64_t nVal = 0;
+            READWRITE(VARINT(nVal));
+            txout.SetNull();
+            txout.nValue = DecompressAmount(nVal);
+        }
+        CScriptCompressor cscript(REF(txout.scriptPubKey));
+        READWRITE(cscript);
+
+        if (s.GetExtra() == 0){
+            return;
+        }
+        txout.SerializeConfidential(s, ser_action);
+    }
+};
+
 /**
  * A UTXO entry.
  *
@@ -30,7 +276,7 @@ class Coin
 {
 public:
     //! unspent transaction output
-    CTxOut out;
+    CCoinOut out;
 
     //! whether containing transaction was a coinbase
     unsigned int fCoinBase : 1;
@@ -61,7 +307,7 @@ public:
         s.SetExtra(1);
         uint32_t code = nHeight * 2 + fCoinBase;
         ::Serialize(s, VARINT(code));
-        ::Serialize(s, CTxOutCompressor(REF(out)));
+        ::Serialize(s, CCoinOutCompressor(REF(out)));
     }
 
     template<typename Stream>
@@ -70,23 +316,11 @@ public:
         ::Unserialize(s, VARINT(code));
         nHeight = code >> 1;
         fCoinBase = code & 1;
-        ::Unserialize(s, CTxOutCompressor(out));
-        
+        ::Unserialize(s, CCoinOutCompressor(out));
+
         if (s.size() != 0){
             //CA:
-            s >> out.flags;
-            if (out.flags == 1){
-                uint8_t type = 0;
-                s >> type;
-                if (type == 0) {
-                    uint64_t nVal = 0;
-                    s >> (VARINT(nVal));
-                    out.nValueCA = DecompressAmount(nVal);
-                } else {
-                    s >> out.nValueCA;
-                }
-                s >> out.nAsset;
-            }
+            out.SerializeConfidential(s, CSerActionUnserialize());
         }
     }
 
@@ -95,7 +329,7 @@ public:
     }
 
     size_t DynamicMemoryUsage() const {
-        return memusage::DynamicUsage(out.scriptPubKey);
+        return out.DynamicMemoryUsage();
     }
 };
 
@@ -292,6 +526,13 @@ public:
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Add a coin read from the backing view ahead of time, unless this cache
+     * already has an entry for outpoint. The backing view must not have been
+     * written to since the coin was read. Returns whether the coin was added.
+     */
+    bool AddFetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
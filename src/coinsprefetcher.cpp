@@ -0,0 +1,221 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coinsprefetcher.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <logging.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <unordered_set>
+
+/** Number of coins a thread reads at a time. */
+static const size_t PREFETCH_CHUNK_SIZE = 32;
+/** Jobs kept at most, the oldest ones belong to blocks that were not connected after all. */
+static const size_t MAX_PREFETCH_JOBS = 4;
+
+std::unique_ptr<CCoinsPrefetcher> g_coins_prefetcher;
+
+struct CCoinsPrefetcher::Job
+{
+    const CBlockIndex* pindex;
+    std::shared_ptr<const CBlock> block;
+    /** Where to read the block if it is not given, looked up under cs_main when the job is queued. */
+    CDiskBlockPos pos;
+    bool check_poc{true};
+    const CCoinsViewDB* db;
+    /** Write count of db when the job was queued. */
+    uint64_t write_count;
+
+    /** Whether a thread is reading the block. */
+    bool reading{false};
+    /** Whether outpoints is complete. */
+    bool ready{false};
+    std::vector<COutPoint> outpoints;
+    /** Next outpoint to hand out to a thread. */
+    size_t next{0};
+    /** Number of chunks being read. */
+    int pending{0};
+    std::vector<std::pair<COutPoint, Coin>> coins;
+
+    bool HasWork() const { return ready ? next < outpoints.size() : !reading; }
+    bool Done() const { return ready && next == outpoints.size() && pending == 0; }
+};
+
+CCoinsPrefetcher::~CCoinsPrefetcher()
+{
+    Stop();
+}
+
+void CCoinsPrefetcher::Start(int threads)
+{
+    for (int i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&TraceThread<std::function<void()>>, "coinsprefetch", std::bind(&CCoinsPrefetcher::ThreadFetch, this));
+    }
+}
+
+void CCoinsPrefetcher::Stop()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+        m_jobs.clear();
+    }
+    m_work_cv.notify_all();
+    m_done_cv.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+void CCoinsPrefetcher::ThreadFetch()
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (true) {
+        std::shared_ptr<Job> job;
+        for (const auto& queued : m_jobs) {
+            if (queued->HasWork()) {
+                job = queued;
+                break;
+            }
+        }
+        if (!job) {
+            if (m_stop) return;
+            m_work_cv.wait(lock);
+            continue;
+        }
+
+        if (!job->ready) {
+            job->reading = true;
+            std::shared_ptr<const CBlock> block = job->block;
+            lock.unlock();
+
+            if (!block) {
+                // The thread connecting blocks holds cs_main while it waits for
+                // the job, so the block is read by the position taken at Prefetch.
+                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                if (ReadBlockFromDisk(*pblock, job->pos, job->pindex->nHeight, Params().GetConsensus(), job->check_poc) &&
+                    pblock->GetHash() == job->pindex->GetBlockHash()) {
+                    block = pblock;
+                }
+            }
+            // Coins created in the block itself are not in the database
+            std::vector<COutPoint> outpoints;
+            if (block) {
+                std::unordered_set<uint256, SaltedTxidHasher> txids;
+                for (const CTransactionRef& tx : block->vtx) {
+                    txids.insert(tx->GetHash());
+                }
+                for (const CTransactionRef& tx : block->vtx) {
+                    if (tx->IsCoinBase()) continue;
+                    for (const CTxIn& txin : tx->vin) {
+                        if (!txids.count(txin.prevout.hash)) {
+                            outpoints.push_back(txin.prevout);
+                        }
+                    }
+                }
+            }
+
+            lock.lock();
+            job->block = block;
+            job->outpoints = std::move(outpoints);
+            job->reading = false;
+            job->ready = true;
+            if (job->Done()) {
+                m_done_cv.notify_all();
+            } else {
+                m_work_cv.notify_all();
+            }
+            continue;
+        }
+
+        const size_t begin = job->next;
+        const size_t end = std::min(begin + PREFETCH_CHUNK_SIZE, job->outpoints.size());
+        job->next = end;
+        ++job->pending;
+        lock.unlock();
+
+        // outpoints does not change once the job is ready
+        std::vector<std::pair<COutPoint, Coin>> coins;
+        coins.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            Coin coin;
+            try {
+                if (!job->db->GetCoin(job->outpoints[i], coin)) continue;
+            } catch (const std::exception&) {
+                // Left to ConnectBlock, which reports database errors
+                continue;
+            }
+            coins.emplace_back(job->outpoints[i], std::move(coin));
+        }
+
+        lock.lock();
+        job->coins.insert(job->coins.end(), std::make_move_iterator(coins.begin()), std::make_move_iterator(coins.end()));
+        --job->pending;
+        if (job->Done()) {
+            m_done_cv.notify_all();
+        }
+    }
+}
+
+void CCoinsPrefetcher::Prefetch(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& block, const CCoinsViewDB& db)
+{
+    AssertLockHeld(cs_main);
+    {
+        LOCK(m_mutex);
+        for (const auto& queued : m_jobs) {
+            if (queued->pindex == pindex) return;
+        }
+        if (m_jobs.size() >= MAX_PREFETCH_JOBS) {
+            m_jobs.pop_front();
+        }
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->pindex = pindex;
+        job->block = block;
+        if (!block) {
+            job->pos = pindex->GetBlockPos();
+            job->check_poc = CheckPocOnRead(pindex, Params().GetConsensus());
+        }
+        job->db = &db;
+        job->write_count = db.GetWriteCount();
+        m_jobs.push_back(std::move(job));
+    }
+    m_work_cv.notify_all();
+}
+
+void CCoinsPrefetcher::Apply(const CBlockIndex* pindex, std::shared_ptr<const CBlock>& block, CCoinsViewCache& cache, const CCoinsViewDB& db)
+{
+    int64_t time_start = GetTimeMicros();
+    std::shared_ptr<Job> job;
+    {
+        WAIT_LOCK(m_mutex, lock);
+        auto it = m_jobs.begin();
+        while (it != m_jobs.end() && (*it)->pindex != pindex) ++it;
+        if (it == m_jobs.end()) return;
+        job = *it;
+        m_jobs.erase(m_jobs.begin(), it);
+        m_done_cv.wait(lock, [&] { return job->Done() || m_stop; });
+        if (!job->Done()) return;
+        // Only the thread connecting blocks adds and removes jobs
+        assert(m_jobs.front() == job);
+        m_jobs.pop_front();
+    }
+
+    if (!block) {
+        block = job->block;
+    }
+    size_t added = 0;
+    if (job->db == &db && job->write_count == db.GetWriteCount()) {
+        for (auto& entry : job->coins) {
+            added += cache.AddFetchedCoin(entry.first, std::move(entry.second));
+        }
+    }
+    LogPrint(BCLog::BENCH, "  - Prefetch: %u/%u coins added, waited %.2fms\n", added, job->outpoints.size(), (GetTimeMicros() - time_start) * 0.001);
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LAVA_COINSPREFETCHER_H
+#define LAVA_COINSPREFETCHER_H
+
+#include <coins.h>
+#include <primitives/block.h>
+#include <sync.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class CBlockIndex;
+class CCoinsViewDB;
+
+/** Default for -prefetchthreads, the number of threads fetching block inputs ahead of ConnectBlock */
+static const int DEFAULT_PREFETCH_THREADS = 4;
+static const int MAX_PREFETCH_THREADS = 16;
+
+/**
+ * Reads the coins spent by blocks about to be connected from the coin
+ * database on a pool of threads, so that ConnectBlock finds them in the coins
+ * cache instead of reading them one by one from LevelDB. The next block is
+ * fetched while the current one is connected and its scripts are checked.
+ *
+ * Coins read from the database are only handed to the cache if the database
+ * was not written to in between: the cache holds every change made since the
+ * last write, and a coin it has no entry for is unchanged since then.
+ */
+class CCoinsPrefetcher
+{
+private:
+    struct Job;
+
+    Mutex m_mutex;
+    /** Signalled when there is work for the threads, or when they have to stop. */
+    std::condition_variable m_work_cv;
+    /** Signalled when a job completes. */
+    std::condition_variable m_done_cv;
+    /** Jobs in the order the blocks are connected. */
+    std::deque<std::shared_ptr<Job>> m_jobs GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void ThreadFetch();
+
+public:
+    CCoinsPrefetcher() = default;
+    ~CCoinsPrefetcher();
+
+    void Start(int threads);
+    void Stop();
+
+    /**
+     * Start fetching the coins spent by the block of pindex from db. The
+     * block is read from disk unless it is given. Requires cs_main, the
+     * threads never take it.
+     */
+    void Prefetch(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& block, const CCoinsViewDB& db);
+
+    /**
+     * Wait for the coins of the block of pindex and add them to cache, whose
+     * backing database is db. Sets block if it was read by the prefetcher.
+     * Jobs for blocks queued before pindex are dropped.
+     */
+    void Apply(const CBlockIndex* pindex, std::shared_ptr<const CBlock>& block, CCoinsViewCache& cache, const CCoinsViewDB& db);
+};
+
+/** The prefetcher used by ActivateBestChain. May be null. */
+extern std::unique_ptr<CCoinsPrefetcher> g_coins_prefetcher;
+
+#endif // LAVA_COINSPREFETCHER_H
@@ -138,40 +138,49 @@ bool VerifyAmounts(const std::vector<CTxOut>& inputs, const CTransaction& tx, st
         const CConfidentialValue& val = inputs[i].nValueCA;
         const CConfidentialAsset& asset = inputs[i].nAsset;
 
-        if (val.IsNull() || asset.IsNull())
-            return false;
+        // Native inputs are accounted for by the plain value checks, but may
+        // still carry an initial issuance.
+        if (!inputs[i].IsCA()) {
+            if (!tx.vin[i].assetIssuance.IsNull() && !tx.vin[i].assetIssuance.assetBlindingNonce.IsNull()) {
+                // A reissuance has to spend the reissuance token
+                return false;
+            }
+        } else {
+            if (val.IsNull() || asset.IsNull())
+                return false;
 
-        if (asset.IsExplicit()) {
-            ret = secp256k1_generator_generate(secp256k1_ctx_verify_amounts, &gen, asset.GetAsset().begin());
-            assert(ret != 0);
-        }
-        else if (asset.IsCommitment()) {
-            if (secp256k1_generator_parse(secp256k1_ctx_verify_amounts, &gen, &asset.vchCommitment[0]) != 1)
+            if (asset.IsExplicit()) {
+                ret = secp256k1_generator_generate(secp256k1_ctx_verify_amounts, &gen, asset.GetAsset().begin());
+                assert(ret != 0);
+            }
+            else if (asset.IsCommitment()) {
+                if (secp256k1_generator_parse(secp256k1_ctx_verify_amounts, &gen, &asset.vchCommitment[0]) != 1)
+                    return false;
+            }
+            else {
                 return false;
-        }
-        else {
-            return false;
-        }
+            }
 
-        target_generators.push_back(gen);
+            target_generators.push_back(gen);
 
-        if (val.IsExplicit()) {
-            if (!MoneyRange(val.GetAmount()))
-                return false;
+            if (val.IsExplicit()) {
+                if (!MoneyRange(val.GetAmount()))
+                    return false;
 
-            // Fails if val.GetAmount() == 0
-            if (secp256k1_pedersen_commit(secp256k1_ctx_verify_amounts, &commit, explicit_blinds, val.GetAmount(), &gen, &secp256k1_generator_const_g) != 1)
-                return false;
-        } else if (val.IsCommitment()) {
-            if (secp256k1_pedersen_commitment_parse(secp256k1_ctx_verify_amounts, &commit, &val.vchCommitment[0]) != 1)
-                return false;
-        } else {
-                return false;
-        }
+                // Fails if val.GetAmount() == 0
+                if (secp256k1_pedersen_commit(secp256k1_ctx_verify_amounts, &commit, explicit_blinds, val.GetAmount(), &gen, &secp256k1_generator_const_g) != 1)
+                    return false;
+            } else if (val.IsCommitment()) {
+                if (secp256k1_pedersen_commitment_parse(secp256k1_ctx_verify_amounts, &commit, &val.vchCommitment[0]) != 1)
+                    return false;
+            } else {
+                    return false;
+            }
 
-        vData.push_back(commit);
-        vpCommitsIn.push_back(p);
-        p++;
+            vData.push_back(commit);
+            vpCommitsIn.push_back(p);
+            p++;
+        }
 
         // Each transaction input may have up to two "pseudo-inputs" to add to the LHS
         // for (re)issuance and may require up to two rangeproof checks:
@@ -261,6 +270,9 @@ bool VerifyAmounts(const std::vector<CTxOut>& inputs, const CTransaction& tx, st
 
     for (size_t i = 0; i < tx.vout.size(); ++i)
     {
+        // Native outputs are accounted for by the plain value checks
+        if (!tx.vout[i].IsCA())
+            continue;
         const CConfidentialValue& val = tx.vout[i].nValueCA;
         const CConfidentialAsset& asset = tx.vout[i].nAsset;
         if (!asset.IsValid())
@@ -319,6 +331,8 @@ bool VerifyAmounts(const std::vector<CTxOut>& inputs, const CTransaction& tx, st
 
     // Range proofs
     for(const auto& out : tx.vout) {
+        if (!out.IsCA())
+            continue;
         const CConfidentialValue& val = out.nValueCA;
         const CConfidentialAsset& asset = out.nAsset;
         std::vector<unsigned char> vchAssetCommitment = asset.vchCommitment;
@@ -341,6 +355,8 @@ bool VerifyAmounts(const std::vector<CTxOut>& inputs, const CTransaction& tx, st
     // Surjection proofs
     for (const auto& out : tx.vout)
     {
+        if (!out.IsCA())
+            continue;
         const CConfidentialAsset& asset = out.nAsset;
         // No need for surjection proof
         if (asset.IsExplicit()) {
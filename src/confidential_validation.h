@@ -86,6 +86,12 @@ public:
 
 ScriptError QueueCheck(std::vector<CCheck*>* queue, CCheck* check);
 
+/**
+ * Verify the range and surjection proofs of the confidential outputs of tx and
+ * that its confidential inputs and outputs balance. Native inputs and outputs
+ * are left to the plain value checks; native inputs may carry an initial
+ * issuance but no reissuance. Enforced from Consensus::Params::ConfidentialAmountsHeight.
+ */
 bool VerifyAmounts(const std::vector<CTxOut>& inputs, const CTransaction& tx, std::vector<CCheck*>* pvChecks, const bool cacheStore);
 
 bool VerifyCoinbaseAmount(const CTransaction& tx, const CAmountMap& mapFees);
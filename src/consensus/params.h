@@ -61,6 +61,10 @@ struct Params {
     int BIP66Height;
     /** Block height at which LVIP05 becomes active */
     int LVIP05Height;
+    /** Block height at which the range, surjection and balance proofs of confidential transactions are enforced */
+    int ConfidentialAmountsHeight;
+    /** Base target of the first blocks, and the upper bound of the base target adjustment */
+    uint64_t nMaxBaseTarget;
     /**
      * Minimum blocks including miner confirmation of the total of 2016 blocks in a retargeting period,
      * (nPowTargetTimespan / nPowTargetSpacing) which is also used for BIP9 deployments.
@@ -27,6 +27,9 @@ namespace Consensus {
  * Check whether all inputs of this transaction are valid (no double spends and amounts)
  * This does not modify the UTXO set. This does not check scripts and sigs.
  * @param[out] txfee Set to the transaction fee if successful.
+ * If fScriptChecks is set (from ConfidentialAmountsHeight) and the transaction has confidential outputs, its
+ * range, surjection and balance proofs are verified too; they are appended to
+ * pvChecks (owned by the caller) instead of run inline if pvChecks is not null.
  * Preconditions: tx.IsCoinBase() is false.
  */
 bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, int nSpendHeight, CAmount& txfee, std::vector<CCheck*> *pvChecks=nullptr, const bool cacheStore=false, bool fScriptChecks=false);
@@ -0,0 +1,120 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/shabal256.h>
+#include <crypto/common.h>
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#define SHABAL256_X86
+#endif
+
+extern "C" {
+#include <crypto/sph_shabal.h>
+}
+
+namespace shabal256_sse41
+{
+void Shabal256_4way(unsigned char* const* output, const unsigned char* const* input, size_t len);
+}
+
+namespace shabal256_avx2
+{
+void Shabal256_8way(unsigned char* const* output, const unsigned char* const* input, size_t len);
+}
+
+namespace
+{
+typedef void (*ShabalLanesFn)(unsigned char* const*, const unsigned char* const*, size_t);
+
+struct Implementation
+{
+    ShabalLanesFn lanes4{nullptr};
+    ShabalLanesFn lanes8{nullptr};
+    std::string name{"standard"};
+};
+
+void Shabal256One(unsigned char* output, const unsigned char* input, size_t len)
+{
+    sph_shabal256_context ctx;
+    sph_shabal256_init(&ctx);
+    sph_shabal256(&ctx, input, len);
+    sph_shabal256_close(&ctx, output);
+}
+
+#ifdef SHABAL256_X86
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+
+Implementation Detect()
+{
+    Implementation impl;
+#ifdef SHABAL256_X86
+    uint32_t eax, ebx, ecx, edx;
+    __cpuid_count(1, 0, eax, ebx, ecx, edx);
+    const bool have_sse4 = (ecx >> 19) & 1;
+    const bool have_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled();
+    bool have_avx2 = false;
+    if (have_sse4) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = have_avx && ((ebx >> 5) & 1);
+    }
+    (void)have_avx2;
+
+#if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_sse4) {
+        impl.lanes4 = shabal256_sse41::Shabal256_4way;
+        impl.name += ",sse41(4way)";
+    }
+#endif
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2) {
+        impl.lanes8 = shabal256_avx2::Shabal256_8way;
+        impl.name += ",avx2(8way)";
+    }
+#endif
+#endif
+    return impl;
+}
+
+const Implementation& GetImplementation()
+{
+    static const Implementation impl = Detect();
+    return impl;
+}
+
+} // namespace
+
+std::string Shabal256AutoDetect()
+{
+    return GetImplementation().name;
+}
+
+void Shabal256Multi(unsigned char* const* output, const unsigned char* const* input, size_t len, size_t count)
+{
+    const Implementation& impl = GetImplementation();
+    size_t i = 0;
+    if (impl.lanes8) {
+        for (; i + 8 <= count; i += 8) {
+            impl.lanes8(output + i, input + i, len);
+        }
+    }
+    if (impl.lanes4) {
+        for (; i + 4 <= count; i += 4) {
+            impl.lanes4(output + i, input + i, len);
+        }
+    }
+    for (; i < count; i++) {
+        Shabal256One(output[i], input[i], len);
+    }
+}
@@ -0,0 +1,24 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LAVA_CRYPTO_SHABAL256_H
+#define LAVA_CRYPTO_SHABAL256_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** Autodetect the best available multi-lane Shabal-256 implementation.
+ *  Returns the name of the implementation.
+ */
+std::string Shabal256AutoDetect();
+
+/** Compute the Shabal-256 hashes of count messages of the same length at
+ *  once, the way plot generation hashes several nonces side by side.
+ *  output:  count pointers to 32 byte output buffers
+ *  input:   count pointers to len byte messages
+ */
+void Shabal256Multi(unsigned char* const* output, const unsigned char* const* input, size_t len, size_t count);
+
+#endif // LAVA_CRYPTO_SHABAL256_H
@@ -0,0 +1,60 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+#include <crypto/shabal256_lanes.h>
+
+namespace shabal256_avx2 {
+namespace {
+
+struct Lanes
+{
+    typedef __m256i V;
+    static const int N = 8;
+
+    static V K(uint32_t x) { return _mm256_set1_epi32(x); }
+    static V Add(V x, V y) { return _mm256_add_epi32(x, y); }
+    static V Sub(V x, V y) { return _mm256_sub_epi32(x, y); }
+    static V Xor(V x, V y) { return _mm256_xor_si256(x, y); }
+    static V Or(V x, V y) { return _mm256_or_si256(x, y); }
+    /** ~x & y */
+    static V AndNot(V x, V y) { return _mm256_andnot_si256(x, y); }
+    static V Not(V x) { return _mm256_xor_si256(x, _mm256_set1_epi32(-1)); }
+    static V ShL(V x, int n) { return _mm256_slli_epi32(x, n); }
+    static V ShR(V x, int n) { return _mm256_srli_epi32(x, n); }
+
+    static V Load(const unsigned char* const* in, size_t offset)
+    {
+        return _mm256_set_epi32(ReadLE32(in[7] + offset), ReadLE32(in[6] + offset), ReadLE32(in[5] + offset), ReadLE32(in[4] + offset),
+                                ReadLE32(in[3] + offset), ReadLE32(in[2] + offset), ReadLE32(in[1] + offset), ReadLE32(in[0] + offset));
+    }
+
+    static void Store(unsigned char* const* out, size_t offset, V x)
+    {
+        WriteLE32(out[0] + offset, _mm256_extract_epi32(x, 0));
+        WriteLE32(out[1] + offset, _mm256_extract_epi32(x, 1));
+        WriteLE32(out[2] + offset, _mm256_extract_epi32(x, 2));
+        WriteLE32(out[3] + offset, _mm256_extract_epi32(x, 3));
+        WriteLE32(out[4] + offset, _mm256_extract_epi32(x, 4));
+        WriteLE32(out[5] + offset, _mm256_extract_epi32(x, 5));
+        WriteLE32(out[6] + offset, _mm256_extract_epi32(x, 6));
+        WriteLE32(out[7] + offset, _mm256_extract_epi32(x, 7));
+    }
+};
+
+} // namespace
+
+void Shabal256_8way(unsigned char* const* output, const unsigned char* const* input, size_t len)
+{
+    shabal256_lanes::Shabal256<Lanes>(output, input, len);
+}
+
+} // namespace shabal256_avx2
+
+#endif
@@ -0,0 +1,120 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LAVA_CRYPTO_SHABAL256_LANES_H
+#define LAVA_CRYPTO_SHABAL256_LANES_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+/**
+ * Shabal-256 over the lanes of a vector type, one message per lane, as
+ * crypto/shabal.c computes it for one. L provides the vector type V, its
+ * number of lanes N and the 32-bit lane-wise operations.
+ */
+namespace shabal256_lanes {
+
+static const uint32_t A_INIT[12] = {
+    0x52F84552, 0xE54B7999, 0x2D8EE3EC, 0xB9645191, 0xE0078B86, 0xBB7C44C9,
+    0xD2B5C1CA, 0xB0D2EB8C, 0x14CE5A45, 0x22AF50DC, 0xEFFDBC6B, 0xEB21B74A,
+};
+
+static const uint32_t B_INIT[16] = {
+    0xB555C6EE, 0x3E710596, 0xA72A652F, 0x9301515F, 0xDA28C1FA, 0x696FD868, 0x9CB6BF72, 0x0AFE4002,
+    0xA6E03615, 0x5138C1D4, 0xBE216306, 0xB38B8890, 0x3EA8B96B, 0x3299ACE4, 0x30924DD4, 0x55CB34A5,
+};
+
+static const uint32_t C_INIT[16] = {
+    0xB405F031, 0xC4233EBA, 0xB3733979, 0xC0DD9D55, 0xC51C28AE, 0xA327B8E1, 0x56C56167, 0xED614433,
+    0x88B59D60, 0x60E2CEBA, 0x758B4B8B, 0x83E82A7F, 0xBC968828, 0xE6E00BF7, 0xBA839E55, 0x9B491C60,
+};
+
+template <typename L>
+inline typename L::V RotL(typename L::V x, int n) { return L::Or(L::ShL(x, n), L::ShR(x, 32 - n)); }
+
+/** The keyed permutation P and the feed-forward of C into A. */
+template <typename L>
+inline void Permute(typename L::V* A, typename L::V* B, const typename L::V* C, const typename L::V* M)
+{
+    for (int i = 0; i < 16; i++) {
+        B[i] = RotL<L>(B[i], 17);
+    }
+    for (int k = 0; k < 48; k++) {
+        const int i = k & 15;
+        const int a0 = k % 12;
+        const int a1 = (k + 11) % 12;
+        typename L::V u = RotL<L>(A[a1], 15);
+        u = L::Add(L::ShL(u, 2), u); // * 5
+        u = L::Xor(L::Xor(A[a0], u), C[(24 - i) & 15]);
+        u = L::Add(L::ShL(u, 1), u); // * 3
+        A[a0] = L::Xor(L::Xor(u, B[(i + 13) & 15]), L::Xor(L::AndNot(B[(i + 6) & 15], B[(i + 9) & 15]), M[i]));
+        B[i] = L::Not(L::Xor(RotL<L>(B[i], 1), A[a0]));
+    }
+    for (int k = 0; k < 36; k++) {
+        A[11 - k % 12] = L::Add(A[11 - k % 12], C[(54 - k) & 15]);
+    }
+}
+
+template <typename L>
+void Shabal256(unsigned char* const* output, const unsigned char* const* input, size_t len)
+{
+    typedef typename L::V V;
+    V A[12], B[16], C[16], M[16];
+    for (int i = 0; i < 12; i++) A[i] = L::K(A_INIT[i]);
+    for (int i = 0; i < 16; i++) B[i] = L::K(B_INIT[i]);
+    for (int i = 0; i < 16; i++) C[i] = L::K(C_INIT[i]);
+    // The messages have the same length, the block counter is the same in every lane
+    uint32_t wlow = 1, whigh = 0;
+
+    size_t pos = 0;
+    for (; pos + 64 <= len; pos += 64) {
+        for (int i = 0; i < 16; i++) {
+            M[i] = L::Load(input, pos + 4 * i);
+            B[i] = L::Add(B[i], M[i]);
+        }
+        A[0] = L::Xor(A[0], L::K(wlow));
+        A[1] = L::Xor(A[1], L::K(whigh));
+        Permute<L>(A, B, C, M);
+        for (int i = 0; i < 16; i++) {
+            C[i] = L::Sub(C[i], M[i]);
+            std::swap(B[i], C[i]);
+        }
+        if (++wlow == 0) ++whigh;
+    }
+
+    // The last block holds the rest of the message and the padding
+    unsigned char last[L::N][64];
+    const unsigned char* lastptr[L::N];
+    for (int lane = 0; lane < L::N; lane++) {
+        memcpy(last[lane], input[lane] + pos, len - pos);
+        last[lane][len - pos] = 0x80;
+        memset(last[lane] + len - pos + 1, 0, 63 - (len - pos));
+        lastptr[lane] = last[lane];
+    }
+    for (int i = 0; i < 16; i++) {
+        M[i] = L::Load(lastptr, 4 * i);
+        B[i] = L::Add(B[i], M[i]);
+    }
+    A[0] = L::Xor(A[0], L::K(wlow));
+    A[1] = L::Xor(A[1], L::K(whigh));
+    Permute<L>(A, B, C, M);
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 16; i++) {
+            std::swap(B[i], C[i]);
+        }
+        A[0] = L::Xor(A[0], L::K(wlow));
+        A[1] = L::Xor(A[1], L::K(whigh));
+        Permute<L>(A, B, C, M);
+    }
+
+    for (int i = 8; i < 16; i++) {
+        L::Store(output, 4 * (i - 8), B[i]);
+    }
+}
+
+} // namespace shabal256_lanes
+
+#endif // LAVA_CRYPTO_SHABAL256_LANES_H
@@ -43,6 +43,24 @@ const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w);
 
 };
 
+/**
+ * Height serialized big-endian, so that LevelDB iterates the records keyed by
+ * (prefix, height) in height order.
+ */
+struct DBHeightKey
+{
+    int32_t height;
+
+    DBHeightKey() : height(0) {}
+    explicit DBHeightKey(int32_t height_in) : height(height_in) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const { ser_writedata32be(s, height); }
+
+    template <typename Stream>
+    void Unserialize(Stream& s) { height = ser_readdata32be(s); }
+};
+
 /** Batch of changes queued to be written to a CDBWrapper */
 class CDBBatch
 {
@@ -94,6 +112,25 @@ public:
         ssValue.clear();
     }
 
+    /**
+     * Write an already serialized key and value, as returned by
+     * CDBIterator::GetKeyBytes() and CDBIterator::GetValueBytes(). The value
+     * is obfuscated with the key of the parent database.
+     */
+    void WriteBytes(const std::vector<unsigned char>& key, const std::vector<unsigned char>& value)
+    {
+        leveldb::Slice slKey((const char*)key.data(), key.size());
+
+        ssValue.reserve(value.size());
+        ssValue.write((const char*)value.data(), value.size());
+        ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+        leveldb::Slice slValue(ssValue.data(), ssValue.size());
+
+        batch.Put(slKey, slValue);
+        size_estimate += 3 + (slKey.size() > 127) + slKey.size() + (slValue.size() > 127) + slValue.size();
+        ssValue.clear();
+    }
+
     template <typename K>
     void Erase(const K& key)
     {
@@ -134,6 +171,8 @@ public:
 
     void SeekToFirst();
 
+    void SeekToLast();
+
     template<typename K> void Seek(const K& key) {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
@@ -144,6 +183,8 @@ public:
 
     void Next();
 
+    void Prev();
+
     template<typename K> bool GetKey(K& key) {
         leveldb::Slice slKey = piter->key();
         try {
@@ -171,6 +212,20 @@ public:
         return piter->value().size();
     }
 
+    /** The serialized key at the current position. */
+    std::vector<unsigned char> GetKeyBytes() const {
+        leveldb::Slice slKey = piter->key();
+        return std::vector<unsigned char>(slKey.data(), slKey.data() + slKey.size());
+    }
+
+    /** The serialized value at the current position, with the obfuscation of the parent database removed. */
+    std::vector<unsigned char> GetValueBytes() const {
+        leveldb::Slice slValue = piter->value();
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+        return std::vector<unsigned char>(ssValue.begin(), ssValue.end());
+    }
+
 };
 
 class CDBWrapper
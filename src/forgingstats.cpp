@@ -0,0 +1,132 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <forgingstats.h>
+
+#include <crypto/common.h>
+#include <logging.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+
+CForgingStats g_forging_stats;
+
+const char* ForgingStageName(ForgingStage stage)
+{
+    switch (stage) {
+    case ForgingStage::NONCE_VERIFY: return "nonceverify";
+    case ForgingStage::DEADLINE_POLL: return "deadlinepoll";
+    case ForgingStage::CREATE_BLOCK: return "createblock";
+    case ForgingStage::TEST_VALIDITY: return "testvalidity";
+    case ForgingStage::PROCESS_BLOCK: return "processblock";
+    case ForgingStage::ANNOUNCE: return "announce";
+    case ForgingStage::TOTAL: return "total";
+    case ForgingStage::COUNT: break;
+    }
+    assert(false);
+}
+
+int64_t GetForgingTimeMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t LatencyHistogram::Snapshot::Quantile(double q) const
+{
+    if (count == 0) return 0;
+    const uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q * count + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min<uint64_t>(i == 0 ? 0 : ((uint64_t)1 << i) - 1, max);
+        }
+    }
+    return max;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+void LatencyHistogram::Add(int64_t micros)
+{
+    const uint64_t value = std::max<int64_t>(micros, 0);
+    const int bucket = std::min<int>(CountBits(value), BUCKETS - 1);
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::GetSnapshot() const
+{
+    Snapshot snapshot;
+    for (int i = 0; i < BUCKETS; i++) {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void LatencyHistogram::Reset()
+{
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+CForgingStats::CForgingStats() : m_forged(0) {}
+
+void CForgingStats::Record(ForgingStage stage, int64_t micros)
+{
+    m_histograms[(size_t)stage].Add(micros);
+}
+
+void CForgingStats::BlockForged(const uint256& hash, int64_t matured)
+{
+    LOCK(m_mutex);
+    m_forged_hash = hash;
+    m_matured = matured;
+    m_forged.store(GetForgingTimeMicros());
+}
+
+void CForgingStats::BlockAnnounced(const uint256& hash)
+{
+    if (m_forged.load(std::memory_order_relaxed) == 0) return;
+
+    int64_t announce, total;
+    {
+        LOCK(m_mutex);
+        const int64_t forged = m_forged.load();
+        if (forged == 0 || hash != m_forged_hash) return;
+        const int64_t now = GetForgingTimeMicros();
+        announce = now - forged;
+        total = now - m_matured;
+        m_forged.store(0);
+    }
+    Record(ForgingStage::ANNOUNCE, announce);
+    Record(ForgingStage::TOTAL, total);
+    LogPrint(BCLog::BENCH, "Forged block %s announced %.2fms after processing, %.2fms after its deadline\n", hash.ToString(), 0.001 * announce, 0.001 * total);
+}
+
+LatencyHistogram::Snapshot CForgingStats::GetSnapshot(ForgingStage stage) const
+{
+    return m_histograms[(size_t)stage].GetSnapshot();
+}
+
+void CForgingStats::Reset()
+{
+    for (auto& histogram : m_histograms) {
+        histogram.Reset();
+    }
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LAVA_FORGINGSTATS_H
+#define LAVA_FORGINGSTATS_H
+
+#include <sync.h>
+#include <uint256.h>
+
+#include <array>
+#include <atomic>
+#include <stdint.h>
+
+/** The steps of forging a block whose latencies are recorded. */
+enum class ForgingStage {
+    NONCE_VERIFY,  //!< Deadline check of a submitted nonce in CPOCBlockAssember::UpdateDeadline, rejected nonces included
+    DEADLINE_POLL, //!< Deadline maturity to the CheckDeadline poll acting on it
+    CREATE_BLOCK,  //!< BlockAssembler::CreateNewBlock of a forged block, TestBlockValidity included
+    TEST_VALIDITY, //!< TestBlockValidity of the forged block
+    PROCESS_BLOCK, //!< ProcessNewBlock of the forged block
+    ANNOUNCE,      //!< ProcessNewBlock to the first announcement of the forged block to a peer
+    TOTAL,         //!< Deadline maturity to the first announcement
+    COUNT
+};
+
+const char* ForgingStageName(ForgingStage stage);
+
+/** Microseconds of a monotonic clock, for the latencies only. */
+int64_t GetForgingTimeMicros();
+
+/**
+ * Histogram of latencies in microseconds with power of two buckets. Bucket 0
+ * counts latencies of 0us and bucket i those in [2^(i-1), 2^i). Samples are
+ * added with relaxed atomic operations, so that recording never takes a lock;
+ * a snapshot taken while samples are added may be off by the samples in flight.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int BUCKETS = 40;
+
+    struct Snapshot
+    {
+        uint64_t count{0};
+        uint64_t sum{0};
+        uint64_t max{0};
+        std::array<uint64_t, BUCKETS> buckets{};
+
+        /** Upper bound of the bucket holding the given quantile, at most max. */
+        uint64_t Quantile(double q) const;
+        double Mean() const { return count ? (double)sum / count : 0; }
+    };
+
+    LatencyHistogram();
+
+    void Add(int64_t micros);
+    Snapshot GetSnapshot() const;
+    void Reset();
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> m_buckets;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+/**
+ * Latencies of the forging pipeline, from the submitnonce RPC to the first
+ * announcement of the forged block to a peer. Reported by getforginginfo and
+ * logged to the bench category.
+ */
+class CForgingStats
+{
+public:
+    CForgingStats();
+
+    void Record(ForgingStage stage, int64_t micros);
+
+    /**
+     * Start timing the announcement of a block we forged, right before it is
+     * processed. matured is the monotonic time its deadline was reached.
+     */
+    void BlockForged(const uint256& hash, int64_t matured);
+
+    /** Called whenever a block is announced to a peer, cheap unless the block was just forged. */
+    void BlockAnnounced(const uint256& hash);
+
+    LatencyHistogram::Snapshot GetSnapshot(ForgingStage stage) const;
+    void Reset();
+
+private:
+    std::array<LatencyHistogram, (size_t)ForgingStage::COUNT> m_histograms;
+
+    /** Time the pending block was forged at, 0 when no announcement is awaited. */
+    std::atomic<int64_t> m_forged;
+    Mutex m_mutex;
+    uint256 m_forged_hash GUARDED_BY(m_mutex);
+    int64_t m_matured GUARDED_BY(m_mutex){0};
+};
+
+extern CForgingStats g_forging_stats;
+
+#endif // LAVA_FORGINGSTATS_H
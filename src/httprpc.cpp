@@ -145,6 +145,48 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
+/**
+ * Sends the JSON written to its writer as the reply to a request. A reply
+ * that fits in one piece of the writer is sent as usual, a larger one as a
+ * chunked reply, so that it is never held in memory as a whole.
+ */
+class HTTPJSONReply
+{
+private:
+    HTTPRequest* m_req;
+    bool m_chunked{false};
+    bool m_finished{false};
+    JSONStreamWriter m_writer;
+
+    void Send(const std::string& json)
+    {
+        if (!m_chunked) {
+            m_req->WriteHeader("Content-Type", "application/json");
+            if (m_finished) {
+                m_req->WriteReply(HTTP_OK, json);
+                return;
+            }
+            m_req->StartChunkedReply(HTTP_OK);
+            m_chunked = true;
+        }
+        m_req->WriteReplyChunk(json);
+    }
+
+public:
+    explicit HTTPJSONReply(HTTPRequest* req) : m_req(req), m_writer([this](const std::string& json) { Send(json); }) {}
+
+    JSONStreamWriter& Writer() { return m_writer; }
+
+    void Finish()
+    {
+        m_finished = true;
+        m_writer.Flush();
+        if (m_chunked) {
+            m_req->EndChunkedReply();
+        }
+    }
+};
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -184,7 +226,6 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
@@ -192,16 +233,19 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            HTTPJSONReply reply(req);
+            reply.Writer().WriteReply(result, NullUniValue, jreq.id);
+            reply.Writer().WriteRaw("\n");
+            reply.Finish();
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
-        else
+        } else if (valRequest.isArray()) {
+            // One after the other, unless -rpcbatchthreads allows running them concurrently
+            HTTPJSONReply reply(req);
+            JSONRPCExecBatch(jreq, valRequest.get_array(), reply.Writer(), QueueHTTPBatchWork, GetHTTPBatchWorkerCount());
+            reply.Finish();
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
-
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
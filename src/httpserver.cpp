@@ -14,6 +14,7 @@
 #include <sync.h>
 #include <ui_interface.h>
 
+#include <deque>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
@@ -40,6 +41,8 @@
 
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
+/** Bytes of a chunked reply waiting to be sent before WriteReplyChunk blocks */
+static const size_t MAX_CHUNKED_REPLY_PENDING = 1 << 20;
 
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
@@ -122,6 +125,35 @@ public:
     }
 };
 
+/** Work item running a function */
+class HTTPFunctionItem final : public HTTPClosure
+{
+public:
+    explicit HTTPFunctionItem(const std::function<void()>& _func) : func(_func)
+    {
+    }
+    void operator()() override
+    {
+        func();
+    }
+
+private:
+    std::function<void()> func;
+};
+
+/** A chunked reply, shared by the worker writing it and the http thread sending it */
+struct HTTPChunkedReply
+{
+    Mutex cs;
+    std::condition_variable cond;
+    //! Bytes handed to libevent that are not sent yet
+    size_t pending GUARDED_BY(cs){0};
+    //! Whether the connection was closed, which frees the request
+    bool closed GUARDED_BY(cs){false};
+    //! Only used by the http thread
+    struct evhttp_request* req;
+};
+
 struct HTTPPathHandler
 {
     HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
@@ -143,6 +175,8 @@ struct evhttp* eventHTTP = nullptr;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = nullptr;
+//! Work queue for executing the requests of JSON-RPC batches concurrently
+static WorkQueue<HTTPClosure>* batchWorkQueue = nullptr;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -399,6 +433,7 @@ bool InitHTTPServer()
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
 
     workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    batchWorkQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -421,6 +456,25 @@ bool UpdateHTTPServerLogging(bool enable) {
 
 std::thread threadHTTP;
 static std::vector<std::thread> g_thread_http_workers;
+static std::vector<std::thread> g_thread_http_batch_workers;
+
+bool QueueHTTPBatchWork(const std::function<void()>& func)
+{
+    if (!batchWorkQueue || g_thread_http_batch_workers.empty()) {
+        return false;
+    }
+    std::unique_ptr<HTTPFunctionItem> item(new HTTPFunctionItem(func));
+    if (!batchWorkQueue->Enqueue(item.get())) {
+        return false;
+    }
+    item.release(); /* queue took ownership */
+    return true;
+}
+
+int GetHTTPBatchWorkerCount()
+{
+    return g_thread_http_batch_workers.size();
+}
 
 void StartHTTPServer()
 {
@@ -432,6 +486,13 @@ void StartHTTPServer()
     for (int i = 0; i < rpcThreads; i++) {
         g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue);
     }
+    int batchThreads = std::max((long)gArgs.GetArg("-rpcbatchthreads", DEFAULT_HTTP_BATCH_THREADS), 0L);
+    if (batchThreads > 0) {
+        LogPrintf("HTTP: starting %d batch worker threads\n", batchThreads);
+    }
+    for (int i = 0; i < batchThreads; i++) {
+        g_thread_http_batch_workers.emplace_back(HTTPWorkQueueRun, batchWorkQueue);
+    }
 }
 
 void InterruptHTTPServer()
@@ -443,6 +504,8 @@ void InterruptHTTPServer()
     }
     if (workQueue)
         workQueue->Interrupt();
+    if (batchWorkQueue)
+        batchWorkQueue->Interrupt();
 }
 
 void StopHTTPServer()
@@ -457,6 +520,14 @@ void StopHTTPServer()
         delete workQueue;
         workQueue = nullptr;
     }
+    if (batchWorkQueue) {
+        for (auto& thread: g_thread_http_batch_workers) {
+            thread.join();
+        }
+        g_thread_http_batch_workers.clear();
+        delete batchWorkQueue;
+        batchWorkQueue = nullptr;
+    }
     // Unlisten sockets, these are what make the event loop running, which means
     // that after this and all connections are closed the event loop will quit.
     for (evhttp_bound_socket *socket : boundSockets) {
@@ -515,6 +586,9 @@ HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req),
 }
 HTTPRequest::~HTTPRequest()
 {
+    if (chunkedReply) {
+        EndChunkedReply();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -596,6 +670,121 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = nullptr; // transferred back to main thread
 }
 
+/** Called by libevent when the connection of a chunked reply is closed */
+static void http_chunked_close_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReply* reply = static_cast<HTTPChunkedReply*>(arg);
+    LOCK(reply->cs);
+    reply->closed = true;
+    reply->cond.notify_all();
+}
+
+/** Called by libevent when everything handed to it for a chunked reply is sent */
+static void http_chunk_sent_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReply* reply = static_cast<HTTPChunkedReply*>(arg);
+    LOCK(reply->cs);
+    reply->pending = 0;
+    reply->cond.notify_all();
+}
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && req);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+    chunkedReply = std::make_shared<HTTPChunkedReply>();
+    chunkedReply->req = req;
+    auto reply = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [reply, nStatus]{
+        // The closed callback is removed before the reply ends, while the reply is alive
+        evhttp_connection* conn = evhttp_request_get_connection(reply->req);
+        if (conn) {
+            evhttp_connection_set_closecb(conn, http_chunked_close_cb, reply.get());
+        }
+        evhttp_send_reply_start(reply->req, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& chunk)
+{
+    assert(chunkedReply);
+    // An empty chunk ends the reply
+    if (chunk.empty()) {
+        return;
+    }
+    {
+        WAIT_LOCK(chunkedReply->cs, lock);
+        while (!chunkedReply->closed && chunkedReply->pending >= MAX_CHUNKED_REPLY_PENDING) {
+            chunkedReply->cond.wait_for(lock, std::chrono::milliseconds(100));
+            // Do not wait for a client that does not read while shutting down
+            if (ShutdownRequested()) {
+                chunkedReply->closed = true;
+            }
+        }
+        if (chunkedReply->closed) {
+            return;
+        }
+        chunkedReply->pending += chunk.size();
+    }
+
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+    auto reply = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [reply, evb]{
+        bool closed;
+        {
+            LOCK(reply->cs);
+            closed = reply->closed;
+            if (closed) {
+                reply->pending = 0;
+            }
+        }
+        if (!closed) {
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+            evhttp_send_reply_chunk_with_cb(reply->req, evb, http_chunk_sent_cb, reply.get());
+#else
+            evhttp_send_reply_chunk(reply->req, evb);
+            http_chunk_sent_cb(nullptr, reply.get());
+#endif
+        }
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(chunkedReply);
+    auto reply = std::move(chunkedReply);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [reply]{
+        {
+            LOCK(reply->cs);
+            if (reply->closed) {
+                return;
+            }
+        }
+        evhttp_connection* conn = evhttp_request_get_connection(reply->req);
+        if (conn) {
+            evhttp_connection_set_closecb(conn, nullptr, nullptr);
+        }
+        evhttp_send_reply_end(reply->req);
+        // Re-enable reading from the socket, as in WriteReply.
+        if (conn && event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    });
+    ev->trigger(nullptr);
+}
+
 CService HTTPRequest::GetPeer() const
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -8,15 +8,18 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
+static const int DEFAULT_HTTP_BATCH_THREADS=0;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
 struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReply;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -32,6 +35,14 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/**
+ * Run func on one of the -rpcbatchthreads threads, which are separate from the
+ * HTTP workers. Returns false if there are none or their work queue is full.
+ */
+bool QueueHTTPBatchWork(const std::function<void()>& func);
+/** Number of -rpcbatchthreads threads. */
+int GetHTTPBatchWorkerCount();
+
 /** Change logging level for libevent. Removes BCLog::LIBEVENT from log categories if
  * libevent doesn't support debug logging.*/
 bool UpdateHTTPServerLogging(bool enable);
@@ -59,6 +70,7 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    std::shared_ptr<HTTPChunkedReply> chunkedReply;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req);
@@ -114,6 +126,28 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, for a body sent in pieces with
+     * WriteReplyChunk and completed with EndChunkedReply.
+     *
+     * @note Call this instead of WriteReply.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /**
+     * Send a piece of the body of a chunked reply. This blocks while too much
+     * of the reply waits to be sent to the client, so that the memory used
+     * does not grow with the size of the reply. Pieces written after the
+     * client went away are dropped.
+     */
+    void WriteReplyChunk(const std::string& chunk);
+
+    /**
+     * Complete a chunked reply. Do not call any other HTTPRequest methods
+     * after calling this.
+     */
+    void EndChunkedReply();
 };
 
 /** Event handler closure.
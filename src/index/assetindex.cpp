@@ -0,0 +1,146 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/assetindex.h>
+#include <issuance.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <map>
+
+constexpr char DB_ISSUANCE_HEIGHT = 'h';
+constexpr char DB_ISSUANCE_ASSET = 'a';
+
+std::unique_ptr<AssetIndex> g_assetindex;
+
+/**
+ * Access to the asset index database (indexes/assets/)
+ *
+ * Only blocks containing issuances are stored. As in the miner statistics
+ * index, the per-height entries are authoritative: the asset entries of a
+ * block replaced by a reorg are erased when its successor at that height is
+ * written.
+ */
+class AssetIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Write the issuances of a newly connected block, replacing any stale entries at its height.
+    bool WriteIssuances(int height, const uint256& block_hash, const std::vector<CAssetIssuanceRecord>& records);
+
+    template <typename Key>
+    bool ReadRange(const Key& prefix, int start_height, int end_height, std::vector<CAssetIssuanceRecord>& records);
+};
+
+AssetIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "assets", n_cache_size, f_memory, f_wipe)
+{}
+
+bool AssetIndex::DB::WriteIssuances(int height, const uint256& block_hash, const std::vector<CAssetIssuanceRecord>& records)
+{
+    CDBBatch batch(*this);
+    std::vector<CAssetIssuanceRecord> stale;
+    if (Read(std::make_pair(DB_ISSUANCE_HEIGHT, DBHeightKey(height)), stale)) {
+        if (!stale.empty() && stale[0].hashBlock == block_hash) {
+            return true;
+        }
+        for (const auto& record : stale) {
+            batch.Erase(std::make_pair(std::make_pair(DB_ISSUANCE_ASSET, record.asset), DBHeightKey(height)));
+        }
+        batch.Erase(std::make_pair(DB_ISSUANCE_HEIGHT, DBHeightKey(height)));
+    } else if (records.empty()) {
+        return true;
+    }
+
+    if (!records.empty()) {
+        std::map<CAsset, std::vector<CAssetIssuanceRecord>> by_asset;
+        for (const auto& record : records) {
+            by_asset[record.asset].push_back(record);
+        }
+        batch.Write(std::make_pair(DB_ISSUANCE_HEIGHT, DBHeightKey(height)), records);
+        for (const auto& entry : by_asset) {
+            batch.Write(std::make_pair(std::make_pair(DB_ISSUANCE_ASSET, entry.first), DBHeightKey(height)), entry.second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+template <typename Key>
+bool AssetIndex::DB::ReadRange(const Key& prefix, int start_height, int end_height,
+                               std::vector<CAssetIssuanceRecord>& records)
+{
+    if (start_height < 0 || start_height > end_height) {
+        return error("%s: invalid height range %d-%d", __func__, start_height, end_height);
+    }
+
+    std::unique_ptr<CDBIterator> db_it(NewIterator());
+    db_it->Seek(std::make_pair(prefix, DBHeightKey(start_height)));
+
+    std::pair<Key, DBHeightKey> key;
+    for (; db_it->Valid(); db_it->Next()) {
+        if (!db_it->GetKey(key) || key.first != prefix || key.second.height > end_height) {
+            break;
+        }
+        std::vector<CAssetIssuanceRecord> block_records;
+        if (!db_it->GetValue(block_records)) {
+            return error("%s: unable to read issuances at height %d", __func__, key.second.height);
+        }
+        records.insert(records.end(), block_records.begin(), block_records.end());
+    }
+    return true;
+}
+
+AssetIndex::AssetIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AssetIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AssetIndex::~AssetIndex() {}
+
+bool AssetIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<CAssetIssuanceRecord> records;
+    for (const auto& tx : block.vtx) {
+        for (uint32_t n = 0; n < tx->vin.size(); n++) {
+            const CAssetIssuance& issuance = tx->vin[n].assetIssuance;
+            if (issuance.IsNull()) {
+                continue;
+            }
+
+            CAssetIssuanceRecord record;
+            // Same derivation as in the issuance checks of VerifyAmounts
+            if (issuance.assetBlindingNonce.IsNull()) {
+                GenerateAssetEntropy(record.entropy, tx->vin[n].prevout, issuance.assetEntropy);
+                CalculateAsset(record.asset, record.entropy);
+                CalculateReissuanceToken(record.token, record.entropy, issuance.nAmount.IsCommitment());
+            } else {
+                record.entropy = issuance.assetEntropy;
+                CalculateAsset(record.asset, record.entropy);
+                record.fReissuance = true;
+            }
+            record.prevout = tx->vin[n].prevout;
+            record.txid = tx->GetHash();
+            record.nVin = n;
+            record.nHeight = pindex->nHeight;
+            record.hashBlock = pindex->GetBlockHash();
+            record.nAmount = issuance.nAmount.IsNull() ? 0 : issuance.nAmount.IsExplicit() ? issuance.nAmount.GetAmount() : -1;
+            record.nInflationKeys = issuance.nInflationKeys.IsNull() ? 0 : issuance.nInflationKeys.IsExplicit() ? issuance.nInflationKeys.GetAmount() : -1;
+            records.push_back(std::move(record));
+        }
+    }
+
+    return m_db->WriteIssuances(pindex->nHeight, pindex->GetBlockHash(), records);
+}
+
+BaseIndex::DB& AssetIndex::GetDB() const { return *m_db; }
+
+bool AssetIndex::LookupRange(int start_height, int end_height, std::vector<CAssetIssuanceRecord>& records) const
+{
+    return m_db->ReadRange(DB_ISSUANCE_HEIGHT, start_height, end_height, records);
+}
+
+bool AssetIndex::FindAssetIssuances(const CAsset& asset, std::vector<CAssetIssuanceRecord>& records) const
+{
+    return m_db->ReadRange(std::make_pair(DB_ISSUANCE_ASSET, asset), 0, std::numeric_limits<int32_t>::max(), records);
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ASSETINDEX_H
+#define BITCOIN_INDEX_ASSETINDEX_H
+
+#include <amount.h>
+#include <asset.h>
+#include <chain.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+static const bool DEFAULT_ASSETINDEX = false;
+
+/**
+ * One asset issuance or reissuance as seen by the asset index. Amounts are
+ * the explicit issued amounts, -1 if the amount was blinded.
+ */
+struct CAssetIssuanceRecord
+{
+    CAsset asset;
+    /** The reissuance token of the asset, null for reissuances (see the initial issuance). */
+    CAsset token;
+    uint256 entropy;
+    /** The outpoint spent by the issuing input. */
+    COutPoint prevout;
+    uint256 txid;
+    uint32_t nVin;
+    int32_t nHeight;
+    uint256 hashBlock;
+    bool fReissuance;
+    CAmount nAmount;
+    CAmount nInflationKeys;
+
+    CAssetIssuanceRecord() { SetNull(); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(asset);
+        READWRITE(token);
+        READWRITE(entropy);
+        READWRITE(prevout);
+        READWRITE(txid);
+        READWRITE(nVin);
+        READWRITE(nHeight);
+        READWRITE(hashBlock);
+        READWRITE(fReissuance);
+        READWRITE(nAmount);
+        READWRITE(nInflationKeys);
+    }
+
+    void SetNull()
+    {
+        asset.SetNull();
+        token.SetNull();
+        entropy.SetNull();
+        prevout.SetNull();
+        txid.SetNull();
+        nVin = 0;
+        nHeight = -1;
+        hashBlock.SetNull();
+        fReissuance = false;
+        nAmount = 0;
+        nInflationKeys = 0;
+    }
+
+    bool IsNull() const { return nHeight < 0; }
+};
+
+/**
+ * AssetIndex records every asset issuance and reissuance of the active chain.
+ * The issuances of a block are stored under its height and duplicated under
+ * (asset, height), so that both a height range and the history of one asset
+ * are a single range scan.
+ */
+class AssetIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "assetindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AssetIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AssetIndex() override;
+
+    /// Get the issuances of all indexed blocks with start_height <= height <= end_height.
+    bool LookupRange(int start_height, int end_height, std::vector<CAssetIssuanceRecord>& records) const;
+
+    /// Get the issuance and all reissuances of asset, in height order.
+    bool FindAssetIssuances(const CAsset& asset, std::vector<CAssetIssuanceRecord>& records) const;
+};
+
+/// The global asset index. May be null.
+extern std::unique_ptr<AssetIndex> g_assetindex;
+
+#endif // BITCOIN_INDEX_ASSETINDEX_H
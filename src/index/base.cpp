@@ -89,7 +89,7 @@ void BaseIndex::ThreadSync()
 {
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
-        auto& consensus_params = Params().GetConsensus();
+        const size_t batch_size = std::max<size_t>(1, GetSyncBatchSize());
 
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
@@ -99,6 +99,7 @@ void BaseIndex::ThreadSync()
                 return;
             }
 
+            std::vector<const CBlockIndex*> batch;
             {
                 LOCK(cs_main);
                 const CBlockIndex* pindex_next = NextSyncBlock(pindex);
@@ -108,32 +109,30 @@ void BaseIndex::ThreadSync()
                     m_synced = true;
                     break;
                 }
-                pindex = pindex_next;
+                batch.push_back(pindex_next);
+                while (batch.size() < batch_size && (pindex_next = chainActive.Next(batch.back()))) {
+                    batch.push_back(pindex_next);
+                }
             }
 
             int64_t current_time = GetTime();
             if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
                 LogPrintf("Syncing %s with block chain from height %d\n",
-                          GetName(), pindex->nHeight);
+                          GetName(), batch.front()->nHeight);
                 last_log_time = current_time;
             }
 
+            if (!WriteBlocks(batch)) {
+                FatalError("%s: Failed to write blocks %s-%s to index database",
+                           __func__, batch.front()->GetBlockHash().ToString(), batch.back()->GetBlockHash().ToString());
+                return;
+            }
+            pindex = batch.back();
+
             if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
                 WriteBestBlock(pindex);
                 last_locator_write_time = current_time;
             }
-
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
-            }
-            if (!WriteBlock(block, pindex)) {
-                FatalError("%s: Failed to write block %s to index database",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
-            }
         }
     }
 
@@ -144,6 +143,23 @@ void BaseIndex::ThreadSync()
     }
 }
 
+bool BaseIndex::WriteBlocks(const std::vector<const CBlockIndex*>& block_indexes)
+{
+    const auto& consensus_params = Params().GetConsensus();
+    for (const CBlockIndex* pindex : block_indexes) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        if (!WriteBlock(block, pindex)) {
+            return error("%s: Failed to write block %s to index database",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+    }
+    return true;
+}
+
 bool BaseIndex::WriteBestBlock(const CBlockIndex* block_index)
 {
     LOCK(cs_main);
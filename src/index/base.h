@@ -69,6 +69,14 @@ protected:
     /// Write update index entries for a newly connected block.
     virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
 
+    /// Maximum number of consecutive blocks the sync thread passes to WriteBlocks at once.
+    virtual size_t GetSyncBatchSize() const { return 1; }
+
+    /// Write update index entries for consecutive blocks of the active chain
+    /// while catching up. Indexes which can build their entries in parallel
+    /// override this; by default the blocks are read and written one by one.
+    virtual bool WriteBlocks(const std::vector<const CBlockIndex*>& block_indexes);
+
     virtual DB& GetDB() const = 0;
 
     /// Get the name of the index for display in logs.
@@ -0,0 +1,455 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockfilterindex.h>
+#include <chainparams.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <atomic>
+#include <thread>
+
+/* The index database stores three items for each block: the disk location of the encoded filter,
+ * its dSHA256 hash, and the header. Those belonging to blocks on the active chain are indexed by
+ * height, and those belonging to blocks that have been reorganized out of the active chain are
+ * indexed by block hash. This ensures that filter data for any block that becomes part of the
+ * active chain can always be retrieved, alleviating timing concerns.
+ *
+ * The filters themselves are stored in flat files and referenced by the LevelDB entries. This
+ * minimizes the amount of data written to LevelDB and keeps the database values constant size.
+ * The disk location of the next block filter to be written (represented as a CDiskBlockPos) is
+ * stored under the DB_FILTER_POS key.
+ *
+ * Keys for the height index have the type [DB_BLOCK_HEIGHT, DBHeightKey] and values are
+ * [block hash, DBVal]. Keys for the hash index have the type [DB_BLOCK_HASH, uint256] and
+ * values are DBVal.
+ */
+constexpr char DB_BLOCK_HASH = 's';
+constexpr char DB_BLOCK_HEIGHT = 't';
+constexpr char DB_FILTER_POS = 'P';
+
+constexpr unsigned int MAX_FLTR_FILE_SIZE = 0x1000000; // 16 MiB
+/** The pre-allocation chunk size for fltr?????.dat files */
+constexpr unsigned int FLTR_FILE_CHUNK_SIZE = 0x100000; // 1 MiB
+
+/** Number of blocks whose filters are built concurrently while the index catches up. */
+constexpr size_t FILTER_SYNC_BLOCKS_PER_THREAD = 32;
+
+std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+namespace {
+
+struct DBVal {
+    uint256 hash;
+    uint256 header;
+    CDiskBlockPos pos;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hash);
+        READWRITE(header);
+        READWRITE(pos);
+    }
+};
+
+} // namespace
+
+class BlockFilterIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(const fs::path& path, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the entry of a block, in the height index if it is the block
+    /// indexed at its height and in the hash index otherwise.
+    bool LookupOne(const CBlockIndex* block_index, DBVal& result) const;
+
+    /// Look up the entries of the blocks between start_height and stop_index on its chain.
+    bool LookupRange(int start_height, const CBlockIndex* stop_index, std::vector<DBVal>& results) const;
+
+    /// Move the entry indexed at height to the hash index if it belongs to another block than
+    /// block_hash, so that it stays available after its block has been reorganized out.
+    void MoveStaleEntry(CDBBatch& batch, int height, const uint256& block_hash) const;
+};
+
+BlockFilterIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(path, n_cache_size, f_memory, f_wipe)
+{}
+
+bool BlockFilterIndex::DB::LookupOne(const CBlockIndex* block_index, DBVal& result) const
+{
+    // First check if the result is stored under the height index and the value there matches the
+    // block hash. This should be the case if the block is on the active chain.
+    std::pair<uint256, DBVal> read_out;
+    if (!Read(std::make_pair(DB_BLOCK_HEIGHT, DBHeightKey(block_index->nHeight)), read_out)) {
+        return false;
+    }
+    if (read_out.first == block_index->GetBlockHash()) {
+        result = std::move(read_out.second);
+        return true;
+    }
+
+    // If value at the height index corresponds to an different block, the result will be stored in
+    // the hash index.
+    return Read(std::make_pair(DB_BLOCK_HASH, block_index->GetBlockHash()), result);
+}
+
+bool BlockFilterIndex::DB::LookupRange(int start_height, const CBlockIndex* stop_index,
+                                       std::vector<DBVal>& results) const
+{
+    if (start_height < 0) {
+        return error("%s: start height (%d) is negative", __func__, start_height);
+    }
+    if (start_height > stop_index->nHeight) {
+        return error("%s: start height (%d) is greater than stop height (%d)",
+                     __func__, start_height, stop_index->nHeight);
+    }
+
+    size_t results_size = static_cast<size_t>(stop_index->nHeight - start_height + 1);
+    std::vector<std::pair<uint256, DBVal>> values(results_size);
+
+    std::unique_ptr<CDBIterator> db_it(const_cast<DB*>(this)->NewIterator());
+    db_it->Seek(std::make_pair(DB_BLOCK_HEIGHT, DBHeightKey(start_height)));
+    for (int height = start_height; height <= stop_index->nHeight; ++height) {
+        std::pair<char, DBHeightKey> key;
+        if (!db_it->Valid() || !db_it->GetKey(key) || key.first != DB_BLOCK_HEIGHT ||
+            key.second.height != height) {
+            return false;
+        }
+
+        size_t i = static_cast<size_t>(height - start_height);
+        if (!db_it->GetValue(values[i])) {
+            return error("%s: unable to read value in %s at key (%c, %d)",
+                         __func__, "blockfilterindex", DB_BLOCK_HEIGHT, height);
+        }
+
+        db_it->Next();
+    }
+
+    results.resize(results_size);
+
+    // Iterate backwards through block indexes collecting results in order to access the block hash
+    // of each entry in case we need to look it up in the hash index.
+    for (const CBlockIndex* block_index = stop_index;
+         block_index && block_index->nHeight >= start_height;
+         block_index = block_index->pprev) {
+        uint256 block_hash = block_index->GetBlockHash();
+
+        size_t i = static_cast<size_t>(block_index->nHeight - start_height);
+        if (block_hash == values[i].first) {
+            results[i] = std::move(values[i].second);
+            continue;
+        }
+
+        if (!Read(std::make_pair(DB_BLOCK_HASH, block_hash), results[i])) {
+            return error("%s: unable to read value in %s at key (%c, %s)",
+                         __func__, "blockfilterindex", DB_BLOCK_HASH, block_hash.ToString());
+        }
+    }
+
+    return true;
+}
+
+void BlockFilterIndex::DB::MoveStaleEntry(CDBBatch& batch, int height, const uint256& block_hash) const
+{
+    std::pair<uint256, DBVal> stale;
+    if (Read(std::make_pair(DB_BLOCK_HEIGHT, DBHeightKey(height)), stale) && stale.first != block_hash) {
+        batch.Write(std::make_pair(DB_BLOCK_HASH, stale.first), stale.second);
+    }
+}
+
+BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type,
+                                   size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_filter_type(filter_type)
+{
+    const std::string& filter_name = BlockFilterTypeName(filter_type);
+    if (filter_name.empty()) throw std::invalid_argument("unknown filter_type");
+
+    fs::path path = GetDataDir() / "indexes" / "blockfilter" / filter_name;
+    fs::create_directories(path);
+
+    m_name = filter_name + " block filter index";
+    m_db = MakeUnique<BlockFilterIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+    m_filter_dir = path;
+}
+
+BlockFilterIndex::~BlockFilterIndex() {}
+
+bool BlockFilterIndex::Init()
+{
+    if (!m_db->Read(DB_FILTER_POS, m_next_filter_pos)) {
+        // Check that the cause of the read failure is that the key does not exist. Any other errors
+        // indicate database corruption or a disk failure, and starting the index would cause
+        // further corruption.
+        if (m_db->Exists(DB_FILTER_POS)) {
+            return error("%s: Cannot read current %s state; index may be corrupted",
+                         __func__, GetName());
+        }
+
+        // If the DB_FILTER_POS is not set, then initialize to the first location.
+        m_next_filter_pos.nFile = 0;
+        m_next_filter_pos.nPos = 0;
+    }
+    return BaseIndex::Init();
+}
+
+FILE* BlockFilterIndex::OpenFilterFile(const CDiskBlockPos& pos, bool read_only) const
+{
+    if (pos.IsNull()) {
+        return nullptr;
+    }
+    fs::path path = m_filter_dir / strprintf("fltr%05u.dat", pos.nFile);
+    FILE* file = fsbridge::fopen(path, read_only ? "rb" : "rb+");
+    if (!file && !read_only) {
+        file = fsbridge::fopen(path, "wb+");
+    }
+    if (!file) {
+        LogPrintf("Unable to open file %s\n", path.string());
+        return nullptr;
+    }
+    if (pos.nPos && fseek(file, pos.nPos, SEEK_SET)) {
+        LogPrintf("Unable to seek to position %u of %s\n", pos.nPos, path.string());
+        fclose(file);
+        return nullptr;
+    }
+    return file;
+}
+
+bool BlockFilterIndex::ReadFilterFromDisk(const CDiskBlockPos& pos, const uint256& filter_hash, BlockFilter& filter) const
+{
+    CAutoFile filein(OpenFilterFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return false;
+    }
+
+    uint256 block_hash;
+    std::vector<unsigned char> encoded_filter;
+    try {
+        filein >> block_hash >> encoded_filter;
+        filter = BlockFilter(GetFilterType(), block_hash, std::move(encoded_filter));
+    }
+    catch (const std::exception& e) {
+        return error("%s: Failed to deserialize block filter from disk: %s", __func__, e.what());
+    }
+
+    if (filter.GetHash() != filter_hash) {
+        return error("%s: Checksum mismatch in filter of block %s", __func__, block_hash.ToString());
+    }
+    return true;
+}
+
+size_t BlockFilterIndex::WriteFilterToDisk(CDiskBlockPos& pos, const BlockFilter& filter)
+{
+    assert(filter.GetFilterType() == GetFilterType());
+
+    size_t data_size =
+        GetSerializeSize(filter.GetBlockHash(), CLIENT_VERSION) +
+        GetSerializeSize(filter.GetEncodedFilter(), CLIENT_VERSION);
+
+    // If writing the filter would overflow the file, flush and move to the next one.
+    if (pos.nPos + data_size > MAX_FLTR_FILE_SIZE) {
+        CAutoFile last_file(OpenFilterFile(pos), SER_DISK, CLIENT_VERSION);
+        if (last_file.IsNull()) {
+            LogPrintf("%s: Failed to open filter file %d\n", __func__, pos.nFile);
+            return 0;
+        }
+        if (!TruncateFile(last_file.Get(), pos.nPos)) {
+            LogPrintf("%s: Failed to truncate filter file %d\n", __func__, pos.nFile);
+            return 0;
+        }
+        if (!FileCommit(last_file.Get())) {
+            LogPrintf("%s: Failed to commit filter file %d\n", __func__, pos.nFile);
+            return 0;
+        }
+
+        pos.nFile++;
+        pos.nPos = 0;
+    }
+
+    CAutoFile fileout(OpenFilterFile(pos), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        LogPrintf("%s: Failed to open filter file %d\n", __func__, pos.nFile);
+        return 0;
+    }
+
+    // Pre-allocate sufficient space for filter data, in chunks like the block files.
+    unsigned int old_chunks = (pos.nPos + FLTR_FILE_CHUNK_SIZE - 1) / FLTR_FILE_CHUNK_SIZE;
+    unsigned int new_chunks = (pos.nPos + data_size + FLTR_FILE_CHUNK_SIZE - 1) / FLTR_FILE_CHUNK_SIZE;
+    if (new_chunks > old_chunks) {
+        AllocateFileRange(fileout.Get(), pos.nPos, new_chunks * FLTR_FILE_CHUNK_SIZE - pos.nPos);
+        if (fseek(fileout.Get(), pos.nPos, SEEK_SET)) {
+            LogPrintf("%s: Failed to seek in filter file %d\n", __func__, pos.nFile);
+            return 0;
+        }
+    }
+
+    fileout << filter.GetBlockHash() << filter.GetEncodedFilter();
+    return data_size;
+}
+
+bool BlockFilterIndex::WriteFilters(const std::vector<BlockFilter>& filters,
+                                    const std::vector<const CBlockIndex*>& block_indexes)
+{
+    assert(filters.size() == block_indexes.size());
+    if (filters.empty()) {
+        return true;
+    }
+
+    uint256 prev_header;
+    if (block_indexes.front()->nHeight > 0) {
+        DBVal read_out;
+        if (!m_db->LookupOne(block_indexes.front()->pprev, read_out)) {
+            return error("%s: Failed to read the filter header of the parent of block %s",
+                         __func__, block_indexes.front()->GetBlockHash().ToString());
+        }
+        prev_header = read_out.header;
+    }
+
+    CDBBatch batch(*m_db);
+    for (size_t i = 0; i < filters.size(); ++i) {
+        const CBlockIndex* pindex = block_indexes[i];
+
+        CDiskBlockPos pos = m_next_filter_pos;
+        size_t bytes_written = WriteFilterToDisk(pos, filters[i]);
+        if (bytes_written == 0) return false;
+
+        m_db->MoveStaleEntry(batch, pindex->nHeight, pindex->GetBlockHash());
+
+        std::pair<uint256, DBVal> value;
+        value.first = pindex->GetBlockHash();
+        value.second.hash = filters[i].GetHash();
+        value.second.header = filters[i].ComputeHeader(prev_header);
+        value.second.pos = pos;
+        batch.Write(std::make_pair(DB_BLOCK_HEIGHT, DBHeightKey(pindex->nHeight)), value);
+
+        prev_header = value.second.header;
+        m_next_filter_pos = pos;
+        m_next_filter_pos.nPos += bytes_written;
+    }
+
+    // Make the filters durable before the database refers to them.
+    CAutoFile file(OpenFilterFile(m_next_filter_pos), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull() || !FileCommit(file.Get())) {
+        return error("%s: Failed to commit filter file %d", __func__, m_next_filter_pos.nFile);
+    }
+
+    batch.Write(DB_FILTER_POS, m_next_filter_pos);
+    return m_db->WriteBatch(batch);
+}
+
+bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo block_undo;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+
+    std::vector<BlockFilter> filters;
+    filters.emplace_back(m_filter_type, block, block_undo);
+    return WriteFilters(filters, {pindex});
+}
+
+size_t BlockFilterIndex::GetSyncBatchSize() const
+{
+    return FILTER_SYNC_BLOCKS_PER_THREAD * std::max(1, nScriptCheckThreads);
+}
+
+bool BlockFilterIndex::WriteBlocks(const std::vector<const CBlockIndex*>& block_indexes)
+{
+    // Reading the blocks and undo data and building the filters does not depend
+    // on the other blocks, so it is spread over the script verification thread
+    // count. Only chaining the headers and appending to the files is sequential.
+    const auto& consensus_params = Params().GetConsensus();
+    std::vector<BlockFilter> filters(block_indexes.size());
+    std::atomic<bool> all_ok{true};
+
+    const size_t n_threads = std::min(block_indexes.size(), static_cast<size_t>(std::max(1, nScriptCheckThreads)));
+    auto build_filters = [&](size_t offset) {
+        for (size_t i = offset; i < block_indexes.size() && all_ok; i += n_threads) {
+            const CBlockIndex* pindex = block_indexes[i];
+            CBlock block;
+            CBlockUndo block_undo;
+            if (!ReadBlockFromDisk(block, pindex, consensus_params) ||
+                (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex))) {
+                error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+                all_ok = false;
+                return;
+            }
+            filters[i] = BlockFilter(m_filter_type, block, block_undo);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < n_threads; ++t) {
+        threads.emplace_back(build_filters, t);
+    }
+    build_filters(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    return all_ok && WriteFilters(filters, block_indexes);
+}
+
+BaseIndex::DB& BlockFilterIndex::GetDB() const { return *m_db; }
+
+bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
+{
+    DBVal entry;
+    if (!m_db->LookupOne(block_index, entry)) {
+        return false;
+    }
+
+    return ReadFilterFromDisk(entry.pos, entry.hash, filter_out);
+}
+
+bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const
+{
+    DBVal entry;
+    if (!m_db->LookupOne(block_index, entry)) {
+        return false;
+    }
+
+    header_out = entry.header;
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* stop_index,
+                                         std::vector<BlockFilter>& filters_out) const
+{
+    std::vector<DBVal> entries;
+    if (!m_db->LookupRange(start_height, stop_index, entries)) {
+        return false;
+    }
+
+    filters_out.resize(entries.size());
+    auto filter_pos_it = filters_out.begin();
+    for (const auto& entry : entries) {
+        if (!ReadFilterFromDisk(entry.pos, entry.hash, *filter_pos_it)) {
+            return false;
+        }
+        ++filter_pos_it;
+    }
+
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                                             std::vector<uint256>& hashes_out) const
+{
+    std::vector<DBVal> entries;
+    if (!m_db->LookupRange(start_height, stop_index, entries)) {
+        return false;
+    }
+
+    hashes_out.clear();
+    hashes_out.reserve(entries.size());
+    for (const auto& entry : entries) {
+        hashes_out.push_back(entry.hash);
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BLOCKFILTERINDEX_H
+#define BITCOIN_INDEX_BLOCKFILTERINDEX_H
+
+#include <blockfilter.h>
+#include <chain.h>
+#include <fs.h>
+#include <index/base.h>
+
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
+
+/**
+ * BlockFilterIndex is used to store and retrieve block filters, hashes, and headers
+ * for a range of blocks by height. An index is constructed for each supported filter
+ * type with its own database (ie. filter data for different types are stored in
+ * separate databases).
+ *
+ * The filters themselves are appended to flat files (fltr?????.dat) next to the
+ * database, which only stores their positions together with the filter hashes
+ * and headers.
+ *
+ * This index is used to serve BIP 157 net requests.
+ */
+class BlockFilterIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    BlockFilterType m_filter_type;
+    std::string m_name;
+    std::unique_ptr<DB> m_db;
+
+    fs::path m_filter_dir;
+    /** Position at which the next filter is appended. Only used by the thread writing the index. */
+    CDiskBlockPos m_next_filter_pos;
+
+    FILE* OpenFilterFile(const CDiskBlockPos& pos, bool read_only = false) const;
+    bool ReadFilterFromDisk(const CDiskBlockPos& pos, const uint256& filter_hash, BlockFilter& filter) const;
+    size_t WriteFilterToDisk(CDiskBlockPos& pos, const BlockFilter& filter);
+
+    /// Append the filters of consecutive blocks to the flat files and index them.
+    bool WriteFilters(const std::vector<BlockFilter>& filters, const std::vector<const CBlockIndex*>& block_indexes);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    size_t GetSyncBatchSize() const override;
+
+    bool WriteBlocks(const std::vector<const CBlockIndex*>& block_indexes) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return m_name.c_str(); }
+
+public:
+    /** Constructs the index, which becomes available to be queried. */
+    explicit BlockFilterIndex(BlockFilterType filter_type,
+                              size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~BlockFilterIndex() override;
+
+    BlockFilterType GetFilterType() const { return m_filter_type; }
+
+    /** Get a single filter by block. */
+    bool LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const;
+
+    /** Get a single filter header by block. */
+    bool LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) const;
+
+    /** Get a range of filters between two heights on a chain. */
+    bool LookupFilterRange(int start_height, const CBlockIndex* stop_index,
+                           std::vector<BlockFilter>& filters_out) const;
+
+    /** Get a range of filter hashes between two heights on a chain. */
+    bool LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
+                               std::vector<uint256>& hashes_out) const;
+};
+
+/// The global basic block filter index. May be null.
+extern std::unique_ptr<BlockFilterIndex> g_blockfilterindex;
+
+#endif // BITCOIN_INDEX_BLOCKFILTERINDEX_H
@@ -0,0 +1,134 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/minerstatsindex.h>
+#include <script/script.h>
+#include <util/system.h>
+#include <validation.h>
+
+constexpr char DB_FORGE_HEIGHT = 'h';
+constexpr char DB_FORGE_PLOTID = 'p';
+constexpr char DB_FORGE_KEYID = 'k';
+
+std::unique_ptr<MinerStatsIndex> g_minerstatsindex;
+
+/**
+ * Access to the miner statistics database (indexes/minerstats/)
+ *
+ * The per-height records are authoritative: when a block at a height that is
+ * already indexed gets connected (after a reorg), the generator entry of the
+ * replaced block is erased before the new one is written.
+ */
+class MinerStatsIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Write the record of a newly connected block, replacing any stale record at its height.
+    bool WriteRecord(const CForgeRecord& record);
+
+    template <typename Key>
+    bool ReadRange(const Key& prefix, int start_height, int end_height, std::vector<CForgeRecord>& records);
+};
+
+MinerStatsIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "minerstats", n_cache_size, f_memory, f_wipe)
+{}
+
+static void WriteGeneratorEntry(CDBBatch& batch, const CForgeRecord& record, bool erase)
+{
+    if (record.nPlotID != 0) {
+        auto key = std::make_pair(std::make_pair(DB_FORGE_PLOTID, record.nPlotID), DBHeightKey(record.nHeight));
+        if (erase) batch.Erase(key); else batch.Write(key, record);
+    } else {
+        auto key = std::make_pair(std::make_pair(DB_FORGE_KEYID, record.nPublicKeyID), DBHeightKey(record.nHeight));
+        if (erase) batch.Erase(key); else batch.Write(key, record);
+    }
+}
+
+bool MinerStatsIndex::DB::WriteRecord(const CForgeRecord& record)
+{
+    CDBBatch batch(*this);
+    CForgeRecord stale;
+    if (Read(std::make_pair(DB_FORGE_HEIGHT, DBHeightKey(record.nHeight)), stale) &&
+        stale.hashBlock != record.hashBlock) {
+        WriteGeneratorEntry(batch, stale, true);
+    }
+    batch.Write(std::make_pair(DB_FORGE_HEIGHT, DBHeightKey(record.nHeight)), record);
+    WriteGeneratorEntry(batch, record, false);
+    return WriteBatch(batch);
+}
+
+template <typename Key>
+bool MinerStatsIndex::DB::ReadRange(const Key& prefix, int start_height, int end_height,
+                                    std::vector<CForgeRecord>& records)
+{
+    if (start_height < 0 || start_height > end_height) {
+        return error("%s: invalid height range %d-%d", __func__, start_height, end_height);
+    }
+
+    std::unique_ptr<CDBIterator> db_it(NewIterator());
+    db_it->Seek(std::make_pair(prefix, DBHeightKey(start_height)));
+
+    std::pair<Key, DBHeightKey> key;
+    for (; db_it->Valid(); db_it->Next()) {
+        if (!db_it->GetKey(key) || key.first != prefix || key.second.height > end_height) {
+            break;
+        }
+        CForgeRecord record;
+        if (!db_it->GetValue(record)) {
+            return error("%s: unable to read record at height %d", __func__, key.second.height);
+        }
+        records.push_back(std::move(record));
+    }
+    return true;
+}
+
+MinerStatsIndex::MinerStatsIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<MinerStatsIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+MinerStatsIndex::~MinerStatsIndex() {}
+
+bool MinerStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CForgeRecord record;
+    record.nHeight = pindex->nHeight;
+    record.hashBlock = pindex->GetBlockHash();
+    record.nTime = block.nTime;
+    record.nPlotID = block.nPlotID;
+    record.nPublicKeyID = block.nPublicKeyID;
+    record.nBaseTarget = block.nBaseTarget;
+    record.nDeadline = block.nDeadline;
+
+    // Same layout as checked in ConnectBlock: the coinbase commits to the
+    // firestone spent by the second transaction of the block.
+    if (block.vtx.size() >= 2 && !block.vtx[1]->vin.empty()) {
+        const COutPoint& out = block.vtx[1]->vin[0].prevout;
+        if (block.vtx[0]->vin[0].scriptSig == CScript() << pindex->nHeight << ToByteVector(out.hash) << out.n << OP_0) {
+            record.firestone = out;
+        }
+    }
+
+    return m_db->WriteRecord(record);
+}
+
+BaseIndex::DB& MinerStatsIndex::GetDB() const { return *m_db; }
+
+bool MinerStatsIndex::LookupRange(int start_height, int end_height, std::vector<CForgeRecord>& records) const
+{
+    return m_db->ReadRange(DB_FORGE_HEIGHT, start_height, end_height, records);
+}
+
+bool MinerStatsIndex::FindBlocksByPlotID(uint64_t plot_id, int start_height, int end_height,
+                                         std::vector<CForgeRecord>& records) const
+{
+    return m_db->ReadRange(std::make_pair(DB_FORGE_PLOTID, plot_id), start_height, end_height, records);
+}
+
+bool MinerStatsIndex::FindBlocksByKeyID(const uint160& key_id, int start_height, int end_height,
+                                        std::vector<CForgeRecord>& records) const
+{
+    return m_db->ReadRange(std::make_pair(DB_FORGE_KEYID, key_id), start_height, end_height, records);
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_MINERSTATSINDEX_H
+#define BITCOIN_INDEX_MINERSTATSINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+static const bool DEFAULT_MINERSTATSINDEX = false;
+
+/**
+ * One forged block as seen by the miner statistics index. PoC2 blocks are
+ * attributed to nPlotID, PoC2.x blocks (nPlotID == 0) to nPublicKeyID.
+ */
+struct CForgeRecord
+{
+    int32_t nHeight;
+    uint256 hashBlock;
+    uint32_t nTime;
+    uint64_t nPlotID;
+    uint160 nPublicKeyID;
+    uint64_t nBaseTarget;
+    uint64_t nDeadline;
+    /** The firestone spent by the block's second transaction, null if the block was forged without one. */
+    COutPoint firestone;
+
+    CForgeRecord() { SetNull(); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nHeight);
+        READWRITE(hashBlock);
+        READWRITE(nTime);
+        READWRITE(nPlotID);
+        READWRITE(nPublicKeyID);
+        READWRITE(nBaseTarget);
+        READWRITE(nDeadline);
+        READWRITE(firestone);
+    }
+
+    void SetNull()
+    {
+        nHeight = -1;
+        hashBlock.SetNull();
+        nTime = 0;
+        nPlotID = 0;
+        nPublicKeyID.SetNull();
+        nBaseTarget = 0;
+        nDeadline = 0;
+        firestone.SetNull();
+    }
+
+    bool IsNull() const { return nHeight < 0; }
+
+    bool UsesFirestone() const { return !firestone.IsNull(); }
+
+    /** The deadline of the block in seconds. */
+    uint64_t DeadlineSeconds() const { return nBaseTarget == 0 ? 0 : nDeadline / nBaseTarget; }
+};
+
+/**
+ * MinerStatsIndex records the generator, deadline, base target and firestone
+ * usage of every block in the active chain. Records are stored by height and
+ * duplicated under (plot id, height) or (public key id, height) so that the
+ * blocks forged by one generator can be found with a single range scan.
+ */
+class MinerStatsIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "minerstatsindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit MinerStatsIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~MinerStatsIndex() override;
+
+    /// Get the records of all indexed blocks with start_height <= height <= end_height.
+    bool LookupRange(int start_height, int end_height, std::vector<CForgeRecord>& records) const;
+
+    /// Get the records of the PoC2 blocks forged by plot_id with start_height <= height <= end_height.
+    bool FindBlocksByPlotID(uint64_t plot_id, int start_height, int end_height,
+                            std::vector<CForgeRecord>& records) const;
+
+    /// Get the records of the PoC2.x blocks forged by key_id with start_height <= height <= end_height.
+    bool FindBlocksByKeyID(const uint160& key_id, int start_height, int end_height,
+                           std::vector<CForgeRecord>& records) const;
+};
+
+/// The global miner statistics index. May be null.
+extern std::unique_ptr<MinerStatsIndex> g_minerstatsindex;
+
+#endif // BITCOIN_INDEX_MINERSTATSINDEX_H
@@ -15,6 +15,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
+#include <coinsprefetcher.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
 #include <issuance.h>
@@ -22,6 +23,9 @@
 #include <httpserver.h>
 #include <httprpc.h>
 #include <interfaces/chain.h>
+#include <index/assetindex.h>
+#include <index/blockfilterindex.h>
+#include <index/minerstatsindex.h>
 #include <index/txindex.h>
 #include <key.h>
 #include <validation.h>
@@ -32,6 +36,7 @@
 #include <policy/feerate.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
+#include <pocverify.h>
 #include <rpc/server.h>
 #include <rpc/register.h>
 #include <rpc/blockchain.h>
@@ -40,6 +45,7 @@
 #include <script/sigcache.h>
 #include <scheduler.h>
 #include <shutdown.h>
+#include <snapshot.h>
 #include <timedata.h>
 #include <txdb.h>
 #include <actiondb.h>
@@ -178,7 +184,17 @@ static std::unique_ptr<CCoinsViewErrorCatcher> pcoinscatcher;
 static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 static boost::thread_group threadGroup;
+/**
+ * The scheduler is split in lanes, each serviced by its own thread, so that
+ * tasks on one lane never wait behind the tasks of another: forging is not
+ * delayed by wallet notifications or database dumps, and does not delay them.
+ */
+//! Validation interface callbacks and peer maintenance
 static CScheduler scheduler;
+//! Deadline checks and block cache releases, which are time critical
+static CScheduler forgingScheduler;
+//! Periodic dumps and flushes to disk, serviced at a lower priority
+static CScheduler maintenanceScheduler;
 
 void Interrupt()
 {
@@ -193,6 +209,17 @@ void Interrupt()
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_minerstatsindex) {
+        g_minerstatsindex->Interrupt();
+    }
+    if (g_assetindex) {
+        g_assetindex->Interrupt();
+    }
+    if (g_blockfilterindex) {
+        g_blockfilterindex->Interrupt();
+    }
+    InterruptSnapshotValidation();
+    InterruptPocVerification();
 }
 
 void Shutdown(InitInterfaces& interfaces)
@@ -224,6 +251,11 @@ void Shutdown(InitInterfaces& interfaces)
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
+    if (g_minerstatsindex) g_minerstatsindex->Stop();
+    if (g_assetindex) g_assetindex->Stop();
+    if (g_blockfilterindex) g_blockfilterindex->Stop();
+    StopSnapshotValidation();
+    StopPocVerification();
 
     StopTorControl();
 
@@ -231,6 +263,7 @@ void Shutdown(InitInterfaces& interfaces)
     // CScheduler/checkqueue threadGroup
     threadGroup.interrupt_all();
     threadGroup.join_all();
+    g_coins_prefetcher.reset();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
@@ -238,6 +271,9 @@ void Shutdown(InitInterfaces& interfaces)
     g_connman.reset();
     g_banman.reset();
     g_txindex.reset();
+    g_minerstatsindex.reset();
+    g_assetindex.reset();
+    g_blockfilterindex.reset();
 
     if (g_is_mempool_loaded && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
@@ -306,6 +342,7 @@ void Shutdown(InitInterfaces& interfaces)
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    LogInstance().StopAsyncWriter();
 }
 
 /**
@@ -378,6 +415,8 @@ void SetupServerArgs()
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify blocks directory (default: <datadir>/blocks)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-assetindex", strprintf("Maintain an index of all asset issuances and reissuances, used by the getassetinfo and listassetissuances rpc calls (default: %u)", DEFAULT_ASSETINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockfilterindex", strprintf("Maintain an index of BIP 158 basic compact block filters, which also commit to firestone owners and issued assets, used by the getblockfilter rpc call (default: %u)", DEFAULT_BLOCKFILTERINDEX), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to operate in a blocks only mode (default: %u)", DEFAULT_BLOCKSONLY), true, OptionsCategory::OPTIONS);
@@ -389,14 +428,17 @@ void SetupServerArgs()
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-loadsnapshot=<file>", "Replace the chain state with a snapshot written by dumpsnapshot on startup. The blocks up to the snapshot base must be on disk, they are validated in the background. Ignored once the chain state is past the snapshot base", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minimumcumulativediff=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumCumulativeDiff.GetHex(), testnetChainParams->GetConsensus().nMinimumCumulativeDiff.GetHex()), true, OptionsCategory::OPTIONS);
-    gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+    gArgs.AddArg("-minerstatsindex", strprintf("Maintain an index of the generator, deadline and firestone of every block, used by the getminerstats and listforgedblocks rpc calls (default: %u)", DEFAULT_MINERSTATSINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads, which also check the blocks read by -reindex and -loadblock (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-prefetchthreads=<n>", strprintf("Number of threads reading the coins spent by a block from the chain state database before it is connected (0 to %d, 0 = disable, default: %d)", MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), false, OptionsCategory::OPTIONS);
@@ -425,14 +467,17 @@ void SetupServerArgs()
     gArgs.AddArg("-maxreceivebuffer=<n>", strprintf("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXRECEIVEBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msghandlerthreads=<n>", strprintf("Number of threads processing peer messages, each handling a share of the peers (1 to %d, default: %d)", MAX_MSGHANDLER_THREADS, DEFAULT_MSGHANDLER_THREADS), true, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-peerblockfilters", strprintf("Serve compact block filters to peers per BIP 157 (default: %u)", DEFAULT_PEERBLOCKFILTERS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-permitbaremultisig", strprintf("Relay non-P2SH multisig (default: %u)", DEFAULT_PERMIT_BAREMULTISIG), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-port=<port>", strprintf("Listen for connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultChainParams->GetDefaultPort(), testnetChainParams->GetDefaultPort(), regtestChainParams->GetDefaultPort()), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-relaypendingblocks", strprintf("Exchange fully validated blocks with peers that opt in before their deadline matures, so they activate without relay delay (default: %u)", DEFAULT_RELAYPENDINGBLOCKS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), true, OptionsCategory::CONNECTION);
@@ -497,6 +542,7 @@ void SetupServerArgs()
     gArgs.AddArg("-debug=<category>", "Output debugging information (default: -nodebug, supplying <category> is optional). "
         "If <category> is not supplied or if <category> = 1, output all debugging information. <category> can be: " + ListLogCategories() + ".", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-debugexclude=<category>", strprintf("Exclude debugging information for a category. Can be used in conjunction with -debug=1 to output debug logs for all categories except one or more specified categories."), false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-asynclogging", strprintf("Write debug output from a background thread, so that logging never waits for disk or console I/O. Messages are dropped while the thread is %u messages behind, and the last ones are lost if the node crashes (default: %u)", ASYNC_LOG_QUEUE_SIZE, DEFAULT_ASYNCLOGGING), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), true, OptionsCategory::DEBUG_TEST);
@@ -532,6 +578,7 @@ void SetupServerArgs()
     gArgs.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcauth=<userpw>", "Username and HMAC-SHA-256 hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcbatchthreads=<n>", strprintf("Set the number of threads that execute the requests of JSON-RPC batches concurrently. With more than 0, the requests of a batch run in no particular order and must not depend on each other (default: %d, one after the other)", DEFAULT_HTTP_BATCH_THREADS), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcbind=<addr>[:port]", "Bind to given address to listen for JSON-RPC connections. Do not expose the RPC server to untrusted networks such as the public internet! This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost)", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpccookiefile=<loc>", "Location of the auth cookie. Relative paths will be prefixed by a net-specific datadir location. (default: data dir)", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcpassword=<pw>", "Password for JSON-RPC connections", false, OptionsCategory::RPC);
@@ -666,6 +713,7 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
 
     {
     CImportingNow imp;
+    CImportPocScope poc_scope;
 
     // -reindex
     if (fReindex) {
@@ -962,6 +1010,17 @@ bool AppInitParameterInteraction()
         return InitError(_("Prune mode is incompatible with -txindex."));
     }
 
+    if (gArgs.IsArgSet("-loadsnapshot") &&
+        (gArgs.GetBoolArg("-reindex", false) || gArgs.GetBoolArg("-reindex-chainstate", false))) {
+        return InitError(_("-loadsnapshot is incompatible with -reindex and -reindex-chainstate."));
+    }
+
+    // Serving compact filters requires the filter index
+    if (gArgs.GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS) &&
+        !gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        return InitError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+    }
+
     // -bind and -whitebind can't be set when not listening
     size_t nUserBind = gArgs.GetArgs("-bind").size() + gArgs.GetArgs("-whitebind").size();
     if (nUserBind != 0 && !gArgs.GetBoolArg("-listen", DEFAULT_LISTEN)) {
@@ -1156,6 +1215,9 @@ bool AppInitParameterInteraction()
     if (gArgs.GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    if (gArgs.GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS))
+        nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
+
     if (gArgs.GetArg("-rpcserialversion", DEFAULT_RPC_SERIALIZE_VERSION) < 0)
         return InitError("rpcserialversion must be non-negative.");
 
@@ -1241,6 +1303,9 @@ bool AppInitMain(InitInterfaces& interfaces)
                 LogInstance().m_file_path.string()));
         }
     }
+    if (gArgs.GetBoolArg("-asynclogging", DEFAULT_ASYNCLOGGING)) {
+        LogInstance().StartAsyncWriter();
+    }
 
     if (!LogInstance().m_log_timestamps)
         LogPrintf("Startup time: %s\n", FormatISO8601DateTime(GetTime()));
@@ -1272,6 +1337,7 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitActionCache();
     InitRangeproofCache();
     InitSurjectionproofCache();
 
@@ -1281,9 +1347,23 @@ bool AppInitMain(InitInterfaces& interfaces)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
-    // Start the lightweight task scheduler thread
+    int prefetch_threads = std::max(0, std::min<int>(gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS), MAX_PREFETCH_THREADS));
+    if (prefetch_threads) {
+        LogPrintf("Using %u threads for prefetching block inputs\n", prefetch_threads);
+        g_coins_prefetcher = MakeUnique<CCoinsPrefetcher>();
+        g_coins_prefetcher->Start(prefetch_threads);
+    }
+
+    // Start the lightweight task scheduler threads, one per lane
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    CScheduler::Function forgingLoop = std::bind(&CScheduler::serviceQueue, &forgingScheduler);
+    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "forging", forgingLoop));
+    CScheduler::Function maintenanceLoop = [] {
+        ScheduleBatchPriority();
+        maintenanceScheduler.serviceQueue();
+    };
+    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "maintenance", maintenanceLoop));
 
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
     GetMainSignals().RegisterWithMempoolSignals(mempool);
@@ -1341,7 +1421,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     assert(!g_connman);
     g_connman = std::unique_ptr<CConnman>(new CConnman(GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max())));
 
-    peerLogic.reset(new PeerLogicValidation(g_connman.get(), g_banman.get(), scheduler, gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61)));
+    peerLogic.reset(new PeerLogicValidation(g_connman.get(), g_banman.get(), scheduler, gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61), gArgs.GetBoolArg("-relaypendingblocks", DEFAULT_RELAYPENDINGBLOCKS)));
     RegisterValidationInterface(peerLogic.get());
 
     // sanitize comments per BIP-0014, format user agent and check total size
@@ -1457,6 +1537,21 @@ bool AppInitMain(InitInterfaces& interfaces)
     nTotalCache -= nBlockTreeDBCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 8, nMaxTxIndexCache << 20);
     nTotalCache -= nTxIndexCache;
+    int64_t nMinerStatsIndexCache = 0;
+    if (gArgs.GetBoolArg("-minerstatsindex", DEFAULT_MINERSTATSINDEX)) {
+        nMinerStatsIndexCache = std::min(nTotalCache / 8, nMaxMinerStatsIndexCache << 20);
+        nTotalCache -= nMinerStatsIndexCache;
+    }
+    int64_t nAssetIndexCache = 0;
+    if (gArgs.GetBoolArg("-assetindex", DEFAULT_ASSETINDEX)) {
+        nAssetIndexCache = std::min(nTotalCache / 8, nMaxAssetIndexCache << 20);
+        nTotalCache -= nAssetIndexCache;
+    }
+    int64_t nBlockFilterIndexCache = 0;
+    if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        nBlockFilterIndexCache = std::min(nTotalCache / 8, nMaxBlockFilterIndexCache << 20);
+        nTotalCache -= nBlockFilterIndexCache;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1465,6 +1560,15 @@ bool AppInitMain(InitInterfaces& interfaces)
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1f MiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
+    if (gArgs.GetBoolArg("-minerstatsindex", DEFAULT_MINERSTATSINDEX)) {
+        LogPrintf("* Using %.1f MiB for miner statistics index database\n", nMinerStatsIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-assetindex", DEFAULT_ASSETINDEX)) {
+        LogPrintf("* Using %.1f MiB for asset index database\n", nAssetIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        LogPrintf("* Using %.1f MiB for block filter index database\n", nBlockFilterIndexCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1547,6 +1651,43 @@ bool AppInitMain(InitInterfaces& interfaces)
                     break;
                 }
 
+                if (gArgs.IsArgSet("-loadsnapshot") && !fReset) {
+                    const fs::path snapshot_path = fs::absolute(gArgs.GetArg("-loadsnapshot", ""), GetDataDir());
+                    SnapshotMetadata metadata;
+                    uint256 snapshot_hash;
+                    std::string error;
+                    if (!ReadSnapshotHeader(snapshot_path, metadata, error)) {
+                        return InitError(strprintf(_("Unable to load snapshot: %s"), error));
+                    }
+                    const CBlockIndex* pindex_coins = LookupBlockIndex(pcoinsdbview->GetBestBlock());
+                    const CBlockIndex* pindex_base = LookupBlockIndex(metadata.base_hash);
+                    if (pindex_coins && pindex_base && pindex_coins->GetAncestor(pindex_base->nHeight) == pindex_base) {
+                        LogPrintf("The chain state is past the snapshot base %s, ignoring -loadsnapshot\n", metadata.base_hash.ToString());
+                    } else {
+                        if (!CheckSnapshot(snapshot_path, metadata, snapshot_hash, error)) {
+                            return InitError(strprintf(_("Unable to load snapshot: %s"), error));
+                        }
+                        pcoinscatcher.reset();
+                        pcoinsdbview.reset();
+                        pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, true));
+                        pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsdbview.get()));
+                        if (!LoadSnapshot(snapshot_path, *pcoinsdbview, metadata, snapshot_hash, error)) {
+                            strLoadError = strprintf(_("Unable to load snapshot: %s"), error);
+                            break;
+                        }
+                    }
+                } else if (fReindexChainState) {
+                    // A rebuilt chain state is validated as its blocks are connected
+                    pblocktree->EraseSnapshotBase();
+                }
+
+                uint256 snapshot_base, snapshot_coins_hash, snapshot_ticket_hash, snapshot_relation_hash;
+                if (pblocktree->ReadSnapshotBase(snapshot_base, snapshot_coins_hash, snapshot_ticket_hash, snapshot_relation_hash) &&
+                    pcoinsdbview->GetBestBlock().IsNull()) {
+                    strLoadError = _("Loading a chain state snapshot was interrupted. Restart with -loadsnapshot or -reindex-chainstate");
+                    break;
+                }
+
                 // ReplayBlocks is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
                 if (!ReplayBlocks(chainparams, pcoinsdbview.get())) {
                     strLoadError = _("Unable to replay blocks. You will need to rebuild the database using -reindex-chainstate.");
@@ -1684,6 +1825,24 @@ bool AppInitMain(InitInterfaces& interfaces)
     g_txindex = MakeUnique<TxIndex>(nTxIndexCache, false, fReindex);
     g_txindex->Start();
 
+    if (gArgs.GetBoolArg("-minerstatsindex", DEFAULT_MINERSTATSINDEX)) {
+        g_minerstatsindex = MakeUnique<MinerStatsIndex>(nMinerStatsIndexCache, false, fReindex);
+        g_minerstatsindex->Start();
+    }
+
+    if (gArgs.GetBoolArg("-assetindex", DEFAULT_ASSETINDEX)) {
+        g_assetindex = MakeUnique<AssetIndex>(nAssetIndexCache, false, fReindex);
+        g_assetindex->Start();
+    }
+
+    if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        g_blockfilterindex = MakeUnique<BlockFilterIndex>(BlockFilterType::BASIC, nBlockFilterIndexCache, false, fReindex);
+        g_blockfilterindex->Start();
+    }
+
+    StartSnapshotValidation();
+    StartPocVerification();
+
     // ********************************************************* Step 9: load wallet
     for (const auto& client : interfaces.chain_clients) {
         if (!client->load()) {
@@ -1797,6 +1956,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.m_msghandler_threads = gArgs.GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS);
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
@@ -1834,7 +1994,7 @@ bool AppInitMain(InitInterfaces& interfaces)
             connOptions.m_specified_outgoing = connect;
         }
     }
-    if (!g_connman->Start(scheduler, connOptions)) {
+    if (!g_connman->Start(maintenanceScheduler, connOptions)) {
         return false;
     }
 
@@ -1844,14 +2004,14 @@ bool AppInitMain(InitInterfaces& interfaces)
     uiInterface.InitMessage(_("Done loading"));
 
     for (const auto& client : interfaces.chain_clients) {
-        client->start(scheduler);
+        client->start(maintenanceScheduler);
     }
 
-    scheduler.scheduleEvery([]{
+    maintenanceScheduler.scheduleEvery([]{
         g_banman->DumpBanlist();
     }, DUMP_BANS_INTERVAL * 1000);
 
-    scheduler.scheduleEvery([] {blockAssember.CheckDeadline(); }, 200);
-    scheduler.scheduleEvery([] {g_blockCache->PushBlock(); }, 200);
+    forgingScheduler.scheduleEvery([] {blockAssember.CheckDeadline(); }, 200);
+    forgingScheduler.scheduleEvery([] {g_blockCache->PushBlock(); }, 200);
     return true;
 }
@@ -0,0 +1,313 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <chainparams.h>
+#include <chainparamsbase.h>
+#include <clientversion.h>
+#include <crypto/shabal256.h>
+#include <key_io.h>
+#include <plotfile.h>
+#include <poc.h>
+#include <random.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+#include <util/time.h>
+
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <thread>
+
+const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
+
+/** Default for -mem, the memory of the generation and write buffers in MiB */
+static const int64_t DEFAULT_PLOT_MEM = 512;
+static const bool DEFAULT_PLOT_DIRECTIO = true;
+/** Nonces a thread generates at a time, the lanes of the widest Shabal kernel. */
+static const uint64_t PLOT_TASK_NONCES = 8;
+
+static void SetupPlotArgs()
+{
+    SetupHelpOptions(gArgs);
+    SetupChainParamsBaseOptions();
+
+    gArgs.AddArg("-id=<address|plotid>", "Lava address whose PoC2.x nonces are plotted, or the numeric id of a classic PoC2 plot", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-poc2", "Plot the classic PoC2 nonces of the plot id of the address given by -id (default: 0)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-startnonce=<n>", "First nonce of the plot (default: 0)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-count=<n>", strprintf("Number of nonces of the plot, rounded down to a multiple of %u. Each nonce takes 256 KiB", PLOT_NONCE_ALIGNMENT), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-path=<dir>", "Directory of the plot file (default: current directory)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-threads=<n>", "Number of threads generating nonces (default: number of cores)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-mem=<n>", strprintf("Memory of the buffers in MiB, half of it generates nonces while the other half is written (default: %u)", DEFAULT_PLOT_MEM), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-directio", strprintf("Write the plot file bypassing the page cache where the platform supports it (default: %u)", DEFAULT_PLOT_DIRECTIO), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-selfcheck=<n>", "Once the plot is complete, check the scoops of n random nonces against the deadlines the node computes (default: 0)", false, OptionsCategory::OPTIONS);
+}
+
+static bool PlotAppInit(int argc, char* argv[])
+{
+    SetupPlotArgs();
+    std::string error_message;
+    if (!gArgs.ParseParameters(argc, argv, error_message)) {
+        fprintf(stderr, "Error parsing command line arguments: %s\n", error_message.c_str());
+        return false;
+    }
+    if (argc < 2 || HelpRequested(gArgs)) {
+        std::string usage = strprintf("%s lava-plot version", PACKAGE_NAME) + " " + FormatFullVersion() + "\n\n" +
+                                      "lava-plot generates plot files, nonce for nonce what the node checks blocks against.\n" +
+                                      "An interrupted plot is resumed by running the same command again.\n\n" +
+                                      "Usage:\n" +
+                                      "  lava-plot -id=<address|plotid> -count=<n> [options]\n\n" +
+                                      gArgs.GetHelpMessage();
+
+        fprintf(stdout, "%s", usage.c_str());
+        return false;
+    }
+
+    // Check for -testnet or -regtest parameter (Params() calls are only valid after this clause)
+    SelectParams(gArgs.GetChainName());
+
+    return true;
+}
+
+/** Run fn(begin, end) over [0, count) on threads threads, step at a time. */
+static void ParallelFor(int threads, uint64_t count, uint64_t step, const std::function<void(uint64_t, uint64_t)>& fn)
+{
+    std::atomic<uint64_t> next{0};
+    auto worker = [&] {
+        for (uint64_t begin = next.fetch_add(step); begin < count; begin = next.fetch_add(step)) {
+            fn(begin, std::min(begin + step, count));
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+}
+
+static fs::path ResumeFile(const fs::path& path)
+{
+    return path.string() + ".plotting";
+}
+
+/** Nonces written according to the resume file of an unfinished plot. */
+static bool ReadResumeFile(const fs::path& path, uint64_t& done)
+{
+    FILE* file = fsbridge::fopen(ResumeFile(path), "rb");
+    if (!file) return false;
+    char buf[32] = {};
+    size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    return ParseUInt64(std::string(buf, len), &done);
+}
+
+static bool WriteResumeFile(const fs::path& path, uint64_t done)
+{
+    FILE* file = fsbridge::fopen(ResumeFile(path), "wb");
+    if (!file) return false;
+    const std::string str = std::to_string(done);
+    bool ok = fwrite(str.data(), 1, str.size(), file) == str.size() && FileCommit(file);
+    return fclose(file) == 0 && ok;
+}
+
+/**
+ * Generate the nonces of info from done on into path. Nonces are generated
+ * batch by batch into one buffer while the previous batch, turned
+ * scoop-major, is written from the other.
+ */
+static bool Plot(const fs::path& path, const PlotFileInfo& info, uint64_t done, int threads, uint64_t batch, bool direct)
+{
+    // Written first, a plot file without resume file is complete
+    if (!WriteResumeFile(path, done)) {
+        fprintf(stderr, "Error: cannot write %s\n", ResumeFile(path).string().c_str());
+        return false;
+    }
+    CPlotFile file;
+    std::string error;
+    if (!file.Open(path, true, direct, error)) {
+        fprintf(stderr, "Error: %s\n", error.c_str());
+        return false;
+    }
+    if (done == 0 && !file.Allocate(info.FileSize())) {
+        fprintf(stderr, "%s", strprintf("Error: cannot allocate %u bytes for %s\n", info.FileSize(), path.string()).c_str());
+        return false;
+    }
+    fprintf(stdout, "%s", strprintf("Plotting %s from nonce %u on %d threads, %s, %s\n", path.string(), info.startNonce + done, threads,
+        Shabal256AutoDetect(), file.IsDirect() ? "direct I/O" : "buffered I/O").c_str());
+
+    AlignedBuffer gen(batch * POC_NONCE_SIZE);
+    AlignedBuffer out(batch * POC_NONCE_SIZE);
+    std::thread writer;
+    bool write_ok = true;
+    const int64_t start_time = GetTimeMillis();
+    const uint64_t start_done = done;
+
+    while (done < info.nonces) {
+        const uint64_t count = std::min(batch, info.nonces - done);
+        ParallelFor(threads, count, PLOT_TASK_NONCES, [&](uint64_t begin, uint64_t end) {
+            info.GenerateNonces(done + begin, end - begin, gen.data() + begin * POC_NONCE_SIZE);
+        });
+
+        if (writer.joinable()) writer.join();
+        if (!write_ok) break;
+
+        ParallelFor(threads, POC_SCOOPS, POC_SCOOPS / threads + 1, [&](uint64_t begin, uint64_t end) {
+            for (uint64_t scoop = begin; scoop < end; ++scoop) {
+                for (uint64_t n = 0; n < count; ++n) {
+                    memcpy(out.data() + (scoop * count + n) * POC_SCOOP_SIZE, gen.data() + n * POC_NONCE_SIZE + scoop * POC_SCOOP_SIZE, POC_SCOOP_SIZE);
+                }
+            }
+        });
+
+        writer = std::thread([&, count, done] {
+            for (uint32_t scoop = 0; scoop < POC_SCOOPS && write_ok; ++scoop) {
+                write_ok = file.Write(out.data() + scoop * count * POC_SCOOP_SIZE, count * POC_SCOOP_SIZE, info.ScoopOffset(scoop, done));
+            }
+            // The resume file never counts nonces that are not on disk yet
+            write_ok = write_ok && file.Sync() && WriteResumeFile(path, done + count);
+            if (!write_ok) return;
+            const double minutes = std::max<int64_t>(GetTimeMillis() - start_time, 1) / 60000.0;
+            fprintf(stdout, "%s", strprintf("%u/%u nonces, %.0f nonces/min\n", done + count, info.nonces, (done + count - start_done) / minutes).c_str());
+        });
+        done += count;
+    }
+    if (writer.joinable()) writer.join();
+    if (!write_ok) {
+        fprintf(stderr, "Error: cannot write %s\n", path.string().c_str());
+        return false;
+    }
+
+    file.Close();
+    fs::remove(ResumeFile(path));
+    return true;
+}
+
+/** Check the scoops of count random nonces of the plot at path against the deadlines computed by the node. */
+static bool SelfCheck(const fs::path& path, const PlotFileInfo& info, int count)
+{
+    CPlotFile file;
+    std::string error;
+    if (!file.Open(path, false, true, error)) {
+        fprintf(stderr, "Error: %s\n", error.c_str());
+        return false;
+    }
+    AlignedBuffer buf(PLOT_FILE_ALIGNMENT);
+    std::vector<uint8_t> chunk(POC_NONCE_SIZE);
+    int mismatches = 0;
+    for (int i = 0; i < count; ++i) {
+        const uint64_t index = GetRand(info.nonces);
+        const uint256 genSig = GetRandHash();
+        const uint64_t height = GetRand(std::numeric_limits<int32_t>::max());
+        const uint32_t scoop = CalcScoop(genSig, height);
+        const uint64_t offset = info.ScoopOffset(scoop, index);
+        const uint64_t aligned = offset - offset % PLOT_FILE_ALIGNMENT;
+        if (!file.Read(buf.data(), PLOT_FILE_ALIGNMENT, aligned)) {
+            fprintf(stderr, "Error: cannot read %s\n", path.string().c_str());
+            return false;
+        }
+        memcpy(&chunk[scoop * POC_SCOOP_SIZE], buf.data() + (offset - aligned), POC_SCOOP_SIZE);
+        if (CalcDeadline(genSig, scoop, chunk) != info.CalcDeadline(genSig, height, index)) {
+            fprintf(stderr, "%s", strprintf("Mismatch: nonce %u scoop %u\n", info.startNonce + index, scoop).c_str());
+            ++mismatches;
+        }
+    }
+    fprintf(stdout, "Self-check: %d of %d nonces match\n", count - mismatches, count);
+    return mismatches == 0;
+}
+
+/** Fill info from -id and -poc2, as the RPCs parse a generator. */
+static bool ParsePlotID(const std::string& id, PlotFileInfo& info)
+{
+    CTxDestination dest = DecodeDestination(id);
+    if (IsValidDestination(dest)) {
+        if (dest.type() != typeid(CKeyID)) {
+            fprintf(stderr, "Error: only pay to public key hash addresses can forge\n");
+            return false;
+        }
+        const CKeyID& key = boost::get<CKeyID>(dest);
+        info.poc2x = !gArgs.GetBoolArg("-poc2", false);
+        info.publicKeyID = key;
+        info.plotID = key.GetPlotID();
+        return true;
+    }
+    info.poc2x = false;
+    if (!ParseUInt64(id, &info.plotID) || info.plotID == 0) {
+        fprintf(stderr, "Error: invalid address or plot id %s\n", id.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef WIN32
+    util::WinCmdLineArgs winArgs;
+    std::tie(argc, argv) = winArgs.get();
+#endif
+    SetupEnvironment();
+    RandomInit();
+    try {
+        if (!PlotAppInit(argc, argv)) return EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "PlotAppInit()");
+        return EXIT_FAILURE;
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "PlotAppInit()");
+        return EXIT_FAILURE;
+    }
+
+    PlotFileInfo info;
+    if (!ParsePlotID(gArgs.GetArg("-id", ""), info)) return EXIT_FAILURE;
+    const int64_t start = gArgs.GetArg("-startnonce", 0);
+    const int64_t nonces = gArgs.GetArg("-count", 0);
+    if (start < 0) {
+        fprintf(stderr, "Error: invalid -startnonce\n");
+        return EXIT_FAILURE;
+    }
+    info.startNonce = start;
+    // Every scoop of the file then starts aligned for direct I/O
+    info.nonces = nonces > 0 ? nonces - nonces % PLOT_NONCE_ALIGNMENT : 0;
+    if (info.nonces == 0) {
+        fprintf(stderr, "%s", strprintf("Error: -count must be at least %u\n", PLOT_NONCE_ALIGNMENT).c_str());
+        return EXIT_FAILURE;
+    }
+
+    int threads = gArgs.GetArg("-threads", GetNumCores());
+    if (threads <= 0) threads = std::max(GetNumCores(), 1);
+    const int64_t mem = std::max<int64_t>(gArgs.GetArg("-mem", DEFAULT_PLOT_MEM), 1) << 20;
+    uint64_t batch = mem / (2 * POC_NONCE_SIZE);
+    batch = std::max(batch - batch % PLOT_NONCE_ALIGNMENT, PLOT_NONCE_ALIGNMENT);
+    batch = std::min(batch, info.nonces);
+
+    const fs::path dir = fs::absolute(gArgs.GetArg("-path", "."));
+    const fs::path path = dir / info.FileName();
+    uint64_t done = 0;
+    const bool complete = fs::exists(path) && !ReadResumeFile(path, done);
+    if (!complete && done > info.nonces) {
+        fprintf(stderr, "Error: %s is corrupt\n", ResumeFile(path).string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    try {
+        if (complete) {
+            fprintf(stdout, "%s is complete\n", path.string().c_str());
+        } else if (!Plot(path, info, done, threads, batch, gArgs.GetBoolArg("-directio", DEFAULT_PLOT_DIRECTIO))) {
+            return EXIT_FAILURE;
+        }
+        const int checks = gArgs.GetArg("-selfcheck", 0);
+        if (checks > 0 && !SelfCheck(path, info, checks)) {
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "lava-plot");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
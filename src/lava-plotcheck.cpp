@@ -0,0 +1,149 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <chainparams.h>
+#include <chainparamsbase.h>
+#include <clientversion.h>
+#include <crypto/shabal256.h>
+#include <plotcheck.h>
+#include <poc.h>
+#include <random.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+#include <util/time.h>
+
+#include <functional>
+#include <stdio.h>
+
+const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
+
+static void SetupPlotCheckArgs()
+{
+    SetupHelpOptions(gArgs);
+    SetupChainParamsBaseOptions();
+
+    gArgs.AddArg("-path=<file|dir>", "Plot file, or directory whose plot files are checked. Can be specified multiple times", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-density=<n>", strprintf("Nonces recomputed and compared per GiB of plot (default: %g)", DEFAULT_PLOTCHECK_DENSITY), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-scoops=<n>", strprintf("Scoops read in full from every file, one round of deadlines each (default: %u)", DEFAULT_PLOTCHECK_SCOOPS), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-threads=<n>", "Number of threads recomputing nonces and hashing scoops (default: number of cores)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-readsize=<n>", strprintf("Size of the reads in MiB, each device being read from on its own thread (default: %u)", DEFAULT_PLOTCHECK_READ_SIZE), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-directio", "Read bypassing the page cache where the platform supports it (default: 1)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-basetarget=<n>", strprintf("Base target the expected deadline is computed against, see getmininginfo (default: %u)", INITIAL_BASE_TARGET), false, OptionsCategory::OPTIONS);
+}
+
+static bool PlotCheckAppInit(int argc, char* argv[])
+{
+    SetupPlotCheckArgs();
+    std::string error_message;
+    if (!gArgs.ParseParameters(argc, argv, error_message)) {
+        fprintf(stderr, "Error parsing command line arguments: %s\n", error_message.c_str());
+        return false;
+    }
+    if (argc < 2 || HelpRequested(gArgs)) {
+        std::string usage = strprintf("%s lava-plotcheck version", PACKAGE_NAME) + " " + FormatFullVersion() + "\n\n" +
+                                      "lava-plotcheck samples plot files and compares them with the nonces the node computes.\n\n" +
+                                      "Usage:\n" +
+                                      "  lava-plotcheck -path=<file|dir> [-path=<file|dir> ...] [options]\n\n" +
+                                      gArgs.GetHelpMessage();
+
+        fprintf(stdout, "%s", usage.c_str());
+        return false;
+    }
+
+    // Check for -testnet or -regtest parameter (Params() calls are only valid after this clause)
+    SelectParams(gArgs.GetChainName());
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef WIN32
+    util::WinCmdLineArgs winArgs;
+    std::tie(argc, argv) = winArgs.get();
+#endif
+    SetupEnvironment();
+    RandomInit();
+    try {
+        if (!PlotCheckAppInit(argc, argv)) return EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "PlotCheckAppInit()");
+        return EXIT_FAILURE;
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "PlotCheckAppInit()");
+        return EXIT_FAILURE;
+    }
+
+    PlotCheckOptions options;
+    if (gArgs.IsArgSet("-density")) {
+        int64_t density;
+        if (!ParseFixedPoint(gArgs.GetArg("-density", ""), 3, &density) || density <= 0) {
+            fprintf(stderr, "Error: invalid -density\n");
+            return EXIT_FAILURE;
+        }
+        options.density = density / 1000.0;
+    }
+    options.scoops = std::max<int64_t>(gArgs.GetArg("-scoops", DEFAULT_PLOTCHECK_SCOOPS), 1);
+    options.threads = gArgs.GetArg("-threads", GetNumCores());
+    if (options.threads <= 0) options.threads = std::max(GetNumCores(), 1);
+    options.readSize = std::max<int64_t>(gArgs.GetArg("-readsize", DEFAULT_PLOTCHECK_READ_SIZE), 1) << 20;
+    options.direct = gArgs.GetBoolArg("-directio", true);
+    const int64_t baseTarget = gArgs.GetArg("-basetarget", INITIAL_BASE_TARGET);
+    if (baseTarget <= 0) {
+        fprintf(stderr, "Error: invalid -basetarget\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<fs::path> paths;
+    for (const std::string& path : gArgs.GetArgs("-path")) {
+        paths.push_back(fs::absolute(path));
+    }
+    const std::vector<fs::path> files = FindPlotFiles(paths);
+    if (files.empty()) {
+        fprintf(stderr, "Error: no plot files found\n");
+        return EXIT_FAILURE;
+    }
+
+    PlotCheckResult result;
+    try {
+        fprintf(stdout, "%s", strprintf("Checking %u plot files on %d threads, %s\n", files.size(), options.threads, Shabal256AutoDetect()).c_str());
+        const int64_t start_time = GetTimeMillis();
+        result = CheckPlotFiles(files, options);
+        fprintf(stdout, "%s", strprintf("Checked in %.1fs\n\n", (GetTimeMillis() - start_time) * 0.001).c_str());
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "lava-plotcheck");
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    for (const PlotFileCheck& check : result.files) {
+        if (!check.error.empty()) {
+            fprintf(stdout, "%s", strprintf("%s: error: %s\n", check.path.string(), check.error).c_str());
+            ok = false;
+            continue;
+        }
+        fprintf(stdout, "%s", strprintf("%s: %u of %u nonces checked, %u mismatches\n", check.path.string(), check.checked, check.info.nonces, check.mismatches).c_str());
+        for (const PlotRegionCheck& region : check.regions) {
+            fprintf(stdout, "%s", strprintf("  nonces %u to %u: %u of %u checked nonces mismatch\n",
+                region.startNonce, region.startNonce + region.nonces - 1, region.mismatches, region.checked).c_str());
+        }
+        ok = ok && check.mismatches == 0;
+    }
+    for (const auto& overlap : result.overlaps) {
+        fprintf(stdout, "%s", strprintf("%s and %s plot the same nonces\n", overlap.first.string(), overlap.second.string()).c_str());
+        ok = false;
+    }
+
+    const double capacity = result.EffectiveCapacity();
+    fprintf(stdout, "%s", strprintf("\nCapacity: %.3f TiB plotted, %.3f TiB effective, %.3f TiB estimated from %u rounds of deadlines\n",
+        result.Capacity(), capacity, result.DeadlineCapacity(), result.bestDeadlines.size()).c_str());
+    if (capacity > 0) {
+        fprintf(stdout, "%s", strprintf("Expected best deadline at base target %u: %.0fs\n", baseTarget, PlotCheckResult::ExpectedDeadline(capacity, baseTarget)).c_str());
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
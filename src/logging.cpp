@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <logging.h>
+#include <util/system.h>
 #include <util/time.h>
 
 const char * const DEFAULT_DEBUGLOGFILE = "debug.log";
@@ -127,6 +128,7 @@ const CLogCategoryDesc LogCategories[] =
     {BCLog::LEVELDB, "leveldb"},
     {BCLog::FIRESTONE, "firestone"},
     {BCLog::RELATION, "relation"},
+    {BCLog::POC, "poc"},
     {BCLog::ALL, "1"},
     {BCLog::ALL, "all"},
 };
@@ -210,6 +212,24 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
 {
     std::string strTimestamped = LogTimestampStr(str);
 
+    {
+        std::lock_guard<std::mutex> scoped_lock(m_queue_mutex);
+        if (m_async) {
+            if (m_queue_count == m_queue.size()) {
+                ++m_queue_dropped;
+                return;
+            }
+            m_queue[(m_queue_head + m_queue_count) % m_queue.size()].swap(strTimestamped);
+            ++m_queue_count;
+            m_queue_cond.notify_one();
+            return;
+        }
+    }
+    WriteStr(strTimestamped);
+}
+
+void BCLog::Logger::WriteStr(const std::string& strTimestamped)
+{
     if (m_print_to_console) {
         // print to console
         fwrite(strTimestamped.data(), 1, strTimestamped.size(), stdout);
@@ -239,6 +259,64 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
     }
 }
 
+void BCLog::Logger::WriterThread()
+{
+    RenameThread("bitcoin-log");
+
+    std::vector<std::string> batch;
+    std::string joined;
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    while (true) {
+        m_queue_cond.wait(lock, [this] { return m_queue_count > 0 || m_queue_dropped > 0 || !m_async; });
+        if (m_queue_count == 0 && m_queue_dropped == 0) {
+            break;
+        }
+
+        batch.resize(m_queue_count);
+        for (auto& msg : batch) {
+            msg.swap(m_queue[m_queue_head]);
+            m_queue_head = (m_queue_head + 1) % m_queue.size();
+        }
+        m_queue_count = 0;
+        const uint64_t dropped = m_queue_dropped;
+        m_queue_dropped = 0;
+        lock.unlock();
+
+        // One write per batch instead of one per message
+        joined.clear();
+        for (auto& msg : batch) {
+            joined += msg;
+            msg.clear();
+        }
+        if (dropped > 0) {
+            joined += LogTimestampStr(strprintf("Logging: dropped %u messages, the log writer fell behind\n", dropped));
+        }
+        WriteStr(joined);
+
+        lock.lock();
+    }
+}
+
+void BCLog::Logger::StartAsyncWriter()
+{
+    std::lock_guard<std::mutex> scoped_lock(m_queue_mutex);
+    if (m_async) return;
+    m_queue.resize(ASYNC_LOG_QUEUE_SIZE);
+    m_async = true;
+    m_writer_thread = std::thread(&BCLog::Logger::WriterThread, this);
+}
+
+void BCLog::Logger::StopAsyncWriter()
+{
+    {
+        std::lock_guard<std::mutex> scoped_lock(m_queue_mutex);
+        if (!m_async) return;
+        m_async = false;
+        m_queue_cond.notify_one();
+    }
+    m_writer_thread.join();
+}
+
 void BCLog::Logger::ShrinkDebugFile()
 {
     // Amount of debug.log to save at end when shrinking (must fit in memory)
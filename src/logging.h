@@ -10,15 +10,20 @@
 #include <tinyformat.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <list>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+static const bool DEFAULT_ASYNCLOGGING  = false;
+/** Number of messages the asynchronous log writer can fall behind before messages are dropped. */
+static const size_t ASYNC_LOG_QUEUE_SIZE = 1 << 16;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -55,6 +60,7 @@ namespace BCLog {
         LEVELDB     = (1 << 20),
         FIRESTONE   = (1 << 21),
         RELATION    = (1 << 22),
+        POC         = (1 << 23),
         ALL         = ~(uint32_t)0,
     };
 
@@ -65,6 +71,20 @@ namespace BCLog {
         std::mutex m_file_mutex;
         std::list<std::string> m_msgs_before_open;
 
+        /**
+         * Ring buffer of timestamped messages waiting for the writer thread,
+         * so that logging threads never wait on disk or console I/O.
+         */
+        std::mutex m_queue_mutex;
+        std::condition_variable m_queue_cond;
+        std::vector<std::string> m_queue;
+        size_t m_queue_head = 0;
+        size_t m_queue_count = 0;
+        /** Messages dropped because the queue was full, reported by the writer. */
+        uint64_t m_queue_dropped = 0;
+        bool m_async = false;
+        std::thread m_writer_thread;
+
         /**
          * m_started_new_line is a state variable that will suppress printing of
          * the timestamp when multiple calls are made that don't end in a
@@ -77,6 +97,11 @@ namespace BCLog {
 
         std::string LogTimestampStr(const std::string& str);
 
+        /** Write a timestamped string to the outputs. */
+        void WriteStr(const std::string& str);
+
+        void WriterThread();
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -90,6 +115,13 @@ namespace BCLog {
         /** Send a string to the log output */
         void LogPrintStr(const std::string &str);
 
+        /**
+         * Hand messages to a background writer thread from now on. Stopping
+         * writes out all queued messages, later messages are written directly.
+         */
+        void StartAsyncWriter();
+        void StopAsyncWriter();
+
         /** Returns whether logs will be written to any output */
         bool Enabled() const { return m_print_to_console || m_print_to_file; }
 
@@ -146,12 +178,13 @@ static inline void LogPrintf(const char* fmt, const Args&... args)
     }
 }
 
-template <typename... Args>
-static inline void LogPrint(const BCLog::LogFlags& category, const Args&... args)
-{
-    if (LogAcceptCategory((category))) {
-        LogPrintf(args...);
-    }
-}
+// Use a macro instead of a function for conditional logging to prevent
+// evaluating arguments when logging for the category is not enabled.
+#define LogPrint(category, ...)              \
+    do {                                     \
+        if (LogAcceptCategory((category))) { \
+            LogPrintf(__VA_ARGS__);          \
+        }                                    \
+    } while (0)
 
 #endif // BITCOIN_LOGGING_H
@@ -164,6 +164,9 @@ public:
     static Optional<int64_t> m_last_block_num_txs;
     static Optional<int64_t> m_last_block_weight;
 
+    //! Microseconds TestBlockValidity took in the last CreateNewBlock, recorded by the forging path only
+    int64_t m_last_validity_micros{0};
+
 private:
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
@@ -31,6 +31,11 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#include <unordered_set>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -1129,7 +1134,98 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
     return !recv_set.empty() || !send_set.empty() || !error_set.empty();
 }
 
-#ifdef USE_POLL
+#ifdef USE_EPOLL
+void CConnman::EpollUpdate(SOCKET hSocket, NodeId node_id, uint32_t events)
+{
+    struct epoll_event event{};
+    event.events = events;
+    event.data.fd = hSocket;
+
+    auto it = m_epoll_registrations.find(hSocket);
+    if (it != m_epoll_registrations.end() && it->second.node_id == node_id) {
+        if (it->second.events == events) return;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, hSocket, &event) == 0) {
+            it->second.events = events;
+            return;
+        }
+    }
+
+    // Closing a socket removes it from the epoll instance, so a socket number
+    // that was registered for another node is usually not registered anymore
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, hSocket, &event) != 0 &&
+        (errno != EEXIST || epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, hSocket, &event) != 0)) {
+        LogPrintf("epoll_ctl error %s\n", NetworkErrorString(errno));
+        m_epoll_registrations.erase(hSocket);
+        return;
+    }
+    m_epoll_registrations[hSocket] = EpollRegistration{node_id, events};
+}
+
+void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    if (m_epoll_fd == -1) {
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll_fd == -1) {
+            LogPrintf("epoll_create1 error %s\n", NetworkErrorString(errno));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+            return;
+        }
+    }
+
+    // Same selection as GenerateSelectSet, but sockets are only re-registered
+    // when what they wait for changes. Errors and hang-ups are always reported.
+    std::unordered_set<SOCKET> registered;
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        EpollUpdate(hListenSocket.socket, -1, uint32_t{EPOLLIN});
+        registered.insert(hListenSocket.socket);
+    }
+
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes)
+        {
+            bool select_recv = !pnode->fPauseRecv;
+            bool select_send;
+            {
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
+
+            // Registered while the socket cannot be closed, so the registration
+            // refers to the socket of this node
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            EpollUpdate(pnode->hSocket, pnode->GetId(), select_send ? uint32_t{EPOLLOUT} : select_recv ? uint32_t{EPOLLIN} : uint32_t{0});
+            registered.insert(pnode->hSocket);
+        }
+    }
+
+    for (auto it = m_epoll_registrations.begin(); it != m_epoll_registrations.end();) {
+        if (registered.count(it->first)) {
+            ++it;
+            continue;
+        }
+        // Fails if the socket was closed already, which is fine
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, it->first, nullptr);
+        it = m_epoll_registrations.erase(it);
+    }
+
+    std::vector<struct epoll_event> events(std::max<size_t>(m_epoll_registrations.size(), 1));
+    int nEvents = epoll_wait(m_epoll_fd, events.data(), events.size(), SELECT_TIMEOUT_MILLISECONDS);
+    if (nEvents < 0) return;
+
+    if (interruptNet) return;
+
+    for (int i = 0; i < nEvents; ++i) {
+        const SOCKET hSocket = events[i].data.fd;
+        if (events[i].events & EPOLLIN)              recv_set.insert(hSocket);
+        if (events[i].events & EPOLLOUT)             send_set.insert(hSocket);
+        if (events[i].events & (EPOLLERR|EPOLLHUP))  error_set.insert(hSocket);
+    }
+}
+#elif defined(USE_POLL)
 void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
@@ -1325,7 +1421,7 @@ void CConnman::SocketHandler()
                         pnode->nProcessQueueSize += nSizeAdded;
                         pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
                     }
-                    WakeMessageHandler();
+                    WakeMessageHandler(pnode);
                 }
             }
             else if (nBytes == 0)
@@ -1383,10 +1479,21 @@ void CConnman::ThreadSocketHandler()
 void CConnman::WakeMessageHandler()
 {
     {
-        std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        LOCK(mutexMsgProc);
+        vMsgProcWake.assign(vMsgProcWake.size(), true);
     }
-    condMsgProc.notify_one();
+    condMsgProc.notify_all();
+}
+
+void CConnman::WakeMessageHandler(const CNode* pnode)
+{
+    {
+        LOCK(mutexMsgProc);
+        if (vMsgProcWake.empty()) return;
+        vMsgProcWake[pnode->GetId() % vMsgProcWake.size()] = true;
+    }
+    // The threads share the condition variable
+    condMsgProc.notify_all();
 }
 
 
@@ -1944,16 +2051,21 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     }
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int thread_index)
 {
+    // Each thread processes the messages of a fixed share of the peers, so
+    // that the messages of a peer are processed in order. What peers share is
+    // protected by cs_main and the locks of the connection manager.
+    const int thread_count = m_msghandler_threads;
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy) {
+            for (CNode* pnode : vNodes) {
+                if (pnode->GetId() % thread_count != thread_index) continue;
                 pnode->AddRef();
+                vNodesCopy.push_back(pnode);
             }
         }
 
@@ -1987,9 +2099,9 @@ void CConnman::ThreadMessageHandler()
 
         WAIT_LOCK(mutexMsgProc, lock);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, thread_index] { return vMsgProcWake[thread_index]; });
         }
-        fMsgProcWake = false;
+        vMsgProcWake[thread_index] = false;
     }
 }
 
@@ -2243,7 +2355,7 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     {
         LOCK(mutexMsgProc);
-        fMsgProcWake = false;
+        vMsgProcWake.assign(m_msghandler_threads, false);
     }
 
     // Send and receive from sockets, accept connections
@@ -2269,7 +2381,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this, connOptions.m_specified_outgoing)));
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < m_msghandler_threads; ++i) {
+        threadMessageHandlers.emplace_back(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i)));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpAddresses, this), DUMP_PEERS_INTERVAL * 1000);
@@ -2318,8 +2432,11 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& threadMessageHandler : threadMessageHandlers) {
+        if (threadMessageHandler.joinable())
+            threadMessageHandler.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2328,6 +2445,13 @@ void CConnman::Stop()
         threadDNSAddressSeed.join();
     if (threadSocketHandler.joinable())
         threadSocketHandler.join();
+#ifdef USE_EPOLL
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+    m_epoll_registrations.clear();
+#endif
 
     if (fAddressesInitialized)
     {
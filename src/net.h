@@ -28,6 +28,7 @@
 #include <stdint.h>
 #include <thread>
 #include <memory>
+#include <unordered_map>
 #include <condition_variable>
 
 #ifndef WIN32
@@ -81,6 +82,10 @@ static const uint64_t MAX_UPLOAD_TIMEFRAME = 60 * 60 * 24;
 static const bool DEFAULT_BLOCKSONLY = false;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
+/** -msghandlerthreads default, the number of threads processing peer messages */
+static const int DEFAULT_MSGHANDLER_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSGHANDLER_THREADS = 16;
 
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
@@ -141,6 +146,7 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        int m_msghandler_threads = DEFAULT_MSGHANDLER_THREADS;
         std::vector<std::string> vSeedNodes;
         std::vector<CSubNet> vWhitelistedRange;
         std::vector<CService> vBinds, vWhiteBinds;
@@ -163,6 +169,7 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_msghandler_threads = std::max(1, std::min(connOptions.m_msghandler_threads, MAX_MSGHANDLER_THREADS));
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -308,6 +315,7 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    /** Wake all message handler threads. */
     void WakeMessageHandler();
 
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
@@ -331,13 +339,19 @@ private:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int thread_index);
+    /** Wake the message handler thread processing the messages of pnode. */
+    void WakeMessageHandler(const CNode* pnode);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_EPOLL
+    /** Change the events the epoll instance waits for on hSocket, owned by node_id (-1 for listening sockets). */
+    void EpollUpdate(SOCKET hSocket, NodeId node_id, uint32_t events);
+#endif
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -421,8 +435,9 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** flags for waking the message processor threads, one per thread. */
+    std::vector<bool> vMsgProcWake GUARDED_BY(mutexMsgProc);
+    int m_msghandler_threads{DEFAULT_MSGHANDLER_THREADS};
 
     std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
@@ -434,7 +449,21 @@ private:
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
+
+#ifdef USE_EPOLL
+    struct EpollRegistration {
+        NodeId node_id;
+        uint32_t events;
+    };
+    /**
+     * epoll instance the sockets stay registered with across iterations of
+     * the socket handler, and what each socket is registered for. Only used
+     * by the socket handler thread.
+     */
+    int m_epoll_fd{-1};
+    std::unordered_map<SOCKET, EpollRegistration> m_epoll_registrations;
+#endif
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of nMaxOutbound
@@ -698,8 +727,10 @@ public:
     std::atomic<int> nStartingHeight{-1};
 
     // flood relay
-    std::vector<CAddress> vAddrToSend;
-    CRollingBloomFilter addrKnown;
+    // Addresses are pushed to a peer from the message handler threads of other peers
+    CCriticalSection cs_addrSend;
+    std::vector<CAddress> vAddrToSend GUARDED_BY(cs_addrSend);
+    CRollingBloomFilter addrKnown GUARDED_BY(cs_addrSend);
     bool fGetAddr{false};
     std::set<uint256> setKnown;
     int64_t nNextAddrSend GUARDED_BY(cs_sendProcessing){0};
@@ -821,11 +852,13 @@ public:
 
     void AddAddressKnown(const CAddress& _addr)
     {
+        LOCK(cs_addrSend);
         addrKnown.insert(_addr.GetKey());
     }
 
     void PushAddress(const CAddress& _addr, FastRandomContext &insecure_rand)
     {
+        LOCK(cs_addrSend);
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
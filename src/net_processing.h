@@ -19,6 +19,30 @@ static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
 /** Default for BIP61 (sending reject messages) */
 static constexpr bool DEFAULT_ENABLE_BIP61{true};
+/** Default for -relaypendingblocks */
+static constexpr bool DEFAULT_RELAYPENDINGBLOCKS{false};
+/** Maximum number of pending blocks validated for relay on top of one tip */
+static const int MAX_PENDING_BLOCK_VALIDATIONS = 4;
+
+/**
+ * Chooses the pending blocks worth validating for relay. They are validated
+ * under cs_main on the scheduler thread, so only a block that matures before
+ * all the blocks validated so far on the same parent is, and at most
+ * MAX_PENDING_BLOCK_VALIDATIONS of them.
+ */
+class PendingBlockFilter
+{
+private:
+    uint256 m_parent;
+    int64_t m_best_time;
+    int m_count;
+
+public:
+    PendingBlockFilter() : m_best_time(0), m_count(0) {}
+
+    /** Whether to validate a block on parent whose deadline matures at mature_time. */
+    bool Allow(const uint256& parent, int64_t mature_time);
+};
 
 class PeerLogicValidation final : public CValidationInterface, public NetEventsInterface {
 private:
@@ -27,7 +51,7 @@ private:
 
     bool SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_bip61) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 public:
-    PeerLogicValidation(CConnman* connman, BanMan* banman, CScheduler &scheduler, bool enable_bip61);
+    PeerLogicValidation(CConnman* connman, BanMan* banman, CScheduler &scheduler, bool enable_bip61, bool relay_pending_blocks);
 
     /**
      * Overridden from CValidationInterface.
@@ -45,6 +69,10 @@ public:
      * Overridden from CValidationInterface.
      */
     void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
+    /**
+     * Overridden from CValidationInterface.
+     */
+    void NewPendingBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
 
     /** Initialize a peer by adding it to mapNodeState and pushing a message requesting its version */
     void InitializeNode(CNode* pnode) override;
@@ -77,6 +105,11 @@ private:
 
     /** Enable BIP61 (sending reject messages) */
     const bool m_enable_bip61;
+
+    /** Exchange validated blocks with peers before their deadline matures */
+    const bool m_relay_pending_blocks;
+
+    PendingBlockFilter m_pending_block_filter GUARDED_BY(cs_main);
 };
 
 struct CNodeStateStats {
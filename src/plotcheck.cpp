@@ -0,0 +1,444 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <plotcheck.h>
+
+#include <crypto/common.h>
+#include <crypto/shabal256.h>
+#include <random.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
+
+/** Nonces recomputed together, the lanes of the widest Shabal kernel. */
+static const uint64_t CHECK_GROUP_NONCES = 8;
+/** Reads of a device that are in flight or waiting to be hashed. */
+static const size_t READ_DEPTH = 4;
+/** Parts a file is split into to tell where its mismatches are. */
+static const uint64_t CHECK_REGIONS = 64;
+
+double PlotCheckResult::Capacity() const
+{
+    return (double)nonces * POC_NONCE_SIZE / (1ULL << 40);
+}
+
+double PlotCheckResult::EffectiveCapacity() const
+{
+    return checked == 0 ? Capacity() : Capacity() * (checked - mismatches) / checked;
+}
+
+double PlotCheckResult::DeadlineCapacity() const
+{
+    // The best of n uniform deadlines is about exponential with rate n, whose
+    // unbiased estimate from k samples is (k - 1) / sum
+    double sum = 0;
+    for (uint64_t deadline : bestDeadlines) {
+        sum += deadline / 18446744073709551616.0;
+    }
+    if (sum == 0) return 0;
+    return std::max<double>(bestDeadlines.size() - 1, 1) / sum * POC_NONCE_SIZE / (1ULL << 40);
+}
+
+double PlotCheckResult::ExpectedDeadline(double capacity, uint64_t baseTarget)
+{
+    const double nonces = capacity * (1ULL << 40) / POC_NONCE_SIZE;
+    return 18446744073709551616.0 / (nonces + 1) / baseTarget;
+}
+
+std::vector<fs::path> FindPlotFiles(const std::vector<fs::path>& paths)
+{
+    std::vector<fs::path> files;
+    for (const fs::path& path : paths) {
+        if (!fs::is_directory(path)) {
+            files.push_back(path);
+            continue;
+        }
+        std::vector<fs::path> found;
+        PlotFileInfo info;
+        for (fs::directory_iterator it(path); it != fs::directory_iterator(); ++it) {
+            if (fs::is_regular_file(it->status()) && info.SetFileName(it->path().filename().string())) {
+                found.push_back(it->path());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return files;
+}
+
+namespace {
+
+/** Files on the same device are read one after the other. */
+uint64_t DeviceOf(const fs::path& path)
+{
+#ifdef WIN32
+    return std::hash<std::string>()(fs::absolute(path).root_name().string());
+#else
+    struct stat st;
+    return stat(path.string().c_str(), &st) == 0 ? st.st_dev : 0;
+#endif
+}
+
+struct Round
+{
+    uint256 genSig;
+    uint32_t scoop;
+};
+
+struct FileState
+{
+    PlotFileCheck* check;
+    bool direct;
+    uint64_t groupNonces;
+    /** First nonce of each checked group, ascending. */
+    std::vector<uint64_t> groups;
+    /** Scoops of the checked nonces by nonce and round, as recomputed and as read. */
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> observed;
+    std::vector<uint64_t> best;
+};
+
+struct Device
+{
+    std::vector<FileState*> files;
+    /** Buffers not being read into nor hashed. */
+    std::vector<std::unique_ptr<AlignedBuffer>> free;
+};
+
+struct Block
+{
+    Device* device;
+    FileState* file;
+    size_t round;
+    uint64_t index;
+    uint64_t count;
+    std::unique_ptr<AlignedBuffer> buf;
+};
+
+class PlotChecker
+{
+private:
+    const PlotCheckOptions& m_options;
+    const std::vector<Round>& m_rounds;
+    const uint64_t m_read_nonces;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Block> m_blocks GUARDED_BY(m_mutex);
+    /** Groups to recompute, and the next one. */
+    std::vector<std::pair<FileState*, size_t>> m_tasks;
+    size_t m_next_task GUARDED_BY(m_mutex){0};
+    int m_readers GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+
+    bool Interrupted() const { return m_options.interrupt && m_options.interrupt(); }
+
+    /** The scoops of the checked nonces of a group, as the node computes them. */
+    void Recompute(FileState& file, size_t group, std::vector<uint8_t>& chunks)
+    {
+        chunks.resize(CHECK_GROUP_NONCES * POC_NONCE_SIZE);
+        file.check->info.GenerateNonces(file.groups[group], file.groupNonces, chunks.data());
+        for (uint64_t n = 0; n < file.groupNonces; ++n) {
+            for (size_t r = 0; r < m_rounds.size(); ++r) {
+                memcpy(&file.expected[((group * file.groupNonces + n) * m_rounds.size() + r) * POC_SCOOP_SIZE],
+                    &chunks[n * POC_NONCE_SIZE + m_rounds[r].scoop * POC_SCOOP_SIZE], POC_SCOOP_SIZE);
+            }
+        }
+    }
+
+    /** Best deadline of the nonces of block, whose scoops of checked nonces are copied aside. */
+    uint64_t Hash(const Block& block)
+    {
+        const Round& round = m_rounds[block.round];
+        unsigned char sigs[CHECK_GROUP_NONCES][32 + POC_SCOOP_SIZE];
+        unsigned char hashes[CHECK_GROUP_NONCES][32];
+        const unsigned char* inputs[CHECK_GROUP_NONCES];
+        unsigned char* outputs[CHECK_GROUP_NONCES];
+        for (uint64_t i = 0; i < CHECK_GROUP_NONCES; ++i) {
+            memcpy(sigs[i], round.genSig.begin(), 32);
+            inputs[i] = sigs[i];
+            outputs[i] = hashes[i];
+        }
+        uint64_t best = std::numeric_limits<uint64_t>::max();
+        for (uint64_t i = 0; i < block.count; i += CHECK_GROUP_NONCES) {
+            const uint64_t n = std::min(CHECK_GROUP_NONCES, block.count - i);
+            for (uint64_t j = 0; j < n; ++j) {
+                memcpy(sigs[j] + 32, block.buf->data() + (i + j) * POC_SCOOP_SIZE, POC_SCOOP_SIZE);
+            }
+            Shabal256Multi(outputs, inputs, sizeof(sigs[0]), n);
+            for (uint64_t j = 0; j < n; ++j) {
+                best = std::min(best, ReadLE64(hashes[j]));
+            }
+        }
+
+        // Blocks start at multiples of the group size, groups are never split
+        FileState& file = *block.file;
+        auto it = std::lower_bound(file.groups.begin(), file.groups.end(), block.index);
+        for (; it != file.groups.end() && *it < block.index + block.count; ++it) {
+            const size_t group = it - file.groups.begin();
+            for (uint64_t n = 0; n < file.groupNonces; ++n) {
+                memcpy(&file.observed[((group * file.groupNonces + n) * m_rounds.size() + block.round) * POC_SCOOP_SIZE],
+                    block.buf->data() + (*it - block.index + n) * POC_SCOOP_SIZE, POC_SCOOP_SIZE);
+            }
+        }
+        return best;
+    }
+
+    /** Only the reader of a file sets its error. */
+    static void Fail(FileState& file, const std::string& error)
+    {
+        if (file.check->error.empty()) file.check->error = error;
+    }
+
+    void Read(Device& device)
+    {
+        for (FileState* file : device.files) {
+            const PlotFileInfo& info = file->check->info;
+            CPlotFile plot;
+            std::string error;
+            if (!plot.Open(file->check->path, false, file->direct, error)) {
+                Fail(*file, error);
+                continue;
+            }
+            for (size_t r = 0; r < m_rounds.size() && file->check->error.empty(); ++r) {
+                for (uint64_t index = 0; index < info.nonces; index += m_read_nonces) {
+                    std::unique_ptr<AlignedBuffer> buf;
+                    {
+                        WAIT_LOCK(m_mutex, lock);
+                        m_cv.wait(lock, [&] { return !device.free.empty() || m_stop; });
+                        if (m_stop) return;
+                        buf = std::move(device.free.back());
+                        device.free.pop_back();
+                    }
+                    const uint64_t count = std::min(m_read_nonces, info.nonces - index);
+                    if (!plot.Read(buf->data(), count * POC_SCOOP_SIZE, info.ScoopOffset(m_rounds[r].scoop, index))) {
+                        Fail(*file, strprintf("cannot read scoop %u of nonce %u", m_rounds[r].scoop, info.startNonce + index));
+                        LOCK(m_mutex);
+                        device.free.push_back(std::move(buf));
+                        break;
+                    }
+                    {
+                        LOCK(m_mutex);
+                        m_blocks.push_back(Block{&device, file, r, index, count, std::move(buf)});
+                    }
+                    m_cv.notify_all();
+                }
+            }
+        }
+    }
+
+    void Work()
+    {
+        std::vector<uint8_t> chunks;
+        WAIT_LOCK(m_mutex, lock);
+        while (true) {
+            if (!m_stop && Interrupted()) {
+                m_stop = true;
+                m_cv.notify_all();
+            }
+            if (!m_blocks.empty()) {
+                Block block = std::move(m_blocks.front());
+                m_blocks.pop_front();
+                lock.unlock();
+                const uint64_t best = Hash(block);
+                lock.lock();
+                block.file->best[block.round] = std::min(block.file->best[block.round], best);
+                block.device->free.push_back(std::move(block.buf));
+                m_cv.notify_all();
+                continue;
+            }
+            // Hashing what was read comes first, the devices are kept busy
+            if (!m_stop && m_next_task < m_tasks.size()) {
+                const auto task = m_tasks[m_next_task++];
+                lock.unlock();
+                Recompute(*task.first, task.second, chunks);
+                lock.lock();
+                continue;
+            }
+            if (m_readers == 0 && (m_stop || m_next_task == m_tasks.size())) return;
+            m_cv.wait(lock);
+        }
+    }
+
+public:
+    PlotChecker(const PlotCheckOptions& options, const std::vector<Round>& rounds, uint64_t readNonces)
+        : m_options(options), m_rounds(rounds), m_read_nonces(readNonces) {}
+
+    /** Returns false if interrupted. */
+    bool Run(std::vector<Device>& devices, std::vector<FileState>& files)
+    {
+        for (FileState& file : files) {
+            for (size_t g = 0; g < file.groups.size(); ++g) {
+                m_tasks.emplace_back(&file, g);
+            }
+        }
+        for (Device& device : devices) {
+            for (size_t i = 0; i < READ_DEPTH; ++i) {
+                device.free.emplace_back(new AlignedBuffer(m_read_nonces * POC_SCOOP_SIZE));
+            }
+        }
+
+        std::vector<std::thread> threads;
+        {
+            LOCK(m_mutex);
+            m_readers = devices.size();
+        }
+        for (Device& device : devices) {
+            threads.emplace_back([this, &device] {
+                RenameThread("lava-plotread");
+                Read(device);
+                LOCK(m_mutex);
+                --m_readers;
+                m_cv.notify_all();
+            });
+        }
+        for (int i = 0; i < std::max(m_options.threads, 1); ++i) {
+            threads.emplace_back([this] {
+                RenameThread("lava-plotcheck");
+                Work();
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        LOCK(m_mutex);
+        return !m_stop;
+    }
+};
+
+} // namespace
+
+PlotCheckResult CheckPlotFiles(const std::vector<fs::path>& paths, const PlotCheckOptions& options)
+{
+    PlotCheckResult result;
+    FastRandomContext rng;
+
+    std::vector<Round> rounds(std::max(options.scoops, 1));
+    for (Round& round : rounds) {
+        round.genSig = rng.rand256();
+        round.scoop = CalcScoop(round.genSig, rng.rand32());
+    }
+    // Reads of whole 4 KiB pages, and of whole groups
+    const uint64_t readNonces = std::max<uint64_t>(options.readSize / PLOT_FILE_ALIGNMENT, 1) * PLOT_NONCE_ALIGNMENT;
+
+    result.files.resize(paths.size());
+    std::vector<FileState> files(paths.size());
+    std::map<uint64_t, Device> devicesById;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        PlotFileCheck& check = result.files[i];
+        FileState& file = files[i];
+        check.path = paths[i];
+        file.check = &check;
+        if (!check.info.SetFileName(paths[i].filename().string())) {
+            check.error = "not the name of a plot file";
+            continue;
+        }
+        boost::system::error_code ec;
+        const uint64_t size = fs::file_size(paths[i], ec);
+        if (ec || size != check.info.FileSize()) {
+            check.error = ec ? ec.message() : strprintf("size %u does not match the name, %u expected", size, check.info.FileSize());
+            continue;
+        }
+        // Scoops of files plotted with other nonce counts do not start page aligned
+        file.direct = options.direct && check.info.nonces % PLOT_NONCE_ALIGNMENT == 0;
+        file.groupNonces = std::min(CHECK_GROUP_NONCES, check.info.nonces);
+        file.best.assign(rounds.size(), std::numeric_limits<uint64_t>::max());
+
+        const uint64_t available = check.info.nonces / file.groupNonces;
+        const double gib = (double)check.info.FileSize() / (1 << 30);
+        const uint64_t wanted = std::max<uint64_t>(options.density * gib / file.groupNonces + 0.5, 1);
+        std::set<uint64_t> groups;
+        if (wanted * 2 > available) {
+            for (uint64_t g = 0; g < available; ++g) groups.insert(g);
+        } else {
+            while (groups.size() < wanted) groups.insert(rng.randrange(available));
+        }
+        for (uint64_t g : groups) {
+            file.groups.push_back(g * file.groupNonces);
+        }
+        file.expected.resize(file.groups.size() * file.groupNonces * rounds.size() * POC_SCOOP_SIZE);
+        file.observed.resize(file.expected.size());
+        devicesById[DeviceOf(paths[i])].files.push_back(&file);
+    }
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        for (size_t j = i + 1; j < paths.size(); ++j) {
+            const PlotFileInfo& a = result.files[i].info;
+            const PlotFileInfo& b = result.files[j].info;
+            if (result.files[i].error.empty() && result.files[j].error.empty() &&
+                a.poc2x == b.poc2x && (a.poc2x ? a.publicKeyID == b.publicKeyID : a.plotID == b.plotID) &&
+                a.startNonce < b.startNonce + b.nonces && b.startNonce < a.startNonce + a.nonces) {
+                result.overlaps.emplace_back(paths[i], paths[j]);
+            }
+        }
+    }
+
+    std::vector<Device> devices;
+    for (auto& entry : devicesById) {
+        devices.push_back(std::move(entry.second));
+    }
+    PlotChecker checker(options, rounds, readNonces);
+    result.interrupted = !checker.Run(devices, files);
+
+    result.bestDeadlines.assign(rounds.size(), std::numeric_limits<uint64_t>::max());
+    for (FileState& file : files) {
+        PlotFileCheck& check = *file.check;
+        if (!check.error.empty()) continue;
+        result.nonces += check.info.nonces;
+        for (size_t r = 0; r < rounds.size(); ++r) {
+            result.bestDeadlines[r] = std::min(result.bestDeadlines[r], file.best[r]);
+        }
+        if (result.interrupted) continue;
+
+        const uint64_t regionNonces = (check.info.nonces + CHECK_REGIONS - 1) / CHECK_REGIONS;
+        std::map<uint64_t, PlotRegionCheck> regions;
+        const size_t nonceBytes = rounds.size() * POC_SCOOP_SIZE;
+        for (size_t g = 0; g < file.groups.size(); ++g) {
+            for (uint64_t n = 0; n < file.groupNonces; ++n) {
+                const uint64_t index = file.groups[g] + n;
+                const size_t offset = (g * file.groupNonces + n) * nonceBytes;
+                PlotRegionCheck& region = regions[index / regionNonces];
+                ++region.checked;
+                ++check.checked;
+                if (memcmp(&file.expected[offset], &file.observed[offset], nonceBytes) != 0) {
+                    ++region.mismatches;
+                    ++check.mismatches;
+                }
+            }
+        }
+        // Neighbouring regions with mismatches are reported as one
+        uint64_t last = std::numeric_limits<uint64_t>::max();
+        for (auto& entry : regions) {
+            PlotRegionCheck& region = entry.second;
+            if (region.mismatches == 0) continue;
+            region.startNonce = check.info.startNonce + entry.first * regionNonces;
+            region.nonces = std::min(regionNonces, check.info.nonces - entry.first * regionNonces);
+            if (!check.regions.empty() && last + 1 == entry.first) {
+                check.regions.back().nonces += region.nonces;
+                check.regions.back().checked += region.checked;
+                check.regions.back().mismatches += region.mismatches;
+            } else {
+                check.regions.push_back(region);
+            }
+            last = entry.first;
+        }
+        result.checked += check.checked;
+        result.mismatches += check.mismatches;
+    }
+    if (result.nonces == 0) result.bestDeadlines.clear();
+    return result;
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LAVA_PLOTCHECK_H
+#define LAVA_PLOTCHECK_H
+
+#include <fs.h>
+#include <plotfile.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Default for -density, the nonces checked per GiB of plot */
+static const double DEFAULT_PLOTCHECK_DENSITY = 1.0;
+/** Default for -scoops, the scoops of every file that are read and compared */
+static const int DEFAULT_PLOTCHECK_SCOOPS = 16;
+/** Default for -readsize, the size of the reads in MiB */
+static const int DEFAULT_PLOTCHECK_READ_SIZE = 8;
+/** Maximum number of threads the checkplots RPC hashes on, the node keeps the other cores */
+static const int MAX_PLOTCHECK_RPC_THREADS = 4;
+
+struct PlotCheckOptions
+{
+    double density{DEFAULT_PLOTCHECK_DENSITY};
+    int scoops{DEFAULT_PLOTCHECK_SCOOPS};
+    /** Threads recomputing nonces and hashing the scoops read. */
+    int threads{1};
+    size_t readSize{(size_t)DEFAULT_PLOTCHECK_READ_SIZE << 20};
+    bool direct{true};
+    /** Polled to stop the check early, may be empty. */
+    std::function<bool()> interrupt;
+};
+
+/** Nonces checked in a part of a plot file. */
+struct PlotRegionCheck
+{
+    uint64_t startNonce{0};
+    uint64_t nonces{0};
+    uint64_t checked{0};
+    uint64_t mismatches{0};
+};
+
+struct PlotFileCheck
+{
+    fs::path path;
+    PlotFileInfo info;
+    /** Why the file could not be checked, empty if it was. */
+    std::string error;
+    uint64_t checked{0};
+    uint64_t mismatches{0};
+    /** The parts of the file where checked nonces mismatch. */
+    std::vector<PlotRegionCheck> regions;
+};
+
+struct PlotCheckResult
+{
+    std::vector<PlotFileCheck> files;
+    /** Files sharing nonces, only one of which can forge with them. */
+    std::vector<std::pair<fs::path, fs::path>> overlaps;
+    bool interrupted{false};
+    /** Nonces of the files that could be read. */
+    uint64_t nonces{0};
+    uint64_t checked{0};
+    uint64_t mismatches{0};
+    /** Best deadline of every round over all the nonces read, before division by the base target. */
+    std::vector<uint64_t> bestDeadlines;
+
+    /** Plotted space in TiB. */
+    double Capacity() const;
+    /** Plotted space in TiB less the share of checked nonces that mismatch. */
+    double EffectiveCapacity() const;
+    /** Space in TiB whose best deadlines are on average the ones observed. */
+    double DeadlineCapacity() const;
+    /** Average best deadline in seconds of capacity TiB forging against baseTarget. */
+    static double ExpectedDeadline(double capacity, uint64_t baseTarget);
+};
+
+/** The plot files among paths, directories being searched without descending into subdirectories. */
+std::vector<fs::path> FindPlotFiles(const std::vector<fs::path>& paths);
+
+/**
+ * Sample plot files and check them against the nonces the node computes.
+ *
+ * A few rounds are drawn at random, each with its generation signature and
+ * scoop. The scoop of every round is read in full from every file, in large
+ * sequential reads and with one reader thread per device, and hashed into
+ * the best deadline of the round. Groups of consecutive nonces are drawn at
+ * the given density and recomputed with the multi-lane Shabal kernel, their
+ * scoops then have to match the ones read.
+ */
+PlotCheckResult CheckPlotFiles(const std::vector<fs::path>& paths, const PlotCheckOptions& options);
+
+#endif // LAVA_PLOTCHECK_H
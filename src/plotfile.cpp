@@ -0,0 +1,203 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <plotfile.h>
+
+#include <tinyformat.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+
+#include <errno.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::string PlotFileInfo::FileName() const
+{
+    return strprintf("%s_%u_%u", poc2x ? publicKeyID.GetHex() : std::to_string(plotID), startNonce, nonces);
+}
+
+bool PlotFileInfo::SetFileName(const std::string& name)
+{
+    const size_t first = name.find('_');
+    const size_t second = first == std::string::npos ? first : name.find('_', first + 1);
+    if (second == std::string::npos) return false;
+    const std::string id = name.substr(0, first);
+    if (!ParseUInt64(name.substr(first + 1, second - first - 1), &startNonce) ||
+        !ParseUInt64(name.substr(second + 1), &nonces) || nonces == 0) {
+        return false;
+    }
+    if (id.size() == 2 * publicKeyID.size() && IsHex(id)) {
+        poc2x = true;
+        publicKeyID.SetHex(id);
+        return true;
+    }
+    poc2x = false;
+    return ParseUInt64(id, &plotID) && plotID != 0;
+}
+
+void PlotFileInfo::GenerateNonces(uint64_t index, size_t count, uint8_t* out) const
+{
+    if (poc2x) {
+        genNonceChunks(publicKeyID, startNonce + index, count, out);
+    } else {
+        genNonceChunksPoc2(plotID, startNonce + index, count, out);
+    }
+}
+
+uint64_t PlotFileInfo::CalcDeadline(const uint256& genSig, uint64_t height, uint64_t index) const
+{
+    if (poc2x) {
+        return ::CalcDeadline(genSig, height, publicKeyID, startNonce + index);
+    }
+    return CalcDeadlinePoc2(genSig, height, plotID, startNonce + index);
+}
+
+AlignedBuffer::AlignedBuffer(size_t size) : m_size(size)
+{
+#ifdef WIN32
+    m_data = (unsigned char*)_aligned_malloc(size, PLOT_FILE_ALIGNMENT);
+#else
+    void* data = nullptr;
+    if (posix_memalign(&data, PLOT_FILE_ALIGNMENT, size) == 0) {
+        m_data = (unsigned char*)data;
+    }
+#endif
+    if (m_data == nullptr) throw std::bad_alloc();
+}
+
+AlignedBuffer::~AlignedBuffer()
+{
+#ifdef WIN32
+    _aligned_free(m_data);
+#else
+    free(m_data);
+#endif
+}
+
+bool CPlotFile::Open(const fs::path& path, bool write, bool direct, std::string& error)
+{
+    Close();
+#ifdef WIN32
+    // "r+b" does not create the file
+    if (write && !fs::exists(path)) {
+        FILE* file = fsbridge::fopen(path, "wb");
+        if (file) fclose(file);
+    }
+    m_file = fsbridge::fopen(path, write ? "r+b" : "rb");
+    if (m_file == nullptr) {
+        error = strprintf("cannot open %s: %s", path.string(), strerror(errno));
+        return false;
+    }
+    m_direct = false;
+#else
+    int flags = write ? O_RDWR | O_CREAT : O_RDONLY;
+#ifdef O_DIRECT
+    m_fd = direct ? open(path.string().c_str(), flags | O_DIRECT, 0644) : -1;
+    // Not every file system supports direct I/O, tmpfs for instance
+    m_direct = m_fd != -1;
+#endif
+    if (m_fd == -1) {
+        m_fd = open(path.string().c_str(), flags, 0644);
+    }
+    if (m_fd == -1) {
+        error = strprintf("cannot open %s: %s", path.string(), strerror(errno));
+        return false;
+    }
+#if defined(MAC_OSX) && defined(F_NOCACHE)
+    m_direct = direct && fcntl(m_fd, F_NOCACHE, 1) != -1;
+#endif
+#endif
+    return true;
+}
+
+void CPlotFile::Close()
+{
+#ifdef WIN32
+    if (m_file) fclose(m_file);
+    m_file = nullptr;
+#else
+    if (m_fd != -1) close(m_fd);
+    m_fd = -1;
+#endif
+    m_direct = false;
+}
+
+bool CPlotFile::Allocate(uint64_t size)
+{
+#ifdef WIN32
+    HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(m_file));
+    LARGE_INTEGER nFileSize;
+    nFileSize.QuadPart = size;
+    return SetFilePointerEx(hFile, nFileSize, 0, FILE_BEGIN) && SetEndOfFile(hFile);
+#elif defined(MAC_OSX)
+    fstore_t fst;
+    fst.fst_flags = F_ALLOCATECONTIG;
+    fst.fst_posmode = F_PEOFPOSMODE;
+    fst.fst_offset = 0;
+    fst.fst_length = (off_t)size;
+    fst.fst_bytesalloc = 0;
+    if (fcntl(m_fd, F_PREALLOCATE, &fst) == -1) {
+        fst.fst_flags = F_ALLOCATEALL;
+        fcntl(m_fd, F_PREALLOCATE, &fst);
+    }
+    return ftruncate(m_fd, (off_t)size) == 0;
+#elif defined(__linux__)
+    // Falls back to setting the size where the file system cannot reserve space
+    return posix_fallocate(m_fd, 0, (off_t)size) == 0 || ftruncate(m_fd, (off_t)size) == 0;
+#else
+    return ftruncate(m_fd, (off_t)size) == 0;
+#endif
+}
+
+bool CPlotFile::Read(unsigned char* buf, size_t size, uint64_t offset)
+{
+#ifdef WIN32
+    return _fseeki64(m_file, offset, SEEK_SET) == 0 && fread(buf, 1, size, m_file) == size;
+#else
+    while (size > 0) {
+        ssize_t n = pread(m_fd, buf, size, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+#endif
+}
+
+bool CPlotFile::Write(const unsigned char* buf, size_t size, uint64_t offset)
+{
+#ifdef WIN32
+    return _fseeki64(m_file, offset, SEEK_SET) == 0 && fwrite(buf, 1, size, m_file) == size;
+#else
+    while (size > 0) {
+        ssize_t n = pwrite(m_fd, buf, size, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+#endif
+}
+
+bool CPlotFile::Sync()
+{
+#ifdef WIN32
+    return FileCommit(m_file);
+#elif defined(__linux__)
+    return fdatasync(m_fd) == 0 || errno == EINVAL;
+#else
+    return fsync(m_fd) == 0 || errno == EINVAL;
+#endif
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LAVA_PLOTFILE_H
+#define LAVA_PLOTFILE_H
+
+#include <fs.h>
+#include <poc.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+/** Alignment of the offsets, sizes and buffers of direct I/O on plot files. */
+static const size_t PLOT_FILE_ALIGNMENT = 4096;
+/** Nonces of a plot file are a multiple of this, so that every scoop starts aligned. */
+static const uint64_t PLOT_NONCE_ALIGNMENT = PLOT_FILE_ALIGNMENT / POC_SCOOP_SIZE;
+
+/**
+ * What the name of a plot file tells about it. A PoC2.x plot is named
+ * <public key id>_<start nonce>_<nonces> and a classic PoC2 plot
+ * <plot id>_<start nonce>_<nonces>. Both are laid out scoop-major: scoop 0
+ * of every nonce, then scoop 1 of every nonce and so on.
+ */
+struct PlotFileInfo
+{
+    /** Whether the nonces are generated from publicKeyID (genNonceChunk) or plotID (genNonceChunkPoc2). */
+    bool poc2x{true};
+    uint160 publicKeyID;
+    uint64_t plotID{0};
+    uint64_t startNonce{0};
+    uint64_t nonces{0};
+
+    std::string FileName() const;
+    /** Parse a file name, returns false if it is not the name of a plot file. */
+    bool SetFileName(const std::string& name);
+
+    uint64_t FileSize() const { return nonces * POC_NONCE_SIZE; }
+    /** Offset of a scoop of the nonce startNonce + index. */
+    uint64_t ScoopOffset(uint32_t scoop, uint64_t index) const { return (scoop * nonces + index) * POC_SCOOP_SIZE; }
+
+    /** Plot data of the count nonces from startNonce + index, nonce-major. */
+    void GenerateNonces(uint64_t index, size_t count, uint8_t* out) const;
+    /** Deadline of the nonce startNonce + index given the block it is forging on, as the node computes it. */
+    uint64_t CalcDeadline(const uint256& genSig, uint64_t height, uint64_t index) const;
+};
+
+/** A buffer aligned for direct I/O. */
+class AlignedBuffer
+{
+private:
+    unsigned char* m_data{nullptr};
+    size_t m_size{0};
+
+public:
+    explicit AlignedBuffer(size_t size);
+    ~AlignedBuffer();
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
+/**
+ * A plot file opened for positioned reads and writes. With direct I/O the
+ * page cache is bypassed where the platform allows it (O_DIRECT on Linux,
+ * F_NOCACHE on macOS), offsets, sizes and buffers then have to be multiples
+ * of PLOT_FILE_ALIGNMENT. Elsewhere the file is read and written buffered.
+ */
+class CPlotFile
+{
+private:
+#ifdef WIN32
+    FILE* m_file{nullptr};
+#else
+    int m_fd{-1};
+#endif
+    bool m_direct{false};
+
+public:
+    CPlotFile() = default;
+    ~CPlotFile() { Close(); }
+    CPlotFile(const CPlotFile&) = delete;
+    CPlotFile& operator=(const CPlotFile&) = delete;
+
+    /** Open path for reading, or for writing too, creating it if needed. Sets error on failure. */
+    bool Open(const fs::path& path, bool write, bool direct, std::string& error);
+    void Close();
+    bool IsDirect() const { return m_direct; }
+
+    /** Reserve the space of the first size bytes. */
+    bool Allocate(uint64_t size);
+    bool Read(unsigned char* buf, size_t size, uint64_t offset);
+    bool Write(const unsigned char* buf, size_t size, uint64_t offset);
+    bool Sync();
+};
+
+#endif // LAVA_PLOTFILE_H
@@ -1,6 +1,11 @@
 #include <poc.h>
+#include <arith_uint256.h>
 #include <chain.h>
+#include <chainparams.h>
+#include <crypto/common.h>
+#include <crypto/shabal256.h>
 
+#include <algorithm>
 #include <vector>
 
 using namespace std;
@@ -35,8 +40,9 @@ extern "C" {
 #define SEED_LENGTH 31
 
 static constexpr char SEED_MAGIC[] = "LV\x0\x80";
-const uint64_t INITIAL_BASE_TARGET = 18325193796L;
-const uint64_t MAX_BASE_TARGET = 18325193796L;
+
+/** Nonces whose plot data is generated side by side, the lanes of the widest Shabal256Multi. */
+static const size_t NONCE_LANES = 8;
 
 
 uint256 CalcGenerationSignaturePoc2(const uint256& lastSig, uint64_t lastPlotID)
@@ -160,6 +166,67 @@ vector<uint8_t> genNonceChunk(const uint160& publicKeyID, const uint64_t nonce)
     return std::move(data);
 }
 
+/**
+ * The hash chains of genNonceChunk and genNonceChunkPoc2 for count nonces,
+ * NONCE_LANES at a time: every step hashes the same range of each nonce.
+ * putSeed(n, seed) writes the seedLength bytes of seed of the n-th nonce.
+ */
+template <typename PutSeed>
+static void GenNonceChunks(const size_t seedLength, const size_t count, uint8_t* out, PutSeed putSeed)
+{
+    vector<vector<uint8_t>> genData(std::min(count, NONCE_LANES), vector<uint8_t>(seedLength + PLOT_SIZE));
+    uint8_t final[NONCE_LANES][HASH_SIZE];
+    unsigned char* outputs[NONCE_LANES];
+    const unsigned char* inputs[NONCE_LANES];
+    for (size_t first = 0; first < count; first += NONCE_LANES) {
+        const size_t lanes = std::min(count - first, NONCE_LANES);
+        for (size_t lane = 0; lane < lanes; lane++) {
+            putSeed(first + lane, &genData[lane][PLOT_SIZE]);
+        }
+        for (size_t i = PLOT_SIZE; i > 0; i -= HASH_SIZE) {
+            const size_t len = std::min<size_t>(PLOT_SIZE + seedLength - i, HASH_CAP);
+            for (size_t lane = 0; lane < lanes; lane++) {
+                inputs[lane] = &genData[lane][i];
+                outputs[lane] = &genData[lane][i - HASH_SIZE];
+            }
+            Shabal256Multi(outputs, inputs, len, lanes);
+        }
+        for (size_t lane = 0; lane < lanes; lane++) {
+            inputs[lane] = &genData[lane][0];
+            outputs[lane] = final[lane];
+        }
+        Shabal256Multi(outputs, inputs, PLOT_SIZE + seedLength, lanes);
+
+        // XOR with final and shuffle, as genNonceChunk does
+        for (size_t lane = 0; lane < lanes; lane++) {
+            uint8_t* data = out + (first + lane) * PLOT_SIZE;
+            for (size_t i = 0; i < PLOT_SIZE; i += HASH_SIZE) {
+                const uint8_t* src = &genData[lane][(i / HASH_SIZE) % 2 == 0 ? i : PLOT_SIZE - i];
+                for (size_t j = 0; j < HASH_SIZE; j++) {
+                    data[i + j] = src[j] ^ final[lane][j];
+                }
+            }
+        }
+    }
+}
+
+void genNonceChunksPoc2(const uint64_t plotID, const uint64_t startNonce, const size_t count, uint8_t* out)
+{
+    GenNonceChunks(16, count, out, [&](size_t n, uint8_t* seed) {
+        WriteBE64(seed, plotID);
+        WriteBE64(seed + 8, startNonce + n);
+    });
+}
+
+void genNonceChunks(const uint160& publicKeyID, const uint64_t startNonce, const size_t count, uint8_t* out)
+{
+    GenNonceChunks(SEED_LENGTH, count, out, [&](size_t n, uint8_t* seed) {
+        WriteBE64(seed, startNonce + n);
+        std::reverse_copy(publicKeyID.begin(), publicKeyID.end(), seed + 8);
+        memcpy(seed + 28, SEED_MAGIC, 3);
+    });
+}
+
 uint64_t CalcDeadlinePoc2(const uint256& genSig, const uint64_t height, const uint64_t plotID, const uint64_t nonce)
 {
     vector<uint8_t> scoopGen(40);
@@ -193,7 +260,7 @@ uint64_t CalcDeadlinePoc2(const uint256& genSig, const uint64_t height, const ui
     return *wertung;
 }
 
-uint64_t CalcDeadline(const uint256& genSig, const uint64_t height, const uint160& publicKeyID, const uint64_t nonce)
+uint32_t CalcScoop(const uint256& genSig, const uint64_t height)
 {
     vector<uint8_t> scoopGen(40);
     memcpy(&scoopGen[0], genSig.begin(), genSig.size());
@@ -212,9 +279,13 @@ uint64_t CalcDeadline(const uint256& genSig, const uint64_t height, const uint16
     SHABAL(&ctx, &scoopGen[0], 40);
     char genHash[32];
     CLOSE(&ctx, genHash);
-    uint32_t scoop = (((unsigned char)genHash[31]) + 256 * (unsigned char)genHash[30]) % 4096;
+    return (((unsigned char)genHash[31]) + 256 * (unsigned char)genHash[30]) % 4096;
+}
 
-    auto chunk = genNonceChunk(publicKeyID, nonce);
+uint64_t CalcDeadline(const uint256& genSig, const uint32_t scoop, const vector<uint8_t>& chunk)
+{
+    CONTEXT ctx;
+    MMZEROUPPER();
     vector<uint8_t> sig(32 + 64);
     memcpy(&sig[0], genSig.begin(), genSig.size());
     memcpy(&sig[32], &chunk[scoop * 64], sizeof(uint8_t) * 64);
@@ -226,6 +297,11 @@ uint64_t CalcDeadline(const uint256& genSig, const uint64_t height, const uint16
     return *wertung;
 }
 
+uint64_t CalcDeadline(const uint256& genSig, const uint64_t height, const uint160& publicKeyID, const uint64_t nonce)
+{
+    return CalcDeadline(genSig, CalcScoop(genSig, height), genNonceChunk(publicKeyID, nonce));
+}
+
 uint64_t CalcDeadlinePoc2(const CBlockHeader* block, const CBlockIndex* prevBlock)
 {
     auto generationSig = CalcGenerationSignaturePoc2(prevBlock->genSign, prevBlock->nPlotID);
@@ -250,13 +326,24 @@ bool CheckProofOfCapacity(const uint256& genSig, const uint64_t height, const ui
     return (dl == deadline) && (targetDeadline >= dl / baseTarget);
 }
 
+/** Scale a base target by difTime / timespan, saturating at the maximum base target instead of overflowing. */
+static uint64_t ScaleBaseTarget(const uint64_t baseTarget, const uint64_t difTime, const uint64_t timespan, const uint64_t maxBaseTarget)
+{
+    arith_uint256 scaled = arith_uint256(baseTarget) * arith_uint256(difTime) / arith_uint256(timespan);
+    if (scaled > arith_uint256(maxBaseTarget)) {
+        return maxBaseTarget;
+    }
+    return scaled.GetLow64();
+}
+
 uint64_t AdjustBaseTarget(const CBlockIndex* prevBlock, const uint32_t nTime)
 {
+    const uint64_t maxBaseTarget = Params().GetConsensus().nMaxBaseTarget;
     if (prevBlock == nullptr) 
-        return INITIAL_BASE_TARGET;
+        return maxBaseTarget;
     auto height = prevBlock->nHeight + 1;
     if (height < 4) {
-        return INITIAL_BASE_TARGET;
+        return maxBaseTarget;
     }
     if (height < 2700) {
         auto itBlock = prevBlock;
@@ -272,11 +359,7 @@ uint64_t AdjustBaseTarget(const CBlockIndex* prevBlock, const uint32_t nTime)
         uint64_t difTime = nTime - itBlock->nTime;
 
         uint64_t curBaseTarget = avgBaseTarget;
-        uint64_t newBaseTarget = curBaseTarget * difTime / (240 * 4);
-
-        if (newBaseTarget < 0 || newBaseTarget > MAX_BASE_TARGET) {
-            newBaseTarget = MAX_BASE_TARGET;
-        }
+        uint64_t newBaseTarget = ScaleBaseTarget(curBaseTarget, difTime, 240 * 4, maxBaseTarget);
 
         if (newBaseTarget == 0) {
             newBaseTarget = 1;
@@ -312,11 +395,7 @@ uint64_t AdjustBaseTarget(const CBlockIndex* prevBlock, const uint32_t nTime)
     }
 
     uint64_t curBaseTarget = prevBlock->nBaseTarget;
-    uint64_t newBaseTarget = expBaseTarget * difTime / targetTimespan;
-
-    if (newBaseTarget < 0 || newBaseTarget > MAX_BASE_TARGET) {
-        newBaseTarget = MAX_BASE_TARGET;
-    }
+    uint64_t newBaseTarget = ScaleBaseTarget(expBaseTarget, difTime, targetTimespan, maxBaseTarget);
 
     if (newBaseTarget == 0) {
         newBaseTarget = 1;
@@ -334,89 +413,12 @@ uint64_t AdjustBaseTarget(const CBlockIndex* prevBlock, const uint32_t nTime)
 
 void AdjustBaseTarget(const CBlockIndex* prevBlock, CBlock* block)
 {
-    // 1. Gensis block
-    auto height = 0;
-    if (prevBlock != nullptr) {
-        height = prevBlock->nHeight + 1;
-    }
-    if (prevBlock == nullptr || height == 0) {
-        block->nBaseTarget = INITIAL_BASE_TARGET;
-        // 2. First 4 blocks
-    } else if (height < 4) {
-        block->nBaseTarget = INITIAL_BASE_TARGET;
-        // 3. First 2700 blocks
-    } else if (height < 2700) {
-        auto itBlock = prevBlock;
-        uint64_t avgBaseTarget = itBlock->nBaseTarget;
-
-        do {
-            itBlock = itBlock->pprev;
-            avgBaseTarget += itBlock->nBaseTarget;
-        } while (itBlock->nHeight > height - 4);
-
-        avgBaseTarget = avgBaseTarget / 4;
-
-        uint64_t difTime = block->nTime - itBlock->nTime;
-
-        uint64_t curBaseTarget = avgBaseTarget;
-        uint64_t newBaseTarget = curBaseTarget * difTime / (240 * 4);
-
-        if (newBaseTarget < 0 || newBaseTarget > MAX_BASE_TARGET) {
-            newBaseTarget = MAX_BASE_TARGET;
-        }
-
-        if (newBaseTarget == 0) {
-            newBaseTarget = 1;
-        }
-
-        // Adjust range should at [0.9, 1.1]
-        if (newBaseTarget < (curBaseTarget * 9 / 10)) {
-            newBaseTarget = curBaseTarget * 9 / 10;
-        } else if (newBaseTarget > (curBaseTarget * 11 / 10)) {
-            newBaseTarget = curBaseTarget * 11 / 10;
-        }
-
-        block->nBaseTarget = newBaseTarget;
-    } else { // 4. Later blocks
-        auto itBlock = prevBlock;
-        uint64_t expBaseTarget = itBlock->nBaseTarget;
-        int blockCounter = 1;
-
-        // Calculate EV of last 30 blocks
-        do {
-            itBlock = itBlock->pprev;
-            blockCounter++;
-            expBaseTarget = (expBaseTarget * blockCounter + itBlock->nBaseTarget) / (blockCounter + 1);
-        } while (blockCounter < 24);
-
-        uint64_t difTime = block->nTime - itBlock->nTime;
-        uint64_t targetTimespan = 24 * 4 * 60;
-
-        if (difTime < targetTimespan / 2) {
-            difTime = targetTimespan / 2;
-        }
-
-        if (difTime > targetTimespan * 2) {
-            difTime = targetTimespan * 2;
-        }
-
-        uint64_t curBaseTarget = prevBlock->nBaseTarget;
-        uint64_t newBaseTarget = expBaseTarget * difTime / targetTimespan;
-
-        if (newBaseTarget < 0 || newBaseTarget > MAX_BASE_TARGET) {
-            newBaseTarget = MAX_BASE_TARGET;
-        }
-
-        if (newBaseTarget == 0) {
-            newBaseTarget = 1;
-        }
-
-        if (newBaseTarget < (curBaseTarget * 8 / 10)) {
-            newBaseTarget = curBaseTarget * 8 / 10;
-        } else if (newBaseTarget > (curBaseTarget * 12 / 10)) {
-            newBaseTarget = curBaseTarget * 12 / 10;
-        }
+    block->nBaseTarget = AdjustBaseTarget(prevBlock, block->nTime);
+}
 
-        block->nBaseTarget = newBaseTarget;
-    }
+double EstimateNetworkCapacity(const uint64_t avgBaseTarget)
+{
+    if (avgBaseTarget == 0)
+        return 0.0;
+    return (double)INITIAL_BASE_TARGET / (double)avgBaseTarget;
 }
@@ -3,6 +3,7 @@
 
 #include "uint256.h"
 #include <string>
+#include <vector>
 #include <pubkey.h>
 
 using namespace std;
@@ -11,11 +12,30 @@ class CBlockHeader;
 class CBlockIndex;
 class CBlock;
 
+/** Plot data of a nonce: POC_SCOOPS scoops of POC_SCOOP_SIZE bytes. */
+static const size_t POC_SCOOPS = 4096;
+static const size_t POC_SCOOP_SIZE = 64;
+static const size_t POC_NONCE_SIZE = POC_SCOOPS * POC_SCOOP_SIZE;
+
+/** Base target of the first blocks, which corresponds to about 1 TiB of plots forging at the target spacing. */
+static const uint64_t INITIAL_BASE_TARGET = 18325193796L;
+/** Largest base target on the main and test networks (see Consensus::Params::nMaxBaseTarget). */
+static const uint64_t MAX_BASE_TARGET = 18325193796L;
+
 // for the classic poc2 plotter check.
 uint256 CalcGenerationSignaturePoc2(const uint256& lastSig, uint64_t lastPlotID);
 
 uint64_t CalcDeadlinePoc2(const uint256& genSig, const uint64_t height, const uint64_t plotID, const uint64_t nonce);
 
+/** Generate the plot data of one nonce of plotID. */
+vector<uint8_t> genNonceChunkPoc2(const uint64_t plotID, const uint64_t nonce);
+
+/**
+ * Generate the plot data of the count nonces of plotID from startNonce into
+ * out, POC_NONCE_SIZE bytes per nonce, hashing several nonces at once.
+ */
+void genNonceChunksPoc2(const uint64_t plotID, const uint64_t startNonce, const size_t count, uint8_t* out);
+
 uint64_t CalcDeadlinePoc2(const CBlockHeader* block, const CBlockIndex* prevBlock);
 
 bool CheckProofOfCapacityPoc2(const uint256& genSig, const uint64_t height, const uint64_t plotID, const uint64_t nonce, const uint64_t baseTarget, const uint64_t deadline, const uint64_t targetDeadline);
@@ -23,6 +43,21 @@ bool CheckProofOfCapacityPoc2(const uint256& genSig, const uint64_t height, cons
 // for the poc2.x
 uint256 CalcGenerationSignature(const uint256& lastSig, const uint160& publicKeyID);
 
+/** Generate the plot data (4096 scoops of 64 bytes) of one nonce of publicKeyID. */
+vector<uint8_t> genNonceChunk(const uint160& publicKeyID, const uint64_t nonce);
+
+/**
+ * Generate the plot data of the count nonces of publicKeyID from startNonce
+ * into out, POC_NONCE_SIZE bytes per nonce, hashing several nonces at once.
+ */
+void genNonceChunks(const uint160& publicKeyID, const uint64_t startNonce, const size_t count, uint8_t* out);
+
+/** The scoop of each nonce that is read when forging the block at height. */
+uint32_t CalcScoop(const uint256& genSig, const uint64_t height);
+
+/** Deadline of a nonce from its plot data, as generated by genNonceChunk. */
+uint64_t CalcDeadline(const uint256& genSig, const uint32_t scoop, const vector<uint8_t>& chunk);
+
 uint64_t CalcDeadline(const uint256& genSig, const uint64_t height, const uint160& publicKeyID, const uint64_t nonce);
 
 uint64_t CalcDeadline(const CBlockHeader* block, const CBlockIndex* prevBlock);
@@ -33,4 +68,7 @@ void AdjustBaseTarget(const CBlockIndex* prevBlock, CBlock* block);
 
 uint64_t AdjustBaseTarget(const CBlockIndex* prevBlock, const uint32_t nTime);
 
+/** Estimate the plotted space in TiB that is forging against the given average base target. */
+double EstimateNetworkCapacity(const uint64_t avgBaseTarget);
+
 #endif // end COMMON_POC_H
\ No newline at end of file
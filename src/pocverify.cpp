@@ -0,0 +1,137 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pocverify.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <shutdown.h>
+#include <threadinterrupt.h>
+#include <tinyformat.h>
+#include <txdb.h>
+#include <ui_interface.h>
+#include <util/system.h>
+#include <validation.h>
+#include <warnings.h>
+
+#include <thread>
+
+/** Number of blocks checked between two writes of the progress. */
+static const int POC_VERIFY_PROGRESS_INTERVAL = 10000;
+
+constexpr int64_t POC_VERIFY_LOG_INTERVAL = 30; // seconds
+
+static std::thread g_pocverify_thread;
+static CThreadInterrupt g_pocverify_interrupt;
+
+template<typename... Args>
+static void FatalError(const char* fmt, const Args&... args)
+{
+    std::string strMessage = tfm::format(fmt, args...);
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(
+        "Error: A fatal internal error occurred, see debug.log for details",
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+}
+
+void VerifyAssumedValidPoc(const CThreadInterrupt& interrupt)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    CBlockIndex* pindex_assumed;
+    const CBlockIndex* pindex_verified = nullptr;
+    {
+        LOCK(cs_main);
+        pindex_assumed = LookupBlockIndex(hashAssumeValid);
+        if (!pindex_assumed) {
+            return;
+        }
+        uint256 verified_hash;
+        if (pblocktree->ReadPocVerified(verified_hash)) {
+            pindex_verified = LookupBlockIndex(verified_hash);
+        }
+    }
+    // The progress of a previous -assumevalid block only counts if it is on the same chain
+    if (pindex_verified && pindex_assumed->GetAncestor(pindex_verified->nHeight) != pindex_verified) {
+        pindex_verified = nullptr;
+    }
+    const int start_height = pindex_verified ? pindex_verified->nHeight + 1 : 1;
+    if (start_height > pindex_assumed->nHeight) {
+        return;
+    }
+    LogPrintf("Verifying the proofs of capacity below the assumed valid block %s, from height %d to %d\n",
+        hashAssumeValid.ToString(), start_height, pindex_assumed->nHeight);
+
+    int64_t last_log_time = GetTime();
+    for (int height = start_height; height <= pindex_assumed->nHeight; ++height) {
+        // Block index entries are never deleted, the ancestors can be used without cs_main
+        CBlockIndex* pindex = pindex_assumed->GetAncestor(height);
+        if (!CheckBlockProofOfCapacity(pindex->GetBlockHeader(), height, consensusParams)) {
+            // The block and its descendants are invalidated as if it had been checked when connected
+            LogPrintf("The proof of capacity of block %s at height %d, below the assumed valid block %s, is invalid, invalidating it\n",
+                pindex->GetBlockHash().ToString(), height, hashAssumeValid.ToString());
+            SetMiscWarning(strprintf(_("Warning: Block %s below the assumed valid block has an invalid proof of capacity and was invalidated. Check -assumevalid."),
+                pindex->GetBlockHash().ToString()));
+            CValidationState state;
+            if (!InvalidateBlock(state, Params(), pindex) || !ActivateBestChain(state, Params())) {
+                FatalError("%s: Failed to invalidate block %s: %s", __func__, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
+            }
+            return;
+        }
+
+        const bool interrupted = static_cast<bool>(interrupt);
+        if (interrupted || height % POC_VERIFY_PROGRESS_INTERVAL == 0 || height == pindex_assumed->nHeight) {
+            if (!pblocktree->WritePocVerified(pindex->GetBlockHash())) {
+                FatalError("%s: Failed to write the proof of capacity verification progress", __func__);
+                return;
+            }
+        }
+        if (interrupted) {
+            LogPrintf("Proof of capacity verification interrupted at height %d, it resumes at the next startup\n", height);
+            return;
+        }
+
+        int64_t current_time = GetTime();
+        if (last_log_time + POC_VERIFY_LOG_INTERVAL < current_time) {
+            LogPrintf("Verifying the proofs of capacity below the assumed valid block, at height %d\n", height);
+            last_log_time = current_time;
+        }
+    }
+    LogPrintf("The proofs of capacity below the assumed valid block %s are valid\n", hashAssumeValid.ToString());
+}
+
+static void ThreadVerifyPoc()
+{
+    ScheduleBatchPriority();
+
+    // Blocks are only skipped while catching up
+    while (IsInitialBlockDownload()) {
+        if (!g_pocverify_interrupt.sleep_for(std::chrono::seconds(10))) {
+            return;
+        }
+    }
+    VerifyAssumedValidPoc(g_pocverify_interrupt);
+}
+
+void StartPocVerification()
+{
+    if (hashAssumeValid.IsNull()) {
+        return;
+    }
+    g_pocverify_thread = std::thread(&TraceThread<void (*)()>, "pocverify", &ThreadVerifyPoc);
+}
+
+void InterruptPocVerification()
+{
+    g_pocverify_interrupt();
+}
+
+void StopPocVerification()
+{
+    if (g_pocverify_thread.joinable()) {
+        g_pocverify_thread.join();
+    }
+}
@@ -0,0 +1,24 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LAVA_POCVERIFY_H
+#define LAVA_POCVERIFY_H
+
+class CThreadInterrupt;
+
+/**
+ * The deadlines of the blocks below the -assumevalid block are not checked
+ * against their plots while syncing. Once the initial block download is over,
+ * a low priority thread checks them from the headers in the block index, and
+ * invalidates the first invalid one with its descendants. Its progress is kept
+ * in the block tree database so that it does not start over at every startup.
+ */
+void StartPocVerification();
+void InterruptPocVerification();
+void StopPocVerification();
+
+/** Check the deadlines below the -assumevalid block from the saved progress on, until interrupted. */
+void VerifyAssumedValidPoc(const CThreadInterrupt& interrupt);
+
+#endif // LAVA_POCVERIFY_H
@@ -50,7 +50,7 @@ struct CCoin {
     ADD_SERIALIZE_METHODS;
 
     CCoin() : nHeight(0) {}
-    explicit CCoin(Coin&& in) : nHeight(in.nHeight), out(std::move(in.out)) {}
+    explicit CCoin(Coin&& in) : nHeight(in.nHeight), out(in.out.GetTxOut()) {}
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
@@ -204,7 +204,7 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CBlock block;
+    std::shared_ptr<const CRawBlock> raw_block;
     CBlockIndex* pblockindex = nullptr;
     CBlockIndex* tip = nullptr;
     {
@@ -218,14 +218,24 @@ static bool rest_block(HTTPRequest* req,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        raw_block = GetRawBlock(pblockindex, Params().MessageStart());
+        if (!raw_block)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
+    // The block is stored in network format, so it is only decoded when
+    // witnesses have to be stripped from it or it is shown as JSON
+    CDataStream ssBlock(raw_block->data, SER_NETWORK, PROTOCOL_VERSION);
+    if (rf != RetFormat::JSON && RPCSerializationFlags() != 0 && raw_block->HasWitness()) {
+        CBlock block;
+        ssBlock >> block;
+        ssBlock.clear();
+        ssBlock.SetVersion(PROTOCOL_VERSION | RPCSerializationFlags());
+        ssBlock << block;
+    }
+
     switch (rf) {
     case RetFormat::BINARY: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
         std::string binaryBlock = ssBlock.str();
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
@@ -233,8 +243,6 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RetFormat::HEX: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
         std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
@@ -242,6 +250,8 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RetFormat::JSON: {
+        CBlock block;
+        ssBlock >> block;
         UniValue objBlock = blockToJSON(block, tip, pblockindex, showTxDetails);
         std::string strJSON = objBlock.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
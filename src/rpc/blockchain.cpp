@@ -14,6 +14,8 @@
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
+#include <index/assetindex.h>
+#include <index/blockfilterindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <policy/feerate.h>
@@ -23,6 +25,7 @@
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <snapshot.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -986,11 +989,12 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
         ss << VARINT(output.second.out.nValue, VarIntMode::NONNEGATIVE_SIGNED);
         stats.nTransactionOutputs++;
         if (output.second.out.IsCA()) {
+            const CConfidentialValue value = output.second.out.GetValueCommitment();
             ss << output.second.out.nValue;
-            ss << output.second.out.nAsset;
-            ss << output.second.out.nNonce;
-            if (output.second.out.nValueCA.IsExplicit()) {
-                stats.nTotalAmount += output.second.out.nValueCA.GetAmount();
+            ss << output.second.out.GetAssetCommitment();
+            ss << output.second.out.GetNonceCommitment();
+            if (value.IsExplicit()) {
+                stats.nTotalAmount += value.GetAmount();
             }
         }
         stats.nBogoSize += 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
@@ -1207,18 +1211,19 @@ UniValue gettxout(const JSONRPCRequest& request)
         ret.pushKV("confirmations", (int64_t)(pindex->nHeight - coin.nHeight + 1));
     }
     if (coin.out.IsCA()) {
-        if (coin.out.nValueCA.IsExplicit()) {
-            ret.pushKV("value-ca", ValueFromAmount(coin.out.nValueCA.GetAmount()));
+        const CTxOut txout = coin.out.GetTxOut();
+        if (txout.nValueCA.IsExplicit()) {
+            ret.pushKV("value-ca", ValueFromAmount(txout.nValueCA.GetAmount()));
         } else {
-            ret.pushKV("valuecommitment", coin.out.nValueCA.GetHex());
+            ret.pushKV("valuecommitment", txout.nValueCA.GetHex());
         }
-        if (coin.out.nAsset.IsExplicit()) {
-            ret.pushKV("asset", coin.out.nAsset.GetAsset().GetHex());
+        if (txout.nAsset.IsExplicit()) {
+            ret.pushKV("asset", txout.nAsset.GetAsset().GetHex());
         } else {
-            ret.pushKV("assetcommitment", coin.out.nAsset.GetHex());
+            ret.pushKV("assetcommitment", txout.nAsset.GetHex());
         }
 
-        ret.pushKV("commitmentnonce", coin.out.nNonce.GetHex());
+        ret.pushKV("commitmentnonce", txout.nNonce.GetHex());
     } else {
         ret.pushKV("value", ValueFromAmount(coin.out.nValue));
     }
@@ -2142,6 +2147,61 @@ static UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue dumpsnapshot(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        throw std::runtime_error(
+            RPCHelpMan{"dumpsnapshot",
+                "\nWrite the coins set together with the ticket and relation state at the tip to a file.\n"
+                "A node started with -loadsnapshot=<file> loads it instead of connecting the blocks below its base.\n",
+                {
+                    {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "The file to write, relative paths are prefixed by the data directory"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"base_hash\": \"hex\",      (string) the hash of the block at which the snapshot was taken\n"
+            "  \"base_height\": n,          (numeric) the height of that block\n"
+            "  \"coins\": n,                (numeric) the number of coins written\n"
+            "  \"coins_hash\": \"hex\",     (string) the hash of the coins set\n"
+            "  \"records\": n,              (numeric) the number of ticket and relation records written\n"
+            "  \"ticket_hash\": \"hex\",    (string) the hash of the ticket records\n"
+            "  \"relation_hash\": \"hex\",  (string) the hash of the relation records, but the plot id ones\n"
+            "  \"snapshot_hash\": \"hex\",  (string) the hash of the snapshot file, to be checked by whoever loads it\n"
+            "  \"path\": \"path\"           (string) the absolute path of the file\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("dumpsnapshot", "\"snapshot.dat\"")
+            + HelpExampleRpc("dumpsnapshot", "\"snapshot.dat\"")
+                },
+            }.ToString());
+    }
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+    }
+
+    SnapshotMetadata metadata;
+    uint256 snapshot_hash;
+    std::string error;
+    if (!DumpSnapshot(path, metadata, snapshot_hash, error)) {
+        throw JSONRPCError(RPC_MISC_ERROR, error);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("base_hash", metadata.base_hash.GetHex());
+    result.pushKV("base_height", metadata.base_height);
+    result.pushKV("coins", metadata.coins_count);
+    result.pushKV("coins_hash", metadata.coins_hash.GetHex());
+    result.pushKV("records", metadata.records_count);
+    result.pushKV("ticket_hash", metadata.ticket_hash.GetHex());
+    result.pushKV("relation_hash", metadata.relation_hash.GetHex());
+    result.pushKV("snapshot_hash", snapshot_hash.GetHex());
+    result.pushKV("path", path.string());
+    return result;
+}
+
 //! Search for a given set of pubkey scripts
 bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results) {
     scan_progress = 0;
@@ -2348,7 +2408,7 @@ UniValue scantxoutset(const JSONRPCRequest& request)
         for (const auto& it : coins) {
             const COutPoint& outpoint = it.first;
             const Coin& coin = it.second;
-            const CTxOut& txo = coin.out;
+            const CTxOut txo = coin.out.GetTxOut();
             input_txos.push_back(txo);
             total_in += txo.nValue;
 
@@ -2383,6 +2443,249 @@ UniValue scantxoutset(const JSONRPCRequest& request)
     return result;
 }
 
+static void EnsureAssetIndex()
+{
+    if (!g_assetindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Requires -assetindex");
+    }
+    if (!g_assetindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Asset index is still syncing, try again later");
+    }
+}
+
+/** Drop the issuances of blocks that were replaced by a reorg but are still in the index. */
+static void FilterActiveIssuances(std::vector<CAssetIssuanceRecord>& records)
+{
+    LOCK(cs_main);
+    records.erase(std::remove_if(records.begin(), records.end(), [](const CAssetIssuanceRecord& record) {
+        const CBlockIndex* pindex = chainActive[record.nHeight];
+        return pindex == nullptr || pindex->GetBlockHash() != record.hashBlock;
+    }), records.end());
+}
+
+static UniValue IssuanceAmountToJSON(CAmount amount)
+{
+    return amount == -1 ? UniValue(-1) : ValueFromAmount(amount);
+}
+
+static UniValue IssuanceRecordToJSON(const CAssetIssuanceRecord& record)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("asset", record.asset.GetHex());
+    if (!record.fReissuance) {
+        obj.pushKV("token", record.token.GetHex());
+    }
+    obj.pushKV("entropy", record.entropy.GetHex());
+    obj.pushKV("isreissuance", record.fReissuance);
+    obj.pushKV("txid", record.txid.GetHex());
+    obj.pushKV("vin", (uint64_t)record.nVin);
+    obj.pushKV("prevout", record.prevout.hash.GetHex() + ":" + std::to_string(record.prevout.n));
+    obj.pushKV("height", record.nHeight);
+    obj.pushKV("blockhash", record.hashBlock.GetHex());
+    obj.pushKV("assetamount", IssuanceAmountToJSON(record.nAmount));
+    obj.pushKV("tokenamount", IssuanceAmountToJSON(record.nInflationKeys));
+    return obj;
+}
+
+static UniValue getassetinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getassetinfo",
+                "\nReturns the issuance and all reissuances of an asset in the active chain.\n"
+                "Requires -assetindex.\n",
+                {
+                    {"asset", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The asset id"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"asset\": \"hex\",            (string) the asset id\n"
+            "  \"token\": \"hex\",            (string) the reissuance token of the asset\n"
+            "  \"entropy\": \"hex\",          (string) the asset entropy\n"
+            "  \"height\": xxx,               (numeric) the height of the initial issuance\n"
+            "  \"assetamount\": x.xxx,        (numeric) the total explicit amount issued, -1 if any issuance was blinded\n"
+            "  \"tokenamount\": x.xxx,        (numeric) the total explicit token amount issued, -1 if any issuance was blinded\n"
+            "  \"issuances\": [              (array) the issuance followed by the reissuances, as in listassetissuances\n"
+            "    ...\n"
+            "  ]\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getassetinfo", "\"asset\"")
+            + HelpExampleRpc("getassetinfo", "\"asset\"")
+                },
+            }.ToString());
+
+    EnsureAssetIndex();
+
+    CAsset asset(ParseHashV(request.params[0], "asset"));
+    std::vector<CAssetIssuanceRecord> records;
+    if (!g_assetindex->FindAssetIssuances(asset, records)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read asset index");
+    }
+    FilterActiveIssuances(records);
+
+    auto initial = std::find_if(records.begin(), records.end(), [](const CAssetIssuanceRecord& record) {
+        return !record.fReissuance;
+    });
+    if (initial == records.end()) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Asset not issued in the active chain");
+    }
+
+    CAmount asset_amount = 0, token_amount = 0;
+    UniValue issuances(UniValue::VARR);
+    for (const auto& record : records) {
+        if (asset_amount != -1) asset_amount = record.nAmount == -1 ? -1 : asset_amount + record.nAmount;
+        if (token_amount != -1) token_amount = record.nInflationKeys == -1 ? -1 : token_amount + record.nInflationKeys;
+        issuances.push_back(IssuanceRecordToJSON(record));
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("asset", asset.GetHex());
+    obj.pushKV("token", initial->token.GetHex());
+    obj.pushKV("entropy", initial->entropy.GetHex());
+    obj.pushKV("height", initial->nHeight);
+    obj.pushKV("assetamount", IssuanceAmountToJSON(asset_amount));
+    obj.pushKV("tokenamount", IssuanceAmountToJSON(token_amount));
+    obj.pushKV("issuances", issuances);
+    return obj;
+}
+
+static UniValue listassetissuances(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"listassetissuances",
+                "\nLists the asset issuances and reissuances of the active chain in a height range.\n"
+                "Requires -assetindex.\n",
+                {
+                    {"start_height", RPCArg::Type::NUM, /* default */ "0", "The first height to list."},
+                    {"end_height", RPCArg::Type::NUM, /* default */ "tip height", "The last height to list."},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"asset\": \"hex\",          (string) the asset id\n"
+            "    \"token\": \"hex\",          (string, optional) the reissuance token, for initial issuances\n"
+            "    \"entropy\": \"hex\",        (string) the asset entropy\n"
+            "    \"isreissuance\": true|false, (boolean) whether this is a reissuance\n"
+            "    \"txid\": \"hex\",           (string) the issuing transaction\n"
+            "    \"vin\": n,                  (numeric) the input position of the issuance in the transaction\n"
+            "    \"prevout\": \"txid:n\",      (string) the outpoint spent by the issuing input\n"
+            "    \"height\": xxx,             (numeric) the block height\n"
+            "    \"blockhash\": \"hex\",      (string) the block hash\n"
+            "    \"assetamount\": x.xxx,      (numeric) the amount issued, -1 if blinded\n"
+            "    \"tokenamount\": x.xxx,      (numeric) the reissuance token amount issued, -1 if blinded\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("listassetissuances", "1000 2000")
+            + HelpExampleRpc("listassetissuances", "1000, 2000")
+                },
+            }.ToString());
+
+    EnsureAssetIndex();
+
+    int start = request.params[0].isNull() ? 0 : request.params[0].get_int();
+    int end;
+    {
+        LOCK(cs_main);
+        end = request.params[1].isNull() ? chainActive.Height() : request.params[1].get_int();
+    }
+    if (start < 0 || start > end) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid height range");
+    }
+
+    std::vector<CAssetIssuanceRecord> records;
+    if (!g_assetindex->LookupRange(start, end, records)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read asset index");
+    }
+    FilterActiveIssuances(records);
+
+    UniValue result(UniValue::VARR);
+    for (const auto& record : records) {
+        result.push_back(IssuanceRecordToJSON(record));
+    }
+    return result;
+}
+
+static UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getblockfilter",
+                "\nRetrieve a BIP 157 content filter for a particular block.\n"
+                "Requires -blockfilterindex.\n",
+                {
+                    {"blockhash", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The hash of the block"},
+                    {"filtertype", RPCArg::Type::STR, /*default*/ "basic", "The type name of the filter"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"filter\" : (string) the hex-encoded filter data\n"
+            "  \"header\" : (string) the hex-encoded filter header\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+                },
+            }.ToString());
+
+    uint256 block_hash = ParseHashV(request.params[0], "blockhash");
+    BlockFilterType filtertype = BlockFilterType::BASIC;
+    if (!request.params[1].isNull()) {
+        if (!BlockFilterTypeByName(request.params[1].get_str(), filtertype)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+        }
+    }
+
+    if (!g_blockfilterindex || g_blockfilterindex->GetFilterType() != filtertype) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + BlockFilterTypeName(filtertype));
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = g_blockfilterindex->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!g_blockfilterindex->LookupFilter(block_index, filter) ||
+        !g_blockfilterindex->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2392,10 +2695,13 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockstats",          &getblockstats,          {"hash_or_height", "stats"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
+    { "blockchain",         "getassetinfo",           &getassetinfo,           {"asset"} },
+    { "blockchain",         "listassetissuances",     &listassetissuances,     {"start_height", "end_height"} },
     { "blockchain",         "getpoc2xstate",          &getpoc2xstate,          {"blockhash"} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
@@ -2407,6 +2713,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
+    { "blockchain",         "dumpsnapshot",           &dumpsnapshot,           {"path"} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
 
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
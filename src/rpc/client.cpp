@@ -32,6 +32,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "generate", 1, "maxtries" },
     //{ "generatetoaddress", 0, "nblocks" },
     //{ "generatetoaddress", 2, "maxtries" },
+    { "generatepoc", 0, "nblocks" },
+    { "generatepoc", 2, "nonces" },
     { "getnetworkhashps", 0, "nblocks" },
     { "getnetworkhashps", 1, "height" },
     { "sendtoaddress", 1, "amount" },
@@ -178,6 +180,16 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "spendhtlcwithwallet", 9, "isrefund" }, 
     { "cleanfstx",0,"slotindex"},
     { "listfstx",0,"slotindex"},
+    { "getbindinginfo", 1, "height" },
+    { "getminerstats", 1, "nblocks" },
+    { "listforgedblocks", 1, "start_height" },
+    { "listforgedblocks", 2, "end_height" },
+    { "checkplots", 0, "paths" },
+    { "checkplots", 1, "density" },
+    { "checkplots", 2, "scoops" },
+    { "getforginginfo", 0, "reset" },
+    { "listassetissuances", 0, "start_height" },
+    { "listassetissuances", 1, "end_height" },
     //
     // CA:
     { "issueasset", 0, "assetamount" },
@@ -190,6 +190,129 @@ static UniValue generatetoaddress(const JSONRPCRequest& request)
     return generateBlocks(coinbaseScript, nGenerate, nMaxTries, false);
 }
 
+/** Maximum number of nonces plotted in memory by generatepoc (256 KiB each). */
+static const int MAX_GENERATEPOC_NONCES = 1024;
+
+/** The in-memory plot of the key generatepoc last forged with, kept between calls. */
+static Mutex cs_memory_plot;
+static CKeyID g_memory_plot_key GUARDED_BY(cs_memory_plot);
+static std::vector<std::vector<uint8_t>> g_memory_plot GUARDED_BY(cs_memory_plot);
+
+static UniValue generatepoc(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
+        throw std::runtime_error(
+            RPCHelpMan{"generatepoc",
+                "\nForge blocks immediately with an in-memory plot of the given address (regtest only).\n"
+                "Each block is forged with the nonce of the plot that has the best deadline. If the mock time is set,\n"
+                "it is advanced to the deadline of each block, otherwise the call waits until the deadline is reached.\n",
+                {
+                    {"nblocks", RPCArg::Type::NUM, RPCArg::Optional::NO, "How many blocks are generated immediately."},
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The miner address whose key the plot and the blocks belong to."},
+                    {"nonces", RPCArg::Type::NUM, /* default */ "8", "How many nonces are plotted in memory."},
+                },
+                RPCResult{
+            "[ blockhashes ]     (array) hashes of blocks generated\n"
+                },
+                RPCExamples{
+            "\nForge 11 blocks with an address of the wallet\n"
+            + HelpExampleCli("generatepoc", "11 \"myaddress\"")
+            + HelpExampleRpc("generatepoc", "11, \"myaddress\"")
+                },
+            }.ToString());
+
+    if (!Params().MineBlocksOnDemand())
+        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "This method can only be used on regtest");
+
+    int nGenerate = request.params[0].get_int();
+    int nNonces = 8;
+    if (!request.params[2].isNull()) {
+        nNonces = request.params[2].get_int();
+    }
+    if (nNonces < 1 || nNonces > MAX_GENERATEPOC_NONCES) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("nonces must be between 1 and %d", MAX_GENERATEPOC_NONCES));
+    }
+
+    CTxDestination destination = DecodeDestination(request.params[1].get_str());
+    const CKeyID* keyID = boost::get<CKeyID>(&destination);
+    if (!keyID) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Error: Address does not refer to a key");
+    }
+
+    LOCK(cs_memory_plot);
+    if (g_memory_plot_key != *keyID) {
+        g_memory_plot.clear();
+        g_memory_plot_key = *keyID;
+    }
+    while (g_memory_plot.size() < (size_t)nNonces) {
+        g_memory_plot.push_back(genNonceChunk(*keyID, g_memory_plot.size()));
+    }
+
+    const CChainParams& params = Params();
+    unsigned int nExtraNonce = 0;
+    UniValue blockHashes(UniValue::VARR);
+    for (int i = 0; i < nGenerate && !ShutdownRequested(); i++) {
+        int nHeight;
+        uint256 genSig;
+        int64_t nPrevTime;
+        uint64_t nPrevBaseTarget;
+        CKeyID target;
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pindexPrev = chainActive.Tip();
+            nHeight = pindexPrev->nHeight + 1;
+            if (nHeight < params.GetConsensus().LVIP05Height) {
+                throw JSONRPCError(RPC_MISC_ERROR, "In-memory plots can only forge poc2.x blocks");
+            }
+            genSig = CalcGenerationSignature(pindexPrev->genSign, pindexPrev->nPublicKeyID);
+            nPrevTime = pindexPrev->nTime;
+            nPrevBaseTarget = pindexPrev->nBaseTarget;
+            auto to = prelationview->To(*keyID, keyID->GetPlotID(), true);
+            target = to.IsNull() ? *keyID : to;
+        }
+
+        const uint32_t scoop = CalcScoop(genSig, nHeight);
+        uint64_t nonce = 0;
+        uint64_t deadline = CalcDeadline(genSig, scoop, g_memory_plot[0]);
+        for (uint64_t n = 1; n < (uint64_t)nNonces; n++) {
+            uint64_t dl = CalcDeadline(genSig, scoop, g_memory_plot[n]);
+            if (dl < deadline) {
+                nonce = n;
+                deadline = dl;
+            }
+        }
+
+        // A block has to be later than its parent, even with a deadline below a second
+        const int64_t nForgeTime = nPrevTime + std::max<int64_t>(1, deadline / nPrevBaseTarget);
+        if (GetMockTime() != 0) {
+            if (GetMockTime() < nForgeTime) {
+                SetMockTime(nForgeTime);
+            }
+        } else {
+            while (GetTime() < nForgeTime) {
+                if (ShutdownRequested()) {
+                    return blockHashes;
+                }
+                MilliSleep(250);
+            }
+        }
+
+        std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(params).CreateNewBlock(GetScriptForDestination(target), nonce, *keyID, 0, deadline, MakeTransactionRef()));
+        if (!pblocktemplate.get())
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't create new block");
+        CBlock *pblock = &pblocktemplate->block;
+        {
+            LOCK(cs_main);
+            IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
+        }
+        std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
+        if (!ProcessNewBlock(params, shared_pblock, true, nullptr))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "ProcessNewBlock, block not accepted");
+        blockHashes.push_back(pblock->GetHash().GetHex());
+    }
+    return blockHashes;
+}
+
 static UniValue getmininginfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0) {
@@ -991,6 +1114,7 @@ static const CRPCCommand commands[] =
 
 
     //{ "generating",         "generatetoaddress",      &generatetoaddress,      {"nblocks","address","maxtries"} },
+    { "generating",         "generatepoc",            &generatepoc,            {"nblocks","address","nonces"} },
 
     { "util",               "estimatesmartfee",       &estimatesmartfee,       {"conf_target", "estimate_mode"} },
 
@@ -19,7 +19,11 @@
 #include <wallet/rpcwallet.h>
 #include <ticket.h>
 #include <consensus/tx_verify.h>
+#include <forgingstats.h>
+#include <index/minerstatsindex.h>
 #include <net.h>
+#include <plotcheck.h>
+#include <shutdown.h>
 #include <validation.h>
 
 UniValue getAddressPlotId(const JSONRPCRequest& request)
@@ -254,6 +258,399 @@ UniValue setfsowner(const JSONRPCRequest& request){
     return true;
 }
 
+/** Parse an address or a numeric plot id into the generator ids under which its blocks are indexed. */
+static void ParseGenerator(const UniValue& param, uint64_t& plotID, uint160& keyID)
+{
+    plotID = 0;
+    keyID.SetNull();
+    CTxDestination dest = DecodeDestination(param.get_str());
+    if (IsValidDestination(dest)) {
+        if (dest.type() != typeid(CKeyID)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Only support PUBKEYHASH");
+        }
+        auto key = boost::get<CKeyID>(dest);
+        plotID = key.GetPlotID();
+        keyID = key;
+    } else if (!ParseUInt64(param.get_str(), &plotID) || plotID == 0) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address or plot id");
+    }
+}
+
+/** Collect the blocks forged by a generator in [start, end] that are still in the active chain. */
+static std::vector<CForgeRecord> FindForgedBlocks(uint64_t plotID, const uint160& keyID, int start, int end)
+{
+    std::vector<CForgeRecord> records;
+    if (!g_minerstatsindex->FindBlocksByPlotID(plotID, start, end, records) ||
+        (!keyID.IsNull() && !g_minerstatsindex->FindBlocksByKeyID(keyID, start, end, records))) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read miner statistics index");
+    }
+
+    LOCK(cs_main);
+    records.erase(std::remove_if(records.begin(), records.end(), [](const CForgeRecord& record) {
+        const CBlockIndex* pindex = chainActive[record.nHeight];
+        return pindex == nullptr || pindex->GetBlockHash() != record.hashBlock;
+    }), records.end());
+    std::sort(records.begin(), records.end(), [](const CForgeRecord& a, const CForgeRecord& b) {
+        return a.nHeight < b.nHeight;
+    });
+    return records;
+}
+
+static UniValue ForgeRecordToJSON(const CForgeRecord& record)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("height", record.nHeight);
+    obj.pushKV("hash", record.hashBlock.GetHex());
+    obj.pushKV("time", (int64_t)record.nTime);
+    obj.pushKV("deadline", record.DeadlineSeconds());
+    obj.pushKV("basetarget", record.nBaseTarget);
+    if (record.UsesFirestone()) {
+        obj.pushKV("firestone", record.firestone.hash.GetHex() + ":" + std::to_string(record.firestone.n));
+    }
+    return obj;
+}
+
+static void EnsureMinerStatsIndex()
+{
+    if (!g_minerstatsindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Requires -minerstatsindex");
+    }
+    if (!g_minerstatsindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Miner statistics index is still syncing, try again later");
+    }
+}
+
+UniValue getminerstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            RPCHelpMan{"getminerstats",
+                "\nReturns forging statistics of a miner over the last blocks of the active chain.\n"
+                "Requires -minerstatsindex.\n",
+                {
+                    {"generator", RPCArg::Type::STR, RPCArg::Optional::NO, "The miner address or numeric plot id."},
+                    {"nblocks", RPCArg::Type::NUM, /* default */ "360", "The number of blocks in the window, ending at the tip."},
+                },
+                RPCResult{
+            "{\n"
+            "  \"startheight\": xxx,          (numeric) the first height of the window\n"
+            "  \"endheight\": xxx,            (numeric) the last height of the window\n"
+            "  \"blocks\": xxx,               (numeric) the number of blocks in the window\n"
+            "  \"forged\": xxx,               (numeric) the number of blocks forged by the miner\n"
+            "  \"firestones\": xxx,           (numeric) the number of forged blocks which used a firestone\n"
+            "  \"winrate\": x.xxx,            (numeric) forged / blocks\n"
+            "  \"bestdeadline\": xxx,         (numeric) the lowest deadline of the forged blocks in seconds\n"
+            "  \"averagedeadline\": xxx,      (numeric) the average deadline of the forged blocks in seconds\n"
+            "  \"networkcapacity\": x.xxx,    (numeric) the estimated network capacity in TiB\n"
+            "  \"estimatedcapacity\": x.xxx,  (numeric) the estimated capacity of the miner in TiB\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getminerstats", "\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\" 1000")
+            + HelpExampleRpc("getminerstats", "\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\", 1000")
+                },
+            }.ToString());
+
+    EnsureMinerStatsIndex();
+
+    uint64_t plotID;
+    uint160 keyID;
+    ParseGenerator(request.params[0], plotID, keyID);
+
+    int nblocks = request.params[1].isNull() ? 360 : request.params[1].get_int();
+    if (nblocks <= 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid nblocks");
+    }
+
+    int end;
+    {
+        LOCK(cs_main);
+        end = chainActive.Height();
+    }
+    int start = std::max(0, end - nblocks + 1);
+
+    std::vector<CForgeRecord> window;
+    if (!g_minerstatsindex->LookupRange(start, end, window)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read miner statistics index");
+    }
+    uint64_t sumBaseTarget = 0;
+    for (const auto& record : window) {
+        sumBaseTarget += record.nBaseTarget;
+    }
+    double networkCapacity = window.empty() ? 0.0 : EstimateNetworkCapacity(sumBaseTarget / window.size());
+
+    auto forged = FindForgedBlocks(plotID, keyID, start, end);
+    uint64_t bestDeadline = 0, sumDeadline = 0, firestones = 0;
+    for (const auto& record : forged) {
+        uint64_t deadline = record.DeadlineSeconds();
+        if (bestDeadline == 0 || deadline < bestDeadline) bestDeadline = deadline;
+        sumDeadline += deadline;
+        if (record.UsesFirestone()) firestones++;
+    }
+    double winrate = (double)forged.size() / (end - start + 1);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("startheight", start);
+    obj.pushKV("endheight", end);
+    obj.pushKV("blocks", end - start + 1);
+    obj.pushKV("forged", (uint64_t)forged.size());
+    obj.pushKV("firestones", firestones);
+    obj.pushKV("winrate", winrate);
+    obj.pushKV("bestdeadline", bestDeadline);
+    obj.pushKV("averagedeadline", forged.empty() ? 0 : sumDeadline / forged.size());
+    obj.pushKV("networkcapacity", networkCapacity);
+    obj.pushKV("estimatedcapacity", winrate * networkCapacity);
+    return obj;
+}
+
+UniValue listforgedblocks(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            RPCHelpMan{"listforgedblocks",
+                "\nLists the blocks of the active chain forged by a miner.\n"
+                "Requires -minerstatsindex.\n",
+                {
+                    {"generator", RPCArg::Type::STR, RPCArg::Optional::NO, "The miner address or numeric plot id."},
+                    {"start_height", RPCArg::Type::NUM, /* default */ "0", "The first height to list."},
+                    {"end_height", RPCArg::Type::NUM, /* default */ "tip height", "The last height to list."},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"height\": xxx,             (numeric) the block height\n"
+            "    \"hash\": \"hash\",            (string) the block hash\n"
+            "    \"time\": xxx,               (numeric) the block time\n"
+            "    \"deadline\": xxx,           (numeric) the deadline in seconds\n"
+            "    \"basetarget\": xxx,         (numeric) the base target of the block\n"
+            "    \"firestone\": \"txid:n\",     (string, optional) the firestone used by the block\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("listforgedblocks", "\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\" 1000 2000")
+            + HelpExampleRpc("listforgedblocks", "\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\", 1000, 2000")
+                },
+            }.ToString());
+
+    EnsureMinerStatsIndex();
+
+    uint64_t plotID;
+    uint160 keyID;
+    ParseGenerator(request.params[0], plotID, keyID);
+
+    int start = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    int end;
+    {
+        LOCK(cs_main);
+        end = request.params[2].isNull() ? chainActive.Height() : request.params[2].get_int();
+    }
+    if (start < 0 || start > end) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid height range");
+    }
+
+    UniValue result(UniValue::VARR);
+    for (const auto& record : FindForgedBlocks(plotID, keyID, start, end)) {
+        result.push_back(ForgeRecordToJSON(record));
+    }
+    return result;
+}
+
+UniValue checkplots(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            RPCHelpMan{"checkplots",
+                "\nSamples plot files and compares them with the nonces the node computes.\n"
+                "The scoop of a few random rounds is read in full from every file, which also gives the best\n"
+                "deadline of every round, and the scoops of randomly chosen nonces are recomputed and compared.\n"
+                "Reading takes about scoops/4096 of the plotted space, on one thread per device, and hashing\n"
+                "uses at most " + std::to_string(MAX_PLOTCHECK_RPC_THREADS) + " threads. This is long-running: the call takes minutes to hours on\n"
+                "large plots, so raise the client timeout (e.g. lava-cli -rpcclienttimeout=0). It returns early\n"
+                "with an error when the node shuts down.\n",
+                {
+                    {"paths", RPCArg::Type::ARR, RPCArg::Optional::NO, "The plot files, or directories whose plot files are checked.",
+                        {
+                            {"path", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "A plot file or directory"},
+                        },
+                    },
+                    {"density", RPCArg::Type::AMOUNT, /* default */ strprintf("%g", DEFAULT_PLOTCHECK_DENSITY), "The nonces compared per GiB of plot."},
+                    {"scoops", RPCArg::Type::NUM, /* default */ strprintf("%u", DEFAULT_PLOTCHECK_SCOOPS), "The scoops read from every file, one round of deadlines each."},
+                },
+                RPCResult{
+            "{\n"
+            "  \"files\": [\n"
+            "    {\n"
+            "      \"path\": \"path\",          (string) the plot file\n"
+            "      \"error\": \"error\",        (string, optional) why the file could not be checked\n"
+            "      \"nonces\": xxx,             (numeric) the nonces of the file\n"
+            "      \"checked\": xxx,            (numeric) the nonces compared\n"
+            "      \"mismatches\": xxx,         (numeric) the nonces compared that do not match\n"
+            "      \"regions\": [               (array) the ranges of nonces with mismatches\n"
+            "        {\n"
+            "          \"startnonce\": xxx,     (numeric) the first nonce of the range\n"
+            "          \"nonces\": xxx,         (numeric) the nonces of the range\n"
+            "          \"checked\": xxx,        (numeric) the nonces compared in the range\n"
+            "          \"mismatches\": xxx,     (numeric) the nonces compared in the range that do not match\n"
+            "        }\n"
+            "        ,...\n"
+            "      ]\n"
+            "    }\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"overlaps\": [ [\"path\", \"path\"], ... ], (array) the files plotting the same nonces\n"
+            "  \"capacity\": x.xxx,           (numeric) the plotted space in TiB\n"
+            "  \"effectivecapacity\": x.xxx,  (numeric) the plotted space in TiB less the share of mismatches\n"
+            "  \"deadlinecapacity\": x.xxx,   (numeric) the space in TiB estimated from the best deadlines of the rounds\n"
+            "  \"basetarget\": xxx,           (numeric) the base target of the tip\n"
+            "  \"expecteddeadline\": xxx,     (numeric) the average best deadline in seconds of the effective capacity at this base target\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("checkplots", "\"[\\\"/plots\\\"]\" 10")
+            + HelpExampleRpc("checkplots", "[\"/plots\"], 10")
+                },
+            }.ToString());
+
+    std::vector<fs::path> paths;
+    for (const UniValue& path : request.params[0].get_array().getValues()) {
+        paths.push_back(fs::absolute(path.get_str()));
+    }
+    PlotCheckOptions options;
+    if (!request.params[1].isNull()) {
+        options.density = (double)AmountFromValue(request.params[1]) / COIN;
+        if (options.density <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid density");
+        }
+    }
+    if (!request.params[2].isNull()) {
+        options.scoops = request.params[2].get_int();
+        if (options.scoops <= 0 || options.scoops > (int)POC_SCOOPS) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid scoops");
+        }
+    }
+    options.threads = std::max(std::min(GetNumCores(), MAX_PLOTCHECK_RPC_THREADS), 1);
+    options.interrupt = [] { return ShutdownRequested(); };
+
+    const std::vector<fs::path> files = FindPlotFiles(paths);
+    if (files.empty()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "No plot files found");
+    }
+    const PlotCheckResult result = CheckPlotFiles(files, options);
+    if (result.interrupted) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Plot check interrupted by shutdown");
+    }
+
+    UniValue jsonFiles(UniValue::VARR);
+    for (const PlotFileCheck& check : result.files) {
+        UniValue file(UniValue::VOBJ);
+        file.pushKV("path", check.path.string());
+        if (!check.error.empty()) {
+            file.pushKV("error", check.error);
+            jsonFiles.push_back(file);
+            continue;
+        }
+        file.pushKV("nonces", check.info.nonces);
+        file.pushKV("checked", check.checked);
+        file.pushKV("mismatches", check.mismatches);
+        UniValue regions(UniValue::VARR);
+        for (const PlotRegionCheck& region : check.regions) {
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("startnonce", region.startNonce);
+            obj.pushKV("nonces", region.nonces);
+            obj.pushKV("checked", region.checked);
+            obj.pushKV("mismatches", region.mismatches);
+            regions.push_back(obj);
+        }
+        file.pushKV("regions", regions);
+        jsonFiles.push_back(file);
+    }
+    UniValue overlaps(UniValue::VARR);
+    for (const auto& overlap : result.overlaps) {
+        UniValue pair(UniValue::VARR);
+        pair.push_back(overlap.first.string());
+        pair.push_back(overlap.second.string());
+        overlaps.push_back(pair);
+    }
+
+    uint64_t baseTarget;
+    {
+        LOCK(cs_main);
+        baseTarget = chainActive.Tip()->nBaseTarget;
+    }
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("files", jsonFiles);
+    obj.pushKV("overlaps", overlaps);
+    obj.pushKV("capacity", result.Capacity());
+    obj.pushKV("effectivecapacity", result.EffectiveCapacity());
+    obj.pushKV("deadlinecapacity", result.DeadlineCapacity());
+    obj.pushKV("basetarget", baseTarget);
+    obj.pushKV("expecteddeadline", result.EffectiveCapacity() > 0 ? PlotCheckResult::ExpectedDeadline(result.EffectiveCapacity(), baseTarget) : 0);
+    return obj;
+}
+
+UniValue getforginginfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            RPCHelpMan{"getforginginfo",
+                "\nReturns the latencies of the forging pipeline since startup, from submitnonce to the first announcement of forged blocks.\n"
+                "All times are in microseconds, quantiles are upper bounds of power of two buckets.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, /* default */ "false", "Clear the histograms after reporting them"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"stage\": {                (json object) one of nonceverify, deadlinepoll, createblock, testvalidity,\n"
+            "                                processblock, announce and total\n"
+            "    \"count\": n,             (numeric) the number of samples\n"
+            "    \"mean\": n,              (numeric) the mean latency\n"
+            "    \"p50\": n,               (numeric) the median latency\n"
+            "    \"p90\": n,               (numeric) the 90th percentile\n"
+            "    \"p99\": n,               (numeric) the 99th percentile\n"
+            "    \"max\": n,               (numeric) the highest latency\n"
+            "    \"buckets\": [            (json array) the non-empty buckets\n"
+            "      [le, count],            (json array) samples of at most le microseconds and above the previous bucket\n"
+            "      ...\n"
+            "    ]\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getforginginfo", "") + HelpExampleRpc("getforginginfo", "true")
+                },
+            }.ToString());
+
+    UniValue obj(UniValue::VOBJ);
+    for (int i = 0; i < (int)ForgingStage::COUNT; i++) {
+        const ForgingStage stage = (ForgingStage)i;
+        const LatencyHistogram::Snapshot snapshot = g_forging_stats.GetSnapshot(stage);
+        UniValue buckets(UniValue::VARR);
+        for (int bucket = 0; bucket < LatencyHistogram::BUCKETS; bucket++) {
+            if (snapshot.buckets[bucket] == 0) continue;
+            UniValue entry(UniValue::VARR);
+            entry.push_back(bucket == 0 ? 0 : (((uint64_t)1 << bucket) - 1));
+            entry.push_back(snapshot.buckets[bucket]);
+            buckets.push_back(entry);
+        }
+        UniValue histogram(UniValue::VOBJ);
+        histogram.pushKV("count", snapshot.count);
+        histogram.pushKV("mean", (uint64_t)snapshot.Mean());
+        histogram.pushKV("p50", snapshot.Quantile(0.5));
+        histogram.pushKV("p90", snapshot.Quantile(0.9));
+        histogram.pushKV("p99", snapshot.Quantile(0.99));
+        histogram.pushKV("max", snapshot.max);
+        histogram.pushKV("buckets", buckets);
+        obj.pushKV(ForgingStageName(stage), histogram);
+    }
+    if (!request.params[0].isNull() && request.params[0].get_bool()) {
+        g_forging_stats.Reset();
+    }
+    return obj;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -262,6 +659,10 @@ static const CRPCCommand commands[] =
     { "poc",               "submitnonce",             &submitNonce,            {"address", "nonce", "deadline"} },
 	{ "poc",               "getaddressplotid",        &getAddressPlotId,       {"address"} },
     { "poc",               "getslotinfo",             &getslotinfo,            {"index"} },
+    { "poc",               "getminerstats",           &getminerstats,          {"generator", "nblocks"} },
+    { "poc",               "listforgedblocks",        &listforgedblocks,       {"generator", "start_height", "end_height"} },
+    { "poc",               "checkplots",              &checkplots,             {"paths", "density", "scoops"} },
+    { "poc",               "getforginginfo",          &getforginginfo,         {"reset"} },
     { "wallet",            "setfsowner",             &setfsowner,            {"address"} },    
 };
 
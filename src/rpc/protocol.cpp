@@ -48,6 +48,104 @@ std::string JSONRPCReply(const UniValue& result, const UniValue& error, const Un
     return reply.write() + "\n";
 }
 
+void JSONStreamWriter::MaybeFlush()
+{
+    if (m_buffer.size() >= JSON_STREAM_CHUNK_SIZE) {
+        Flush();
+    }
+}
+
+void JSONStreamWriter::Flush()
+{
+    m_sink(m_buffer);
+    m_buffer.clear();
+}
+
+void JSONStreamWriter::WriteRaw(const std::string& json)
+{
+    m_buffer += json;
+    MaybeFlush();
+}
+
+void JSONStreamWriter::WriteString(const std::string& str)
+{
+    // Same escapes as UniValue
+    static const char* hex = "0123456789abcdef";
+    m_buffer += '"';
+    for (unsigned char ch : str) {
+        switch (ch) {
+        case '"': m_buffer += "\\\""; break;
+        case '\\': m_buffer += "\\\\"; break;
+        case '\b': m_buffer += "\\b"; break;
+        case '\t': m_buffer += "\\t"; break;
+        case '\n': m_buffer += "\\n"; break;
+        case '\f': m_buffer += "\\f"; break;
+        case '\r': m_buffer += "\\r"; break;
+        default:
+            if (ch < 0x20 || ch == 0x7f) {
+                m_buffer += "\\u00";
+                m_buffer += hex[ch >> 4];
+                m_buffer += hex[ch & 0xf];
+            } else {
+                m_buffer += ch;
+            }
+        }
+    }
+    m_buffer += '"';
+}
+
+void JSONStreamWriter::Write(const UniValue& value)
+{
+    switch (value.getType()) {
+    case UniValue::VNULL:
+        m_buffer += "null";
+        break;
+    case UniValue::VBOOL:
+        m_buffer += value.isTrue() ? "true" : "false";
+        break;
+    case UniValue::VNUM:
+        m_buffer += value.getValStr();
+        break;
+    case UniValue::VSTR:
+        WriteString(value.get_str());
+        break;
+    case UniValue::VARR:
+        m_buffer += '[';
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (i != 0) m_buffer += ',';
+            Write(value[i]);
+        }
+        m_buffer += ']';
+        break;
+    case UniValue::VOBJ: {
+        const std::vector<std::string>& keys = value.getKeys();
+        const std::vector<UniValue>& values = value.getValues();
+        m_buffer += '{';
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (i != 0) m_buffer += ',';
+            WriteString(keys[i]);
+            m_buffer += ':';
+            Write(values[i]);
+        }
+        m_buffer += '}';
+        break;
+    }
+    }
+    MaybeFlush();
+}
+
+void JSONStreamWriter::WriteReply(const UniValue& result, const UniValue& error, const UniValue& id)
+{
+    m_buffer += "{\"result\":";
+    Write(error.isNull() ? result : NullUniValue);
+    m_buffer += ",\"error\":";
+    Write(error);
+    m_buffer += ",\"id\":";
+    Write(id);
+    m_buffer += '}';
+    MaybeFlush();
+}
+
 UniValue JSONRPCError(int code, const std::string& message)
 {
     UniValue error(UniValue::VOBJ);
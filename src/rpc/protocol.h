@@ -8,6 +8,7 @@
 
 #include <fs.h>
 
+#include <functional>
 #include <list>
 #include <map>
 #include <stdint.h>
@@ -97,6 +98,38 @@ UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const Un
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
 UniValue JSONRPCError(int code, const std::string& message);
 
+/** Size of the pieces of text JSONStreamWriter hands to its sink */
+static const size_t JSON_STREAM_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * Writes JSON to a sink in pieces of about JSON_STREAM_CHUNK_SIZE bytes,
+ * instead of building the whole text in memory like UniValue::write, which
+ * also copies the text of every nested value into its parent. The output is
+ * the same as UniValue::write without indentation.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+    explicit JSONStreamWriter(Sink sink) : m_sink(std::move(sink)) {}
+
+    void Write(const UniValue& value);
+    /** Write text that is already JSON. */
+    void WriteRaw(const std::string& json);
+    /** Write a reply object, the same as JSONRPCReplyObj without copying result. */
+    void WriteReply(const UniValue& result, const UniValue& error, const UniValue& id);
+    /** Hand what is buffered to the sink, which is called even if nothing is. */
+    void Flush();
+
+private:
+    Sink m_sink;
+    std::string m_buffer;
+
+    void WriteString(const std::string& str);
+    void MaybeFlush();
+};
+
 /** Generate a new RPC authentication cookie and write it to disk */
 bool GenerateAuthCookie(std::string *cookie_out);
 /** Read the RPC authentication cookie from disk */
@@ -779,7 +779,7 @@ static UniValue combinerawtransaction(const JSONRPCRequest& request)
         // ... and merge in other signatures:
         for (const CMutableTransaction& txv : txVariants) {
             if (txv.vin.size() > i) {
-                sigdata.MergeSignatureData(DataFromTransaction(txv, i, coin.out));
+                sigdata.MergeSignatureData(DataFromTransaction(txv, i, coin.out.GetTxOut()));
             }
         }
         ProduceSignature(DUMMY_SIGNING_PROVIDER, MutableTransactionSignatureCreator(&mergedTx, i, coin.out.nValue, 1), coin.out.scriptPubKey, sigdata);
@@ -904,7 +904,7 @@ UniValue SignTransaction(interfaces::Chain& chain, CMutableTransaction& mtx, con
         const CScript& prevPubKey = coin.out.scriptPubKey;
         const CAmount& amount = coin.out.nValue;
 
-        SignatureData sigdata = DataFromTransaction(mtx, i, coin.out);
+        SignatureData sigdata = DataFromTransaction(mtx, i, coin.out.GetTxOut());
         // Only sign SIGHASH_SINGLE if there's a corresponding output:
         if (!fHashSingle || (i < mtx.vout.size())) {
             ProduceSignature(*keystore, MutableTransactionSignatureCreator(&mtx, i, amount, nHashType), prevPubKey, sigdata);
@@ -1763,7 +1763,7 @@ UniValue utxoupdatepsbt(const JSONRPCRequest& request)
         std::vector<std::vector<unsigned char>> solutions_data;
         txnouttype which_type = Solver(coin.out.scriptPubKey, solutions_data);
         if (which_type == TX_WITNESS_V0_SCRIPTHASH || which_type == TX_WITNESS_V0_KEYHASH || which_type == TX_WITNESS_UNKNOWN) {
-            input.witness_utxo = coin.out;
+            input.witness_utxo = coin.out.GetTxOut();
         }
     }
 
@@ -2002,13 +2002,12 @@ UniValue analyzepsbt(const JSONRPCRequest& request)
                 mtx.vin[i].scriptSig = input.final_script_sig;
                 mtx.vin[i].scriptWitness = input.final_script_witness;
 
-                Coin newcoin;
-                if (!psbtx.GetInputUTXO(newcoin.out, i)) {
+                CTxOut utxo;
+                if (!psbtx.GetInputUTXO(utxo, i)) {
                     success = false;
                     break;
                 }
-                newcoin.nHeight = 1;
-                view.AddCoin(psbtx.tx->vin[i].prevout, std::move(newcoin), true);
+                view.AddCoin(psbtx.tx->vin[i].prevout, Coin(std::move(utxo), 1, false), true);
             } else {
                 success = false;
                 break;
@@ -19,6 +19,7 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
+#include <condition_variable>
 #include <memory> // for unique_ptr
 #include <unordered_map>
 
@@ -486,13 +487,77 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+namespace {
+
+/** A batch being executed by several threads */
+struct RPCBatch
+{
+    RPCBatch(const JSONRPCRequest& jreqIn, const UniValue& vReqIn) :
+        jreq(jreqIn), vReq(vReqIn), count(vReqIn.size()), replies(count), done(count, false) {}
+
+    const JSONRPCRequest jreq;
+    //! Only used while requests are left to execute, the caller outlives that
+    const UniValue& vReq;
+    const size_t count;
+
+    Mutex cs;
+    std::condition_variable cond;
+    //! Index of the next request to execute
+    size_t next GUARDED_BY(cs){0};
+    std::vector<UniValue> replies GUARDED_BY(cs);
+    std::vector<bool> done GUARDED_BY(cs);
+
+    /** Execute the next request, returns false if all are taken. */
+    bool ExecNext()
+    {
+        size_t index;
+        {
+            LOCK(cs);
+            if (next == count) return false;
+            index = next++;
+        }
+        UniValue reply = JSONRPCExecOne(jreq, vReq[index]);
+        LOCK(cs);
+        replies[index] = std::move(reply);
+        done[index] = true;
+        cond.notify_all();
+        return true;
+    }
+};
+
+} // namespace
+
+void JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, JSONStreamWriter& writer,
+                      const std::function<bool(const std::function<void()>&)>& run_async, int max_helpers)
 {
-    UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    auto batch = std::make_shared<RPCBatch>(jreq, vReq);
+    const int helpers = std::min<int>(max_helpers, (int)vReq.size() - 1);
+    for (int i = 0; i < helpers; ++i) {
+        if (!run_async([batch] { while (batch->ExecNext()) {} })) break;
+    }
 
-    return ret.write() + "\n";
+    writer.WriteRaw("[");
+    for (size_t written = 0; written < vReq.size(); ++written) {
+        UniValue reply;
+        {
+            WAIT_LOCK(batch->cs, lock);
+            while (!batch->done[written]) {
+                if (batch->next < batch->count) {
+                    // Help rather than wait, helpers might not get to run
+                    lock.unlock();
+                    batch->ExecNext();
+                    lock.lock();
+                } else {
+                    batch->cond.wait(lock);
+                }
+            }
+            reply = std::move(batch->replies[written]);
+            batch->replies[written].setNull();
+        }
+        if (written != 0) writer.WriteRaw(",");
+        writer.Write(reply);
+    }
+    writer.WriteRaw("]\n");
 }
 
 /**
@@ -201,7 +201,17 @@ extern std::string HelpExampleRpc(const std::string& methodname, const std::stri
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+
+/**
+ * Execute a batch of requests and write the array of their replies. Up to
+ * max_helpers functions are passed to run_async to execute requests on other
+ * threads while the calling thread executes them too, run_async returns false
+ * if it cannot run one. With no helpers the requests are executed one after
+ * the other, otherwise concurrently. The replies are written in the order of
+ * the requests, each as soon as it and the ones before it are done.
+ */
+void JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, JSONStreamWriter& writer,
+                      const std::function<bool(const std::function<void()>&)>& run_async, int max_helpers);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
@@ -0,0 +1,585 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <snapshot.h>
+
+#include <actiondb.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <hash.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <threadinterrupt.h>
+#include <ticket.h>
+#include <tinyformat.h>
+#include <txdb.h>
+#include <ui_interface.h>
+#include <util/system.h>
+#include <validation.h>
+#include <warnings.h>
+
+#include <thread>
+
+/** "lvsn" */
+static const uint32_t SNAPSHOT_MAGIC = 0x6e73766c;
+
+static const char SNAPSHOT_RECORD_COIN = 'c';
+static const char SNAPSHOT_RECORD_TICKET = 't';
+static const char SNAPSHOT_RECORD_RELATION = 'r';
+static const char SNAPSHOT_RECORD_END = 'e';
+
+/** Number of coins written to the coin database at once while loading. */
+static const size_t SNAPSHOT_COINS_CHUNK = 100000;
+/** Memory used by the coins cache of the background validation before it is flushed (bytes). */
+static const size_t SNAPSHOT_CHECK_CACHE = 64 << 20;
+
+constexpr int64_t SNAPSHOT_CHECK_LOG_INTERVAL = 30; // seconds
+
+static std::thread g_snapshot_thread;
+static CThreadInterrupt g_snapshot_interrupt;
+
+template<typename... Args>
+static void FatalError(const char* fmt, const Args&... args)
+{
+    std::string strMessage = tfm::format(fmt, args...);
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(
+        "Error: A fatal internal error occurred, see debug.log for details",
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+}
+
+namespace {
+
+/** Writes to a snapshot file while hashing what is written. */
+class SnapshotWriter
+{
+private:
+    CAutoFile& m_file;
+    CHashWriter m_hasher;
+
+public:
+    explicit SnapshotWriter(CAutoFile& file) : m_file(file), m_hasher(file.GetType(), file.GetVersion()) {}
+
+    template <typename T>
+    SnapshotWriter& operator<<(const T& obj)
+    {
+        m_file << obj;
+        m_hasher << obj;
+        return *this;
+    }
+
+    uint256 GetHash() { return m_hasher.GetHash(); }
+};
+
+/** Streams the records of a snapshot into the chain state databases. */
+class SnapshotSink
+{
+private:
+    CCoinsViewDB& m_coinsdb;
+    std::vector<std::pair<COutPoint, Coin>> m_coins;
+    CDBWrapper& m_ticketdb;
+    CDBWrapper& m_relationdb;
+    CDBBatch m_ticket_batch;
+    CDBBatch m_relation_batch;
+    const size_t m_batch_size;
+
+    bool WriteBatch(CDBWrapper& db, CDBBatch& batch, bool force)
+    {
+        if (!force && batch.SizeEstimate() <= m_batch_size) {
+            return true;
+        }
+        if (!db.WriteBatch(batch, force)) {
+            return false;
+        }
+        batch.Clear();
+        return true;
+    }
+
+public:
+    SnapshotSink(CCoinsViewDB& coinsdb, CDBWrapper& ticketdb, CDBWrapper& relationdb) :
+        m_coinsdb(coinsdb), m_ticketdb(ticketdb), m_relationdb(relationdb),
+        m_ticket_batch(ticketdb), m_relation_batch(relationdb),
+        m_batch_size((size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize))
+    {
+        m_coins.reserve(SNAPSHOT_COINS_CHUNK);
+    }
+
+    bool AddCoin(const COutPoint& outpoint, Coin&& coin)
+    {
+        m_coins.emplace_back(outpoint, std::move(coin));
+        if (m_coins.size() < SNAPSHOT_COINS_CHUNK) {
+            return true;
+        }
+        if (!m_coinsdb.WriteSnapshotCoins(m_coins)) {
+            return false;
+        }
+        m_coins.clear();
+        return true;
+    }
+
+    bool AddRecord(char type, const std::vector<unsigned char>& key, const std::vector<unsigned char>& value)
+    {
+        switch (type) {
+        case SNAPSHOT_RECORD_TICKET:
+            m_ticket_batch.WriteBytes(key, value);
+            return WriteBatch(m_ticketdb, m_ticket_batch, false);
+        case SNAPSHOT_RECORD_RELATION:
+            m_relation_batch.WriteBytes(key, value);
+            return WriteBatch(m_relationdb, m_relation_batch, false);
+        }
+        return false;
+    }
+
+    bool Flush()
+    {
+        if (!m_coinsdb.WriteSnapshotCoins(m_coins)) {
+            return false;
+        }
+        m_coins.clear();
+        return WriteBatch(m_ticketdb, m_ticket_batch, true) &&
+               WriteBatch(m_relationdb, m_relation_batch, true);
+    }
+};
+
+} // namespace
+
+/** Coins are not self-delimiting when serialized, they are written as byte strings. */
+static std::vector<unsigned char> SerializeCoin(const Coin& coin)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << coin;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+template <typename Stream>
+static bool ReadHeader(Stream& s, SnapshotMetadata& metadata, std::string& error)
+{
+    uint32_t magic, version;
+    s >> magic >> version;
+    if (magic != SNAPSHOT_MAGIC) {
+        error = "Not a snapshot file";
+        return false;
+    }
+    if (version != SNAPSHOT_VERSION) {
+        error = strprintf("Unsupported snapshot version %u", version);
+        return false;
+    }
+    s >> metadata.base_hash >> metadata.base_height;
+    return true;
+}
+
+/**
+ * Whether a record of a Lava state database is committed to by the hash of
+ * its section. Records that are not can be checked on their own.
+ */
+static bool IsCommittedRecord(char type, const std::vector<unsigned char>& key)
+{
+    return type != SNAPSHOT_RECORD_RELATION || CRelationView::IsChainStateRecord(key);
+}
+
+static bool DumpDB(SnapshotWriter& writer, CDBIterator& it, char type, uint64_t& count, CHashWriter& hasher)
+{
+    for (it.SeekToFirst(); it.Valid(); it.Next()) {
+        const std::vector<unsigned char> key = it.GetKeyBytes();
+        const std::vector<unsigned char> value = it.GetValueBytes();
+        writer << type << key << value;
+        if (IsCommittedRecord(type, key)) {
+            hasher << key << value;
+        }
+        if (++count % 10000 == 0 && ShutdownRequested()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Hash the committed records of a Lava state database the way DumpDB does. */
+static uint256 HashDB(CDBWrapper& db, char type)
+{
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    std::unique_ptr<CDBIterator> it(db.NewIterator());
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        const std::vector<unsigned char> key = it->GetKeyBytes();
+        if (IsCommittedRecord(type, key)) {
+            hasher << key << it->GetValueBytes();
+        }
+    }
+    return hasher.GetHash();
+}
+
+bool DumpSnapshot(const fs::path& path, SnapshotMetadata& metadata, uint256& snapshot_hash, std::string& error)
+{
+    std::unique_ptr<CCoinsViewCursor> coins_cursor;
+    std::unique_ptr<CDBIterator> ticket_it, relation_it;
+    {
+        // The database iterators read consistent snapshots of the state
+        // flushed at the tip, the files are written without holding cs_main.
+        LOCK(cs_main);
+        FlushStateToDisk();
+        const CBlockIndex* tip = chainActive.Tip();
+        coins_cursor.reset(pcoinsdbview->Cursor());
+        if (coins_cursor->GetBestBlock() != tip->GetBlockHash()) {
+            error = "The chain state is not flushed at the tip";
+            return false;
+        }
+        // The relation state is only complete with its history entries,
+        // which the node writes once at startup.
+        if (!prelationview->IsHistoryIndexed()) {
+            error = "The relation history is not indexed yet";
+            return false;
+        }
+        ticket_it.reset(pticketview->NewIterator());
+        relation_it.reset(prelationview->NewIterator());
+        metadata.base_hash = tip->GetBlockHash();
+        metadata.base_height = tip->nHeight;
+    }
+
+    const fs::path temppath = path.string() + ".incomplete";
+    CAutoFile file(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Unable to open %s for writing", temppath.string());
+        return false;
+    }
+
+    SnapshotWriter writer(file);
+    writer << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << metadata.base_hash << metadata.base_height;
+
+    CHashWriter coins_hasher(SER_GETHASH, PROTOCOL_VERSION);
+    metadata.coins_count = 0;
+    for (; coins_cursor->Valid(); coins_cursor->Next()) {
+        COutPoint outpoint;
+        Coin coin;
+        if (!coins_cursor->GetKey(outpoint) || !coins_cursor->GetValue(coin)) {
+            error = "Unable to read the coin database";
+            return false;
+        }
+        writer << SNAPSHOT_RECORD_COIN << outpoint << SerializeCoin(coin);
+        coins_hasher << outpoint << coin;
+        if (++metadata.coins_count % 10000 == 0 && ShutdownRequested()) {
+            error = "Shutdown requested";
+            return false;
+        }
+    }
+    metadata.coins_hash = coins_hasher.GetHash();
+
+    CHashWriter ticket_hasher(SER_GETHASH, PROTOCOL_VERSION);
+    CHashWriter relation_hasher(SER_GETHASH, PROTOCOL_VERSION);
+    metadata.records_count = 0;
+    if (!DumpDB(writer, *ticket_it, SNAPSHOT_RECORD_TICKET, metadata.records_count, ticket_hasher) ||
+        !DumpDB(writer, *relation_it, SNAPSHOT_RECORD_RELATION, metadata.records_count, relation_hasher)) {
+        error = "Shutdown requested";
+        return false;
+    }
+    metadata.ticket_hash = ticket_hasher.GetHash();
+    metadata.relation_hash = relation_hasher.GetHash();
+
+    writer << SNAPSHOT_RECORD_END << metadata.coins_count << metadata.coins_hash << metadata.records_count
+           << metadata.ticket_hash << metadata.relation_hash;
+    snapshot_hash = writer.GetHash();
+    file << snapshot_hash;
+    if (!FileCommit(file.Get())) {
+        error = strprintf("Unable to write %s", temppath.string());
+        return false;
+    }
+    file.fclose();
+
+    if (!RenameOver(temppath, path)) {
+        error = strprintf("Unable to rename %s to %s", temppath.string(), path.string());
+        return false;
+    }
+    return true;
+}
+
+bool ReadSnapshotHeader(const fs::path& path, SnapshotMetadata& metadata, std::string& error)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Unable to open snapshot file %s", path.string());
+        return false;
+    }
+    try {
+        return ReadHeader(file, metadata, error);
+    } catch (const std::exception& e) {
+        error = strprintf("Unable to read snapshot file %s: %s", path.string(), e.what());
+        return false;
+    }
+}
+
+/** Read the snapshot at path, check its commitments and pass its records to sink, if any. */
+static bool ReadSnapshot(const fs::path& path, SnapshotMetadata& metadata, uint256& snapshot_hash, SnapshotSink* sink, std::string& error)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Unable to open snapshot file %s", path.string());
+        return false;
+    }
+
+    try {
+        CHashVerifier<CAutoFile> verifier(&file);
+        if (!ReadHeader(verifier, metadata, error)) {
+            return false;
+        }
+
+        CHashWriter coins_hasher(SER_GETHASH, PROTOCOL_VERSION);
+        CHashWriter ticket_hasher(SER_GETHASH, PROTOCOL_VERSION);
+        CHashWriter relation_hasher(SER_GETHASH, PROTOCOL_VERSION);
+        uint64_t coins_count = 0;
+        uint64_t records_count = 0;
+        char type;
+        for (verifier >> type; type != SNAPSHOT_RECORD_END; verifier >> type) {
+            if (type == SNAPSHOT_RECORD_COIN) {
+                COutPoint outpoint;
+                std::vector<unsigned char> coin_bytes;
+                verifier >> outpoint >> coin_bytes;
+                Coin coin;
+                CDataStream(coin_bytes, SER_DISK, CLIENT_VERSION) >> coin;
+                coins_hasher << outpoint << coin;
+                ++coins_count;
+                if (sink && !sink->AddCoin(outpoint, std::move(coin))) {
+                    error = "Unable to write the coin database";
+                    return false;
+                }
+            } else if (type == SNAPSHOT_RECORD_TICKET || type == SNAPSHOT_RECORD_RELATION) {
+                std::vector<unsigned char> key, value;
+                verifier >> key >> value;
+                ++records_count;
+                if (IsCommittedRecord(type, key)) {
+                    (type == SNAPSHOT_RECORD_TICKET ? ticket_hasher : relation_hasher) << key << value;
+                } else if (!CRelationView::CheckPlotRecord(key, value)) {
+                    error = "Snapshot file has an invalid plot id record";
+                    return false;
+                }
+                if (sink && !sink->AddRecord(type, key, value)) {
+                    error = "Unable to write the Lava state databases";
+                    return false;
+                }
+            } else {
+                error = strprintf("Unknown snapshot record type 0x%02x", (unsigned char)type);
+                return false;
+            }
+            if ((coins_count + records_count) % 10000 == 0 && ShutdownRequested()) {
+                error = "Shutdown requested";
+                return false;
+            }
+        }
+
+        verifier >> metadata.coins_count >> metadata.coins_hash >> metadata.records_count
+                 >> metadata.ticket_hash >> metadata.relation_hash;
+        const uint256 content_hash = verifier.GetHash();
+        file >> snapshot_hash;
+        if (snapshot_hash != content_hash) {
+            error = "Snapshot file is corrupted (content hash mismatch)";
+            return false;
+        }
+        if (coins_count != metadata.coins_count || coins_hasher.GetHash() != metadata.coins_hash ||
+            records_count != metadata.records_count || ticket_hasher.GetHash() != metadata.ticket_hash ||
+            relation_hasher.GetHash() != metadata.relation_hash) {
+            error = "Snapshot file is inconsistent with its commitments";
+            return false;
+        }
+    } catch (const std::exception& e) {
+        error = strprintf("Unable to read snapshot file %s: %s", path.string(), e.what());
+        return false;
+    }
+
+    if (sink && !sink->Flush()) {
+        error = "Unable to write the chain state databases";
+        return false;
+    }
+    return true;
+}
+
+bool CheckSnapshot(const fs::path& path, SnapshotMetadata& metadata, uint256& snapshot_hash, std::string& error)
+{
+    AssertLockHeld(cs_main);
+
+    if (!ReadSnapshotHeader(path, metadata, error)) {
+        return false;
+    }
+    const CBlockIndex* pindex_base = LookupBlockIndex(metadata.base_hash);
+    if (!pindex_base || pindex_base->nHeight != metadata.base_height) {
+        error = strprintf("The snapshot base block %s is not in the block index", metadata.base_hash.ToString());
+        return false;
+    }
+    if (pindex_base->nStatus & BLOCK_FAILED_MASK) {
+        error = strprintf("The snapshot base block %s is invalid", metadata.base_hash.ToString());
+        return false;
+    }
+    // The background validation reads every block below the base. The
+    // transaction counts are kept by pruning, so the data is looked at.
+    for (const CBlockIndex* pindex = pindex_base; pindex->nHeight > 0; pindex = pindex->pprev) {
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            error = strprintf("The block at height %d below the snapshot base %s is not on disk", pindex->nHeight, metadata.base_hash.ToString());
+            return false;
+        }
+    }
+
+    LogPrintf("Checking snapshot %s at block %s (height %d)\n", path.string(), metadata.base_hash.ToString(), metadata.base_height);
+    return ReadSnapshot(path, metadata, snapshot_hash, nullptr, error);
+}
+
+bool LoadSnapshot(const fs::path& path, CCoinsViewDB& coinsdb, SnapshotMetadata& metadata, uint256& snapshot_hash, std::string& error)
+{
+    AssertLockHeld(cs_main);
+
+    // Recorded before anything is written, so that an interrupted load is
+    // noticed at the next startup.
+    if (!pblocktree->WriteSnapshotBase(metadata.base_hash, metadata.coins_hash, metadata.ticket_hash, metadata.relation_hash)) {
+        error = "Unable to write the block index database";
+        return false;
+    }
+    pticketview.reset();
+    pticketview.reset(new CTicketView(0, false, true));
+    prelationview.reset();
+    prelationview.reset(new CRelationView(0, false, true));
+
+    LogPrintf("Loading snapshot %s\n", snapshot_hash.ToString());
+    SnapshotSink sink(coinsdb, *pticketview, *prelationview);
+    if (!ReadSnapshot(path, metadata, snapshot_hash, &sink, error)) {
+        return false;
+    }
+    // Reopened so that it reads the history flag of the loaded records.
+    prelationview.reset();
+    prelationview.reset(new CRelationView(0));
+
+    CCoinsMap empty;
+    if (!coinsdb.BatchWrite(empty, metadata.base_hash)) {
+        error = "Unable to write the coin database";
+        return false;
+    }
+    LogPrintf("Loaded snapshot %s: %u coins, %u Lava state records\n", snapshot_hash.ToString(), metadata.coins_count, metadata.records_count);
+    return true;
+}
+
+bool ValidateSnapshotBlocks(std::string& error)
+{
+    uint256 base_hash, coins_hash, ticket_hash, relation_hash;
+    if (!pblocktree->ReadSnapshotBase(base_hash, coins_hash, ticket_hash, relation_hash)) {
+        return true;
+    }
+    const CChainParams& chainparams = Params();
+    CBlockIndex* pindex_base;
+    {
+        LOCK(cs_main);
+        pindex_base = LookupBlockIndex(base_hash);
+    }
+    if (!pindex_base) {
+        error = strprintf("Snapshot base block %s not found", base_hash.ToString());
+        return false;
+    }
+    LogPrintf("Validating the blocks below the snapshot base %s (height %d)\n", base_hash.ToString(), pindex_base->nHeight);
+
+    const fs::path check_path = GetDataDir() / "snapshotcheck";
+    {
+        // The blocks are connected as the active chain connects them, to a
+        // coin database and to Lava state databases of their own.
+        CCoinsViewDB db(check_path, nMaxCoinsDBCache << 20, false, true);
+        CCoinsViewCache view(&db);
+        CTicketView tickets(0, true);
+        CRelationView relations(0, true);
+        if (!relations.MarkHistoryIndexed()) {
+            error = "Failed to write the snapshot check relation database";
+            return false;
+        }
+
+        // Same as for an empty chain state at startup
+        const CTransactionRef& genesis_tx = chainparams.GenesisBlock().vtx[0];
+        view.AddCoin(COutPoint(genesis_tx->GetHash(), 0), Coin(genesis_tx->vout[0], 0, true), true);
+        view.SetBestBlock(chainparams.GenesisBlock().GetHash());
+
+        int64_t last_log_time = 0;
+        for (int height = 1; height <= pindex_base->nHeight; ++height) {
+            if (g_snapshot_interrupt) {
+                LogPrintf("Snapshot validation interrupted at height %d, it restarts at the next startup\n", height);
+                return true;
+            }
+
+            CBlockIndex* pindex = pindex_base->GetAncestor(height);
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+                error = strprintf("Failed to read block %s from disk", pindex->GetBlockHash().ToString());
+                return false;
+            }
+            CValidationState state;
+            if (!ConnectSnapshotBlock(block, pindex, view, tickets, relations, chainparams, state)) {
+                error = strprintf("The loaded snapshot is not backed by a valid chain (block %s at height %d: %s). "
+                                  "Restart with -reindex-chainstate to rebuild the chain state.",
+                                  pindex->GetBlockHash().ToString(), height, FormatStateMessage(state));
+                return false;
+            }
+            if (view.DynamicMemoryUsage() > SNAPSHOT_CHECK_CACHE || height == pindex_base->nHeight) {
+                if (!view.Flush()) {
+                    error = "Failed to write the snapshot check database";
+                    return false;
+                }
+            }
+
+            int64_t current_time = GetTime();
+            if (last_log_time + SNAPSHOT_CHECK_LOG_INTERVAL < current_time) {
+                LogPrintf("Validating the blocks below the snapshot base, at height %d\n", height);
+                last_log_time = current_time;
+            }
+        }
+
+        std::unique_ptr<CCoinsViewCursor> cursor(db.Cursor());
+        CHashWriter coins_hasher(SER_GETHASH, PROTOCOL_VERSION);
+        for (; cursor->Valid(); cursor->Next()) {
+            COutPoint outpoint;
+            Coin coin;
+            if (!cursor->GetKey(outpoint) || !cursor->GetValue(coin)) {
+                error = "Failed to read the snapshot check database";
+                return false;
+            }
+            coins_hasher << outpoint << coin;
+        }
+        if (coins_hasher.GetHash() != coins_hash) {
+            error = strprintf("The coins set of the loaded snapshot does not match the block chain at %s. "
+                              "Restart with -reindex-chainstate to rebuild the chain state.", base_hash.ToString());
+            return false;
+        }
+        if (HashDB(tickets, SNAPSHOT_RECORD_TICKET) != ticket_hash || HashDB(relations, SNAPSHOT_RECORD_RELATION) != relation_hash) {
+            error = strprintf("The Lava state of the loaded snapshot does not match the block chain at %s. "
+                              "Restart with -reindex-chainstate to rebuild the chain state.", base_hash.ToString());
+            return false;
+        }
+    }
+
+    pblocktree->EraseSnapshotBase();
+    fs::remove_all(check_path);
+    LogPrintf("The blocks below the snapshot base %s are valid\n", base_hash.ToString());
+    return true;
+}
+
+static void ThreadValidateSnapshot()
+{
+    std::string error;
+    if (!ValidateSnapshotBlocks(error)) {
+        FatalError("%s", error);
+    }
+}
+
+void StartSnapshotValidation()
+{
+    uint256 base_hash, coins_hash, ticket_hash, relation_hash;
+    if (!pblocktree->ReadSnapshotBase(base_hash, coins_hash, ticket_hash, relation_hash)) {
+        return;
+    }
+    g_snapshot_thread = std::thread(&TraceThread<void (*)()>, "snapshotcheck", &ThreadValidateSnapshot);
+}
+
+void InterruptSnapshotValidation()
+{
+    g_snapshot_interrupt();
+}
+
+void StopSnapshotValidation()
+{
+    if (g_snapshot_thread.joinable()) {
+        g_snapshot_thread.join();
+    }
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LAVA_SNAPSHOT_H
+#define LAVA_SNAPSHOT_H
+
+#include <fs.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <string>
+
+class CCoinsViewDB;
+
+extern CCriticalSection cs_main;
+
+/** Version of the snapshot file format written by DumpSnapshot. */
+static const uint32_t SNAPSHOT_VERSION = 2;
+
+/**
+ * A snapshot holds the coins set together with the ticket and relation
+ * databases at a block. The file is laid out as
+ *
+ * - a header: magic, version, base block hash and height;
+ * - one record per coin and per entry of the Lava databases, each tagged
+ *   with the section it belongs to, the database entries being copied as
+ *   they are stored;
+ * - a footer: coin count, hash of the coins set, record count and the
+ *   hashes of the ticket and relation records;
+ * - the hash of everything above, which identifies the snapshot.
+ *
+ * The hashes of the footer are also what the background validation of the
+ * blocks below the snapshot checks its result against. The fspool database
+ * holds the firestone transactions of the local wallet, it is not part of a
+ * snapshot.
+ */
+struct SnapshotMetadata
+{
+    uint256 base_hash;
+    int base_height{-1};
+    uint64_t coins_count{0};
+    uint256 coins_hash;
+    uint64_t records_count{0};
+    uint256 ticket_hash;
+    uint256 relation_hash;
+};
+
+/**
+ * Write the chain state at the tip of the active chain to path. Returns false
+ * and sets error if the snapshot could not be written.
+ */
+bool DumpSnapshot(const fs::path& path, SnapshotMetadata& metadata, uint256& snapshot_hash, std::string& error);
+
+/** Read the header of the snapshot at path. */
+bool ReadSnapshotHeader(const fs::path& path, SnapshotMetadata& metadata, std::string& error);
+
+/**
+ * Check the snapshot at path against its commitments, and that the blocks up
+ * to its base are on disk. Nothing is written.
+ */
+bool CheckSnapshot(const fs::path& path, SnapshotMetadata& metadata, uint256& snapshot_hash, std::string& error) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/**
+ * Replace the chain state with the snapshot at path, which passed
+ * CheckSnapshot. The coins are written to coinsdb, which must be empty, and the
+ * ticket and relation databases are wiped and refilled. The blocks below the
+ * snapshot base are validated in the background after startup.
+ */
+bool LoadSnapshot(const fs::path& path, CCoinsViewDB& coinsdb, SnapshotMetadata& metadata, uint256& snapshot_hash, std::string& error) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/**
+ * Connect the blocks below a loaded snapshot whose history is not validated
+ * yet to separate chain state databases, and compare the result with the
+ * hashes of the snapshot. Returns false and sets error if a block is invalid
+ * or the result does not match; true once validated, if there is nothing to
+ * validate or if interrupted.
+ */
+bool ValidateSnapshotBlocks(std::string& error);
+
+/**
+ * Start validating the blocks below a loaded snapshot in the background. The
+ * node is shut down if they do not match it.
+ */
+void StartSnapshotValidation();
+void InterruptSnapshotValidation();
+void StopSnapshotValidation();
+
+#endif // LAVA_SNAPSHOT_H
@@ -142,6 +142,7 @@ private:
     const int m_version;
     const std::vector<unsigned char>& m_data;
     size_t m_pos = 0;
+    int m_extra = 0;
 
 public:
 
@@ -181,6 +182,8 @@ public:
 
     int GetVersion() const { return m_version; }
     int GetType() const { return m_type; }
+    void SetExtra(int n) { m_extra = n; }
+    int GetExtra() const { return m_extra; }
 
     size_t size() const { return m_data.size() - m_pos; }
     bool empty() const { return m_data.size() == m_pos; }
@@ -0,0 +1,345 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <actiondb.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <script/interpreter.h>
+#include <test/test_bitcoin.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(actiondb_tests, BasicTestingSetup)
+
+static CKeyID RandomKeyID()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    return key.GetPubKey().GetID();
+}
+
+/** A block whose transactions carry the given actions, with a coinbase first. */
+static CBlock MakeActionBlock(int height, const std::vector<CAction>& actions, std::vector<CAction>& blockActions)
+{
+    CBlock block;
+    blockActions.clear();
+    for (size_t i = 0; i <= actions.size(); i++) {
+        CMutableTransaction tx;
+        tx.nLockTime = height * 100 + i;
+        block.vtx.push_back(MakeTransactionRef(tx));
+        blockActions.push_back(i == 0 ? CAction(CNilAction()) : actions[i - 1]);
+    }
+    return block;
+}
+
+static CKeyID RelationAt(CRelationView& view, const CKeyID& from, int height, int& bindHeight)
+{
+    CKeyID to;
+    bindHeight = -1;
+    BOOST_CHECK(view.GetRelationAt(from, height, to, bindHeight));
+    return to;
+}
+
+BOOST_AUTO_TEST_CASE(relation_history_reorg)
+{
+    SetDataDir("actiondb");
+    CRelationView view(0, true);
+    BOOST_CHECK(view.MarkHistoryIndexed());
+
+    const CKeyID a = RandomKeyID(), b = RandomKeyID(), c = RandomKeyID(), d = RandomKeyID();
+    std::vector<CAction> actions;
+    std::map<int, CBlock> blocks;
+    blocks[10] = MakeActionBlock(10, {MakeBindAction(a, b)}, actions);
+    view.ConnectBlock(10, blocks[10], actions, true);
+    blocks[12] = MakeActionBlock(12, {MakeBindAction(a, c), MakeBindAction(d, b)}, actions);
+    view.ConnectBlock(12, blocks[12], actions, true);
+    blocks[15] = MakeActionBlock(15, {CUnbindAction(a)}, actions);
+    view.ConnectBlock(15, blocks[15], actions, true);
+
+    int bindHeight;
+    CKeyID to;
+    BOOST_CHECK(!view.GetRelationAt(a, 9, to, bindHeight));
+    BOOST_CHECK(RelationAt(view, a, 10, bindHeight) == b);
+    BOOST_CHECK_EQUAL(bindHeight, 10);
+    BOOST_CHECK(RelationAt(view, a, 11, bindHeight) == b);
+    BOOST_CHECK_EQUAL(bindHeight, 10);
+    BOOST_CHECK(RelationAt(view, a, 14, bindHeight) == c);
+    BOOST_CHECK_EQUAL(bindHeight, 12);
+    BOOST_CHECK(RelationAt(view, a, 100, bindHeight).IsNull());
+    BOOST_CHECK_EQUAL(bindHeight, 15);
+    BOOST_CHECK(RelationAt(view, d, 100, bindHeight) == b);
+    BOOST_CHECK_EQUAL(bindHeight, 12);
+    BOOST_CHECK(!view.GetRelationAt(b, 100, to, bindHeight));
+
+    CPersonalRelationHistoryList history = view.GetRelationHistory(a);
+    BOOST_CHECK_EQUAL(history.size(), 3U);
+    BOOST_CHECK(history[10] == b);
+    BOOST_CHECK(history[12] == c);
+    BOOST_CHECK(history[15].IsNull());
+    BOOST_CHECK(view.To(a, a.GetPlotID(), true).IsNull());
+
+    // Disconnecting the unbind restores the relation set at height 12.
+    view.DisconnectBlock(15, blocks[15], true);
+    history = view.GetRelationHistory(a);
+    BOOST_CHECK_EQUAL(history.size(), 2U);
+    BOOST_CHECK(!history.count(15));
+    BOOST_CHECK(view.To(a, a.GetPlotID(), true) == c);
+    BOOST_CHECK(RelationAt(view, a, 100, bindHeight) == c);
+    BOOST_CHECK_EQUAL(bindHeight, 12);
+
+    // Disconnecting height 12 restores the first bind and removes d altogether.
+    view.DisconnectBlock(12, blocks[12], true);
+    BOOST_CHECK(view.To(a, a.GetPlotID(), true) == b);
+    BOOST_CHECK(view.To(d, d.GetPlotID(), true).IsNull());
+    BOOST_CHECK(view.GetRelationHistory(d).empty());
+    BOOST_CHECK(!view.GetRelationAt(d, 100, to, bindHeight));
+
+    // The blocks of the new branch replace the history of the stale ones.
+    blocks[12] = MakeActionBlock(12, {MakeBindAction(a, d)}, actions);
+    view.ConnectBlock(12, blocks[12], actions, true);
+    blocks[13] = MakeActionBlock(13, {CUnbindAction(a), MakeBindAction(c, a)}, actions);
+    view.ConnectBlock(13, blocks[13], actions, true);
+    history = view.GetRelationHistory(a);
+    BOOST_CHECK_EQUAL(history.size(), 3U);
+    BOOST_CHECK(history[10] == b);
+    BOOST_CHECK(history[12] == d);
+    BOOST_CHECK(history[13].IsNull());
+    BOOST_CHECK(RelationAt(view, a, 12, bindHeight) == d);
+    BOOST_CHECK(RelationAt(view, c, 13, bindHeight) == a);
+    BOOST_CHECK(view.To(a, a.GetPlotID(), true).IsNull());
+    BOOST_CHECK(view.To(c, c.GetPlotID(), true) == a);
+}
+
+BOOST_AUTO_TEST_CASE(relation_tip_from_history)
+{
+    SetDataDir("actiondb");
+    CRelationView view(0, true);
+    BOOST_CHECK(view.MarkHistoryIndexed());
+    BOOST_CHECK(view.IsHistoryIndexed());
+
+    // poc2+ becomes active at height 5: earlier actions also set the plot id relations.
+    const int poc21Height = 5;
+    const CKeyID a = RandomKeyID(), b = RandomKeyID(), c = RandomKeyID(), d = RandomKeyID();
+    std::vector<std::vector<CAction>> heights = {
+        {},
+        {MakeBindAction(a, b), MakeBindAction(c, b)},
+        {MakeBindAction(d, a)},
+        {CUnbindAction(c)},
+        {},
+        {},
+        {MakeBindAction(a, c)},
+        {CUnbindAction(d), MakeBindAction(b, d)},
+    };
+    std::vector<CAction> actions;
+    for (size_t height = 0; height < heights.size(); height++) {
+        CBlock block = MakeActionBlock(height, heights[height], actions);
+        view.ConnectBlock(height, block, actions, (int)height >= poc21Height);
+    }
+
+    const CRelationVector connected = view.ListRelations();
+    const CKeyID pocTo = view.To(a, a.GetPlotID(), false);
+    BOOST_CHECK_EQUAL(connected.size(), 2U);
+    BOOST_CHECK(view.To(a, a.GetPlotID(), true) == c);
+    BOOST_CHECK(view.To(b, b.GetPlotID(), true) == d);
+    BOOST_CHECK(pocTo == b);
+
+    // Loading the tip from the history gives the relations of the connected blocks...
+    BOOST_CHECK(view.LoadRelationTip(heights.size() - 1, poc21Height));
+    BOOST_CHECK(view.ListRelations() == connected);
+    BOOST_CHECK(view.To(a, a.GetPlotID(), false) == pocTo);
+    BOOST_CHECK(view.To(c, c.GetPlotID(), false).IsNull());
+    BOOST_CHECK(view.To(d, d.GetPlotID(), false) == a);
+
+    // ...and ignores the history above the tip.
+    BOOST_CHECK(view.LoadRelationTip(2, poc21Height));
+    const CRelationVector atTwo = view.ListRelations();
+    BOOST_CHECK_EQUAL(atTwo.size(), 3U);
+    BOOST_CHECK(view.To(a, a.GetPlotID(), true) == b);
+    BOOST_CHECK(view.To(c, c.GetPlotID(), true) == b);
+    BOOST_CHECK(view.To(d, d.GetPlotID(), true) == a);
+    BOOST_CHECK(view.To(b, b.GetPlotID(), true).IsNull());
+}
+
+/** A transaction spending prevout whose OP_RETURN output carries the action signed by key. */
+static CMutableTransaction MakeActionTx(const COutPoint& prevout, const CAction& action, const CKey& key, CAmount value)
+{
+    CMutableTransaction tx;
+    tx.vin.emplace_back(prevout);
+    std::vector<unsigned char> vch;
+    BOOST_CHECK(SignAction(prevout, action, key, vch));
+    tx.vout.emplace_back(0, CScript() << OP_RETURN << vch);
+    tx.vout.emplace_back(value, GetScriptForDestination(key.GetPubKey().GetID()));
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(check_action)
+{
+    CKey key, otherKey;
+    key.MakeNewKey(true);
+    otherKey.MakeNewKey(true);
+    const CKeyID from = key.GetPubKey().GetID();
+    const CAmount fee = Params().GetConsensus().nActionFee;
+    const COutPoint prevout(GetRandHash(), 0);
+    const CAction bind = MakeBindAction(from, RandomKeyID());
+    const CAction unbind = CUnbindAction(from);
+
+    const CTransactionRef bindTx = MakeTransactionRef(MakeActionTx(prevout, bind, key, COIN));
+    BOOST_CHECK(CheckAction(bindTx, fee, false) == bind);
+    BOOST_CHECK(CheckAction(MakeTransactionRef(MakeActionTx(prevout, unbind, key, COIN)), fee, false) == unbind);
+
+    // An action has to pay exactly the action fee...
+    BOOST_CHECK(CheckAction(bindTx, fee - 1, false).type() == typeid(CNilAction));
+    BOOST_CHECK(CheckAction(bindTx, fee + 1, false).type() == typeid(CNilAction));
+
+    // ...be signed by the key it binds or unbinds...
+    const CTransactionRef otherTx = MakeTransactionRef(MakeActionTx(prevout, bind, otherKey, COIN));
+    BOOST_CHECK(CheckAction(otherTx, fee, false).type() == typeid(CNilAction));
+
+    // ...for the outpoint the transaction spends.
+    CMutableTransaction replayed = MakeActionTx(prevout, bind, key, COIN);
+    replayed.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    BOOST_CHECK(CheckAction(MakeTransactionRef(replayed), fee, false).type() == typeid(CNilAction));
+
+    // A transaction with a single output or without a zero value output carries no action.
+    CMutableTransaction single = MakeActionTx(prevout, bind, key, COIN);
+    single.vout.pop_back();
+    BOOST_CHECK(CheckAction(MakeTransactionRef(single), fee, false).type() == typeid(CNilAction));
+    CMutableTransaction nonzero = MakeActionTx(prevout, bind, key, COIN);
+    nonzero.vout[0].nValue = 1;
+    BOOST_CHECK(CheckAction(MakeTransactionRef(nonzero), fee, false).type() == typeid(CNilAction));
+}
+
+BOOST_AUTO_TEST_CASE(action_cache)
+{
+    CKey key, otherKey;
+    key.MakeNewKey(true);
+    otherKey.MakeNewKey(true);
+    const CAmount fee = Params().GetConsensus().nActionFee;
+    const COutPoint prevout(GetRandHash(), 0);
+    const CAction bind = MakeBindAction(key.GetPubKey().GetID(), RandomKeyID());
+    const CTransactionRef tx = MakeTransactionRef(MakeActionTx(prevout, bind, key, COIN));
+
+    // Storing at mempool acceptance and consuming at block connection give the
+    // same action, and so does verifying it again once its entry is consumed.
+    BOOST_CHECK(CheckAction(tx, fee, true) == bind);
+    BOOST_CHECK(CheckAction(tx, fee, false) == bind);
+    BOOST_CHECK(CheckAction(tx, fee, false) == bind);
+
+    // An invalid action is never stored.
+    const CTransactionRef otherTx = MakeTransactionRef(MakeActionTx(prevout, bind, otherKey, COIN));
+    BOOST_CHECK(CheckAction(otherTx, fee, true).type() == typeid(CNilAction));
+    BOOST_CHECK(CheckAction(otherTx, fee, false).type() == typeid(CNilAction));
+
+    // The entry of a transaction does not vouch for the same action in another one.
+    BOOST_CHECK(CheckAction(tx, fee, true) == bind);
+    CMutableTransaction replayed(*tx);
+    replayed.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    BOOST_CHECK(CheckAction(MakeTransactionRef(replayed), fee, false).type() == typeid(CNilAction));
+    BOOST_CHECK(CheckAction(tx, fee, false) == bind);
+}
+
+BOOST_AUTO_TEST_CASE(action_check)
+{
+    CKey key, otherKey;
+    key.MakeNewKey(true);
+    otherKey.MakeNewKey(true);
+    const CAmount fee = Params().GetConsensus().nActionFee;
+    const CAction bind = MakeBindAction(key.GetPubKey().GetID(), RandomKeyID());
+    const CAction unbind = CUnbindAction(key.GetPubKey().GetID());
+
+    // Every check writes the action of its transaction to its own slot, and
+    // an invalid action is a nil action rather than a failed check.
+    std::vector<CTransactionRef> txs = {
+        MakeTransactionRef(MakeActionTx(COutPoint(GetRandHash(), 0), bind, key, COIN)),
+        MakeTransactionRef(MakeActionTx(COutPoint(GetRandHash(), 0), bind, otherKey, COIN)),
+        MakeTransactionRef(MakeActionTx(COutPoint(GetRandHash(), 0), unbind, key, COIN)),
+    };
+    std::vector<CAction> slots(txs.size(), CAction(bind));
+    for (size_t i = 0; i < txs.size(); i++) {
+        CActionCheck check(txs[i], fee, &slots[i]);
+        BOOST_CHECK(check());
+    }
+    BOOST_CHECK(slots[0] == bind);
+    BOOST_CHECK(slots[1].type() == typeid(CNilAction));
+    BOOST_CHECK(slots[2] == unbind);
+
+    CActionCheck check(txs[0], fee + 1, &slots[0]);
+    BOOST_CHECK(check());
+    BOOST_CHECK(slots[0].type() == typeid(CNilAction));
+}
+
+/** Spend the first output of a coinbase paid to coinbaseKey into a transaction carrying the action. */
+static CMutableTransaction SpendToAction(const CTransactionRef& coinbase, const CKey& coinbaseKey, const CAction& action, const CKey& key)
+{
+    const CAmount fee = Params().GetConsensus().nActionFee;
+    CMutableTransaction tx = MakeActionTx(COutPoint(coinbase->GetHash(), 0), action, key, coinbase->vout[0].nValue - fee);
+
+    std::vector<unsigned char> vchSig;
+    const uint256 hash = SignatureHash(coinbase->vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+static CKeyID RelationTo(const CKeyID& from)
+{
+    LOCK(cs_main);
+    return prelationview->To(from, from.GetPlotID(), true);
+}
+
+BOOST_FIXTURE_TEST_CASE(connect_actions, TestChain100Setup)
+{
+    const int script_check_threads = nScriptCheckThreads;
+    const CAmount fee = Params().GetConsensus().nActionFee;
+    const CKeyID from = coinbaseKey.GetPubKey().GetID();
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    const CKeyID to = otherKey.GetPubKey().GetID();
+    // The blocks of a bound plot pay to the key it is bound to, so forge with the other plot.
+    const CScript scriptPubKey = GetScriptForDestination(to);
+
+    // Mine the transaction after it went through the mempool, which stores its
+    // action in the cache unless consume is set and the entry is consumed first.
+    auto mine = [&](const CMutableTransaction& tx, bool consume) {
+        {
+            LOCK(cs_main);
+            CValidationState state;
+            BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(tx), nullptr /* pfMissingInputs */,
+                                           nullptr /* plTxnReplaced */, true /* bypass_limits */, 0 /* nAbsurdFee */));
+        }
+        if (consume) {
+            CheckAction(MakeTransactionRef(tx), fee, false);
+        }
+        const CBlock block = CreateAndProcessBlock({tx}, scriptPubKey);
+        LOCK(cs_main);
+        BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    };
+
+    // The actions of a block are checked on the check threads and without them.
+    size_t coinbase = 0;
+    for (int threads : {script_check_threads, 0}) {
+        nScriptCheckThreads = threads;
+        const CAction bind = MakeBindAction(from, to);
+
+        // A bind signed by another key is ignored, cached or not...
+        mine(SpendToAction(m_coinbase_txns[coinbase++], coinbaseKey, bind, otherKey), false);
+        BOOST_CHECK(RelationTo(from).IsNull());
+        mine(SpendToAction(m_coinbase_txns[coinbase++], coinbaseKey, bind, otherKey), true);
+        BOOST_CHECK(RelationTo(from).IsNull());
+
+        // ...while valid actions are applied, from the cache...
+        mine(SpendToAction(m_coinbase_txns[coinbase++], coinbaseKey, bind, coinbaseKey), false);
+        BOOST_CHECK(RelationTo(from) == to);
+
+        // ...or verified again when connecting the block.
+        mine(SpendToAction(m_coinbase_txns[coinbase++], coinbaseKey, CUnbindAction(from), coinbaseKey), true);
+        BOOST_CHECK(RelationTo(from).IsNull());
+    }
+    nScriptCheckThreads = script_check_threads;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
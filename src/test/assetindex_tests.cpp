@@ -0,0 +1,224 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/assetindex.h>
+#include <issuance.h>
+#include <random.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <list>
+
+#include <boost/test/unit_test.hpp>
+
+/**
+ * The index only reads the issuance fields of the transactions, so the blocks
+ * are handed to it through the validation interface without being checked or
+ * connected. This allows reissuances and blinded amounts without the proofs.
+ */
+struct AssetIndexSetup : public TestingSetup {
+    std::list<uint256> m_hashes;
+    std::list<CBlockIndex> m_indexes;
+
+    const CBlockIndex* IndexBlock(const CBlockIndex* pprev, const std::vector<CMutableTransaction>& txs)
+    {
+        auto block = std::make_shared<CBlock>();
+        block->vtx.push_back(MakeTransactionRef(CMutableTransaction()));
+        for (const auto& tx : txs) {
+            block->vtx.push_back(MakeTransactionRef(tx));
+        }
+        m_hashes.push_back(GetRandHash());
+        m_indexes.emplace_back();
+        CBlockIndex& index = m_indexes.back();
+        index.phashBlock = &m_hashes.back();
+        index.pprev = const_cast<CBlockIndex*>(pprev);
+        index.nHeight = pprev->nHeight + 1;
+        index.BuildSkip();
+
+        GetMainSignals().BlockConnected(block, &index, {});
+        SyncWithValidationInterfaceQueue();
+        return &index;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(assetindex_tests, AssetIndexSetup)
+
+static void WaitForSync(AssetIndex& index)
+{
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+static CConfidentialValue BlindedValue()
+{
+    CConfidentialValue value;
+    value.vchCommitment.assign(CConfidentialValue::nCommittedSize, 0x42);
+    value.vchCommitment[0] = 8;
+    return value;
+}
+
+/** A transaction whose input n carries the given issuance, the other inputs have none. */
+static CMutableTransaction IssuanceTx(const CAssetIssuance& issuance, size_t n = 0)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(n + 1);
+    for (auto& txin : tx.vin) {
+        txin.prevout = COutPoint(GetRandHash(), 0);
+    }
+    tx.vin[n].assetIssuance = issuance;
+    return tx;
+}
+
+static CAssetIssuance NewIssuance(const CConfidentialValue& amount, const CConfidentialValue& tokens)
+{
+    CAssetIssuance issuance;
+    issuance.assetEntropy = GetRandHash();
+    issuance.nAmount = amount;
+    issuance.nInflationKeys = tokens;
+    return issuance;
+}
+
+static CAssetIssuance Reissuance(const uint256& entropy, const CConfidentialValue& amount)
+{
+    CAssetIssuance issuance;
+    issuance.assetBlindingNonce = GetRandHash();
+    issuance.assetEntropy = entropy;
+    issuance.nAmount = amount;
+    return issuance;
+}
+
+static void CheckRecord(const CAssetIssuanceRecord& record, const CMutableTransaction& tx, uint32_t n, const CBlockIndex* pindex)
+{
+    const CAssetIssuance& issuance = tx.vin[n].assetIssuance;
+    uint256 entropy;
+    CAsset asset, token;
+    if (issuance.assetBlindingNonce.IsNull()) {
+        GenerateAssetEntropy(entropy, tx.vin[n].prevout, issuance.assetEntropy);
+        CalculateReissuanceToken(token, entropy, issuance.nAmount.IsCommitment());
+    } else {
+        entropy = issuance.assetEntropy;
+    }
+    CalculateAsset(asset, entropy);
+
+    BOOST_CHECK(record.asset == asset);
+    BOOST_CHECK(record.token == token);
+    BOOST_CHECK(record.entropy == entropy);
+    BOOST_CHECK(record.prevout == tx.vin[n].prevout);
+    BOOST_CHECK(record.txid == tx.GetHash());
+    BOOST_CHECK_EQUAL(record.nVin, n);
+    BOOST_CHECK_EQUAL(record.nHeight, pindex->nHeight);
+    BOOST_CHECK(record.hashBlock == pindex->GetBlockHash());
+    BOOST_CHECK_EQUAL(record.fReissuance, !issuance.assetBlindingNonce.IsNull());
+}
+
+BOOST_AUTO_TEST_CASE(assetindex_issuance_reissuance)
+{
+    AssetIndex index(1 << 20, true);
+    index.Start();
+    WaitForSync(index);
+
+    const CBlockIndex* genesis;
+    {
+        LOCK(cs_main);
+        genesis = chainActive.Tip();
+    }
+
+    // An explicit issuance and a blinded one on a later input.
+    const CMutableTransaction explicit_tx = IssuanceTx(NewIssuance(1000, 10));
+    const CMutableTransaction blinded_tx = IssuanceTx(NewIssuance(BlindedValue(), 1), 1);
+    const CBlockIndex* block1 = IndexBlock(genesis, {explicit_tx, blinded_tx});
+    const CBlockIndex* block2 = IndexBlock(block1, {});
+
+    std::vector<CAssetIssuanceRecord> records;
+    BOOST_CHECK(index.LookupRange(0, 2, records));
+    BOOST_REQUIRE_EQUAL(records.size(), 2U);
+    CheckRecord(records[0], explicit_tx, 0, block1);
+    BOOST_CHECK_EQUAL(records[0].nAmount, 1000);
+    BOOST_CHECK_EQUAL(records[0].nInflationKeys, 10);
+    CheckRecord(records[1], blinded_tx, 1, block1);
+    BOOST_CHECK_EQUAL(records[1].nAmount, -1);
+    BOOST_CHECK_EQUAL(records[1].nInflationKeys, 1);
+    const CAssetIssuanceRecord issued = records[0];
+
+    // A reissuance is listed with the asset of its initial issuance.
+    const CMutableTransaction reissuance_tx = IssuanceTx(Reissuance(issued.entropy, 500));
+    const CBlockIndex* block3 = IndexBlock(block2, {reissuance_tx});
+
+    records.clear();
+    BOOST_CHECK(index.FindAssetIssuances(issued.asset, records));
+    BOOST_REQUIRE_EQUAL(records.size(), 2U);
+    CheckRecord(records[0], explicit_tx, 0, block1);
+    CheckRecord(records[1], reissuance_tx, 0, block3);
+    BOOST_CHECK(records[1].asset == issued.asset);
+    BOOST_CHECK(records[1].token.IsNull());
+    BOOST_CHECK_EQUAL(records[1].nAmount, 500);
+    BOOST_CHECK_EQUAL(records[1].nInflationKeys, 0);
+
+    records.clear();
+    BOOST_CHECK(index.LookupRange(2, 3, records));
+    BOOST_REQUIRE_EQUAL(records.size(), 1U);
+    CheckRecord(records[0], reissuance_tx, 0, block3);
+
+    // Unknown assets and blocks without issuances have no records.
+    records.clear();
+    BOOST_CHECK(index.FindAssetIssuances(CAsset(GetRandHash()), records));
+    BOOST_CHECK(index.LookupRange(2, 2, records));
+    BOOST_CHECK(records.empty());
+
+    // Invalid ranges are rejected.
+    BOOST_CHECK(!index.LookupRange(-1, 3, records));
+    BOOST_CHECK(!index.LookupRange(3, 2, records));
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(assetindex_reorg)
+{
+    AssetIndex index(1 << 20, true);
+    index.Start();
+    WaitForSync(index);
+
+    const CBlockIndex* genesis;
+    {
+        LOCK(cs_main);
+        genesis = chainActive.Tip();
+    }
+
+    const CMutableTransaction stale_tx1 = IssuanceTx(NewIssuance(1000, 1));
+    const CMutableTransaction stale_tx2 = IssuanceTx(NewIssuance(2000, CConfidentialValue()));
+    const CBlockIndex* stale1 = IndexBlock(genesis, {stale_tx1});
+    IndexBlock(stale1, {stale_tx2});
+
+    std::vector<CAssetIssuanceRecord> records;
+    BOOST_CHECK(index.LookupRange(0, 2, records));
+    BOOST_REQUIRE_EQUAL(records.size(), 2U);
+    const CAsset stale_asset1 = records[0].asset, stale_asset2 = records[1].asset;
+
+    // The blocks of the new branch replace the issuances at their heights,
+    // including those of the stale block they have none of their own for.
+    const CMutableTransaction new_tx = IssuanceTx(NewIssuance(3000, 1));
+    const CBlockIndex* new1 = IndexBlock(genesis, {new_tx});
+    IndexBlock(new1, {});
+
+    records.clear();
+    BOOST_CHECK(index.LookupRange(0, 2, records));
+    BOOST_REQUIRE_EQUAL(records.size(), 1U);
+    CheckRecord(records[0], new_tx, 0, new1);
+
+    records.clear();
+    BOOST_CHECK(index.FindAssetIssuances(stale_asset1, records));
+    BOOST_CHECK(index.FindAssetIssuances(stale_asset2, records));
+    BOOST_CHECK(records.empty());
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
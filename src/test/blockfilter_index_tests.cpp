@@ -0,0 +1,235 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilter.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/blockfilterindex.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <undo.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockfilter_index_tests)
+
+static bool ComputeFilter(BlockFilterType filter_type, const CBlockIndex* block_index,
+                          BlockFilter& filter)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, block_index, Params().GetConsensus())) {
+        return false;
+    }
+
+    CBlockUndo block_undo;
+    if (block_index->nHeight > 0 && !UndoReadFromDisk(block_undo, block_index)) {
+        return false;
+    }
+
+    filter = BlockFilter(filter_type, block, block_undo);
+    return true;
+}
+
+static bool CheckFilterLookups(BlockFilterIndex& filter_index, const CBlockIndex* block_index,
+                               uint256& last_header)
+{
+    BlockFilter expected_filter;
+    if (!ComputeFilter(filter_index.GetFilterType(), block_index, expected_filter)) {
+        BOOST_ERROR("ComputeFilter failed on block " << block_index->nHeight);
+        return false;
+    }
+
+    BlockFilter filter;
+    uint256 filter_header;
+    std::vector<BlockFilter> filters;
+    std::vector<uint256> filter_hashes;
+
+    BOOST_CHECK(filter_index.LookupFilter(block_index, filter));
+    BOOST_CHECK(filter_index.LookupFilterHeader(block_index, filter_header));
+    BOOST_CHECK(filter_index.LookupFilterRange(block_index->nHeight, block_index, filters));
+    BOOST_CHECK(filter_index.LookupFilterHashRange(block_index->nHeight, block_index,
+                                                   filter_hashes));
+
+    BOOST_CHECK_EQUAL(filters.size(), 1U);
+    BOOST_CHECK_EQUAL(filter_hashes.size(), 1U);
+
+    BOOST_CHECK(filter.GetHash() == expected_filter.GetHash());
+    BOOST_CHECK(filter_header == expected_filter.ComputeHeader(last_header));
+    BOOST_CHECK(filters[0].GetHash() == expected_filter.GetHash());
+    BOOST_CHECK(filter_hashes[0] == expected_filter.GetHash());
+
+    last_header = filter_header;
+    return true;
+}
+
+static void WaitForSync(BlockFilterIndex& filter_index)
+{
+    // Allow the filter index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+/** Check the lookups of every block of the active chain, chaining the expected headers. */
+static void CheckActiveChainLookups(BlockFilterIndex& filter_index)
+{
+    LOCK(cs_main);
+    uint256 last_header;
+    for (const CBlockIndex* block_index = chainActive.Genesis();
+         block_index != nullptr;
+         block_index = chainActive.Next(block_index)) {
+        CheckFilterLookups(filter_index, block_index, last_header);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_initial_sync, TestChain100Setup)
+{
+    BlockFilterIndex filter_index(BlockFilterType::BASIC, 1 << 20, true);
+
+    uint256 last_header;
+
+    // Filter should not be found in the index before it is started.
+    {
+        LOCK(cs_main);
+
+        BlockFilter filter;
+        uint256 filter_header;
+        std::vector<BlockFilter> filters;
+        std::vector<uint256> filter_hashes;
+
+        for (const CBlockIndex* block_index = chainActive.Genesis();
+             block_index != nullptr;
+             block_index = chainActive.Next(block_index)) {
+            BOOST_CHECK(!filter_index.LookupFilter(block_index, filter));
+            BOOST_CHECK(!filter_index.LookupFilterHeader(block_index, filter_header));
+            BOOST_CHECK(!filter_index.LookupFilterRange(block_index->nHeight, block_index, filters));
+            BOOST_CHECK(!filter_index.LookupFilterHashRange(block_index->nHeight, block_index,
+                                                            filter_hashes));
+        }
+    }
+
+    // BlockUntilSyncedToCurrentChain should return false before index is started.
+    BOOST_CHECK(!filter_index.BlockUntilSyncedToCurrentChain());
+
+    filter_index.Start();
+    WaitForSync(filter_index);
+
+    // Check that filter index has all blocks that were in the chain before it started.
+    CheckActiveChainLookups(filter_index);
+
+    // Blocks connected after the initial sync are indexed too.
+    const CKeyID coinbaseID = coinbaseKey.GetPubKey().GetID();
+    for (int i = 0; i < 3; i++) {
+        CreateAndProcessBlock({}, GetScriptForDestination(coinbaseID));
+    }
+    WaitForSync(filter_index);
+    CheckActiveChainLookups(filter_index);
+
+    // Replace the last 5 blocks with a longer branch forged by another key.
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    std::vector<const CBlockIndex*> stale_blocks;
+    const CBlockIndex* fork_index;
+    {
+        LOCK(cs_main);
+        fork_index = chainActive[chainActive.Height() - 5];
+        for (const CBlockIndex* block_index = chainActive.Next(fork_index);
+             block_index != nullptr;
+             block_index = chainActive.Next(block_index)) {
+            stale_blocks.push_back(block_index);
+        }
+    }
+    {
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), const_cast<CBlockIndex*>(stale_blocks.front())));
+    }
+    for (int i = 0; i < 7; i++) {
+        CreateAndProcessBlock({}, GetScriptForDestination(otherKey.GetPubKey().GetID()));
+    }
+    WaitForSync(filter_index);
+
+    // The filters of the new branch chain from the fork point...
+    CheckActiveChainLookups(filter_index);
+
+    // ...and the filters of the stale blocks can still be looked up by block.
+    BOOST_CHECK(filter_index.LookupFilterHeader(fork_index, last_header));
+    for (const CBlockIndex* block_index : stale_blocks) {
+        CheckFilterLookups(filter_index, block_index, last_header);
+    }
+
+    // Test lookups for a range of filters/hashes.
+    std::vector<BlockFilter> filters;
+    std::vector<uint256> filter_hashes;
+    const CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+    BOOST_CHECK(filter_index.LookupFilterRange(0, tip, filters));
+    BOOST_CHECK(filter_index.LookupFilterHashRange(0, tip, filter_hashes));
+
+    BOOST_CHECK_EQUAL(filters.size(), static_cast<size_t>(tip->nHeight + 1));
+    BOOST_CHECK_EQUAL(filter_hashes.size(), filters.size());
+    for (size_t i = 0; i < filters.size(); ++i) {
+        BOOST_CHECK(filters[i].GetHash() == filter_hashes[i]);
+    }
+
+    // An invalid range is rejected.
+    BOOST_CHECK(!filter_index.LookupFilterRange(tip->nHeight + 1, tip, filters));
+
+    filter_index.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_batched_sync, TestChain100Setup)
+{
+    const int script_check_threads = nScriptCheckThreads;
+    const CBlockIndex* tip;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+    }
+
+    // Sync the index in batches of different sizes, built on one or several
+    // threads: the filters and headers do not depend on the batching.
+    for (int threads : {0, 3}) {
+        nScriptCheckThreads = threads;
+        BlockFilterIndex filter_index(BlockFilterType::BASIC, 1 << 20, false, true);
+        filter_index.Start();
+        WaitForSync(filter_index);
+        CheckActiveChainLookups(filter_index);
+        filter_index.Stop();
+    }
+    nScriptCheckThreads = script_check_threads;
+
+    // The locator written at the end of the batched sync points at the tip, so the
+    // reopened index is synced at once and only indexes the next blocks one by one.
+    BlockFilterIndex filter_index(BlockFilterType::BASIC, 1 << 20, false, false);
+    filter_index.Start();
+    BOOST_CHECK(filter_index.GetIndexSynced());
+    uint256 last_header;
+    BOOST_CHECK(filter_index.LookupFilterHeader(tip, last_header));
+
+    const CKeyID coinbaseID = coinbaseKey.GetPubKey().GetID();
+    for (int i = 0; i < 3; i++) {
+        CreateAndProcessBlock({}, GetScriptForDestination(coinbaseID));
+    }
+    WaitForSync(filter_index);
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* block_index = chainActive.Next(tip);
+             block_index != nullptr;
+             block_index = chainActive.Next(block_index)) {
+            CheckFilterLookups(filter_index, block_index, last_header);
+        }
+    }
+    filter_index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 
 #include <blockfilter.h>
 #include <core_io.h>
+#include <issuance.h>
 #include <serialize.h>
 #include <streams.h>
 #include <univalue.h>
@@ -114,6 +115,45 @@ BOOST_AUTO_TEST_CASE(blockfilter_basic_test)
     BOOST_CHECK(block_filter.GetEncodedFilter() == block_filter2.GetEncodedFilter());
 }
 
+BOOST_AUTO_TEST_CASE(blockfilter_issuance_test)
+{
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(uint256S("01"), 0));
+    tx.vin[0].assetIssuance.nAmount = CConfidentialValue(1000);
+    tx.vin[0].assetIssuance.nInflationKeys = CConfidentialValue(1);
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(tx));
+
+    CBlockUndo block_undo;
+    block_undo.vtxundo.emplace_back();
+    block_undo.vtxundo.back().vprevout.emplace_back(CTxOut(500, CScript() << OP_TRUE), 1000, false);
+
+    uint256 entropy;
+    CAsset asset, token, unrelated;
+    GenerateAssetEntropy(entropy, tx.vin[0].prevout, tx.vin[0].assetIssuance.assetEntropy);
+    CalculateAsset(asset, entropy);
+    CalculateReissuanceToken(token, entropy, false);
+    unrelated = CAsset(uint256S("02"));
+
+    BlockFilter block_filter(BlockFilterType::BASIC, block, block_undo);
+    const GCSFilter& filter = block_filter.GetFilter();
+    BOOST_CHECK(filter.Match(GCSFilter::Element(asset.begin(), asset.end())));
+    BOOST_CHECK(filter.Match(GCSFilter::Element(token.begin(), token.end())));
+    BOOST_CHECK(!filter.Match(GCSFilter::Element(unrelated.begin(), unrelated.end())));
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_type_names)
+{
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(BlockFilterType::BASIC), "basic");
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(static_cast<BlockFilterType>(255)), "");
+
+    BlockFilterType filter_type;
+    BOOST_CHECK(BlockFilterTypeByName("basic", filter_type));
+    BOOST_CHECK(filter_type == BlockFilterType::BASIC);
+    BOOST_CHECK(!BlockFilterTypeByName("unknown", filter_type));
+}
+
 //BOOST_AUTO_TEST_CASE(blockfilters_json_test)
 //{
 //    UniValue json;
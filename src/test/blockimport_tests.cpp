@@ -0,0 +1,175 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <actiondb.h>
+#include <blockcache.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <fspool.h>
+#include <protocol.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <ticket.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+/** A chain of blocks, and a node that only has its genesis block to import them into. */
+struct BlockImportTestingSetup : public TestChain100Setup
+{
+    std::vector<CBlock> blocks;
+
+    BlockImportTestingSetup()
+    {
+        for (int height = 1; height <= chainActive.Height(); height++) {
+            CBlock block;
+            BOOST_REQUIRE(ReadBlockFromDisk(block, chainActive[height], Params().GetConsensus()));
+            blocks.push_back(block);
+        }
+
+        UnloadBlockIndex();
+        pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        prelationview.reset(new CRelationView(0, true));
+        pticketview.reset(new CTicketView(0, true));
+        g_blockCache.reset(new CBlockCache());
+        pfspool.reset(new CFSPool(0, true));
+        BOOST_REQUIRE(LoadGenesisBlock(Params()));
+        CValidationState state;
+        BOOST_REQUIRE(ActivateBestChain(state, Params()));
+        BOOST_REQUIRE_EQUAL(chainActive.Height(), 0);
+    }
+
+    /** Write a block the way block files store it, return the size of the record. */
+    static size_t WriteBlock(CAutoFile& file, const CBlock& block)
+    {
+        const unsigned int nSize = GetSerializeSize(block, file.GetVersion());
+        file.write((const char*)Params().MessageStartForDisk(), CMessageHeader::MESSAGE_START_SIZE);
+        file << nSize << block;
+        return CMessageHeader::MESSAGE_START_SIZE + sizeof(nSize) + nSize;
+    }
+
+    /** Import blocks from the file at path, then connect them. */
+    void Import(const fs::path& path, CDiskBlockPos* dbp = nullptr)
+    {
+        {
+            CImportPocScope poc_scope;
+            FILE* file = fsbridge::fopen(path, "rb");
+            BOOST_REQUIRE(file);
+            LoadExternalBlockFile(Params(), file, dbp);
+        }
+        CValidationState state;
+        BOOST_CHECK(ActivateBestChain(state, Params()));
+    }
+
+    void CheckImported()
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainActive.Height(), (int)blocks.size());
+        BOOST_CHECK(chainActive.Tip()->GetBlockHash() == blocks.back().GetHash());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(blockimport_tests, BlockImportTestingSetup)
+
+BOOST_AUTO_TEST_CASE(import_in_order)
+{
+    const fs::path path = GetDataDir() / "bootstrap.dat";
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        for (const CBlock& block : blocks) {
+            WriteBlock(file, block);
+        }
+    }
+    Import(path);
+    CheckImported();
+}
+
+BOOST_AUTO_TEST_CASE(import_out_of_order)
+{
+    // Out of order blocks are only taken from block files, as when reindexing
+    CDiskBlockPos pos(1, 0);
+    const fs::path path = GetBlockPosFilename(pos, "blk");
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        // Every other pair of blocks swapped, and the first block last
+        for (size_t i = 1; i < blocks.size(); i += 2) {
+            if (i + 1 < blocks.size()) WriteBlock(file, blocks[i + 1]);
+            WriteBlock(file, blocks[i]);
+        }
+        WriteBlock(file, blocks[0]);
+    }
+    Import(path, &pos);
+    CheckImported();
+}
+
+BOOST_AUTO_TEST_CASE(import_invalid_poc)
+{
+    // A copy of a block with an invalid deadline is rejected, the block itself is imported after it
+    const size_t bad = blocks.size() / 2;
+    CBlock bad_block = blocks[bad];
+    bad_block.nDeadline++;
+    const fs::path path = GetDataDir() / "bootstrap.dat";
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (i == bad) WriteBlock(file, bad_block);
+            WriteBlock(file, blocks[i]);
+        }
+    }
+    Import(path);
+    CheckImported();
+    LOCK(cs_main);
+    BOOST_CHECK(!LookupBlockIndex(bad_block.GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(import_rewind)
+{
+    // A header claiming the size of the next two block records swallows them,
+    // scanning resumes one byte after it and finds them again.
+    const fs::path path = GetDataDir() / "bootstrap.dat";
+    const size_t garbled = blocks.size() / 3;
+    {
+        CAutoFile size_file(fsbridge::fopen(GetDataDir() / "sizes.dat", "wb"), SER_DISK, CLIENT_VERSION);
+        const unsigned int nSize = WriteBlock(size_file, blocks[garbled]) + WriteBlock(size_file, blocks[garbled + 1]);
+
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (i == garbled) {
+                file.write((const char*)Params().MessageStartForDisk(), CMessageHeader::MESSAGE_START_SIZE);
+                file << nSize;
+            }
+            WriteBlock(file, blocks[i]);
+        }
+    }
+    Import(path);
+    CheckImported();
+}
+
+BOOST_AUTO_TEST_CASE(import_poc_scope)
+{
+    const fs::path path = GetDataDir() / "bootstrap.dat";
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        for (const CBlock& block : blocks) {
+            WriteBlock(file, block);
+        }
+    }
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    {
+        CImportPocScope poc_scope;
+        LoadExternalBlockFile(Params(), fsbridge::fopen(path, "rb"));
+        // The deadlines verified by the import are not verified again when read
+        LOCK(cs_main);
+        BOOST_CHECK(!CheckPocOnRead(LookupBlockIndex(blocks[0].GetHash()), consensusParams));
+    }
+    // They are forgotten once the import is over
+    LOCK(cs_main);
+    BOOST_CHECK(CheckPocOnRead(LookupBlockIndex(blocks[1].GetHash()), consensusParams));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
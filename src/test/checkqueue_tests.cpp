@@ -125,7 +125,29 @@ struct FrozenCleanupCheck {
     void swap(FrozenCleanupCheck& x){std::swap(should_freeze, x.should_freeze);};
 };
 
+struct BlockingCheck {
+    static std::atomic<size_t> n_calls;
+    static std::mutex m;
+    static std::condition_variable cv;
+    static bool released;
+    bool blocks {false};
+    bool operator()()
+    {
+        if (blocks) {
+            std::unique_lock<std::mutex> l(m);
+            cv.wait(l, []{ return released; });
+        }
+        n_calls.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    void swap(BlockingCheck& x) { std::swap(blocks, x.blocks); };
+};
+
 // Static Allocations
+std::atomic<size_t> BlockingCheck::n_calls{0};
+std::mutex BlockingCheck::m{};
+std::condition_variable BlockingCheck::cv{};
+bool BlockingCheck::released{false};
 std::mutex FrozenCleanupCheck::m{};
 std::atomic<uint64_t> FrozenCleanupCheck::nFrozen{0};
 std::condition_variable FrozenCleanupCheck::cv{};
@@ -141,16 +163,17 @@ typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
+typedef CCheckQueue<BlockingCheck> Blocking_Queue;
 
 
 /** This test case checks that the CCheckQueue works properly
  * with each specified size_t Checks pushed.
  */
-static void Correct_Queue_range(std::vector<size_t> range)
+static void Correct_Queue_range(std::vector<size_t> range, int threads = nScriptCheckThreads)
 {
     auto small_queue = MakeUnique<Correct_Queue>(QUEUE_BATCH_SIZE);
     boost::thread_group tg;
-    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+    for (auto x = 0; x < threads; ++x) {
        tg.create_thread([&]{small_queue->Thread();});
     }
     // Make vChecks here to save on malloc (this test can be slow...)
@@ -208,6 +231,54 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Random)
         range.push_back(i);
     Correct_Queue_range(range);
 }
+/** Test that checks are correct when threads share their queues
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Shared_Slots)
+{
+    std::vector<size_t> range = {1, 2, 1000, 100000};
+    for (size_t i = 3; i < 1000; i += InsecureRandRange(100) + 1)
+        range.push_back(i);
+    Correct_Queue_range(range, MAX_CHECKQUEUE_SLOTS + 6);
+}
+
+/** Test that the queue of a thread busy with a check is emptied by the others */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Steals_From_Busy_Thread)
+{
+    // Batches of one check, so only the blocking check waits for it
+    auto queue = MakeUnique<Blocking_Queue>(1);
+    boost::thread_group tg;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+       tg.create_thread([&]{queue->Thread();});
+    }
+    const size_t COUNT = 10000;
+    for (const size_t blocking : {(size_t)0, COUNT / 2, COUNT - 1}) {
+        BlockingCheck::n_calls = 0;
+        BlockingCheck::released = false;
+        std::thread t0([&]() {
+            CCheckQueueControl<BlockingCheck> control(queue.get());
+            std::vector<BlockingCheck> vChecks(COUNT);
+            vChecks[blocking].blocks = true;
+            control.Add(vChecks);
+            bool waitResult = control.Wait();
+            assert(waitResult);
+        });
+        // Whichever thread runs the blocking check, the others run the rest
+        int64_t deadline = GetTimeMillis() + 30000;
+        while (BlockingCheck::n_calls != COUNT - 1 && GetTimeMillis() < deadline) {
+            MilliSleep(1);
+        }
+        BOOST_CHECK_EQUAL(BlockingCheck::n_calls, COUNT - 1);
+        {
+            std::unique_lock<std::mutex> l(BlockingCheck::m);
+            BlockingCheck::released = true;
+        }
+        BlockingCheck::cv.notify_all();
+        t0.join();
+        BOOST_CHECK_EQUAL(BlockingCheck::n_calls, COUNT);
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
 
 
 /** Test that failing checks are caught */
@@ -381,6 +452,83 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup)
     BOOST_REQUIRE(!fails);
 }
 
+// Test that the master does not return while a check among many, which may
+// have been stolen by another thread, is still being destructed
+BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup_Many)
+{
+    auto queue = MakeUnique<FrozenCleanup_Queue>(QUEUE_BATCH_SIZE);
+    boost::thread_group tg;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+        tg.create_thread([&]{queue->Thread();});
+    }
+    for (const size_t frozen : {(size_t)0, (size_t)500, (size_t)999}) {
+        std::atomic<bool> waited{false};
+        std::thread t0([&]() {
+            CCheckQueueControl<FrozenCleanupCheck> control(queue.get());
+            std::vector<FrozenCleanupCheck> vChecks(1000);
+            vChecks[frozen].should_freeze = true;
+            control.Add(vChecks);
+            bool waitResult = control.Wait();
+            assert(waitResult);
+            waited = true;
+        });
+        {
+            std::unique_lock<std::mutex> l(FrozenCleanupCheck::m);
+            FrozenCleanupCheck::cv.wait(l, [](){return FrozenCleanupCheck::nFrozen == 1;});
+        }
+        // Give the master the time to return if it did not wait for the destructor
+        MilliSleep(10);
+        BOOST_CHECK(!waited);
+        const bool locked = queue->ControlMutex.try_lock();
+        if (locked) queue->ControlMutex.unlock();
+        BOOST_CHECK(!locked);
+        {
+            std::unique_lock<std::mutex> l(FrozenCleanupCheck::m);
+            FrozenCleanupCheck::nFrozen = 0;
+        }
+        FrozenCleanupCheck::cv.notify_one();
+        t0.join();
+        BOOST_CHECK(waited);
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+/** Test that masters taking turns on a queue each get the result of their own checks */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Multiple_Masters)
+{
+    auto fail_queue = MakeUnique<Failing_Queue>(QUEUE_BATCH_SIZE);
+    boost::thread_group tg;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+       tg.create_thread([&]{fail_queue->Thread();});
+    }
+    std::atomic<int> wrong_results{0};
+    std::vector<std::thread> masters;
+    for (int m = 0; m < 4; ++m) {
+        masters.emplace_back([&, m]() {
+            FastRandomContext rng;
+            for (int round = 0; round < 100; ++round) {
+                const bool fails = (round + m) % 3 == 0;
+                const size_t count = 1 + rng.randrange(200);
+                CCheckQueueControl<FailingCheck> control(fail_queue.get());
+                for (size_t added = 0; added < count;) {
+                    std::vector<FailingCheck> vChecks;
+                    for (size_t k = rng.randrange(10); k < 10 && added < count; k++, added++)
+                        vChecks.emplace_back(fails && added == count / 2);
+                    control.Add(vChecks);
+                }
+                if (control.Wait() == fails) wrong_results++;
+            }
+        });
+    }
+    for (std::thread& master : masters) {
+        master.join();
+    }
+    BOOST_CHECK_EQUAL(wrong_results, 0);
+    tg.interrupt_all();
+    tg.join_all();
+}
+
 
 /** Test that CCheckQueueControl is threadsafe */
 BOOST_AUTO_TEST_CASE(test_CheckQueueControl_Locks)
@@ -528,6 +528,56 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_confidential)
+{
+    CConfidentialValue value;
+    value.vchCommitment.assign(CConfidentialValue::nCommittedSize, 0x55);
+    value.vchCommitment[0] = 8;
+    CConfidentialNonce nonce;
+    nonce.vchCommitment.assign(CConfidentialNonce::nCommittedSize, 0x66);
+    nonce.vchCommitment[0] = 2;
+    const CAsset asset(uint256S("0x1111111111111111111111111111111111111111111111111111111111111111"));
+    CTxOut txout(0, CScript() << OP_TRUE, CConfidentialAsset(asset), value, nonce, 1);
+    txout.vchRangeproof.assign(1000, 0x77);
+
+    // The commitments are kept, the proofs are not
+    Coin coin(txout, 100, false);
+    BOOST_CHECK(coin.out.IsCA());
+    const CTxOut coin_txout = coin.out.GetTxOut();
+    BOOST_CHECK(coin_txout == txout);
+    BOOST_CHECK(coin_txout.vchRangeproof.empty());
+    BOOST_CHECK(coin.DynamicMemoryUsage() > Coin(CTxOut(0, CScript() << OP_TRUE), 100, false).DynamicMemoryUsage());
+    BOOST_CHECK(coin.DynamicMemoryUsage() < memusage::DynamicUsage(txout.scriptPubKey) + memusage::DynamicUsage(txout.vchRangeproof));
+
+    // The nonce is not written to the database
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << coin;
+    CDataStream ss_read(ss.begin(), ss.end(), SER_DISK, CLIENT_VERSION);
+    Coin coin_read;
+    ss_read >> coin_read;
+    BOOST_CHECK(coin_read.out.IsCA());
+    BOOST_CHECK(coin_read.out.GetAssetCommitment() == CConfidentialAsset(asset));
+    BOOST_CHECK(coin_read.out.GetValueCommitment() == value);
+    BOOST_CHECK(coin_read.out.GetNonceCommitment().IsNull());
+
+    // Explicit values are compressed
+    coin = Coin(CTxOut(0, CScript() << OP_TRUE, CConfidentialAsset(asset), CConfidentialValue(12345), CConfidentialNonce(), 1), 100, false);
+    CDataStream ss_explicit(SER_DISK, CLIENT_VERSION);
+    ss_explicit << coin;
+    CDataStream ss_explicit_read(ss_explicit.begin(), ss_explicit.end(), SER_DISK, CLIENT_VERSION);
+    ss_explicit_read >> coin_read;
+    BOOST_CHECK(coin_read.out == coin.out);
+    BOOST_CHECK_EQUAL(coin_read.out.GetValueCommitment().GetAmount(), 12345);
+
+    // Reading a coin clears the commitments it had
+    CDataStream ss_plain(SER_DISK, CLIENT_VERSION);
+    ss_plain << Coin(CTxOut(5000, CScript() << OP_TRUE), 100, false);
+    CDataStream ss_plain_read(ss_plain.begin(), ss_plain.end(), SER_DISK, CLIENT_VERSION);
+    ss_plain_read >> coin_read;
+    BOOST_CHECK(!coin_read.out.IsCA());
+    BOOST_CHECK(coin_read.out.GetAssetCommitment().IsNull());
+}
+
 const static COutPoint OUTPOINT;
 const static CAmount PRUNED = -1;
 const static CAmount ABSENT = -2;
@@ -773,6 +823,39 @@ BOOST_AUTO_TEST_CASE(ccoins_add)
     CheckAddCoin(VALUE2, VALUE3, VALUE3, DIRTY|FRESH, DIRTY|FRESH, true );
 }
 
+static void CheckAddFetchedCoin(CAmount cache_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(VALUE1, cache_value, cache_flags);
+    Coin coin;
+    SetCoinsValue(VALUE1, coin);
+    BOOST_CHECK_EQUAL(test.cache.AddFetchedCoin(OUTPOINT, std::move(coin)), cache_value == ABSENT);
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_add_fetched)
+{
+    /* Check AddFetchedCoin behavior, adding a coin read from the base view to
+     * a cache that may already have an entry for it. Existing entries hold
+     * changes the base view does not know about and are kept.
+     *
+     *                  Cache   Result  Cache        Result
+     *                  Value   Value   Flags        Flags
+     */
+    CheckAddFetchedCoin(ABSENT, VALUE1, NO_ENTRY   , 0          );
+    CheckAddFetchedCoin(PRUNED, PRUNED, 0          , 0          );
+    CheckAddFetchedCoin(PRUNED, PRUNED, DIRTY      , DIRTY      );
+    CheckAddFetchedCoin(PRUNED, PRUNED, DIRTY|FRESH, DIRTY|FRESH);
+    CheckAddFetchedCoin(VALUE2, VALUE2, 0          , 0          );
+    CheckAddFetchedCoin(VALUE2, VALUE2, DIRTY      , DIRTY      );
+    CheckAddFetchedCoin(VALUE2, VALUE2, DIRTY|FRESH, DIRTY|FRESH);
+}
+
 void CheckWriteCoins(CAmount parent_value, CAmount child_value, CAmount expected_value, char parent_flags, char child_flags, char expected_flags)
 {
     SingleEntryCacheTest test(ABSENT, parent_value, parent_flags);
@@ -0,0 +1,86 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <coinsprefetcher.h>
+#include <consensus/validation.h>
+#include <script/interpreter.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(coinsprefetcher_tests, TestChain100Setup)
+
+/** Spend the first output of a coinbase to the key. */
+static CMutableTransaction SpendCoinbase(const CTransactionRef& coinbase, const CKey& key)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(coinbase->GetHash(), 0);
+    tx.vout.emplace_back(coinbase->vout[0].nValue - 1000, GetScriptForDestination(key.GetPubKey().GetID()));
+
+    std::vector<unsigned char> vchSig;
+    const uint256 hash = SignatureHash(coinbase->vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_blocks_from_disk)
+{
+    g_coins_prefetcher = MakeUnique<CCoinsPrefetcher>();
+    g_coins_prefetcher->Start(2);
+
+    // Blocks given to ActivateBestChain are connected with their prefetched inputs.
+    // The spends go through the mempool so that the template commits to them.
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    for (int i = 0; i < 3; i++) {
+        const CMutableTransaction tx = SpendCoinbase(m_coinbase_txns[i], coinbaseKey);
+        {
+            LOCK(cs_main);
+            CValidationState state;
+            BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(tx), nullptr /* pfMissingInputs */,
+                                           nullptr /* plTxnReplaced */, true /* bypass_limits */, 0 /* nAbsurdFee */));
+        }
+        CreateAndProcessBlock({tx}, scriptPubKey);
+    }
+
+    CBlockIndex* tip;
+    CBlockIndex* first;
+    {
+        LOCK(cs_main);
+        tip = chainActive.Tip();
+        first = chainActive[tip->nHeight - 2];
+        BOOST_CHECK_EQUAL(tip->nHeight, 35);
+    }
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), first));
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(chainActive.Tip() == first->pprev);
+        for (int i = 0; i < 3; i++) {
+            BOOST_CHECK(pcoinsTip->HaveCoin(COutPoint(m_coinbase_txns[i]->GetHash(), 0)));
+        }
+        ResetBlockFailureFlags(first);
+    }
+
+    // Reconnecting them reads them from disk on the prefetch threads, while the
+    // connecting thread holds cs_main.
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(chainActive.Tip() == tip);
+        for (int i = 0; i < 3; i++) {
+            BOOST_CHECK(!pcoinsTip->HaveCoin(COutPoint(m_coinbase_txns[i]->GetHash(), 0)));
+        }
+    }
+
+    g_coins_prefetcher.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -273,6 +273,42 @@ struct StringContentsSerializer {
     }
 };
 
+BOOST_AUTO_TEST_CASE(iterator_reverse_ordering)
+{
+    fs::path ph = SetDataDir("iterator_reverse_ordering");
+    CDBWrapper dbw(ph, (1 << 20), true, false, false);
+    for (int x=0x00; x<256; x+=2) {
+        uint8_t key = x;
+        uint32_t value = x*x;
+        BOOST_CHECK(dbw.Write(key, value));
+    }
+
+    std::unique_ptr<CDBIterator> it(const_cast<CDBWrapper&>(dbw).NewIterator());
+
+    // Seeking to an odd key and stepping back lands on the largest key below it.
+    for (int x=0x01; x<256; x+=2) {
+        uint8_t key;
+        uint32_t value;
+        it->Seek((uint8_t)x);
+        if (it->Valid()) {
+            it->Prev();
+        } else {
+            it->SeekToLast();
+        }
+        BOOST_CHECK(it->Valid());
+        if (!it->Valid())
+            break;
+        BOOST_CHECK(it->GetKey(key));
+        BOOST_CHECK(it->GetValue(value));
+        BOOST_CHECK_EQUAL(key, x - 1);
+        BOOST_CHECK_EQUAL(value, (uint32_t)((x - 1) * (x - 1)));
+    }
+
+    it->SeekToFirst();
+    it->Prev();
+    BOOST_CHECK(!it->Valid());
+}
+
 BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 {
     char buf[10];
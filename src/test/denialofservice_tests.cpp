@@ -21,23 +21,6 @@
 
 #include <boost/test/unit_test.hpp>
 
-struct CConnmanTest : public CConnman {
-    using CConnman::CConnman;
-    void AddNode(CNode& node)
-    {
-        LOCK(cs_vNodes);
-        vNodes.push_back(&node);
-    }
-    void ClearNodes()
-    {
-        LOCK(cs_vNodes);
-        for (CNode* node : vNodes) {
-            delete node;
-        }
-        vNodes.clear();
-    }
-};
-
 // Tests these internal-to-net_processing.cpp methods:
 extern bool AddOrphanTx(const CTransactionRef& tx, NodeId peer);
 extern void EraseOrphansFor(NodeId peer);
@@ -76,7 +59,7 @@ BOOST_FIXTURE_TEST_SUITE(denialofservice_tests, TestingSetup)
 BOOST_AUTO_TEST_CASE(outbound_slow_chain_eviction)
 {
     auto connman = MakeUnique<CConnman>(0x1337, 0x1337);
-    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), nullptr, scheduler, false);
+    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), nullptr, scheduler, false, false);
 
     // Mock an outbound peer
     CAddress addr1(ip(0xa0b0c001), NODE_NONE);
@@ -146,7 +129,7 @@ static void AddRandomOutboundPeer(std::vector<CNode *> &vNodes, PeerLogicValidat
 BOOST_AUTO_TEST_CASE(stale_tip_peer_management)
 {
     auto connman = MakeUnique<CConnmanTest>(0x1337, 0x1337);
-    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), nullptr, scheduler, false);
+    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), nullptr, scheduler, false, false);
 
     const Consensus::Params& consensusParams = Params().GetConsensus();
     constexpr int nMaxOutbound = 8;
@@ -219,7 +202,7 @@ BOOST_AUTO_TEST_CASE(DoS_banning)
 {
     auto banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
     auto connman = MakeUnique<CConnman>(0x1337, 0x1337);
-    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), banman.get(), scheduler, false);
+    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), banman.get(), scheduler, false, false);
 
     banman->ClearBanned();
     CAddress addr1(ip(0xa0b0c001), NODE_NONE);
@@ -274,7 +257,7 @@ BOOST_AUTO_TEST_CASE(DoS_banscore)
 {
     auto banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
     auto connman = MakeUnique<CConnman>(0x1337, 0x1337);
-    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), banman.get(), scheduler, false);
+    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), banman.get(), scheduler, false, false);
 
     banman->ClearBanned();
     gArgs.ForceSetArg("-banscore", "111"); // because 11 is my favorite number
@@ -321,7 +304,7 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
 {
     auto banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
     auto connman = MakeUnique<CConnman>(0x1337, 0x1337);
-    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), banman.get(), scheduler, false);
+    auto peerLogic = MakeUnique<PeerLogicValidation>(connman.get(), banman.get(), scheduler, false, false);
 
     banman->ClearBanned();
     int64_t nStartTime = GetTime();
@@ -364,6 +347,30 @@ static CTransactionRef RandomOrphan()
     return it->second.tx;
 }
 
+BOOST_AUTO_TEST_CASE(DoS_pending_blocks)
+{
+    PendingBlockFilter filter;
+    const uint256 parent = InsecureRand256();
+
+    // Only blocks maturing before all the ones validated on the same parent are validated...
+    BOOST_CHECK(filter.Allow(parent, 1000));
+    BOOST_CHECK(!filter.Allow(parent, 1000));
+    BOOST_CHECK(!filter.Allow(parent, 1001));
+    BOOST_CHECK(filter.Allow(parent, 999));
+
+    // ...up to a limit, however early they mature.
+    for (int i = 2; i < MAX_PENDING_BLOCK_VALIDATIONS; i++) {
+        BOOST_CHECK(filter.Allow(parent, 999 - i));
+    }
+    BOOST_CHECK(!filter.Allow(parent, 0));
+
+    // A new parent starts over.
+    const uint256 next = InsecureRand256();
+    BOOST_CHECK(filter.Allow(next, 2000));
+    BOOST_CHECK(!filter.Allow(next, 2000));
+    BOOST_CHECK(filter.Allow(parent, 2000));
+}
+
 BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
 {
     CKey key;
@@ -0,0 +1,39 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <logging.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(logging_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(logprint_evaluates_arguments_when_enabled)
+{
+    const bool enabled = LogAcceptCategory(BCLog::RELATION);
+    int evaluations = 0;
+
+    // The arguments are not evaluated while the category is disabled...
+    LogInstance().DisableCategory(BCLog::RELATION);
+    LogPrint(BCLog::RELATION, "%d\n", ++evaluations);
+    BOOST_CHECK_EQUAL(evaluations, 0);
+
+    // ...and once when it is enabled.
+    LogInstance().EnableCategory(BCLog::RELATION);
+    LogPrint(BCLog::RELATION, "%d\n", ++evaluations);
+    BOOST_CHECK_EQUAL(evaluations, 1);
+
+    // The category is evaluated once too, and the macro is a single statement.
+    int categories = 0;
+    if (evaluations == 1)
+        LogPrint((++categories, BCLog::RELATION), "%d\n", ++evaluations);
+    else
+        BOOST_ERROR("LogPrint is not a single statement");
+    BOOST_CHECK_EQUAL(categories, 1);
+    BOOST_CHECK_EQUAL(evaluations, 2);
+
+    if (!enabled) LogInstance().DisableCategory(BCLog::RELATION);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <forgingstats.h>
 #include <validation.h>
 #include <miner.h>
 #include <policy/policy.h>
@@ -532,4 +533,18 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_AUTO_TEST_CASE(CreateNewBlock_forging_stats)
+{
+    // Only blocks the node forges count in the forging latencies, not templates
+    const uint64_t nCreated = g_forging_stats.GetSnapshot(ForgingStage::CREATE_BLOCK).count;
+    const uint64_t nTested = g_forging_stats.GetSnapshot(ForgingStage::TEST_VALIDITY).count;
+    CKey key;
+    key.MakeNewKey(true);
+    BlockAssembler assembler = AssemblerForTest(Params());
+    BOOST_CHECK(assembler.CreateNewBlock(GetScriptForDestination(key.GetPubKey().GetID()), 0, CKeyID(), 0, 0, MakeTransactionRef()));
+    BOOST_CHECK(assembler.m_last_validity_micros >= 0);
+    BOOST_CHECK_EQUAL(g_forging_stats.GetSnapshot(ForgingStage::CREATE_BLOCK).count, nCreated);
+    BOOST_CHECK_EQUAL(g_forging_stats.GetSnapshot(ForgingStage::TEST_VALIDITY).count, nTested);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,137 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/minerstatsindex.h>
+#include <script/standard.h>
+#include <test/test_bitcoin.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(minerstatsindex_tests, TestChain100Setup)
+
+static void WaitForSync(MinerStatsIndex& index)
+{
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+static void CheckRecordsMatchChain(const std::vector<CForgeRecord>& records, int start_height)
+{
+    LOCK(cs_main);
+    for (size_t i = 0; i < records.size(); i++) {
+        const CBlockIndex* pindex = chainActive[start_height + i];
+        BOOST_REQUIRE(pindex != nullptr);
+        BOOST_CHECK_EQUAL(records[i].nHeight, pindex->nHeight);
+        BOOST_CHECK_EQUAL(records[i].hashBlock, pindex->GetBlockHash());
+        BOOST_CHECK(records[i].nPublicKeyID == pindex->nPublicKeyID);
+        BOOST_CHECK_EQUAL(records[i].nBaseTarget, pindex->nBaseTarget);
+        BOOST_CHECK_EQUAL(records[i].nDeadline, pindex->nDeadline);
+        BOOST_CHECK(!records[i].UsesFirestone());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(minerstatsindex_initial_sync)
+{
+    MinerStatsIndex index(1 << 20, true);
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!index.BlockUntilSyncedToCurrentChain());
+
+    index.Start();
+    WaitForSync(index);
+
+    std::vector<CForgeRecord> records;
+    BOOST_CHECK(index.LookupRange(1, COINBASE_MATURITY, records));
+    BOOST_CHECK_EQUAL(records.size(), (size_t)COINBASE_MATURITY);
+    CheckRecordsMatchChain(records, 1);
+
+    const CKeyID coinbaseID = coinbaseKey.GetPubKey().GetID();
+    records.clear();
+    BOOST_CHECK(index.FindBlocksByKeyID(coinbaseID, 1, COINBASE_MATURITY, records));
+    BOOST_CHECK_EQUAL(records.size(), (size_t)COINBASE_MATURITY);
+    CheckRecordsMatchChain(records, 1);
+
+    records.clear();
+    BOOST_CHECK(index.FindBlocksByKeyID(coinbaseID, 10, 19, records));
+    BOOST_CHECK_EQUAL(records.size(), 10U);
+    CheckRecordsMatchChain(records, 10);
+
+    // Blocks connected after the initial sync are indexed too.
+    CreateAndProcessBlock({}, GetScriptForDestination(coinbaseID));
+    WaitForSync(index);
+    records.clear();
+    BOOST_CHECK(index.FindBlocksByKeyID(coinbaseID, COINBASE_MATURITY + 1, COINBASE_MATURITY + 1, records));
+    BOOST_CHECK_EQUAL(records.size(), 1U);
+    CheckRecordsMatchChain(records, COINBASE_MATURITY + 1);
+
+    // Invalid ranges are rejected.
+    records.clear();
+    BOOST_CHECK(!index.LookupRange(-1, 10, records));
+    BOOST_CHECK(!index.LookupRange(10, 9, records));
+    BOOST_CHECK(records.empty());
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(minerstatsindex_reorg)
+{
+    MinerStatsIndex index(1 << 20, true);
+    index.Start();
+    WaitForSync(index);
+
+    const CKeyID coinbaseID = coinbaseKey.GetPubKey().GetID();
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    const CKeyID otherID = otherKey.GetPubKey().GetID();
+
+    // Replace the last 3 blocks with 5 blocks forged by another key.
+    const int fork_height = COINBASE_MATURITY - 3;
+    {
+        CValidationState state;
+        CBlockIndex* pindex;
+        {
+            LOCK(cs_main);
+            pindex = chainActive[fork_height + 1];
+        }
+        BOOST_CHECK(InvalidateBlock(state, Params(), pindex));
+    }
+    for (int i = 0; i < 5; i++) {
+        CreateAndProcessBlock({}, GetScriptForDestination(otherID));
+    }
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainActive.Height(), fork_height + 5);
+    }
+    WaitForSync(index);
+
+    // The records at the heights of the stale blocks were replaced...
+    std::vector<CForgeRecord> records;
+    BOOST_CHECK(index.LookupRange(1, fork_height + 5, records));
+    BOOST_CHECK_EQUAL(records.size(), (size_t)fork_height + 5);
+    CheckRecordsMatchChain(records, 1);
+
+    // ...and the stale blocks are no longer attributed to their generator.
+    records.clear();
+    BOOST_CHECK(index.FindBlocksByKeyID(coinbaseID, 1, fork_height + 5, records));
+    BOOST_CHECK_EQUAL(records.size(), (size_t)fork_height);
+    CheckRecordsMatchChain(records, 1);
+
+    records.clear();
+    BOOST_CHECK(index.FindBlocksByKeyID(otherID, 1, fork_height + 5, records));
+    BOOST_CHECK_EQUAL(records.size(), 5U);
+    CheckRecordsMatchChain(records, fork_height + 1);
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,12 @@
 #include <util/system.h>
 
 #include <memory>
+#include <thread>
+
+#ifdef USE_EPOLL
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 class CAddrManSerializationMock : public CAddrMan
 {
@@ -303,4 +309,164 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
 }
 
 
+/**
+ * Records the threads processing the messages of each peer. Each peer relays
+ * an address to every other peer, as the handler of an addr message does,
+ * while their own handlers send the addresses they were given.
+ */
+class AddrRelayRecorder : public NetEventsInterface
+{
+public:
+    std::vector<CNode*> m_nodes;
+    std::atomic<int> m_relayed{0};
+    std::atomic<int> m_sent{0};
+    Mutex m_mutex;
+    std::map<NodeId, std::set<std::thread::id>> m_threads GUARDED_BY(m_mutex);
+
+    bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) override
+    {
+        {
+            LOCK(m_mutex);
+            m_threads[pnode->GetId()].insert(std::this_thread::get_id());
+        }
+        FastRandomContext insecure_rand;
+        for (CNode* node : m_nodes) {
+            if (node == pnode) continue;
+            in_addr ipv4Addr;
+            ipv4Addr.s_addr = htonl(0x01000000 + ++m_relayed);
+            node->PushAddress(CAddress(CService(ipv4Addr, 7777), NODE_NETWORK), insecure_rand);
+        }
+        return false;
+    }
+    bool SendMessages(CNode* pnode) override
+    {
+        LOCK(pnode->cs_addrSend);
+        for (const CAddress& addr : pnode->vAddrToSend) {
+            pnode->addrKnown.insert(addr.GetKey());
+            ++m_sent;
+        }
+        pnode->vAddrToSend.clear();
+        return true;
+    }
+    void InitializeNode(CNode* pnode) override {}
+    void FinalizeNode(NodeId id, bool& update_connection_time) override {}
+};
+
+BOOST_AUTO_TEST_CASE(message_handler_threads)
+{
+    const int threads = 3;
+    const int node_count = 8;
+    auto connman = MakeUnique<CConnmanTest>(0x1337, 0x1337);
+    AddrRelayRecorder recorder;
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    for (NodeId id = 0; id < node_count; ++id) {
+        CNode* node = new CNode(id, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(CService(ipv4Addr, 7777), NODE_NONE), 0, 0, CAddress(), "", true);
+        connman->AddNode(*node);
+        recorder.m_nodes.push_back(node);
+    }
+
+    connman->StartMessageHandlers(recorder, threads);
+    const int64_t time_start = GetTimeMillis();
+    while (recorder.m_relayed < 20 * node_count * (node_count - 1)) {
+        BOOST_REQUIRE(time_start + 10 * 1000 > GetTimeMillis());
+        connman->WakeMessageHandler();
+        MilliSleep(1);
+    }
+    connman->StopMessageHandlers();
+
+    // Each peer is processed by a single thread, the one of its share.
+    std::map<int, std::thread::id> share_threads;
+    {
+        LOCK(recorder.m_mutex);
+        BOOST_CHECK_EQUAL(recorder.m_threads.size(), (size_t)node_count);
+        for (const auto& entry : recorder.m_threads) {
+            BOOST_REQUIRE_EQUAL(entry.second.size(), 1U);
+            const int share = entry.first % threads;
+            if (!share_threads.count(share)) {
+                share_threads[share] = *entry.second.begin();
+            }
+            BOOST_CHECK(share_threads[share] == *entry.second.begin());
+        }
+    }
+    std::set<std::thread::id> distinct;
+    for (const auto& entry : share_threads) {
+        distinct.insert(entry.second);
+    }
+    BOOST_CHECK_EQUAL(distinct.size(), (size_t)threads);
+
+    // The addresses relayed from the other threads are all sent or still queued.
+    int queued = 0;
+    for (CNode* node : recorder.m_nodes) {
+        LOCK(node->cs_addrSend);
+        queued += node->vAddrToSend.size();
+    }
+    BOOST_CHECK_EQUAL(recorder.m_sent + queued, recorder.m_relayed);
+    connman->ClearNodes();
+}
+
+#ifdef USE_EPOLL
+static bool HasEvent(CConnmanTest& connman, SOCKET socket, std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    recv_set.clear();
+    send_set.clear();
+    error_set.clear();
+    connman.SocketEvents(recv_set, send_set, error_set);
+    return recv_set.count(socket) || send_set.count(socket) || error_set.count(socket);
+}
+
+BOOST_AUTO_TEST_CASE(epoll_socket_events)
+{
+    auto connman = MakeUnique<CConnmanTest>(0x1337, 0x1337);
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    std::set<SOCKET> recv_set, send_set, error_set;
+
+    int sockets[2];
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    CNode* node = new CNode(0, NODE_NETWORK, 0, sockets[0], CAddress(CService(ipv4Addr, 7777), NODE_NONE), 0, 0, CAddress(), "", true);
+    connman->AddNode(*node);
+
+    // The socket is registered once and waits for data to receive...
+    BOOST_CHECK(!HasEvent(*connman, sockets[0], recv_set, send_set, error_set));
+    BOOST_CHECK_EQUAL(connman->EpollRegistrations(), 1U);
+    BOOST_REQUIRE_EQUAL(write(sockets[1], "x", 1), 1);
+    BOOST_CHECK(HasEvent(*connman, sockets[0], recv_set, send_set, error_set));
+    BOOST_CHECK(recv_set.count(sockets[0]) && !send_set.count(sockets[0]));
+
+    // ...or to be writable while there is data to send.
+    {
+        LOCK(node->cs_vSend);
+        node->vSendMsg.push_back({1});
+    }
+    BOOST_CHECK(HasEvent(*connman, sockets[0], recv_set, send_set, error_set));
+    BOOST_CHECK(send_set.count(sockets[0]) && !recv_set.count(sockets[0]));
+    {
+        LOCK(node->cs_vSend);
+        node->vSendMsg.clear();
+    }
+
+    // Removed nodes are unregistered, and the socket number of a closed node
+    // is registered again for the node it is reused by.
+    connman->ClearNodes();
+    close(sockets[1]);
+    BOOST_CHECK(!HasEvent(*connman, sockets[0], recv_set, send_set, error_set));
+    BOOST_CHECK_EQUAL(connman->EpollRegistrations(), 0U);
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    node = new CNode(1, NODE_NETWORK, 0, sockets[0], CAddress(CService(ipv4Addr, 7777), NODE_NONE), 0, 0, CAddress(), "", true);
+    connman->AddNode(*node);
+    BOOST_CHECK(!HasEvent(*connman, sockets[0], recv_set, send_set, error_set));
+    BOOST_CHECK_EQUAL(connman->EpollRegistrations(), 1U);
+    BOOST_REQUIRE_EQUAL(write(sockets[1], "x", 1), 1);
+    BOOST_CHECK(HasEvent(*connman, sockets[0], recv_set, send_set, error_set));
+    BOOST_CHECK(recv_set.count(sockets[0]));
+
+    // A hang-up is reported as an error.
+    close(sockets[1]);
+    BOOST_CHECK(HasEvent(*connman, sockets[0], recv_set, send_set, error_set));
+    BOOST_CHECK(error_set.count(sockets[0]));
+    connman->ClearNodes();
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,9 +4,12 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <forgingstats.h>
+#include <plotcheck.h>
 #include <pow.h>
 #include <poc.h>
 #include <random.h>
+#include <util/strencodings.h>
 #include <util/system.h>
 #include <test/test_bitcoin.h>
 
@@ -58,6 +61,164 @@ BOOST_AUTO_TEST_CASE(get_last_basetarget)
     BOOST_CHECK_EQUAL(AdjustBaseTarget(&blocks[23], nLastRetargetTime), 10000);
 }
 
+/* Test that a long time span saturates at the maximum basetarget instead of overflowing */
+BOOST_AUTO_TEST_CASE(get_saturated_basetarget)
+{
+    std::vector<CBlockIndex> blocks(4);
+    for (int i = 0; i < 4; i++) {
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = 2000 + i;
+        blocks[i].nTime = 160000 + 240*i;
+        blocks[i].nBaseTarget = MAX_BASE_TARGET;
+    }
+
+    BOOST_CHECK_EQUAL(AdjustBaseTarget(&blocks[3], 4000000000U), MAX_BASE_TARGET);
+}
+
+/* Test the deadline of a nonce from its plot data */
+BOOST_AUTO_TEST_CASE(calc_deadline_from_chunk)
+{
+    const uint256 genSig = InsecureRand256();
+    const uint160 publicKeyID(ParseHex("1171f22512e85af9f6adbe69b562d32619693df8"));
+    const uint64_t height = 100;
+
+    auto chunk = genNonceChunk(publicKeyID, 7);
+    BOOST_CHECK_EQUAL(chunk.size(), 4096U * 64);
+    BOOST_CHECK_EQUAL(CalcDeadline(genSig, CalcScoop(genSig, height), chunk), CalcDeadline(genSig, height, publicKeyID, 7));
+}
+
+/* Test that the plot data generated several nonces at once is that of each nonce */
+BOOST_AUTO_TEST_CASE(gen_nonce_chunks)
+{
+    const uint160 publicKeyID(ParseHex("1171f22512e85af9f6adbe69b562d32619693df8"));
+    const uint64_t plotID = 12345678901234567890ULL;
+    // More than the widest lanes, and not a multiple of them
+    const size_t count = 13;
+    std::vector<uint8_t> chunks(count * POC_NONCE_SIZE);
+
+    genNonceChunks(publicKeyID, 1000, count, chunks.data());
+    for (size_t i = 0; i < count; i++) {
+        auto chunk = genNonceChunk(publicKeyID, 1000 + i);
+        BOOST_CHECK(std::equal(chunk.begin(), chunk.end(), chunks.begin() + i * POC_NONCE_SIZE));
+    }
+
+    genNonceChunksPoc2(plotID, 1000, count, chunks.data());
+    for (size_t i = 0; i < count; i++) {
+        auto chunk = genNonceChunkPoc2(plotID, 1000 + i);
+        BOOST_CHECK(std::equal(chunk.begin(), chunk.end(), chunks.begin() + i * POC_NONCE_SIZE));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(plot_file_name)
+{
+    PlotFileInfo info;
+    info.publicKeyID = uint160(ParseHex("1171f22512e85af9f6adbe69b562d32619693df8"));
+    info.startNonce = 64;
+    info.nonces = 128;
+    PlotFileInfo parsed;
+    BOOST_CHECK(parsed.SetFileName(info.FileName()));
+    BOOST_CHECK(parsed.poc2x && parsed.publicKeyID == info.publicKeyID && parsed.startNonce == 64 && parsed.nonces == 128);
+
+    BOOST_CHECK(parsed.SetFileName("12345_0_4096"));
+    BOOST_CHECK(!parsed.poc2x && parsed.plotID == 12345 && parsed.startNonce == 0 && parsed.nonces == 4096);
+    BOOST_CHECK(!parsed.SetFileName("12345_0"));
+    BOOST_CHECK(!parsed.SetFileName("12345_0_0"));
+    BOOST_CHECK(!parsed.SetFileName("abc_0_64"));
+}
+
+/* Test that the plot check finds the nonces that were not plotted right */
+BOOST_AUTO_TEST_CASE(check_plot_files)
+{
+    PlotFileInfo info;
+    info.poc2x = false;
+    info.plotID = 12345;
+    info.startNonce = 100;
+    info.nonces = 8;
+    const fs::path path = SetDataDir("check_plot_files") / info.FileName();
+
+    // Plot the nonces scoop-major
+    std::vector<uint8_t> chunks(info.nonces * POC_NONCE_SIZE);
+    info.GenerateNonces(0, info.nonces, chunks.data());
+    std::vector<uint8_t> plot(info.FileSize());
+    for (uint32_t scoop = 0; scoop < POC_SCOOPS; scoop++) {
+        for (uint64_t n = 0; n < info.nonces; n++) {
+            memcpy(&plot[info.ScoopOffset(scoop, n)], &chunks[n * POC_NONCE_SIZE + scoop * POC_SCOOP_SIZE], POC_SCOOP_SIZE);
+        }
+    }
+    CPlotFile file;
+    std::string error;
+    BOOST_CHECK(file.Open(path, true, false, error));
+    BOOST_CHECK(file.Write(plot.data(), plot.size(), 0));
+    file.Close();
+
+    PlotCheckOptions options;
+    options.density = 1 << 20;
+    options.scoops = 64;
+    options.threads = 2;
+    PlotCheckResult result = CheckPlotFiles(FindPlotFiles({path.parent_path()}), options);
+    BOOST_CHECK_EQUAL(result.files.size(), 1U);
+    BOOST_CHECK(result.files[0].error.empty());
+    BOOST_CHECK_EQUAL(result.checked, info.nonces);
+    BOOST_CHECK_EQUAL(result.mismatches, 0U);
+    BOOST_CHECK_EQUAL(result.bestDeadlines.size(), 64U);
+    // 64 rounds estimate the capacity within a few tens of percent
+    BOOST_CHECK(result.DeadlineCapacity() > result.Capacity() / 2 && result.DeadlineCapacity() < result.Capacity() * 2);
+
+    // Every scoop of one nonce is wrong
+    for (uint32_t scoop = 0; scoop < POC_SCOOPS; scoop++) {
+        plot[info.ScoopOffset(scoop, 5)] ^= 1;
+    }
+    BOOST_CHECK(file.Open(path, true, false, error));
+    BOOST_CHECK(file.Write(plot.data(), plot.size(), 0));
+    file.Close();
+    result = CheckPlotFiles({path}, options);
+    BOOST_CHECK_EQUAL(result.mismatches, 1U);
+    BOOST_CHECK_EQUAL(result.files[0].regions.size(), 1U);
+    BOOST_CHECK_EQUAL(result.files[0].regions[0].startNonce, info.startNonce + 5);
+    BOOST_CHECK(result.EffectiveCapacity() < result.Capacity());
+}
+
+BOOST_AUTO_TEST_CASE(forging_latency_histogram)
+{
+    LatencyHistogram histogram;
+    BOOST_CHECK_EQUAL(histogram.GetSnapshot().Quantile(0.5), 0U);
+
+    histogram.Add(0);
+    histogram.Add(1);
+    for (int i = 0; i < 8; i++) {
+        histogram.Add(1000);
+    }
+    histogram.Add(-5);
+    histogram.Add(3000000);
+
+    LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot.count, 12U);
+    BOOST_CHECK_EQUAL(snapshot.sum, 3008001U);
+    BOOST_CHECK_EQUAL(snapshot.max, 3000000U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[0], 2U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[1], 1U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[10], 8U);
+    BOOST_CHECK_EQUAL(snapshot.Quantile(0.1), 0U);
+    BOOST_CHECK_EQUAL(snapshot.Quantile(0.5), 1023U);
+    BOOST_CHECK_EQUAL(snapshot.Quantile(1.0), 3000000U);
+
+    histogram.Reset();
+    BOOST_CHECK_EQUAL(histogram.GetSnapshot().count, 0U);
+
+    // Only the announcement of the block that was forged is timed, once
+    CForgingStats stats;
+    const uint256 hash = InsecureRand256();
+    stats.BlockAnnounced(hash);
+    stats.BlockForged(hash, GetForgingTimeMicros() - 1000);
+    stats.BlockAnnounced(InsecureRand256());
+    BOOST_CHECK_EQUAL(stats.GetSnapshot(ForgingStage::ANNOUNCE).count, 0U);
+    stats.BlockAnnounced(hash);
+    stats.BlockAnnounced(hash);
+    BOOST_CHECK_EQUAL(stats.GetSnapshot(ForgingStage::ANNOUNCE).count, 1U);
+    BOOST_CHECK_EQUAL(stats.GetSnapshot(ForgingStage::TOTAL).count, 1U);
+    BOOST_CHECK(stats.GetSnapshot(ForgingStage::TOTAL).max >= 1000);
+}
+
 //BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
 //{
 //    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
@@ -0,0 +1,88 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <pocverify.h>
+#include <test/test_bitcoin.h>
+#include <threadinterrupt.h>
+#include <txdb.h>
+#include <validation.h>
+#include <warnings.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pocverify_tests, TestChain100Setup)
+
+BOOST_AUTO_TEST_CASE(check_block_poc_assumed_valid)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, chainActive.Tip(), consensusParams));
+    block.nDeadline++;
+
+    CValidationState state;
+    BOOST_CHECK(!CheckBlock(block, state, consensusParams));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK(!block.fChecked);
+
+    // Skipping the check does not count as checked
+    state = CValidationState();
+    BOOST_CHECK(CheckBlock(block, state, consensusParams, false));
+    BOOST_CHECK(!block.fChecked);
+
+    // A deadline covered by -assumevalid does
+    BOOST_CHECK(CheckBlock(block, state, consensusParams, true, true, true));
+    BOOST_CHECK(block.fChecked);
+}
+
+BOOST_AUTO_TEST_CASE(verify_assumed_valid_poc)
+{
+    CThreadInterrupt interrupt;
+    const CBlockIndex* tip = chainActive.Tip();
+    hashAssumeValid = tip->GetBlockHash();
+    VerifyAssumedValidPoc(interrupt);
+    uint256 verified_hash;
+    BOOST_CHECK(pblocktree->ReadPocVerified(verified_hash));
+    BOOST_CHECK(verified_hash == tip->GetBlockHash());
+    BOOST_CHECK(chainActive.Tip() == tip);
+
+    // An interrupted verification saves its progress at the block it stopped at
+    BOOST_CHECK(pblocktree->WritePocVerified(chainActive[10]->GetBlockHash()));
+    interrupt();
+    VerifyAssumedValidPoc(interrupt);
+    BOOST_CHECK(pblocktree->ReadPocVerified(verified_hash));
+    BOOST_CHECK(verified_hash == chainActive[11]->GetBlockHash());
+    hashAssumeValid = uint256();
+}
+
+BOOST_AUTO_TEST_CASE(verify_assumed_valid_poc_invalidates)
+{
+    CBlockIndex* pindex_bad;
+    {
+        LOCK(cs_main);
+        hashAssumeValid = chainActive.Tip()->GetBlockHash();
+        pindex_bad = chainActive[10];
+        pindex_bad->nDeadline++;
+    }
+    const CBlockIndex* tip = chainActive.Tip();
+
+    CThreadInterrupt interrupt;
+    VerifyAssumedValidPoc(interrupt);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(pindex_bad->nStatus & BLOCK_FAILED_VALID);
+        BOOST_CHECK(tip->nStatus & BLOCK_FAILED_MASK);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 9);
+    }
+    // No progress is saved past the invalid block
+    uint256 verified_hash;
+    BOOST_CHECK(!pblocktree->ReadPocVerified(verified_hash));
+    BOOST_CHECK(GetWarnings("gui").find(pindex_bad->GetBlockHash().ToString()) != std::string::npos);
+    SetMiscWarning("");
+    hashAssumeValid = uint256();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <primitives/block.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(rawblock_tests, TestChain100Setup)
+
+static std::vector<uint8_t> SerializeBlock(const CBlock& block, int version)
+{
+    CDataStream ss(SER_NETWORK, version);
+    ss << block;
+    return std::vector<uint8_t>(ss.begin(), ss.end());
+}
+
+/** Whether the block is served from its raw data exactly when that is its serialization without witnesses. */
+static void CheckHasWitness(const CBlock& block, bool expected)
+{
+    std::vector<uint8_t> data = SerializeBlock(block, PROTOCOL_VERSION);
+    const bool differs = data != SerializeBlock(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    BOOST_CHECK_EQUAL(differs, expected);
+    const CRawBlock raw_block(std::move(data));
+    BOOST_CHECK_EQUAL(raw_block.HasWitness(), expected);
+    BOOST_CHECK_EQUAL(raw_block.HasWitness(), expected);
+}
+
+BOOST_AUTO_TEST_CASE(raw_block_has_witness)
+{
+    // The blocks of the chain are confidential, the one here is made of plain transactions first.
+    CBlock block;
+    {
+        LOCK(cs_main);
+        block = CBlock(chainActive.Tip()->GetBlockHeader());
+    }
+    CheckHasWitness(block, false);
+
+    const CScript script = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(m_coinbase_txns[0]->GetHash(), 0));
+    tx.vout.emplace_back(COIN, script);
+    tx.vout.emplace_back(COIN, script);
+    block.vtx.push_back(MakeTransactionRef(tx));
+    CheckHasWitness(block, false);
+
+    // A transaction with an empty input and output list is serialized without flags.
+    block.vtx.push_back(MakeTransactionRef(CMutableTransaction()));
+    CheckHasWitness(block, false);
+
+    // Witnesses are found after transactions without...
+    CMutableTransaction witness_tx(tx);
+    witness_tx.vin[0].scriptWitness.stack.push_back({1});
+    block.vtx.push_back(MakeTransactionRef(witness_tx));
+    CheckHasWitness(block, true);
+
+    // ...and so are confidential transactions, whose proofs are stripped even when empty.
+    block.vtx.pop_back();
+    CMutableTransaction ca_tx(tx);
+    ca_tx.nVersion = CTransaction::CONFIDENTIAL_VERSION;
+    block.vtx.push_back(MakeTransactionRef(ca_tx));
+    CheckHasWitness(block, true);
+
+    // Data that does not parse is served after decoding it, which fails.
+    std::vector<uint8_t> data = SerializeBlock(block, PROTOCOL_VERSION);
+    data.resize(data.size() / 2);
+    BOOST_CHECK(CRawBlock(std::move(data)).HasWitness());
+}
+
+BOOST_AUTO_TEST_CASE(raw_block_matches_block)
+{
+    // The raw data served for each block is its serialization, read once and kept.
+    LOCK(cs_main);
+    for (const CBlockIndex* pindex = chainActive.Genesis(); pindex; pindex = chainActive.Next(pindex)) {
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+        const std::shared_ptr<const CRawBlock> raw_block = GetRawBlock(pindex, Params().MessageStart());
+        BOOST_REQUIRE(raw_block);
+        BOOST_CHECK(raw_block->data == SerializeBlock(block, PROTOCOL_VERSION));
+        BOOST_CHECK_EQUAL(raw_block->HasWitness(), raw_block->data != SerializeBlock(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+        BOOST_CHECK(GetRawBlock(pindex, Params().MessageStart()) == raw_block);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
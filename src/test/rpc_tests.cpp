@@ -14,6 +14,8 @@
 
 #include <test/test_bitcoin.h>
 
+#include <thread>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -236,6 +238,83 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(json_stream_writer)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("str", std::string("quote\" backslash\\ tab\t nul\0 del\x7f", 32));
+    obj.pushKV("num", 1.5);
+    obj.pushKV("bool", true);
+    obj.pushKV("null", NullUniValue);
+    UniValue arr(UniValue::VARR);
+    arr.push_back(obj);
+    arr.push_back(UniValue(UniValue::VOBJ));
+    arr.push_back(UniValue(UniValue::VARR));
+    UniValue big(UniValue::VARR);
+    for (int i = 0; i < 20000; ++i) {
+        big.push_back(arr);
+    }
+
+    // Same output as UniValue, in several pieces for a large value
+    for (const UniValue& value : {arr, big}) {
+        std::string out;
+        int pieces = 0;
+        JSONStreamWriter writer([&](const std::string& json) { out += json; ++pieces; });
+        writer.WriteReply(value, NullUniValue, 1);
+        writer.Flush();
+        BOOST_CHECK_EQUAL(out + "\n", JSONRPCReply(value, NullUniValue, 1));
+        BOOST_CHECK_EQUAL(pieces > 1, out.size() > JSON_STREAM_CHUNK_SIZE);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch)
+{
+    // The batch goes through CRPCTable::execute, which refuses calls during warmup
+    if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
+    UniValue requests(UniValue::VARR);
+    for (int i = 0; i < 10; ++i) {
+        UniValue request(UniValue::VOBJ);
+        request.pushKV("method", i % 2 ? "getblockcount" : "nosuchmethod");
+        request.pushKV("id", i);
+        requests.push_back(request);
+    }
+    std::vector<std::thread> threads;
+    auto run_async = [&](const std::function<void()>& func) {
+        threads.emplace_back(func);
+        return true;
+    };
+
+    std::string out;
+    JSONStreamWriter writer([&](const std::string& json) { out += json; });
+    JSONRPCExecBatch(JSONRPCRequest(), requests, writer, run_async, 3);
+    writer.Flush();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(threads.size(), 3U);
+
+    // Replies are in the order of the requests
+    UniValue replies;
+    BOOST_CHECK(replies.read(out));
+    BOOST_CHECK_EQUAL(replies.size(), 10U);
+    for (int i = 0; i < 10; ++i) {
+        BOOST_CHECK_EQUAL(find_value(replies[i], "id").get_int(), i);
+        BOOST_CHECK_EQUAL(find_value(replies[i], "error").isNull(), i % 2 == 1);
+    }
+
+    // Without helpers, as by default, the calling thread executes them in order
+    out.clear();
+    threads.clear();
+    JSONStreamWriter sequential_writer([&](const std::string& json) { out += json; });
+    JSONRPCExecBatch(JSONRPCRequest(), requests, sequential_writer, run_async, 0);
+    sequential_writer.Flush();
+    BOOST_CHECK(threads.empty());
+    BOOST_CHECK(replies.read(out));
+    BOOST_CHECK_EQUAL(replies.size(), 10U);
+    for (int i = 0; i < 10; ++i) {
+        BOOST_CHECK_EQUAL(find_value(replies[i], "id").get_int(), i);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(std::string("clearbanned")));
@@ -0,0 +1,207 @@
+// Copyright (c) 2019 The Lava Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <actiondb.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <script/interpreter.h>
+#include <script/standard.h>
+#include <snapshot.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(snapshot_tests, TestChain100Setup)
+
+/** Spend the first output of a coinbase paid to key into a transaction binding key to the KeyID. */
+static CMutableTransaction SpendToBind(const CTransactionRef& coinbase, const CKey& key, const CKeyID& to)
+{
+    const COutPoint prevout(coinbase->GetHash(), 0);
+    std::vector<unsigned char> vch;
+    BOOST_CHECK(SignAction(prevout, MakeBindAction(key.GetPubKey().GetID(), to), key, vch));
+    CMutableTransaction tx;
+    tx.vin.emplace_back(prevout);
+    tx.vout.emplace_back(0, CScript() << OP_RETURN << vch);
+    tx.vout.emplace_back(coinbase->vout[0].nValue - Params().GetConsensus().nActionFee, GetScriptForDestination(key.GetPubKey().GetID()));
+
+    std::vector<unsigned char> vchSig;
+    const uint256 hash = SignatureHash(coinbase->vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+static std::vector<unsigned char> ReadFile(const fs::path& path)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    std::vector<unsigned char> data(fs::file_size(path));
+    file.read((char*)data.data(), data.size());
+    return data;
+}
+
+static void WriteFile(const fs::path& path, const std::vector<unsigned char>& data)
+{
+    CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+    file.write((const char*)data.data(), data.size());
+}
+
+static bool Check(const fs::path& path, std::string& error)
+{
+    LOCK(cs_main);
+    SnapshotMetadata metadata;
+    uint256 snapshot_hash;
+    return CheckSnapshot(path, metadata, snapshot_hash, error);
+}
+
+static std::vector<std::pair<COutPoint, Coin>> ReadCoins(CCoinsView& view)
+{
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    std::unique_ptr<CCoinsViewCursor> cursor(view.Cursor());
+    for (; cursor->Valid(); cursor->Next()) {
+        COutPoint outpoint;
+        Coin coin;
+        BOOST_CHECK(cursor->GetKey(outpoint) && cursor->GetValue(coin));
+        coins.emplace_back(outpoint, std::move(coin));
+    }
+    return coins;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_dump_load_validate)
+{
+    // The relation state of the snapshot holds a bind, forged on by another key.
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    const CKeyID from = coinbaseKey.GetPubKey().GetID();
+    const CKeyID to = otherKey.GetPubKey().GetID();
+    {
+        // As init does for an empty chain state.
+        LOCK(cs_main);
+        const CTransactionRef& genesis_tx = Params().GenesisBlock().vtx[0];
+        pcoinsTip->AddCoin(COutPoint(genesis_tx->GetHash(), 0), Coin(genesis_tx->vout[0], 0, true), true);
+        BOOST_CHECK(prelationview->MarkHistoryIndexed());
+        CValidationState state;
+        BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(SpendToBind(m_coinbase_txns[0], coinbaseKey, to)),
+                                       nullptr /* pfMissingInputs */, nullptr /* plTxnReplaced */, true /* bypass_limits */, 0 /* nAbsurdFee */));
+    }
+    CreateAndProcessBlock({SpendToBind(m_coinbase_txns[0], coinbaseKey, to)}, GetScriptForDestination(to));
+    CreateAndProcessBlock({}, GetScriptForDestination(to));
+
+    const fs::path path = GetDataDir() / "snapshot.dat";
+    SnapshotMetadata metadata;
+    uint256 snapshot_hash;
+    std::string error;
+    BOOST_CHECK_MESSAGE(DumpSnapshot(path, metadata, snapshot_hash, error), error);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(metadata.base_hash == chainActive.Tip()->GetBlockHash());
+        BOOST_CHECK_EQUAL(metadata.base_height, chainActive.Height());
+        BOOST_CHECK(prelationview->To(from, from.GetPlotID(), true) == to);
+    }
+    BOOST_CHECK(metadata.records_count > 0);
+
+    SnapshotMetadata checked;
+    uint256 checked_hash;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_MESSAGE(CheckSnapshot(path, checked, checked_hash, error), error);
+    }
+    BOOST_CHECK(checked_hash == snapshot_hash);
+    BOOST_CHECK(checked.coins_hash == metadata.coins_hash);
+    BOOST_CHECK(checked.ticket_hash == metadata.ticket_hash);
+    BOOST_CHECK(checked.relation_hash == metadata.relation_hash);
+
+    // Any changed byte or a truncated file is detected.
+    const std::vector<unsigned char> data = ReadFile(path);
+    const fs::path tampered = GetDataDir() / "tampered.dat";
+    for (size_t pos : {data.size() / 2, data.size() - 40, data.size() - 1}) {
+        std::vector<unsigned char> changed(data);
+        changed[pos] ^= 0x01;
+        WriteFile(tampered, changed);
+        BOOST_CHECK(!Check(tampered, error));
+    }
+    WriteFile(tampered, std::vector<unsigned char>(data.begin(), data.end() - 33));
+    BOOST_CHECK(!Check(tampered, error));
+
+    // The blocks below the base have to be on disk.
+    CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive[metadata.base_height / 2];
+        pindex->nStatus &= ~BLOCK_HAVE_DATA;
+    }
+    BOOST_CHECK(!Check(path, error));
+    BOOST_CHECK(error.find("not on disk") != std::string::npos);
+    {
+        LOCK(cs_main);
+        pindex->nStatus |= BLOCK_HAVE_DATA;
+    }
+
+    // Loading gives the same coins and relations.
+    const std::vector<std::pair<COutPoint, Coin>> coins = ReadCoins(*pcoinsdbview);
+    CCoinsViewDB coinsdb(1 << 23, true);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_MESSAGE(LoadSnapshot(path, coinsdb, checked, checked_hash, error), error);
+        BOOST_CHECK(coinsdb.GetBestBlock() == metadata.base_hash);
+        BOOST_CHECK(prelationview->IsHistoryIndexed());
+        BOOST_CHECK(prelationview->LoadRelationTip(metadata.base_height, Params().GetConsensus().LVIP05Height));
+        BOOST_CHECK(prelationview->To(from, from.GetPlotID(), true) == to);
+    }
+    const std::vector<std::pair<COutPoint, Coin>> loaded = ReadCoins(coinsdb);
+    BOOST_CHECK_EQUAL(loaded.size(), coins.size());
+    for (size_t i = 0; i < std::min(loaded.size(), coins.size()); i++) {
+        BOOST_CHECK(loaded[i].first == coins[i].first);
+        BOOST_CHECK(loaded[i].second.out == coins[i].second.out);
+        BOOST_CHECK_EQUAL(loaded[i].second.nHeight, coins[i].second.nHeight);
+    }
+
+    // The blocks below the base give the hashes of the snapshot when connected...
+    uint256 base_hash, coins_hash, ticket_hash, relation_hash;
+    BOOST_CHECK(pblocktree->ReadSnapshotBase(base_hash, coins_hash, ticket_hash, relation_hash));
+    BOOST_CHECK_MESSAGE(ValidateSnapshotBlocks(error), error);
+    BOOST_CHECK(!pblocktree->ReadSnapshotBase(base_hash, coins_hash, ticket_hash, relation_hash));
+
+    // ...and any other state is rejected.
+    BOOST_CHECK(pblocktree->WriteSnapshotBase(base_hash, coins_hash, ticket_hash, uint256()));
+    BOOST_CHECK(!ValidateSnapshotBlocks(error));
+    BOOST_CHECK(error.find("Lava state") != std::string::npos);
+    BOOST_CHECK(pblocktree->WriteSnapshotBase(base_hash, coins_hash, uint256(), relation_hash));
+    BOOST_CHECK(!ValidateSnapshotBlocks(error));
+    BOOST_CHECK(error.find("Lava state") != std::string::npos);
+    BOOST_CHECK(pblocktree->WriteSnapshotBase(base_hash, uint256(), ticket_hash, relation_hash));
+    BOOST_CHECK(!ValidateSnapshotBlocks(error));
+    BOOST_CHECK(error.find("coins set") != std::string::npos);
+    pblocktree->EraseSnapshotBase();
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_plot_records)
+{
+    // The plot id records are not committed to, a loaded one has to hold a key of its plot.
+    CKey key;
+    key.MakeNewKey(true);
+    const CKeyID keyID = key.GetPubKey().GetID();
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION);
+    ssKey << std::make_pair('P', keyID.GetPlotID());
+    ssValue << keyID;
+    const std::vector<unsigned char> plotKey(ssKey.begin(), ssKey.end());
+    const std::vector<unsigned char> value(ssValue.begin(), ssValue.end());
+    BOOST_CHECK(!CRelationView::IsChainStateRecord(plotKey));
+    BOOST_CHECK(CRelationView::CheckPlotRecord(plotKey, value));
+
+    CDataStream ssOther(SER_DISK, CLIENT_VERSION);
+    ssOther << std::make_pair('P', keyID.GetPlotID() + 1);
+    BOOST_CHECK(!CRelationView::CheckPlotRecord(std::vector<unsigned char>(ssOther.begin(), ssOther.end()), value));
+    BOOST_CHECK(!CRelationView::CheckPlotRecord(plotKey, std::vector<unsigned char>(value.begin(), value.end() - 1)));
+
+    CDataStream ssHistory(SER_DISK, CLIENT_VERSION);
+    ssHistory << std::make_pair('H', keyID);
+    BOOST_CHECK(CRelationView::IsChainStateRecord(std::vector<unsigned char>(ssHistory.begin(), ssHistory.end())));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
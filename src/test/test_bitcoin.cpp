@@ -4,20 +4,26 @@
 
 #include <test/test_bitcoin.h>
 
+#include <actiondb.h>
 #include <banman.h>
+#include <blockcache.h>
 #include <chainparams.h>
 #include <consensus/consensus.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <fspool.h>
 #include <miner.h>
 #include <net_processing.h>
 #include <noui.h>
+#include <poc.h>
 #include <pow.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <script/sigcache.h>
+#include <script/standard.h>
 #include <streams.h>
+#include <ticket.h>
 #include <ui_interface.h>
 #include <validation.h>
 
@@ -40,6 +46,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     SetupNetworking();
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitActionCache();
     InitRangeproofCache();
     InitSurjectionproofCache();
     fCheckBlockIndex = true;
@@ -83,6 +90,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         pblocktree.reset(new CBlockTreeDB(1 << 20, true));
         pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
         pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        prelationview.reset(new CRelationView(0, true));
+        pticketview.reset(new CTicketView(0, true));
+        g_blockCache.reset(new CBlockCache());
+        pfspool.reset(new CFSPool(0, true));
         if (!LoadGenesisBlock(chainparams)) {
             throw std::runtime_error("LoadGenesisBlock failed.");
         }
@@ -109,6 +120,10 @@ TestingSetup::~TestingSetup()
     g_connman.reset();
     g_banman.reset();
     UnloadBlockIndex();
+    pfspool.reset();
+    g_blockCache.reset();
+    pticketview.reset();
+    prelationview.reset();
     pcoinsTip.reset();
     pcoinsdbview.reset();
     pblocktree.reset();
@@ -131,11 +146,54 @@ TestChain100Setup::TestChain100Setup() : TestingSetup(CBaseChainParams::REGTEST)
 // Create a new block with just given transactions, coinbase paying to
 // scriptPubKey, and try to add it to the current chain.
 //
+// The block is forged like generatepoc does: with the best of
+// FORGE_NONCES nonces plotted in memory for the key scriptPubKey pays to,
+// the mock time being advanced to its deadline.
+//
 CBlock
 TestChain100Setup::CreateAndProcessBlock(const std::vector<CMutableTransaction>& txns, const CScript& scriptPubKey)
 {
     const CChainParams& chainparams = Params();
-    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey,0,CKeyID(),0,0,MakeTransactionRef());
+    CTxDestination dest;
+    if (!ExtractDestination(scriptPubKey, dest) || dest.type() != typeid(CKeyID)) {
+        throw std::runtime_error("CreateAndProcessBlock: the coinbase must pay to a key");
+    }
+    const CKeyID keyID = boost::get<CKeyID>(dest);
+    std::vector<std::vector<uint8_t>>& plot = m_plots[keyID];
+    while (plot.size() < FORGE_NONCES) {
+        plot.push_back(genNonceChunk(keyID, plot.size()));
+    }
+
+    uint256 genSig;
+    int nHeight;
+    int64_t nForgeTime;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindexPrev = chainActive.Tip();
+        nHeight = pindexPrev->nHeight + 1;
+        genSig = CalcGenerationSignature(pindexPrev->genSign, pindexPrev->nPublicKeyID);
+        nForgeTime = pindexPrev->nTime;
+    }
+    const uint32_t scoop = CalcScoop(genSig, nHeight);
+    uint64_t nonce = 0;
+    uint64_t deadline = CalcDeadline(genSig, scoop, plot[0]);
+    for (uint64_t n = 1; n < plot.size(); n++) {
+        const uint64_t dl = CalcDeadline(genSig, scoop, plot[n]);
+        if (dl < deadline) {
+            nonce = n;
+            deadline = dl;
+        }
+    }
+    {
+        LOCK(cs_main);
+        // A block has to be later than its parent, even with a deadline below a second
+        nForgeTime += std::max<int64_t>(1, deadline / chainActive.Tip()->nBaseTarget);
+    }
+    if (GetMockTime() < nForgeTime) {
+        SetMockTime(nForgeTime);
+    }
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey, nonce, keyID, 0, deadline, MakeTransactionRef());
     CBlock& block = pblocktemplate->block;
 
     // Replace mempool-selected txns with just coinbase plus passed-in txns:
@@ -158,6 +216,7 @@ TestChain100Setup::CreateAndProcessBlock(const std::vector<CMutableTransaction>&
 
 TestChain100Setup::~TestChain100Setup()
 {
+    SetMockTime(0);
 }
 
 
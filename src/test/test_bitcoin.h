@@ -8,12 +8,14 @@
 #include <chainparamsbase.h>
 #include <fs.h>
 #include <key.h>
+#include <net.h>
 #include <pubkey.h>
 #include <random.h>
 #include <scheduler.h>
 #include <txdb.h>
 #include <txmempool.h>
 
+#include <map>
 #include <memory>
 #include <type_traits>
 
@@ -68,12 +70,59 @@ private:
     const fs::path m_path_root;
 };
 
+/** Connection manager giving the tests access to its nodes and threads. */
+struct CConnmanTest : public CConnman {
+    using CConnman::CConnman;
+    void AddNode(CNode& node)
+    {
+        LOCK(cs_vNodes);
+        vNodes.push_back(&node);
+    }
+    void ClearNodes()
+    {
+        LOCK(cs_vNodes);
+        for (CNode* node : vNodes) {
+            delete node;
+        }
+        vNodes.clear();
+    }
+
+    /** Start the message handler threads over the added nodes, without the other threads of Start. */
+    void StartMessageHandlers(NetEventsInterface& msgproc, int threads)
+    {
+        m_msgproc = &msgproc;
+        m_msghandler_threads = threads;
+        flagInterruptMsgProc = false;
+        {
+            LOCK(mutexMsgProc);
+            vMsgProcWake.assign(m_msghandler_threads, false);
+        }
+        for (int i = 0; i < m_msghandler_threads; ++i) {
+            threadMessageHandlers.emplace_back(&CConnman::ThreadMessageHandler, this, i);
+        }
+    }
+    void StopMessageHandlers()
+    {
+        {
+            LOCK(mutexMsgProc);
+            flagInterruptMsgProc = true;
+        }
+        condMsgProc.notify_all();
+        for (std::thread& thread : threadMessageHandlers) {
+            thread.join();
+        }
+        threadMessageHandlers.clear();
+    }
+
+    using CConnman::SocketEvents;
+#ifdef USE_EPOLL
+    size_t EpollRegistrations() const { return m_epoll_registrations.size(); }
+#endif
+};
+
 /** Testing setup that configures a complete environment.
  * Included are data directory, coins database, script check threads setup.
  */
-class CConnman;
-class CNode;
-
 class PeerLogicValidation;
 struct TestingSetup : public BasicTestingSetup {
     boost::thread_group threadGroup;
@@ -103,6 +152,10 @@ struct TestChain100Setup : public TestingSetup {
 
     std::vector<CTransactionRef> m_coinbase_txns; // For convenience, coinbase transactions
     CKey coinbaseKey; // private/public key needed to spend coinbase transactions
+
+    // Nonces plotted in memory per key to forge the blocks with
+    static constexpr size_t FORGE_NONCES = 8;
+    std::map<CKeyID, std::vector<std::vector<uint8_t>>> m_plots;
 };
 
 class CTxMemPoolEntry;
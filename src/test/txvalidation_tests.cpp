@@ -1,13 +1,18 @@
 // Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2019 The Lava Core developers
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <validation.h>
 #include <txmempool.h>
 #include <amount.h>
+#include <chainparams.h>
 #include <consensus/validation.h>
 #include <primitives/transaction.h>
+#include <random.h>
+#include <script/interpreter.h>
 #include <script/script.h>
+#include <script/standard.h>
 #include <test/test_bitcoin.h>
 
 #include <boost/test/unit_test.hpp>
@@ -15,4 +20,73 @@
 
 BOOST_AUTO_TEST_SUITE(txvalidation_tests)
 
+static void SetConfidentialAmountsHeight(int height)
+{
+    gArgs.ForceSetArg("-confidentialamountsheight", std::to_string(height));
+    SelectParams(CBaseChainParams::REGTEST);
+}
+
+/**
+ * Spend a coinbase to a native output and an explicit asset output that neither
+ * an input nor an issuance balances: only the confidential amount checks reject it.
+ */
+static CMutableTransaction UnbalancedAssetTx(const CTransactionRef& coinbase, const CKey& key)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(coinbase->GetHash(), 0);
+    const CScript script = GetScriptForDestination(key.GetPubKey().GetID());
+    tx.vout.emplace_back(coinbase->vout[0].nValue - 1000, script);
+    tx.vout.emplace_back(CConfidentialAsset(CAsset(GetRandHash())), CConfidentialValue(1000), script);
+    BOOST_CHECK(tx.vout[1].IsCA());
+
+    std::vector<unsigned char> vchSig;
+    const uint256 hash = SignatureHash(coinbase->vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+static bool ToMemPool(const CMutableTransaction& tx, CValidationState& state)
+{
+    LOCK(cs_main);
+    return AcceptToMemoryPool(mempool, state, MakeTransactionRef(tx), nullptr /* pfMissingInputs */,
+                              nullptr /* plTxnReplaced */, true /* bypass_limits */, 0 /* nAbsurdFee */);
+}
+
+static int ChainHeight()
+{
+    LOCK(cs_main);
+    return chainActive.Height();
+}
+
+BOOST_FIXTURE_TEST_CASE(confidential_amounts_activation, TestChain100Setup)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const int height = ChainHeight();
+    SetConfidentialAmountsHeight(height + 2);
+
+    // Below the activation height the amounts are not checked by consensus...
+    const CMutableTransaction before = UnbalancedAssetTx(m_coinbase_txns[0], coinbaseKey);
+    CValidationState state;
+    BOOST_CHECK(ToMemPool(before, state));
+    CreateAndProcessBlock({before}, scriptPubKey);
+    BOOST_CHECK_EQUAL(ChainHeight(), height + 1);
+    BOOST_CHECK_EQUAL(mempool.size(), 0U);
+
+    // ...from it, the mempool and blocks reject the same transaction.
+    const CMutableTransaction after = UnbalancedAssetTx(m_coinbase_txns[1], coinbaseKey);
+    BOOST_CHECK(!ToMemPool(after, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-in-ne-out");
+    CreateAndProcessBlock({after}, scriptPubKey);
+    BOOST_CHECK_EQUAL(ChainHeight(), height + 1);
+
+    // Blocks without it are still connected above the activation height.
+    CreateAndProcessBlock({}, scriptPubKey);
+    BOOST_CHECK_EQUAL(ChainHeight(), height + 2);
+
+    SetConfidentialAmountsHeight(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
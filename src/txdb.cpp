@@ -28,6 +28,8 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_SNAPSHOT_BASE = 'S';
+static const char DB_POC_VERIFIED = 'P';
 
 namespace {
 
@@ -53,7 +55,11 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true)
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : CCoinsViewDB(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+{
+}
+
+CCoinsViewDB::CCoinsViewDB(const fs::path& ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) : db(ldb_path, nCacheSize, fMemory, fWipe, true)
 {
 }
 
@@ -87,6 +93,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
+    ++m_write_count;
 
     uint256 old_tip = GetBestBlock();
     if (old_tip.IsNull()) {
@@ -149,6 +156,20 @@ size_t CCoinsViewDB::EstimateSize() const
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.IsArgSet("-blocksdir") ? GetDataDir() / "blocks" / "index" : GetBlocksDir() / "index", nCacheSize, fMemory, fWipe) {
 }
 
+bool CCoinsViewDB::WriteSnapshotCoins(const std::vector<std::pair<COutPoint, Coin>>& coins) {
+    CDBBatch batch(db);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    ++m_write_count;
+    for (const auto& entry : coins) {
+        batch.Write(CoinEntry(&entry.first), entry.second);
+        if (batch.SizeEstimate() > batch_size) {
+            if (!db.WriteBatch(batch)) return false;
+            batch.Clear();
+        }
+    }
+    return db.WriteBatch(batch);
+}
+
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
     return Read(std::make_pair(DB_BLOCK_FILES, nFile), info);
 }
@@ -246,6 +267,33 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+bool CBlockTreeDB::WriteSnapshotBase(const uint256& base_hash, const uint256& coins_hash, const uint256& ticket_hash, const uint256& relation_hash) {
+    return Write(DB_SNAPSHOT_BASE, std::make_pair(base_hash, std::vector<uint256>{coins_hash, ticket_hash, relation_hash}), true);
+}
+
+bool CBlockTreeDB::ReadSnapshotBase(uint256& base_hash, uint256& coins_hash, uint256& ticket_hash, uint256& relation_hash) {
+    std::pair<uint256, std::vector<uint256>> base;
+    if (!Read(DB_SNAPSHOT_BASE, base) || base.second.size() != 3)
+        return false;
+    base_hash = base.first;
+    coins_hash = base.second[0];
+    ticket_hash = base.second[1];
+    relation_hash = base.second[2];
+    return true;
+}
+
+bool CBlockTreeDB::EraseSnapshotBase() {
+    return Erase(DB_SNAPSHOT_BASE, true);
+}
+
+bool CBlockTreeDB::WritePocVerified(const uint256& hash) {
+    return Write(DB_POC_VERIFIED, hash);
+}
+
+bool CBlockTreeDB::ReadPocVerified(uint256& hash) {
+    return Read(DB_POC_VERIFIED, hash);
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -9,8 +9,10 @@
 #include <coins.h>
 #include <dbwrapper.h>
 #include <chain.h>
+#include <fs.h>
 #include <primitives/block.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -37,6 +39,12 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to the miner statistics index DB specific cache, if -minerstatsindex (MiB)
+static const int64_t nMaxMinerStatsIndexCache = 64;
+//! Max memory allocated to the asset index DB specific cache, if -assetindex (MiB)
+static const int64_t nMaxAssetIndexCache = 16;
+//! Max memory allocated to the block filter index DB specific cache, if -blockfilterindex (MiB)
+static const int64_t nMaxBlockFilterIndexCache = 32;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -45,8 +53,11 @@ class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+    std::atomic<uint64_t> m_write_count{0};
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    //! Open a coin database at ldb_path instead of chainstate/.
+    CCoinsViewDB(const fs::path& ldb_path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -58,6 +69,12 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+    //! Number of BatchWrite calls so far, coins read before a write may be stale after it.
+    uint64_t GetWriteCount() const { return m_write_count; }
+
+    //! Write coins loaded from a snapshot, without touching the best block.
+    bool WriteSnapshotCoins(const std::vector<std::pair<COutPoint, Coin>>& coins);
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -95,6 +112,13 @@ public:
     void ReadReindexing(bool &fReindexing);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    //! The base of a loaded chain state snapshot whose history is not validated yet, with its commitments.
+    bool WriteSnapshotBase(const uint256& base_hash, const uint256& coins_hash, const uint256& ticket_hash, const uint256& relation_hash);
+    bool ReadSnapshotBase(uint256& base_hash, uint256& coins_hash, uint256& ticket_hash, uint256& relation_hash);
+    bool EraseSnapshotBase();
+    //! The last block below the -assumevalid block whose proof of capacity was verified in the background.
+    bool WritePocVerified(const uint256& hash);
+    bool ReadPocVerified(uint256& hash);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
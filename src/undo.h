@@ -32,7 +32,7 @@ public:
             // Required to maintain compatibility with older undo format.
             ::Serialize(s, (unsigned char)0);
         }
-        ::Serialize(s, CTxOutCompressor(REF(txout->out)));
+        ::Serialize(s, CCoinOutCompressor(REF(txout->out)));
     }
 
     explicit TxInUndoSerializer(const Coin* coin, int versionIn = 0) : txout(coin) {}
@@ -55,7 +55,7 @@ public:
             unsigned int nVersionDummy;
             ::Unserialize(s, VARINT(nVersionDummy));
         }
-        ::Unserialize(s, CTxOutCompressor(REF(txout->out)));
+        ::Unserialize(s, CCoinOutCompressor(REF(txout->out)));
     }
 
     explicit TxInUndoDeserializer(Coin* coin, int versionIn = 0) : txout(coin) {}
@@ -10,6 +10,7 @@
 #include <chainparams.h>
 #include <checkpoints.h>
 #include <checkqueue.h>
+#include <coinsprefetcher.h>
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
@@ -45,8 +46,12 @@
 //#include <actiondb.h>
 #include <blockcache.h>
 
+#include <condition_variable>
 #include <future>
+#include <list>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -174,7 +179,9 @@ public:
 
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view);
-    bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** The ticket and relation views default to the ones of the active chain. */
+    bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false,
+                      CTicketView* ticketview = nullptr, CRelationView* relationview = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block disconnection on our pcoinsTip:
     bool DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -561,7 +568,7 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
         if (txFrom) {
             assert(txFrom->GetHash() == txin.prevout.hash);
             assert(txFrom->vout.size() > txin.prevout.n);
-            assert(txFrom->vout[txin.prevout.n] == coin.out);
+            assert(CCoinOut(txFrom->vout[txin.prevout.n]) == coin.out);
         } else {
             const Coin& coinFromDisk = pcoinsTip->AccessCoin(txin.prevout);
             assert(!coinFromDisk.IsSpent());
@@ -691,7 +698,11 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
             return state.DoS(0, false, REJECT_NONSTANDARD, "non-BIP68-final");
 
         CAmount nFees = 0;
-        if (!Consensus::CheckTxInputs(tx, state, view, GetSpendHeight(view), nFees)) {
+        // Verify confidential amounts inline once they are enforced, storing the
+        // proofs in the caches so that ConnectBlock does not verify them again.
+        const int nSpendHeight = GetSpendHeight(view);
+        const bool fAmountChecks = nSpendHeight >= chainparams.GetConsensus().ConfidentialAmountsHeight;
+        if (!Consensus::CheckTxInputs(tx, state, view, nSpendHeight, nFees, nullptr, true, fAmountChecks)) {
             return error("%s: Consensus::CheckTxInputs: %s, %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
         }
 
@@ -902,6 +913,10 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
             return false; // state filled in by CheckInputs
         }
 
+        // Remember a verified bind/unbind action, so that connecting the block
+        // does not recover its signature again.
+        CheckAction(ptx, nFees, true);
+
         // Check again against the current block tip's script verification
         // flags to cache our script execution flags. This is, of course,
         // useless if the next block has different script flags from the
@@ -1045,7 +1060,84 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const int height, const Consensus::Params& consensusParams)
+/**
+ * Whether pindex is a member of the chain of the -assumevalid block, and
+ * buried deep enough under the best header for the checks -assumevalid covers
+ * to be skipped. These include the deadline, which the background thread of
+ * pocverify.cpp verifies later; the generation signature and base target are
+ * still checked against the parent by ContextualCheckBlockHeader.
+ */
+static bool IsAssumedValid(const CBlockIndex* pindex, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    if (hashAssumeValid.IsNull() || !pindexBestHeader) {
+        return false;
+    }
+    // We've been configured with the hash of a block which has been externally verified to have a valid history.
+    // A suitable default value is included with the software and updated from time to time.  Because validity
+    //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
+    // This setting doesn't force the selection of any particular chain but makes validating some faster by
+    //  effectively caching the result of part of the verification.
+    BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValid);
+    if (it == mapBlockIndex.end()) {
+        return false;
+    }
+    if (it->second->GetAncestor(pindex->nHeight) == pindex &&
+        pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
+        pindexBestHeader->nCumulativeDiff >= nMinimumCumulativeDiff) {
+        // This block is a member of the assumed verified chain and an ancestor of the best header.
+        // The equivalent time check discourages hash power from extorting the network via DOS attack
+        //  into accepting an invalid block through telling users they must manually set assumevalid.
+        //  Requiring a software change or burying the invalid block, regardless of the setting, makes
+        //  it hard to hide the implication of the demand.  This also avoids having release candidates
+        //  that are hardly doing any signature verification at all in testing without having to
+        //  artificially set the default assumed verified block further back.
+        // The test against nMinimumCumulativeDiff prevents the skipping when denied access to any chain at
+        //  least as good as the expected chain.
+        return GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, consensusParams) > 60 * 60 * 24 * 7 * 2;
+    }
+    return false;
+}
+
+/** Deadlines LoadExternalBlockFile remembers at most as verified. */
+static const size_t MAX_IMPORT_POC_CHECKED = 100000;
+
+/**
+ * Blocks whose deadline was verified by the threads of LoadExternalBlockFile,
+ * with the height it was verified at. ReadBlockFromDisk does not verify them
+ * again when the block is connected. Only kept while a CImportPocScope exists.
+ */
+static std::unordered_map<uint256, int, BlockHasher> g_import_poc_checked GUARDED_BY(cs_main);
+static int g_import_poc_scopes GUARDED_BY(cs_main){0};
+
+CImportPocScope::CImportPocScope()
+{
+    LOCK(cs_main);
+    g_import_poc_scopes++;
+}
+
+CImportPocScope::~CImportPocScope()
+{
+    LOCK(cs_main);
+    if (--g_import_poc_scopes == 0) {
+        std::unordered_map<uint256, int, BlockHasher>().swap(g_import_poc_checked);
+    }
+}
+
+bool CheckBlockProofOfCapacity(const CBlockHeader& block, int height, const Consensus::Params& consensusParams)
+{
+    // TODO... check geneist block
+    if (height == 0) {
+        return true;
+    }
+    const CChainParams& params = Params();
+    if (height >= consensusParams.LVIP05Height) {
+        return CheckProofOfCapacity(block.genSign, height, block.nPublicKeyID, block.nNonce, block.nBaseTarget, block.nDeadline, params.TargetDeadline());
+    }
+    return CheckProofOfCapacityPoc2(block.genSign, height, block.nPlotID, block.nNonce, block.nBaseTarget, block.nDeadline, params.TargetDeadline());
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const int height, const Consensus::Params& consensusParams, bool fCheckPoc)
 {
     block.SetNull();
 
@@ -1062,31 +1154,34 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const int height
     }
 
     // Check the header
-    auto params = Params();
-    bool pocxFlag = false;
-    if (height >= consensusParams.LVIP05Height){
-        pocxFlag = true;
-    }
+    if (fCheckPoc && !CheckBlockProofOfCapacity(block, height, consensusParams))
+        return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
+    return true;
+}
 
-    if (pocxFlag){
-        if (height != 0 && !CheckProofOfCapacity(block.genSign, height, block.nPublicKeyID, block.nNonce, block.nBaseTarget, block.nDeadline, params.TargetDeadline()))
-            return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
-    }else{
-        if (height != 0 && !CheckProofOfCapacityPoc2(block.genSign, height, block.nPlotID, block.nNonce, block.nBaseTarget, block.nDeadline, params.TargetDeadline()))
-            return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
+bool CheckPocOnRead(const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    AssertLockHeld(cs_main);
+    bool fCheckPoc = !IsAssumedValid(pindex, consensusParams);
+    auto it = g_import_poc_checked.find(pindex->GetBlockHash());
+    if (it != g_import_poc_checked.end()) {
+        if (it->second == pindex->nHeight) fCheckPoc = false;
+        g_import_poc_checked.erase(it);
     }
-    return true;
+    return fCheckPoc;
 }
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     CDiskBlockPos blockPos;
+    bool fCheckPoc;
     {
         LOCK(cs_main);
         blockPos = pindex->GetBlockPos();
+        fCheckPoc = CheckPocOnRead(pindex, consensusParams);
     }
 
-    if (!ReadBlockFromDisk(block, blockPos, pindex->nHeight, consensusParams))
+    if (!ReadBlockFromDisk(block, blockPos, pindex->nHeight, consensusParams, fCheckPoc))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -1140,6 +1235,117 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
     return ReadRawBlockFromDisk(block, block_pos, message_start);
 }
 
+/**
+ * Whether a transaction of the serialized block uses the extended format, the
+ * part SERIALIZE_TRANSACTION_NO_WITNESS strips. The inputs and outputs of the
+ * other transactions are read one at a time to skip them, no transaction is
+ * built or hashed.
+ */
+static bool RawBlockHasWitness(const std::vector<uint8_t>& data)
+{
+    VectorReader s(SER_NETWORK, PROTOCOL_VERSION, data, 0);
+    CBlockHeader header;
+    s >> header;
+    CTxIn txin;
+    CTxOut txout;
+    for (uint64_t tx_count = ReadCompactSize(s); tx_count > 0; --tx_count) {
+        int32_t version;
+        s >> version;
+        s.SetExtra(version == CTransaction::CONFIDENTIAL_VERSION ? 1 : 0);
+        const uint64_t vin_count = ReadCompactSize(s);
+        if (vin_count == 0) {
+            // Same as UnserializeTransaction: the dummy vector is followed by
+            // the flags, a transaction without flags has no outputs either.
+            unsigned char flags;
+            s >> flags;
+            if (flags != 0) {
+                return true;
+            }
+        } else {
+            for (uint64_t i = 0; i < vin_count; ++i) {
+                s >> txin;
+            }
+            for (uint64_t vout_count = ReadCompactSize(s); vout_count > 0; --vout_count) {
+                s >> txout;
+            }
+        }
+        uint32_t lock_time;
+        s >> lock_time;
+    }
+    return false;
+}
+
+bool CRawBlock::HasWitness() const
+{
+    int has_witness = m_has_witness;
+    if (has_witness < 0) {
+        has_witness = 1;
+        try {
+            has_witness = RawBlockHasWitness(data);
+        } catch (const std::exception&) {
+        }
+        m_has_witness = has_witness;
+    }
+    return has_witness;
+}
+
+namespace {
+
+/** Least recently used raw blocks, bounded by the memory their data uses. */
+class CRawBlockCache
+{
+private:
+    typedef std::list<std::pair<uint256, std::shared_ptr<const CRawBlock>>> List;
+
+    CCriticalSection cs;
+    List m_list GUARDED_BY(cs);
+    std::unordered_map<uint256, List::iterator, BlockHasher> m_map GUARDED_BY(cs);
+    size_t m_usage GUARDED_BY(cs){0};
+
+public:
+    std::shared_ptr<const CRawBlock> Get(const uint256& hash)
+    {
+        LOCK(cs);
+        auto it = m_map.find(hash);
+        if (it == m_map.end()) return nullptr;
+        m_list.splice(m_list.begin(), m_list, it->second);
+        return it->second->second;
+    }
+
+    void Put(const uint256& hash, const std::shared_ptr<const CRawBlock>& block)
+    {
+        LOCK(cs);
+        if (block->data.size() > RAW_BLOCK_CACHE_SIZE || m_map.count(hash)) return;
+        m_list.emplace_front(hash, block);
+        m_map.emplace(hash, m_list.begin());
+        m_usage += block->data.size();
+        while (m_usage > RAW_BLOCK_CACHE_SIZE) {
+            m_usage -= m_list.back().second->data.size();
+            m_map.erase(m_list.back().first);
+            m_list.pop_back();
+        }
+    }
+};
+
+CRawBlockCache g_raw_block_cache;
+
+} // namespace
+
+std::shared_ptr<const CRawBlock> GetRawBlock(const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    std::shared_ptr<const CRawBlock> block = g_raw_block_cache.Get(hash);
+    if (block) return block;
+
+    std::vector<uint8_t> data;
+    if (!ReadRawBlockFromDisk(data, pindex, message_start)) {
+        return nullptr;
+    }
+    block = std::make_shared<const CRawBlock>(std::move(data));
+    g_raw_block_cache.Put(hash, block);
+    return block;
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     int halvings = nHeight / consensusParams.nSubsidyHalvingInterval;
@@ -1310,8 +1516,19 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
     UpdateCoins(tx, inputs, txundo, nHeight);
 }
 
+CScriptCheck::CScriptCheck(CScriptCheck&& check) = default;
+CScriptCheck::~CScriptCheck() = default;
+
 bool CScriptCheck::operator()()
 {
+    if (m_amount_check) {
+        if (!(*m_amount_check)()) {
+            error = m_amount_check->GetScriptError();
+            return false;
+        }
+        return true;
+    }
+
     const CScript& scriptSig = ptxTo->vin[nIn].scriptSig;
     const CScriptWitness* witness = &ptxTo->vin[nIn].scriptWitness;
 
@@ -1396,7 +1613,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsVi
                 // spent being checked as a part of CScriptCheck.
 
                 // Verify signature
-                CScriptCheck check(coin.out, tx, i, flags, cacheSigStore, &txdata);
+                CScriptCheck check(coin.out.GetTxOut(), tx, i, flags, cacheSigStore, &txdata);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -1408,7 +1625,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsVi
                         // arguments; if so, don't trigger DoS protection to
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
-                        CScriptCheck check2(coin.out, tx, i,
+                        CScriptCheck check2(coin.out.GetTxOut(), tx, i,
                             flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore, &txdata);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
@@ -1465,7 +1682,27 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+/** Abort with a message */
+static bool AbortNode(const std::string& strMessage, const std::string& userMessage = "")
+{
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(
+        userMessage.empty() ? _("Error: A fatal internal error occurred, see debug.log for details") : userMessage,
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+    return false;
+}
+
+static bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage = "")
+{
+    AbortNode(strMessage, userMessage);
+    return state.Error(strMessage);
+}
+
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 {
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
@@ -1507,26 +1744,6 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     return true;
 }
 
-/** Abort with a message */
-static bool AbortNode(const std::string& strMessage, const std::string& userMessage = "")
-{
-    SetMiscWarning(strMessage);
-    LogPrintf("*** %s\n", strMessage);
-    uiInterface.ThreadSafeMessageBox(
-        userMessage.empty() ? _("Error: A fatal internal error occurred, see debug.log for details") : userMessage,
-        "", CClientUIInterface::MSG_ERROR);
-    StartShutdown();
-    return false;
-}
-
-static bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage = "")
-{
-    AbortNode(strMessage, userMessage);
-    return state.Error(strMessage);
-}
-
-} // namespace
-
 /**
  * Restore the UTXO in a Coin at a given COutPoint
  * @param undo The Coin to be restored.
@@ -1551,10 +1768,10 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 
 // We don't want to compare things that are not stored in utxo db, specifically
 // the nonce commitment which has no consensus meaning for spending conditions
-static bool TxOutDBEntryIsSame(const CTxOut& block_txout, const CTxOut& txdb_txout)
+static bool TxOutDBEntryIsSame(const CTxOut& block_txout, const CCoinOut& txdb_txout)
 {
     return txdb_txout.nValue == block_txout.nValue &&
-        txdb_txout.nAsset == block_txout.nAsset &&
+        txdb_txout.GetAssetCommitment() == (block_txout.IsCA() ? block_txout.nAsset : CConfidentialAsset()) &&
         txdb_txout.scriptPubKey == block_txout.scriptPubKey;
 }
 
@@ -1666,7 +1883,7 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128, "Script");
 
 void ThreadScriptCheck()
 {
@@ -1785,10 +2002,13 @@ static int64_t nBlocksTotal = 0;
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
-bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
+bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck,
+                               CTicketView* ticketview, CRelationView* relationview)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
+    CTicketView& tickets = ticketview ? *ticketview : *pticketview;
+    CRelationView& relations = relationview ? *relationview : *prelationview;
     assert(*pindex->phashBlock == block.GetHash());
     int64_t nTimeStart = GetTimeMicros();
 
@@ -1805,7 +2025,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // is enforced in ContextualCheckBlockHeader(); we wouldn't want to
     // re-enforce that rule here (at least until we make it impossible for
     // GetAdjustedTime() to go backward).
-    if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck)) {
+    const bool fAssumedValid = IsAssumedValid(pindex, chainparams.GetConsensus());
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck, fAssumedValid)) {
         if (state.CorruptionPossible()) {
             // We don't write down blocks to disk if they may have been
             // corrupted, so this should be impossible unless we're having hardware
@@ -1829,31 +2050,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     nBlocksTotal++;
 
-    bool fScriptChecks = true;
-    if (!hashAssumeValid.IsNull()) {
-        // We've been configured with the hash of a block which has been externally verified to have a valid history.
-        // A suitable default value is included with the software and updated from time to time.  Because validity
-        //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
-        // This setting doesn't force the selection of any particular chain but makes validating some faster by
-        //  effectively caching the result of part of the verification.
-        BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValid);
-        if (it != mapBlockIndex.end()) {
-            if (it->second->GetAncestor(pindex->nHeight) == pindex &&
-                pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
-                pindexBestHeader->nCumulativeDiff >= nMinimumCumulativeDiff) {
-                // This block is a member of the assumed verified chain and an ancestor of the best header.
-                // The equivalent time check discourages hash power from extorting the network via DOS attack
-                //  into accepting an invalid block through telling users they must manually set assumevalid.
-                //  Requiring a software change or burying the invalid block, regardless of the setting, makes
-                //  it hard to hide the implication of the demand.  This also avoids having release candidates
-                //  that are hardly doing any signature verification at all in testing without having to
-                //  artificially set the default assumed verified block further back.
-                // The test against nMinimumCumulativeDiff prevents the skipping when denied access to any chain at
-                //  least as good as the expected chain.
-                fScriptChecks = (GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, chainparams.GetConsensus()) <= 60 * 60 * 24 * 7 * 2);
-            }
-        }
-    }
+    bool fScriptChecks = !fAssumedValid;
 
     int64_t nTime1 = GetTimeMicros();
     nTimeCheck += nTime1 - nTimeStart;
@@ -1964,7 +2161,16 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     CBlockUndo blockundo;
 
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    const bool fParallelChecks = fScriptChecks && nScriptCheckThreads;
+    CCheckQueueControl<CScriptCheck> control(fParallelChecks ? &scriptcheckqueue : nullptr);
+
+    // The bind/unbind action of each transaction, decoded and verified on the
+    // check threads along with the scripts.
+    std::vector<CAction> vActions(block.vtx.size());
+
+    // Height of the coin the second transaction spends first, a firestone if
+    // the coinbase claims one, looked up before this block spends it.
+    const int nFirestoneHeight = block.vtx.size() >= 2 ? view.AccessCoin(block.vtx[1]->vin[0].prevout).nHeight : 0;
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -1978,9 +2184,21 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
         nInputs += tx.vin.size();
 
+        std::vector<CScriptCheck> vChecks;
+        bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
         if (!tx.IsCoinBase()) {
             CAmount txfee = 0;
-            if (!Consensus::CheckTxInputs(tx, state, view, pindex->nHeight, txfee)) {
+            // Range, surjection and balance checks are queued together with
+            // the script checks of the transaction, from their activation height.
+            std::vector<CCheck*> vAmountChecks;
+            const bool fAmountChecks = fScriptChecks && pindex->nHeight >= chainparams.GetConsensus().ConfidentialAmountsHeight;
+            bool amounts_ok = Consensus::CheckTxInputs(tx, state, view, pindex->nHeight, txfee,
+                                                       nScriptCheckThreads ? &vAmountChecks : nullptr, fCacheResults, fAmountChecks);
+            vChecks.reserve(vAmountChecks.size() + tx.vin.size() + 1);
+            for (CCheck* check : vAmountChecks) {
+                vChecks.emplace_back(check);
+            }
+            if (!amounts_ok) {
                 return error("%s: Consensus::CheckTxInputs: %s, %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
             }
             nFees += txfee;
@@ -1992,15 +2210,37 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             // Check that transaction is BIP68 final
             // BIP68 lock checks (as opposed to nLockTime checks) must
             // be in ConnectBlock because they require the UTXO set
+            //
+            // The relation view used to look the spent coins of an action up in
+            // pcoinsTip, which the coins created in this block only reach when
+            // the view is flushed after ConnectBlock. Such a lookup returned the
+            // empty coin, whose nValue is -1 (CTxOut::SetNull), so an input of
+            // this block added -1 instead of its value to the inputs of the old
+            // fee. Removing value + 1 for each of them from the CheckTxInputs
+            // fee gives that same amount, and the same actions are decoded.
+            CAmount actionFee = txfee;
             prevheights.resize(tx.vin.size());
             for (size_t j = 0; j < tx.vin.size(); j++) {
-                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
+                const Coin& coin = view.AccessCoin(tx.vin[j].prevout);
+                prevheights[j] = coin.nHeight;
+                if (coin.nHeight == pindex->nHeight) {
+                    actionFee -= coin.out.nValue + 1;
+                }
             }
 
             if (!SequenceLocks(tx, nLockTimeFlags, &prevheights, *pindex)) {
                 return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
                     REJECT_INVALID, "bad-txns-nonfinal");
             }
+
+            // Actions are also checked when scripts are not, they change the relation state.
+            if (!fJustCheck) {
+                if (fParallelChecks) {
+                    vChecks.emplace_back(new CActionCheck(block.vtx[i], actionFee, &vActions[i]));
+                } else {
+                    vActions[i] = CheckAction(block.vtx[i], actionFee, false);
+                }
+            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -2014,8 +2254,6 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
         txdata.emplace_back(tx);
         if (!tx.IsCoinBase()) {
-            std::vector<CScriptCheck> vChecks;
-            bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
@@ -2038,13 +2276,13 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         if (block.vtx[0]->vin[0].scriptSig == CScript() << pindex->nHeight << ToByteVector(out.hash) << out.n << OP_0) {
             LogPrint(BCLog::FIRESTONE, "%s: coinbase with firestone:%s:%d\n", __func__, out.hash.ToString(), out.n);
             //check ticket
-            auto index = (pindex->nHeight / pticketview->SlotLength()) - 1;
-            for (auto ticket : pticketview->GetTicketsBySlotIndex(index)) {
+            auto index = (pindex->nHeight / tickets.SlotLength()) - 1;
+            for (auto ticket : tickets.GetTicketsBySlotIndex(index)) {
                 if (*(ticket->out) == out) {
-                    auto ticketInHeight = pcoinsTip->AccessCoin(COutPoint(out)).nHeight;
-                    auto index = pindex->nHeight / pticketview->SlotLength();
-                    auto beg = std::max((index - 1) * pticketview->SlotLength(), 0);
-                    auto end = index * pticketview->SlotLength() - 1;
+                    auto ticketInHeight = nFirestoneHeight;
+                    auto index = pindex->nHeight / tickets.SlotLength();
+                    auto beg = std::max((index - 1) * tickets.SlotLength(), 0);
+                    auto end = index * tickets.SlotLength() - 1;
                     if (ticketInHeight >= beg && ticketInHeight <= end) {
                         blockReward += GetBlockSubsidy(pindex->nHeight, chainparams.GetConsensus());
                         LogPrint(BCLog::FIRESTONE, "%s: coinbase with firestone:%s:%d\n", __func__, ticket->out->hash.ToString(), ticket->out->n);
@@ -2101,7 +2339,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         CTxDestination dest;
         ExtractDestination(script, dest);
         auto coinbaseDest = boost::get<CKeyID>(dest);
-        auto to = prelationview->To(block.nPublicKeyID, block.nPlotID, pocxFlag);
+        auto to = relations.To(block.nPublicKeyID, block.nPlotID, pocxFlag);
         if (! pocxFlag){
             auto targetPlotid = to.IsNull() ? block.nPlotID : to.GetPlotID();
             if (targetPlotid != coinbaseDest.GetPlotID()) {
@@ -2116,8 +2354,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     }
 
     //accept action
-    prelationview->ConnectBlock(pindex->nHeight, block, pocxFlag);
-    pticketview->ConnectBlock(pindex->nHeight, block, TestTicket);
+    relations.ConnectBlock(pindex->nHeight, block, vActions, pocxFlag);
+    tickets.ConnectBlock(pindex->nHeight, block, [&tickets](const int height, const CTicketRef& ticket) {
+        return TestTicket(tickets, height, ticket);
+    });
     return true;
 }
 
@@ -2641,8 +2881,21 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
         nHeight = nTargetHeight;
 
         // Connect new blocks.
-        for (CBlockIndex* pindexConnect : reverse_iterate(vpindexToConnect)) {
-            if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+        for (auto it = vpindexToConnect.rbegin(); it != vpindexToConnect.rend(); ++it) {
+            CBlockIndex* pindexConnect = *it;
+            std::shared_ptr<const CBlock> pblockConnect = pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>();
+            if (g_coins_prefetcher) {
+                // Fetch the inputs of the next block while this one is
+                // connected. This step usually returns after one block, the
+                // next step picks the job up.
+                g_coins_prefetcher->Prefetch(pindexConnect, pblockConnect, *pcoinsdbview);
+                if (std::next(it) != vpindexToConnect.rend()) {
+                    CBlockIndex* pindexNext = *std::next(it);
+                    g_coins_prefetcher->Prefetch(pindexNext, pindexNext == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), *pcoinsdbview);
+                }
+                g_coins_prefetcher->Apply(pindexConnect, pblockConnect, *pcoinsTip, *pcoinsdbview);
+            }
+            if (!ConnectTip(state, chainparams, pindexConnect, pblockConnect, connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (!state.CorruptionPossible()) {
@@ -3165,46 +3418,16 @@ static bool FindUndoPos(CValidationState& state, int nFile, CDiskBlockPos& pos,
 
 static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, int height, bool fCheckPoc = true)
 {
-    auto params = Params();
-    // Check proof of work matches claimed amount
-    // TODO... check geneist block
-    bool pocxFlag = false;
-    if (height >= consensusParams.LVIP05Height){
-        pocxFlag = true;
-    }
-
-    if (pocxFlag){
-        if (fCheckPoc && height != 0 && !CheckProofOfCapacity(block.genSign, height, block.nPublicKeyID, block.nNonce, block.nBaseTarget, block.nDeadline, params.TargetDeadline()))
-            return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of capacity failed");
-    }else{
-        if (fCheckPoc && height != 0 && !CheckProofOfCapacityPoc2(block.genSign, height, block.nPlotID, block.nNonce, block.nBaseTarget, block.nDeadline, params.TargetDeadline()))
-            return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of capacity failed");
-    }
+    // Check proof of capacity matches claimed amount
+    if (fCheckPoc && height != 0 && !CheckBlockProofOfCapacity(block, height, consensusParams))
+        return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of capacity failed");
 
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPoc, bool fCheckMerkleRoot)
+/** The checks of CheckBlock that only depend on the block itself, not its header. */
+static bool CheckBlockContents(const CBlock& block, CValidationState& state, bool fCheckMerkleRoot)
 {
-    // These are checks that are independent of context.
-
-    if (block.fChecked)
-        return true;
-
-    // Check that the header is valid (particularly PoW).  This is mostly
-    // redundant with the call in AcceptBlockHeader.
-    auto height = 0;
-    if (!block.hashPrevBlock.IsNull()) {
-        for (auto i = 0; i <= chainActive.Height(); i++) {
-            if (chainActive[i]->GetBlockHash() == block.hashPrevBlock) {
-                height = chainActive[i]->nHeight + 1;
-                break;
-            }
-        }
-    }
-    if (!CheckBlockHeader(block, state, consensusParams, height, fCheckPoc))
-        return false;
-
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
@@ -3256,6 +3479,33 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
         return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
 
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPoc, bool fCheckMerkleRoot, bool fPocAssumedValid)
+{
+    // These are checks that are independent of context.
+
+    if (block.fChecked)
+        return true;
+
+    // Check that the header is valid (particularly PoW).  This is mostly
+    // redundant with the call in AcceptBlockHeader.
+    auto height = 0;
+    if (!block.hashPrevBlock.IsNull()) {
+        for (auto i = 0; i <= chainActive.Height(); i++) {
+            if (chainActive[i]->GetBlockHash() == block.hashPrevBlock) {
+                height = chainActive[i]->nHeight + 1;
+                break;
+            }
+        }
+    }
+    if (!CheckBlockHeader(block, state, consensusParams, height, fCheckPoc && !fPocAssumedValid))
+        return false;
+
+    if (!CheckBlockContents(block, state, fCheckMerkleRoot))
+        return false;
+
     if (fCheckPoc && fCheckMerkleRoot)
         block.fChecked = true;
 
@@ -3402,7 +3652,7 @@ static bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationSta
             strprintf("rejected nVersion=0x%08x block", block.nVersion));
     
 
-    if (block.nTime <= pindexPrev->nTime || block.nTime > GetSystemTimeInSeconds() + MAX_FUTURE_BLOCK_TIME) {
+    if (block.nTime <= pindexPrev->nTime || block.nTime > GetTime() + MAX_FUTURE_BLOCK_TIME) {
         return state.Invalid(false, REJECT_INVALID, "block-time-err", "block timestamp error");
     }
 
@@ -3692,7 +3942,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
         if (pindex->nCumulativeDiff < nMinimumCumulativeDiff) return true;
     }
 
-    if (!CheckBlock(block, state, chainparams.GetConsensus()) ||
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), true, true, IsAssumedValid(pindex, chainparams.GetConsensus())) ||
         !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3741,7 +3991,9 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
 
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
-        bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
+        const CBlockIndex* pindex_known = LookupBlockIndex(pblock->GetHash());
+        const bool fPocAssumedValid = pindex_known && IsAssumedValid(pindex_known, chainparams.GetConsensus());
+        bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus(), true, true, fPocAssumedValid);
         if (ret) {
             // Store to disk
             ret = g_chainstate.AcceptBlock(pblock, state, chainparams, &pindex, fForceProcessing, nullptr, fNewBlock);
@@ -3772,9 +4024,16 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
     }
     //auto prevIndex = chainActive.Tip();
     auto prevIndex = miSelf->second;
-    if (pblock->nDeadline / prevIndex->nBaseTarget + prevIndex->nTime > GetSystemTimeInSeconds()) {
+    if (pblock->nDeadline / prevIndex->nBaseTarget + prevIndex->nTime > GetTime()) {
         LogPrintf("%s: deadline in feature, add to cache, block:%s, time:%d\n", __func__, pblock->GetHash().ToString(), pblock->nTime);
         g_blockCache->AddBlock(pblock, activateBestChain);
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pindex = LookupBlockIndex(pblock->GetHash());
+            if (pindex && pindex->pprev == chainActive.Tip()) {
+                GetMainSignals().NewPendingBlock(pindex, pblock);
+            }
+        }
         return true;
     }
     CValidationState state; // Only used to report errors, not invalidity - ignore it
@@ -4222,12 +4481,17 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView* coinsview,
             LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
             break;
         }
+        if (!(pindex->nStatus & BLOCK_HAVE_UNDO)) {
+            // Blocks up to the base of a loaded snapshot were never connected by this node.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (snapshot, no undo data)\n", pindex->nHeight);
+            break;
+        }
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
             return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
         // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus()))
+        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus(), true, true, IsAssumedValid(pindex, chainparams.GetConsensus())))
             return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
                 pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
         // check level 2: verify undo validity
@@ -4380,6 +4644,14 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
     return g_chainstate.ReplayBlocks(params, view);
 }
 
+bool ConnectSnapshotBlock(const CBlock& block, CBlockIndex* pindex, CCoinsViewCache& view, CTicketView& tickets, CRelationView& relations, const CChainParams& chainparams, CValidationState& state)
+{
+    // The script execution cache, the versionbits cache and the check queue
+    // are shared with the active chain.
+    LOCK(cs_main);
+    return g_chainstate.ConnectBlock(block, state, pindex, view, chainparams, false, &tickets, &relations);
+}
+
 //! Helper for CChainState::RewindBlockIndex
 void CChainState::EraseBlockData(CBlockIndex* index)
 {
@@ -4617,6 +4889,156 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return g_chainstate.LoadGenesisBlock(chainparams);
 }
 
+/** Blocks LoadExternalBlockFile reads ahead per import thread. */
+static const size_t IMPORT_BLOCKS_PER_THREAD = 4;
+/** Bytes of block file LoadExternalBlockFile reads ahead at most. */
+static const uint64_t MAX_IMPORT_READ_AHEAD = 16 * 1000 * 1000;
+
+namespace {
+
+/** A block read from a block file by LoadExternalBlockFile. */
+struct ImportBlock
+{
+    //! Where scanning resumes if the block turns out unreadable
+    uint64_t nRewind{0};
+    uint64_t nBlockPos{0};
+    std::vector<unsigned char> data;
+    size_t nDataSize{0};
+    uint256 hash;
+    uint256 hashPrevBlock;
+    //! Height given by the parent, -1 if the parent is not known yet
+    int height{-1};
+    //! Whether the import threads verify the deadline
+    bool fCheckPoc{false};
+
+    // Set by the import threads
+    std::shared_ptr<CBlock> block;
+    std::string error;
+    //! Bytes the block was deserialized from
+    size_t nBlockSize{0};
+    bool fPocChecked{false};
+    //! The deadline is invalid at height
+    bool fPocFailed{false};
+    bool done{false};
+};
+
+/** Deserialize a block and run the checks of CheckBlock, with the deadline at the height the block file gives. */
+static void CheckImportBlock(ImportBlock& item, const Consensus::Params& consensusParams)
+{
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    try {
+        VectorReader reader(SER_DISK, CLIENT_VERSION, item.data, 0);
+        reader >> *pblock;
+        item.nBlockSize = item.data.size() - reader.size();
+    } catch (const std::exception& e) {
+        item.error = e.what();
+        return;
+    }
+    std::vector<unsigned char>().swap(item.data);
+
+    // A block failing its contents goes through CheckBlock again when it is accepted
+    CValidationState state;
+    if (item.fCheckPoc && !CheckBlockProofOfCapacity(*pblock, item.height, consensusParams)) {
+        item.fPocFailed = true;
+        item.block = pblock;
+        return;
+    }
+    if (CheckBlockContents(*pblock, state, true)) {
+        pblock->fChecked = true;
+        item.fPocChecked = item.fCheckPoc;
+    }
+    item.block = pblock;
+}
+
+/**
+ * Threads deserializing and checking the blocks LoadExternalBlockFile reads
+ * ahead, while it accepts the blocks before them in file order. Without
+ * threads the blocks are checked when they are pushed.
+ */
+class BlockImportPool
+{
+private:
+    const Consensus::Params& m_params;
+    Mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    std::deque<std::shared_ptr<ImportBlock>> m_queue GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void ThreadCheck()
+    {
+        ScheduleBatchPriority();
+        WAIT_LOCK(m_mutex, lock);
+        while (true) {
+            if (m_queue.empty()) {
+                if (m_stop) return;
+                m_work_cv.wait(lock);
+                continue;
+            }
+            std::shared_ptr<ImportBlock> item = std::move(m_queue.front());
+            m_queue.pop_front();
+            lock.unlock();
+            CheckImportBlock(*item, m_params);
+            lock.lock();
+            item->done = true;
+            m_done_cv.notify_all();
+        }
+    }
+
+public:
+    BlockImportPool(const Consensus::Params& params, int threads) : m_params(params)
+    {
+        for (int i = 0; i < threads; ++i) {
+            m_threads.emplace_back(&TraceThread<std::function<void()>>, "loadblkcheck", std::bind(&BlockImportPool::ThreadCheck, this));
+        }
+    }
+
+    ~BlockImportPool()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+            m_queue.clear();
+        }
+        m_work_cv.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    size_t Threads() const { return m_threads.size(); }
+
+    void Push(const std::shared_ptr<ImportBlock>& item)
+    {
+        if (m_threads.empty()) {
+            CheckImportBlock(*item, m_params);
+            item->done = true;
+            return;
+        }
+        {
+            LOCK(m_mutex);
+            m_queue.push_back(item);
+        }
+        m_work_cv.notify_one();
+    }
+
+    void Wait(const ImportBlock& item)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_done_cv.wait(lock, [&] { return item.done; });
+    }
+
+    /** Drop the blocks no thread started on. */
+    void Clear()
+    {
+        LOCK(m_mutex);
+        m_queue.clear();
+    }
+};
+
+} // namespace
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos* dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -4625,71 +5047,169 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
 
     int nLoaded = 0;
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE + 8, SER_DISK, CLIENT_VERSION);
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor.
+        // Scanning resumes after the oldest block read ahead if it is unreadable.
+        const uint64_t nRewindLimit = MAX_IMPORT_READ_AHEAD + MAX_BLOCK_SERIALIZED_SIZE + 8;
+        CBufferedFile blkdat(fileIn, 2 * nRewindLimit, nRewindLimit, SER_DISK, CLIENT_VERSION);
+        BlockImportPool pool(chainparams.GetConsensus(), nScriptCheckThreads);
+        const size_t nMaxPending = std::max<size_t>(1, pool.Threads() * IMPORT_BLOCKS_PER_THREAD);
+        std::deque<std::shared_ptr<ImportBlock>> pending;
+        // Height of the assumed valid block once known, below it the deadlines are left to ConnectBlock
+        int nAssumeValidHeight = hashAssumeValid.IsNull() ? 0 : -1;
+        // Outside of an import scope there is nowhere to remember the verified deadlines
+        bool fRememberPoc;
+        {
+            LOCK(cs_main);
+            fRememberPoc = g_import_poc_scopes > 0;
+        }
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        bool fEnd = false;
+        while (true) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE) && memcmp(buf, chainparams.MessageStartForDisk(), CMessageHeader::MESSAGE_START_SIZE))
+            // Read ahead, the import threads check the blocks while the oldest one is accepted
+            if (!fEnd && pending.size() < nMaxPending && (pending.empty() || nRewind - pending.front()->nRewind < MAX_IMPORT_READ_AHEAD)) {
+                if (blkdat.eof()) {
+                    fEnd = true;
                     continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                }
+                blkdat.SetPos(nRewind);
+                nRewind++;         // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                    blkdat.FindByte(chainparams.MessageStart()[0]);
+                    nRewind = blkdat.GetPos() + 1;
+                    blkdat >> buf;
+                    if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE) && memcmp(buf, chainparams.MessageStartForDisk(), CMessageHeader::MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    fEnd = true;
+                    continue;
+                }
+                std::shared_ptr<ImportBlock> item = std::make_shared<ImportBlock>();
+                try {
+                    // read block
+                    item->nRewind = nRewind;
+                    item->nBlockPos = blkdat.GetPos();
+                    blkdat.SetLimit(item->nBlockPos + nSize);
+                    item->data.resize(nSize);
+                    blkdat.read((char*)item->data.data(), nSize);
+                    item->nDataSize = nSize;
+                    CBlockHeader header;
+                    VectorReader(SER_DISK, CLIENT_VERSION, item->data, 0) >> header;
+                    item->hash = header.GetHash();
+                    item->hashPrevBlock = header.hashPrevBlock;
+                    nRewind = blkdat.GetPos();
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                     continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
+                }
+
+                if (item->hash == chainparams.GetConsensus().hashGenesisBlock) {
+                    item->height = 0;
+                } else {
+                    for (const auto& prev : pending) {
+                        if (prev->hash == item->hashPrevBlock) {
+                            item->height = prev->height < 0 ? -1 : prev->height + 1;
+                        }
+                    }
+                    if (item->height < 0 || nAssumeValidHeight < 0) {
+                        LOCK(cs_main);
+                        const CBlockIndex* pindexPrev = LookupBlockIndex(item->hashPrevBlock);
+                        if (pindexPrev && item->height < 0) {
+                            item->height = pindexPrev->nHeight + 1;
+                        }
+                        const CBlockIndex* pindexAssumed = nAssumeValidHeight < 0 ? LookupBlockIndex(hashAssumeValid) : nullptr;
+                        if (pindexAssumed) {
+                            nAssumeValidHeight = pindexAssumed->nHeight;
+                        }
+                    }
+                }
+                item->fCheckPoc = fRememberPoc && item->height > 0 && nAssumeValidHeight >= 0 && item->height > nAssumeValidHeight;
+                pending.push_back(item);
+                pool.Push(item);
+                continue;
+            }
+            if (pending.empty()) {
                 break;
             }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
 
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                        CValidationState state;
-                        if (g_chainstate.AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
-                            nLoaded++;
-                        }
-                        if (state.IsError()) {
-                            break;
+            std::shared_ptr<ImportBlock> item = std::move(pending.front());
+            pending.pop_front();
+            pool.Wait(*item);
+            if (!item->block || item->nBlockSize != item->nDataSize) {
+                // Scan again from where the block was read, without the blocks read after it
+                pending.clear();
+                pool.Clear();
+                fEnd = false;
+                nRewind = item->block ? item->nBlockPos + item->nBlockSize : item->nRewind;
+                // A long run without blocks may have been scanned past the rewind margin
+                if (!blkdat.SetPos(nRewind)) {
+                    blkdat.Seek(nRewind);
+                }
+                if (!item->block) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, item->error);
+                    continue;
+                }
+            }
+            if (dbp)
+                dbp->nPos = item->nBlockPos;
+
+            std::shared_ptr<CBlock> pblock = item->block;
+            const uint256& hash = item->hash;
+            bool fError = false;
+            {
+                LOCK(cs_main);
+                // detect out of order blocks, and store them for later
+                const CBlockIndex* pindexPrev = LookupBlockIndex(pblock->hashPrevBlock);
+                if (hash != chainparams.GetConsensus().hashGenesisBlock && !pindexPrev) {
+                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                        pblock->hashPrevBlock.ToString());
+                    if (dbp)
+                        mapBlocksUnknownParent.insert(std::make_pair(pblock->hashPrevBlock, *dbp));
+                    continue;
+                }
+
+                // CheckBlock only verifies the deadline of blocks whose parent is on the active chain
+                if (item->fPocFailed && pindexPrev && pindexPrev->nHeight + 1 == item->height) {
+                    LogPrintf("%s: Block %s has an invalid proof of capacity\n", __func__, hash.ToString());
+                    continue;
+                }
+
+                // process in case the block isn't known yet
+                CBlockIndex* pindex = LookupBlockIndex(hash);
+                if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+                    // CheckBlock verifies the deadline of a block whose parent is on the active chain
+                    if (!item->fPocChecked && pindexPrev && chainActive.Contains(pindexPrev)) {
+                        pblock->fChecked = false;
+                    }
+                    CValidationState state;
+                    if (g_chainstate.AcceptBlock(pblock, state, chainparams, &pindex, true, dbp, nullptr)) {
+                        nLoaded++;
+                        if (item->fPocChecked && pindex->nHeight == item->height && g_import_poc_checked.size() < MAX_IMPORT_POC_CHECKED) {
+                            g_import_poc_checked.emplace(hash, item->height);
                         }
-                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
                     }
+                    if (state.IsError()) {
+                        fError = true;
+                    }
+                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
                 }
+            }
+            if (fError) {
+                break;
+            }
 
+            try {
                 // Activate the genesis block so normal node progress can continue
                 if (hash == chainparams.GetConsensus().hashGenesisBlock) {
                     CValidationState state;
@@ -5118,14 +5638,14 @@ public:
     }
 } instance_of_cmaincleanup;
 
-bool TestTicket(const int height, const CTicketRef ticket)
+bool TestTicket(const CTicketView& view, const int height, const CTicketRef ticket)
 {
-    auto index = pticketview->SlotIndex();
-    auto len = pticketview->SlotLength();
+    auto index = view.SlotIndex();
+    auto len = view.SlotLength();
     if (ticket->LockTime() != ((index + 1) * len -1)) {
         return false;
     }
-    if (ticket->nValue != pticketview->CurrentTicketPrice()) {
+    if (ticket->nValue != view.CurrentTicketPrice()) {
         return false;
     }
     return true;
@@ -5150,7 +5670,10 @@ bool LoadRelationView()
     LogPrintf("%s: Load Relations from block database...\n", __func__);
     if (chainActive.Tip()==nullptr){
         // new chain
-        return true;
+        return prelationview->MarkHistoryIndexed();
+    }else if (prelationview->IsHistoryIndexed()){
+        // the history of every KeyID holds its latest action
+        return prelationview->LoadRelationTip(chainActive.Height(), Params().GetConsensus().LVIP05Height);
     }else{
         // assember relationMap index.
         CBlockIndex *currentIndex = chainActive.Genesis();
@@ -5168,6 +5691,6 @@ bool LoadRelationView()
                 return error("%s: failure: %s", __func__, e.what());
             }
         }
-        return true;
+        return prelationview->MarkHistoryIndexed();
     }
 }
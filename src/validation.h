@@ -35,7 +35,9 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
+class CCheck;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
@@ -256,6 +258,17 @@ FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp = nullptr);
+/**
+ * While an import is in scope, LoadExternalBlockFile verifies the deadlines of
+ * the blocks above the -assumevalid block on its threads and remembers them,
+ * so that they are not verified again when the imported blocks are connected.
+ * They are forgotten at the end of the import.
+ */
+struct CImportPocScope
+{
+    CImportPocScope();
+    ~CImportPocScope();
+};
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk,
@@ -357,7 +370,9 @@ bool CheckSequenceLocks(const CTxMemPool& pool, const CTransaction& tx, int flag
 bool LoadTicketView();
 bool LoadRelationView();
 /**
- * Closure representing one script verification
+ * Closure representing one script verification, or one confidential amount
+ * check (range proof, surjection proof or balance) queued by
+ * Consensus::CheckTxInputs, so that both run on the script check threads.
  * Note that this stores references to the spending transaction
  */
 class CScriptCheck
@@ -370,11 +385,19 @@ private:
     bool cacheStore;
     ScriptError error;
     PrecomputedTransactionData *txdata;
+    //! If set, the confidential amount check run instead of the script.
+    std::unique_ptr<CCheck> m_amount_check;
 
 public:
     CScriptCheck(): ptxTo(nullptr), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
     CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
         m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) { }
+    //! Takes ownership of amount_check.
+    explicit CScriptCheck(CCheck* amount_check) :
+        ptxTo(nullptr), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(nullptr), m_amount_check(amount_check) { }
+    // Defined where CCheck is complete.
+    CScriptCheck(CScriptCheck&& check);
+    ~CScriptCheck();
 
     bool operator()();
 
@@ -386,6 +409,7 @@ public:
         std::swap(cacheStore, check.cacheStore);
         std::swap(error, check.error);
         std::swap(txdata, check.txdata);
+        m_amount_check.swap(check.m_amount_check);
     }
 
     ScriptError GetScriptError() const { return error; }
@@ -396,15 +420,55 @@ void InitScriptExecutionCache();
 
 
 /** Functions for disk access for blocks */
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const int height, const Consensus::Params& consensusParams);
+/** Check the deadline of a block header at height against its plot. */
+bool CheckBlockProofOfCapacity(const CBlockHeader& block, int height, const Consensus::Params& consensusParams);
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const int height, const Consensus::Params& consensusParams, bool fCheckPoc = true);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Whether the deadline of the block of pindex has to be checked when the block is read from disk. */
+bool CheckPocOnRead(const CBlockIndex* pindex, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
 
+/** A block as stored on disk, which is its network serialization with witnesses. */
+class CRawBlock
+{
+public:
+    const std::vector<uint8_t> data;
+
+    explicit CRawBlock(std::vector<uint8_t>&& data_) : data(std::move(data_)) {}
+
+    /**
+     * Whether a transaction of the block is serialized with witness data or
+     * confidential proofs, in which case data differs from the serialization
+     * without witnesses. Determined on first use by scanning data, blocks
+     * that do not parse count as having witnesses.
+     */
+    bool HasWitness() const;
+
+private:
+    mutable std::atomic<int> m_has_witness{-1};
+};
+
+/** Memory used at most by the raw blocks kept for serving them again (bytes) */
+static const size_t RAW_BLOCK_CACHE_SIZE = 32 << 20;
+
+/**
+ * Read the block of pindex as stored on disk, without deserializing it. The
+ * blocks most recently read this way are kept in memory, as blocks tend to be
+ * requested by several syncing peers in a row. Returns null on failure.
+ */
+std::shared_ptr<const CRawBlock> GetRawBlock(const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+
 /** Functions for validating blocks and updating the block tree */
 
-/** Context-independent validity checks */
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPoc = true, bool fCheckMerkleRoot = true);
+/**
+ * Context-independent validity checks. fPocAssumedValid skips the deadline
+ * check of a block covered by -assumevalid, which callers decide under
+ * cs_main; the block still counts as fully checked.
+ */
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPoc = true, bool fCheckMerkleRoot = true, bool fPocAssumedValid = false);
 
 /** Check a block is completely valid from start to finish (only works on top of our current best block) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -438,6 +502,13 @@ public:
 /** Replay blocks that aren't fully applied to the database. */
 bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
 
+/**
+ * Connect a block below a loaded snapshot to view and to the given ticket and
+ * relation views, with the same checks as a block of the active chain. Its
+ * undo data is written if it has none.
+ */
+bool ConnectSnapshotBlock(const CBlock& block, CBlockIndex* pindex, CCoinsViewCache& view, CTicketView& tickets, CRelationView& relations, const CChainParams& chainparams, CValidationState& state);
+
 inline CBlockIndex* LookupBlockIndex(const uint256& hash)
 {
     AssertLockHeld(cs_main);
@@ -492,7 +563,7 @@ extern std::unique_ptr<CBlockTreeDB> pblocktree;
  */
 int GetSpendHeight(const CCoinsViewCache& inputs);
 
-bool TestTicket(const int height, const CTicketRef ticket);
+bool TestTicket(const CTicketView& view, const int height, const CTicketRef ticket);
 
 extern VersionBitsCache versionbitscache;
 
@@ -1550,37 +1550,41 @@ UniValue importblindingkey(const JSONRPCRequest& request)
                 },
             }.ToString());
 
-    auto locked_chain = pwallet->chain().lock();
-    LOCK(pwallet->cs_wallet);
+    {
+        auto locked_chain = pwallet->chain().lock();
+        LOCK(pwallet->cs_wallet);
 
-    CTxDestination dest = DecodeDestination(request.params[0].get_str());
-    if (!IsValidDestination(dest)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Bitcoin address.");
-    }
-    if (!IsBlindDestination(dest)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address is not confidential.");
-    }
+        CTxDestination dest = DecodeDestination(request.params[0].get_str());
+        if (!IsValidDestination(dest)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Bitcoin address.");
+        }
+        if (!IsBlindDestination(dest)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address is not confidential.");
+        }
 
-    if (!IsHex(request.params[1].get_str())) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid hexadecimal for key");
-    }
-    std::vector<unsigned char> keydata = ParseHex(request.params[1].get_str());
-    if (keydata.size() != 32) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid hexadecimal key length");
-    }
+        if (!IsHex(request.params[1].get_str())) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid hexadecimal for key");
+        }
+        std::vector<unsigned char> keydata = ParseHex(request.params[1].get_str());
+        if (keydata.size() != 32) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid hexadecimal key length");
+        }
 
-    CKey key;
-    key.Set(keydata.begin(), keydata.end(), true);
-    if (!key.IsValid() || key.GetPubKey() != GetDestinationBlindingKey(dest)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address and key do not match");
-    }
+        CKey key;
+        key.Set(keydata.begin(), keydata.end(), true);
+        if (!key.IsValid() || key.GetPubKey() != GetDestinationBlindingKey(dest)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address and key do not match");
+        }
 
-    uint256 keyval;
-    memcpy(keyval.begin(), &keydata[0], 32);
-    if (!pwallet->AddSpecificBlindingKey(CScriptID(GetScriptForDestination(dest)), keyval)) {
-        throw JSONRPCError(RPC_WALLET_ERROR, "Failed to import blinding key");
+        uint256 keyval;
+        memcpy(keyval.begin(), &keydata[0], 32);
+        if (!pwallet->AddSpecificBlindingKey(CScriptID(GetScriptForDestination(dest)), keyval)) {
+            throw JSONRPCError(RPC_WALLET_ERROR, "Failed to import blinding key");
+        }
+        pwallet->MarkDirty();
     }
-    pwallet->MarkDirty();
+    // Outputs sent to the key before it was imported are unblinded now, outside cs_wallet.
+    pwallet->RecomputeUnknownBlindingData();
 
     return NullUniValue;
 }
@@ -1608,30 +1612,33 @@ UniValue importmasterblindingkey(const JSONRPCRequest& request)
                 },
             }.ToString());
 
-    auto locked_chain = pwallet->chain().lock();
-    LOCK(pwallet->cs_wallet);
+    {
+        auto locked_chain = pwallet->chain().lock();
+        LOCK(pwallet->cs_wallet);
 
-    uint256 keyval;
-    if (request.params.size() == 1) {
-        if (!IsHex(request.params[0].get_str())) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid hexadecimal for key");
-        }
-        std::vector<unsigned char> keydata = ParseHex(request.params[0].get_str());
-        if (keydata.size() != 32) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid hexadecimal key length");
+        uint256 keyval;
+        if (request.params.size() == 1) {
+            if (!IsHex(request.params[0].get_str())) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid hexadecimal for key");
+            }
+            std::vector<unsigned char> keydata = ParseHex(request.params[0].get_str());
+            if (keydata.size() != 32) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid hexadecimal key length");
+            }
+
+            memcpy(keyval.begin(), &keydata[0], 32);
+        } else {
+            CKey key = pwallet->GenerateMasterBlindingKey();
+            memcpy(keyval.begin(), key.begin(), key.size());
         }
 
-        memcpy(keyval.begin(), &keydata[0], 32);
-    } else {
-        CKey key = pwallet->GenerateMasterBlindingKey();
-        memcpy(keyval.begin(), key.begin(), key.size());
-    }
+        if (!pwallet->SetMasterBlindingKey(keyval)) {
+            throw JSONRPCError(RPC_WALLET_ERROR, "Failed to import master blinding key");
+        }
 
-    if (!pwallet->SetMasterBlindingKey(keyval)) {
-        throw JSONRPCError(RPC_WALLET_ERROR, "Failed to import master blinding key");
+        pwallet->MarkDirty();
     }
-
-    pwallet->MarkDirty();
+    pwallet->RecomputeUnknownBlindingData();
 
     return NullUniValue;
 }
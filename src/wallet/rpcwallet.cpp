@@ -5750,13 +5750,14 @@ static UniValue unbindplotid(const JSONRPCRequest& request)
 
 static UniValue getbindinginfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 1) {
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
         throw std::runtime_error(
             RPCHelpMan{
                 "getbindinginfo",
-                "\nunbind plotid mapping.",
+                "\nshow the binding of an address, at the tip or at a given height.",
                 {
                     {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "address"},
+                    {"height", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "show the binding which was active at this height"},
                 },
                 RPCResult{
                     "{\n"
@@ -5769,11 +5770,13 @@ static UniValue getbindinginfo(const JSONRPCRequest& request)
                     "    \"address\": \"1QEWDafENaWingtsSGtnc3M2fiQVuEkZHi\",\n"
                     "    \"plotid\": 14776299456771222,\n"
                     "    \"publickeyid\": 799c5acef87fa36abedeb8fa773cb2gefc680098,\n"
-                    "  }\n"
+                    "  },\n"
+                    "  \"height\": 1024,     (only with height) the height of the bind action\n"
                     "}\n"
                  },
                 RPCExamples{
                     HelpExampleCli("getbindinginfo", "17VkcJoDJEHyuCKgGyky8CGNnb1kPgbwr4")
+                    + HelpExampleCli("getbindinginfo", "17VkcJoDJEHyuCKgGyky8CGNnb1kPgbwr4 20000")
                 },
             }.ToString()
         );
@@ -5790,7 +5793,17 @@ static UniValue getbindinginfo(const JSONRPCRequest& request)
         pocxFlag = true;
     }
     auto from = boost::get<CKeyID>(dest);
-    auto to = prelationview->To(from, from.GetPlotID(), pocxFlag);
+    CKeyID to;
+    int bindHeight = -1;
+    if (request.params[1].isNull()) {
+        to = prelationview->To(from, from.GetPlotID(), pocxFlag);
+    } else {
+        int height = request.params[1].get_int();
+        if (height < 0 || height > chainActive.Height()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        }
+        prelationview->GetRelationAt(from, height, to, bindHeight);
+    }
     if (to == CKeyID()) {
         return UniValue(UniValue::VOBJ);
     }
@@ -5806,9 +5819,70 @@ static UniValue getbindinginfo(const JSONRPCRequest& request)
     UniValue result(UniValue::VOBJ);
     result.pushKV("from", fromVal);
     result.pushKV("to", toVal);
+    if (bindHeight >= 0) {
+        result.pushKV("height", bindHeight);
+    }
     return result;
 }
 
+static UniValue listbindinghistory(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        throw std::runtime_error(
+            RPCHelpMan{
+                "listbindinghistory",
+                "\nlist every bind and unbind action of an address.",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "address"},
+                },
+                RPCResult{
+                    "[\n"
+                    "  {\n"
+                    "    \"height\": 1024,\n"
+                    "    \"action\": \"bind\",\n"
+                    "    \"to\": {\n"
+                    "      \"address\": \"1QEWDafENaWingtsSGtnc3M2fiQVuEkZHi\",\n"
+                    "      \"plotid\": 14776299456771222,\n"
+                    "      \"publickeyid\": 799c5acef87fa36abedeb8fa773cb2gefc680098,\n"
+                    "    }\n"
+                    "  },\n"
+                    "  {\n"
+                    "    \"height\": 2048,\n"
+                    "    \"action\": \"unbind\"\n"
+                    "  }\n"
+                    "]\n"
+                 },
+                RPCExamples{
+                    HelpExampleCli("listbindinghistory", "17VkcJoDJEHyuCKgGyky8CGNnb1kPgbwr4")
+                },
+            }.ToString()
+        );
+    }
+    LOCK(cs_main);
+    auto strAddress = request.params[0].get_str();
+    CTxDestination dest = DecodeDestination(strAddress);
+    if (!IsValidDestination(dest) || dest.type() != typeid(CKeyID)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+    UniValue results(UniValue::VARR);
+    for (const auto& entry : prelationview->GetRelationHistory(boost::get<CKeyID>(dest))) {
+        UniValue val(UniValue::VOBJ);
+        val.pushKV("height", entry.first);
+        if (entry.second == CKeyID()) {
+            val.pushKV("action", "unbind");
+        } else {
+            UniValue toVal(UniValue::VOBJ);
+            toVal.pushKV("address", EncodeDestination(CTxDestination(entry.second)));
+            toVal.pushKV("plotid", entry.second.GetPlotID());
+            toVal.pushKV("publickeyid", entry.second.ToString());
+            val.pushKV("action", "bind");
+            val.pushKV("to", toVal);
+        }
+        results.push_back(val);
+    }
+    return results;
+}
+
 static UniValue listbindings(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0) {
@@ -6827,7 +6901,8 @@ static const CRPCCommand commands[] =
     { "poc",                "bindplotid",                       &bindplotid,                    {"address", "target"} },
     { "poc",                "unbindplotid",                     &unbindplotid,                  {"address"} },
     { "poc",                "listbindings",                     &listbindings,                  {""} },
-    { "poc",                "getbindinginfo",                   &getbindinginfo,                {"address"} },
+    { "poc",                "getbindinginfo",                   &getbindinginfo,                {"address", "height"} },
+    { "poc",                "listbindinghistory",               &listbindinghistory,            {"address"} },
     { "poc",                "createfstxwithwallet",             &createfstxwithwallet,          {"txid","address"} },
     { "poc",                "importfstx",                       &importfstx,                    {"hexstring","slotindex"} },
     { "poc",                "cleanfstx",                        &cleanfstx,                     {"slotindex"} },
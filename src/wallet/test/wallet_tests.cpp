@@ -10,6 +10,7 @@
 #include <utility>
 #include <vector>
 
+#include <blind.h>
 #include <consensus/validation.h>
 #include <interfaces/chain.h>
 #include <rpc/server.h>
@@ -105,6 +106,105 @@ BOOST_AUTO_TEST_CASE(LoadReceiveRequests)
     BOOST_CHECK_EQUAL(values[1], "val_rr1");
 }
 
+static void CheckSameBlindingData(const CWalletTx& precomputed, const CWalletTx& serial)
+{
+    for (unsigned int n = 0; n < precomputed.tx->vout.size(); n++) {
+        BOOST_CHECK_EQUAL(precomputed.GetOutputValueOut(n), serial.GetOutputValueOut(n));
+        BOOST_CHECK(precomputed.GetOutputAsset(n) == serial.GetOutputAsset(n));
+        BOOST_CHECK(precomputed.GetOutputAmountBlindingFactor(n) == serial.GetOutputAmountBlindingFactor(n));
+        BOOST_CHECK(precomputed.GetOutputAssetBlindingFactor(n) == serial.GetOutputAssetBlindingFactor(n));
+        BOOST_CHECK(precomputed.GetOutputBlindingPubKey(n) == serial.GetOutputBlindingPubKey(n));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PrecomputedBlindingData)
+{
+    // The same keys in two wallets: m_wallet gets the outputs unblinded on its
+    // worker threads, serial_wallet unblinds them one by one when they are read.
+    CWallet serial_wallet(*m_chain, WalletLocation(), WalletDatabase::CreateDummy());
+    bool first_run;
+    serial_wallet.LoadWallet(first_run);
+
+    const uint256 master_blinding_key = GetRandHash();
+    std::vector<CScript> scripts;
+    for (int i = 0; i < 3; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        AddKey(m_wallet, key);
+        AddKey(serial_wallet, key);
+        scripts.push_back(GetScriptForDestination(key.GetPubKey().GetID()));
+    }
+    {
+        LOCK2(m_wallet.cs_wallet, serial_wallet.cs_wallet);
+        BOOST_CHECK(m_wallet.SetMasterBlindingKey(master_blinding_key));
+        BOOST_CHECK(serial_wallet.SetMasterBlindingKey(master_blinding_key));
+    }
+
+    // The last wallet output is blinded to a key the wallets do not know yet.
+    CKey foreign_blinding_key;
+    foreign_blinding_key.MakeNewKey(true);
+    const CAsset asset(GetRandHash());
+    const std::vector<CAmount> amounts = {10000, 20000, 30000};
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    std::vector<CPubKey> output_pubkeys;
+    for (size_t i = 0; i < amounts.size(); i++) {
+        mtx.vout.push_back(CTxOut(asset, amounts[i], scripts[i]));
+        output_pubkeys.push_back(i + 1 < amounts.size() ? m_wallet.GetBlindingPubKey(scripts[i]) : foreign_blinding_key.GetPubKey());
+    }
+    mtx.vout.push_back(CTxOut(asset, 1000, CScript()));
+    output_pubkeys.push_back(CPubKey());
+    std::vector<uint256> input_blinds = {uint256()}, input_asset_blinds = {uint256()}, output_blinds, output_asset_blinds;
+    std::vector<CKey> vDummy;
+    BOOST_CHECK_EQUAL(BlindTransaction(input_blinds, input_asset_blinds, {asset}, {61000}, output_blinds, output_asset_blinds, output_pubkeys, vDummy, vDummy, mtx), 3);
+    const CTransactionRef ptx = MakeTransactionRef(mtx);
+
+    m_wallet.StartUnblindThreads(3);
+    m_wallet.TransactionAddedToMempool(ptx);
+    {
+        LOCK(serial_wallet.cs_wallet);
+        serial_wallet.AddToWallet(CWalletTx(&serial_wallet, ptx));
+    }
+    {
+        LOCK2(m_wallet.cs_wallet, serial_wallet.cs_wallet);
+        const CWalletTx& precomputed = m_wallet.mapWallet.at(ptx->GetHash());
+        const CWalletTx& serial = serial_wallet.mapWallet.at(ptx->GetHash());
+        // The confidential outputs were unblinded before the transaction was
+        // added. The last one failed, so MarkDirty() leaves it to be retried.
+        BOOST_CHECK_EQUAL(precomputed.blindingData.at(2).computed, 0);
+        for (unsigned int n = 0; n + 1 < amounts.size(); n++) {
+            BOOST_CHECK_EQUAL(precomputed.blindingData.at(n).computed, 1);
+        }
+        CheckSameBlindingData(precomputed, serial);
+        BOOST_CHECK_EQUAL(serial.GetOutputValueOut(0), amounts[0]);
+        BOOST_CHECK_EQUAL(serial.GetOutputValueOut(1), amounts[1]);
+        BOOST_CHECK(serial.GetOutputAsset(0) == asset);
+        BOOST_CHECK_EQUAL(serial.GetOutputValueOut(2), -1);
+    }
+
+    // Importing the missing key retries the output outside cs_wallet.
+    uint256 foreign_key_value;
+    memcpy(foreign_key_value.begin(), foreign_blinding_key.begin(), foreign_blinding_key.size());
+    {
+        LOCK2(m_wallet.cs_wallet, serial_wallet.cs_wallet);
+        BOOST_CHECK(m_wallet.AddSpecificBlindingKey(CScriptID(scripts[2]), foreign_key_value));
+        BOOST_CHECK(serial_wallet.AddSpecificBlindingKey(CScriptID(scripts[2]), foreign_key_value));
+        m_wallet.MarkDirty();
+        serial_wallet.MarkDirty();
+    }
+    m_wallet.RecomputeUnknownBlindingData();
+    m_wallet.StopUnblindThreads();
+    {
+        LOCK2(m_wallet.cs_wallet, serial_wallet.cs_wallet);
+        const CWalletTx& precomputed = m_wallet.mapWallet.at(ptx->GetHash());
+        const CWalletTx& serial = serial_wallet.mapWallet.at(ptx->GetHash());
+        BOOST_CHECK_EQUAL(precomputed.blindingData.at(2).computed, 1);
+        CheckSameBlindingData(precomputed, serial);
+        BOOST_CHECK_EQUAL(serial.GetOutputValueOut(2), amounts[2]);
+    }
+}
+
 class ListCoinsTestingSetup : public TestChain100Setup
 {
 public:
@@ -159,6 +259,116 @@ public:
     std::unique_ptr<CWallet> wallet;
 };
 
+// Spend the coinbase output prevout back to the wallet without broadcasting it.
+static CTransactionRef CreateSpend(CWallet& wallet, interfaces::Chain::Lock& locked_chain, const COutPoint& prevout, const CScript& script, CAmount amount)
+{
+    CTransactionRef tx;
+    std::vector<std::unique_ptr<CReserveKey>> reservekeys;
+    reservekeys.push_back(MakeUnique<CReserveKey>(&wallet));
+    CAmount fee;
+    int changePos = -1;
+    std::string error;
+    CCoinControl coin_control;
+    coin_control.fAllowOtherInputs = false;
+    coin_control.Select(prevout);
+    BOOST_CHECK(wallet.CreateTransaction(locked_chain, {{script, amount, false}}, tx, reservekeys, fee, changePos, error, coin_control));
+    return tx;
+}
+
+static bool IsAvailable(CWallet& wallet, interfaces::Chain::Lock& locked_chain, const COutPoint& outpoint)
+{
+    LOCK(wallet.cs_wallet);
+    std::vector<COutput> coins;
+    wallet.AvailableCoins(locked_chain, coins, false /* fOnlySafe */);
+    for (const COutput& coin : coins) {
+        if (COutPoint(coin.tx->GetHash(), coin.i) == outpoint) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The outputs AvailableCoins considers are updated incrementally; check them
+// against a rebuild as transactions are added, abandoned, reorged and spent.
+BOOST_FIXTURE_TEST_CASE(SpendableOutputs, ListCoinsTestingSetup)
+{
+    RegisterValidationInterface(wallet.get());
+    wallet->SetBroadcastTransactions(true);
+    // Keep the spent coinbase output mature when a block is disconnected
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(other_key.GetPubKey()));
+    auto check = [&] {
+        SyncWithValidationInterfaceQueue();
+        LOCK2(cs_main, wallet->cs_wallet);
+        BOOST_CHECK(wallet->CheckSpendableOutputs(*m_locked_chain));
+    };
+    const COutPoint coinbase_out(m_coinbase_txns[0]->GetHash(), 0);
+    const CScript script = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    BOOST_CHECK(IsAvailable(*wallet, *m_locked_chain, coinbase_out));
+    check();
+
+    // Spend the coinbase output in a block
+    CTransactionRef spend;
+    {
+        LOCK2(cs_main, wallet->cs_wallet);
+        spend = CreateSpend(*wallet, *m_locked_chain, coinbase_out, script, COIN);
+    }
+    std::vector<std::unique_ptr<CReserveKey>> reservekeys;
+    CValidationState state;
+    BOOST_CHECK(wallet->CommitTransaction(spend, {}, {}, reservekeys, nullptr, state));
+    check();
+    BOOST_CHECK(!IsAvailable(*wallet, *m_locked_chain, coinbase_out));
+    CreateAndProcessBlock({CMutableTransaction(*spend)}, script);
+    CBlockIndex* spend_block = chainActive.Tip();
+    check();
+    BOOST_CHECK(!IsAvailable(*wallet, *m_locked_chain, coinbase_out));
+    BOOST_CHECK(IsAvailable(*wallet, *m_locked_chain, COutPoint(spend->GetHash(), 0)));
+
+    // Disconnect the block, drop the spend from the mempool and abandon it
+    BOOST_CHECK(InvalidateBlock(state, Params(), spend_block));
+    check();
+    BOOST_CHECK(!IsAvailable(*wallet, *m_locked_chain, coinbase_out));
+    // The test mempool does not notify removals, as init does not run
+    mempool.removeRecursive(*spend);
+    wallet->TransactionRemovedFromMempool(spend);
+    check();
+    {
+        LOCK2(cs_main, wallet->cs_wallet);
+        BOOST_CHECK(wallet->AbandonTransaction(*m_locked_chain, spend->GetHash()));
+    }
+    check();
+    BOOST_CHECK(IsAvailable(*wallet, *m_locked_chain, coinbase_out));
+
+    // A double spend in a block conflicts the abandoned spend
+    CTransactionRef double_spend;
+    {
+        LOCK2(cs_main, wallet->cs_wallet);
+        double_spend = CreateSpend(*wallet, *m_locked_chain, coinbase_out, script, 2 * COIN);
+    }
+    BOOST_CHECK(double_spend->GetHash() != spend->GetHash());
+    BOOST_CHECK(wallet->CommitTransaction(double_spend, {}, {}, reservekeys, nullptr, state));
+    CreateAndProcessBlock({CMutableTransaction(*double_spend)}, script);
+    CBlockIndex* double_spend_block = chainActive.Tip();
+    check();
+    BOOST_CHECK(!IsAvailable(*wallet, *m_locked_chain, coinbase_out));
+    BOOST_CHECK(IsAvailable(*wallet, *m_locked_chain, COutPoint(double_spend->GetHash(), 0)));
+
+    // Reorg back to the block with the first spend
+    BOOST_CHECK(InvalidateBlock(state, Params(), double_spend_block));
+    {
+        LOCK(cs_main);
+        ResetBlockFailureFlags(spend_block);
+    }
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    BOOST_CHECK(chainActive.Tip() == spend_block);
+    check();
+    BOOST_CHECK(!IsAvailable(*wallet, *m_locked_chain, coinbase_out));
+    BOOST_CHECK(IsAvailable(*wallet, *m_locked_chain, COutPoint(spend->GetHash(), 0)));
+
+    UnregisterValidationInterface(wallet.get());
+}
+
 // Explicit calculation which is used to test the wallet constant
 // We get the same virtual size due to rounding(weight/4) for both use_max_sig values
 static size_t CalculateNestedKeyhashInputSize(bool use_max_sig)
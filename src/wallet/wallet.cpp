@@ -6,6 +6,7 @@
 #include <wallet/wallet.h>
 
 #include <checkpoints.h>
+#include <checkqueue.h>
 #include <chain.h>
 #include <wallet/coincontrol.h>
 #include <consensus/consensus.h>
@@ -36,6 +37,7 @@
 #include <future>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/thread.hpp>
 
 #include <blind.h>
 #include <issuance.h>
@@ -727,6 +729,97 @@ bool CWallet::IsSpent(interfaces::Chain::Lock& locked_chain, const uint256& hash
     return false;
 }
 
+bool CWallet::IsSpentByActiveTx(const COutPoint& outpoint) const
+{
+    // Transactions that are neither abandoned nor conflicted have a depth of
+    // at least 0, so an output spent by one of them is spent for IsSpent too
+    auto range = mapTxSpends.equal_range(outpoint);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && !mit->second.isAbandoned() && (mit->second.nIndex != -1 || mit->second.hashUnset())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CWallet::UpdateSpendableOutput(const COutPoint& outpoint) const
+{
+    auto it = mapWallet.find(outpoint.hash);
+    if (it == mapWallet.end() || outpoint.n >= it->second.tx->vout.size()) {
+        return;
+    }
+    const CWalletTx& wtx = it->second;
+    // Not ours, so not indexed either; skips unblinding outputs of others
+    if (IsMine(wtx.tx->vout[outpoint.n]) == ISMINE_NO) {
+        return;
+    }
+
+    const CAsset asset = wtx.GetOutputAsset(outpoint.n);
+    if (!IsSpentByActiveTx(outpoint)) {
+        m_spendable_outputs[asset].insert(outpoint);
+        return;
+    }
+    auto asset_it = m_spendable_outputs.find(asset);
+    if (asset_it != m_spendable_outputs.end()) {
+        asset_it->second.erase(outpoint);
+        if (asset_it->second.empty()) {
+            m_spendable_outputs.erase(asset_it);
+        }
+    }
+}
+
+void CWallet::UpdateSpendableOutputs(const CWalletTx& wtx)
+{
+    if (!m_spendable_outputs_valid) {
+        return;
+    }
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        UpdateSpendableOutput(COutPoint(wtx.GetHash(), i));
+    }
+    if (!wtx.IsCoinBase()) {
+        for (const CTxIn& txin : wtx.tx->vin) {
+            UpdateSpendableOutput(txin.prevout);
+        }
+    }
+}
+
+void CWallet::BuildSpendableOutputs() const
+{
+    m_spendable_outputs.clear();
+    for (const auto& entry : mapWallet) {
+        for (unsigned int i = 0; i < entry.second.tx->vout.size(); i++) {
+            UpdateSpendableOutput(COutPoint(entry.first, i));
+        }
+    }
+    m_spendable_outputs_valid = true;
+}
+
+bool CWallet::CheckSpendableOutputs(interfaces::Chain::Lock& locked_chain) const
+{
+    AssertLockHeld(cs_wallet);
+    if (!m_spendable_outputs_valid) {
+        return true;
+    }
+    const std::map<CAsset, std::set<COutPoint>> spendable_outputs = m_spendable_outputs;
+    BuildSpendableOutputs();
+    if (spendable_outputs != m_spendable_outputs) {
+        return false;
+    }
+    for (const auto& entry : mapWallet) {
+        for (unsigned int i = 0; i < entry.second.tx->vout.size(); i++) {
+            if (IsMine(entry.second.tx->vout[i]) == ISMINE_NO || IsSpent(locked_chain, entry.first, i)) {
+                continue;
+            }
+            auto it = m_spendable_outputs.find(entry.second.GetOutputAsset(i));
+            if (it == m_spendable_outputs.end() || !it->second.count(COutPoint(entry.first, i))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
@@ -922,6 +1015,9 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (std::pair<const uint256, CWalletTx>& item : mapWallet)
             item.second.MarkDirty();
+        // Outputs may have become ours or been unblinded
+        m_spendable_outputs_valid = false;
+        m_spendable_outputs.clear();
     }
 }
 
@@ -1021,6 +1117,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 
     // Break debit/credit balance caches:
     wtx.MarkDirty();
+    UpdateSpendableOutputs(wtx);
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1059,7 +1156,7 @@ void CWallet::LoadToWallet(const CWalletTx& wtxIn)
     }
 }
 
-bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const uint256& block_hash, int posInBlock, bool fUpdate)
+bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const uint256& block_hash, int posInBlock, bool fUpdate, const std::vector<BlindingDataInfo>* blinding_data)
 {
     const CTransaction& tx = *ptx;
     {
@@ -1106,6 +1203,12 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const uint256
 
             CWalletTx wtx(this, ptx);
 
+            // Hand over outputs unblinded ahead of time, so that AddToWallet
+            // does not rewind the rangeproofs again while holding cs_wallet
+            if (blinding_data) {
+                (fExisted ? mapWallet.at(tx.GetHash()) : wtx).SeedBlindingData(*blinding_data);
+            }
+
             // Get merkle branch if transaction was found in a block
             if (!block_hash.IsNull())
                 wtx.SetMerkleBranch(block_hash, posInBlock);
@@ -1184,6 +1287,7 @@ bool CWallet::AbandonTransaction(interfaces::Chain::Lock& locked_chain, const ui
             // If a transaction changes 'conflicted' state, that changes the balance
             // available of the outputs it spends. So force those to be recomputed
             MarkInputsDirty(wtx.tx);
+            UpdateSpendableOutputs(wtx);
         }
     }
 
@@ -1237,12 +1341,13 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             // If a transaction changes 'conflicted' state, that changes the balance
             // available of the outputs it spends. So force those to be recomputed
             MarkInputsDirty(wtx.tx);
+            UpdateSpendableOutputs(wtx);
         }
     }
 }
 
-void CWallet::SyncTransaction(const CTransactionRef& ptx, const uint256& block_hash, int posInBlock, bool update_tx) {
-    if (!AddToWalletIfInvolvingMe(ptx, block_hash, posInBlock, update_tx))
+void CWallet::SyncTransaction(const CTransactionRef& ptx, const uint256& block_hash, int posInBlock, bool update_tx, const std::vector<BlindingDataInfo>* blinding_data) {
+    if (!AddToWalletIfInvolvingMe(ptx, block_hash, posInBlock, update_tx, blinding_data))
         return; // Not one of ours
 
     // If a transaction changes 'conflicted' state, that changes the balance
@@ -1251,10 +1356,19 @@ void CWallet::SyncTransaction(const CTransactionRef& ptx, const uint256& block_h
     MarkInputsDirty(ptx);
 }
 
+static const std::vector<BlindingDataInfo>* FindPrecomputedBlindingData(const PrecomputedBlindingData& data, const uint256& txid)
+{
+    auto it = data.find(txid);
+    return it == data.end() ? nullptr : &it->second;
+}
+
 void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx) {
+    PrecomputedBlindingData blinding_data;
+    PrecomputeBlindingData({ptx}, blinding_data);
+
     auto locked_chain = chain().lock();
     LOCK(cs_wallet);
-    SyncTransaction(ptx, {} /* block hash */, 0 /* position in block */);
+    SyncTransaction(ptx, {} /* block hash */, 0 /* position in block */, true /* update_tx */, FindPrecomputedBlindingData(blinding_data, ptx->GetHash()));
 
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
@@ -1271,6 +1385,9 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx) {
 }
 
 void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) {
+    PrecomputedBlindingData blinding_data;
+    PrecomputeBlindingData(pblock->vtx, blinding_data);
+
     auto locked_chain = chain().lock();
     LOCK(cs_wallet);
     // TODO: Temporarily ensure that mempool removals are notified before
@@ -1286,7 +1403,7 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
         TransactionRemovedFromMempool(ptx);
     }
     for (size_t i = 0; i < pblock->vtx.size(); i++) {
-        SyncTransaction(pblock->vtx[i], pindex->GetBlockHash(), i);
+        SyncTransaction(pblock->vtx[i], pindex->GetBlockHash(), i, true /* update_tx */, FindPrecomputedBlindingData(blinding_data, pblock->vtx[i]->GetHash()));
         TransactionRemovedFromMempool(pblock->vtx[i]);
     }
 
@@ -1879,6 +1996,9 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
 
             CBlock block;
             if (chain().findBlock(block_hash, &block) && !block.IsNull()) {
+                PrecomputedBlindingData blinding_data;
+                PrecomputeBlindingData(block.vtx, blinding_data);
+
                 auto locked_chain = chain().lock();
                 LOCK(cs_wallet);
                 if (!locked_chain->getBlockHeight(block_hash)) {
@@ -1891,7 +2011,7 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
                     break;
                 }
                 for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    SyncTransaction(block.vtx[posInBlock], block_hash, posInBlock, fUpdate);
+                    SyncTransaction(block.vtx[posInBlock], block_hash, posInBlock, fUpdate, FindPrecomputedBlindingData(blinding_data, block.vtx[posInBlock]->GetHash()));
                 }
                 // scan succeeded, record block as most recent successfully scanned
                 result.last_scanned_block = block_hash;
@@ -2428,27 +2548,46 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
     vCoins.clear();
     CAmount nTotal = 0;
 
-    for (const auto& entry : mapWallet)
-    {
-        const uint256& wtxid = entry.first;
-        const CWalletTx* pcoin = &entry.second;
+    // Only the outputs that are ours and not spent by an active wallet
+    // transaction are considered, in the order of mapWallet
+    if (!m_spendable_outputs_valid) {
+        BuildSpendableOutputs();
+    }
+    std::vector<COutPoint> outpoints;
+    if (asset_filter) {
+        auto it = m_spendable_outputs.find(*asset_filter);
+        if (it != m_spendable_outputs.end()) {
+            outpoints.assign(it->second.begin(), it->second.end());
+        }
+    } else {
+        for (const auto& entry : m_spendable_outputs) {
+            outpoints.insert(outpoints.end(), entry.second.begin(), entry.second.end());
+        }
+        std::sort(outpoints.begin(), outpoints.end());
+    }
 
+    // The checks of a transaction are shared by its outputs, which are adjacent
+    const CWalletTx* pcoin = nullptr;
+    bool tx_available = false;
+    int nDepth = 0;
+    bool safeTx = false;
+    auto check_tx = [&]() EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet) {
         if (!CheckFinalTx(*pcoin->tx))
-            continue;
+            return false;
 
         if (pcoin->IsImmatureCoinBase(locked_chain))
-            continue;
+            return false;
 
-        int nDepth = pcoin->GetDepthInMainChain(locked_chain);
+        nDepth = pcoin->GetDepthInMainChain(locked_chain);
         if (nDepth < 0)
-            continue;
+            return false;
 
         // We should not consider coins which aren't at least in our mempool
         // It's possible for these to be conflicted via ancestors which we may never be able to detect
         if (nDepth == 0 && !pcoin->InMempool())
-            continue;
+            return false;
 
-        bool safeTx = pcoin->IsTrusted(locked_chain);
+        safeTx = pcoin->IsTrusted(locked_chain);
 
         // We should not consider coins from transactions that are replacing
         // other transactions.
@@ -2482,55 +2621,67 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
         }
 
         if (fOnlySafe && !safeTx) {
-            continue;
+            return false;
         }
 
         if (nDepth < nMinDepth || nDepth > nMaxDepth)
-            continue;
+            return false;
 
-        for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-            CAmount outValue = pcoin->GetOutputValueOut(i);
-            CAsset asset = pcoin->GetOutputAsset(i);
-            if (asset_filter && asset != *asset_filter) {
-                continue;
-            }
-            if (outValue < nMinimumAmount || outValue > nMaximumAmount)
-                continue;
+        return true;
+    };
 
-            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(entry.first, i)))
-                continue;
+    for (const COutPoint& outpoint : outpoints)
+    {
+        const uint256& wtxid = outpoint.hash;
+        if (!pcoin || pcoin->GetHash() != wtxid) {
+            pcoin = &mapWallet.at(wtxid);
+            tx_available = check_tx();
+        }
+        if (!tx_available)
+            continue;
 
-            if (IsLockedCoin(entry.first, i))
-                continue;
+        const unsigned int i = outpoint.n;
+        CAmount outValue = pcoin->GetOutputValueOut(i);
+        CAsset asset = pcoin->GetOutputAsset(i);
+        if (asset_filter && asset != *asset_filter) {
+            continue;
+        }
+        if (outValue < nMinimumAmount || outValue > nMaximumAmount)
+            continue;
 
-            if (IsSpent(locked_chain, wtxid, i))
-                continue;
+        if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(outpoint))
+            continue;
 
-            isminetype mine = IsMine(pcoin->tx->vout[i]);
+        if (IsLockedCoin(wtxid, i))
+            continue;
 
-            if (mine == ISMINE_NO) {
-                continue;
-            }
+        if (IsSpent(locked_chain, wtxid, i))
+            continue;
 
-            bool solvable = IsSolvable(*this, pcoin->tx->vout[i].scriptPubKey);
-            bool spendable = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) || (((mine & ISMINE_WATCH_ONLY) != ISMINE_NO) && (coinControl && coinControl->fAllowWatchOnly && solvable));
+        isminetype mine = IsMine(pcoin->tx->vout[i]);
 
-            vCoins.push_back(COutput(pcoin, i, nDepth, spendable, solvable, safeTx, (coinControl && coinControl->fAllowWatchOnly)));
+        if (mine == ISMINE_NO) {
+            continue;
+        }
 
-            // Checks the sum amount of all UTXO's.
-            if (nMinimumSumAmount != MAX_MONEY) {
-                nTotal += outValue;
+        bool solvable = IsSolvable(*this, pcoin->tx->vout[i].scriptPubKey);
+        bool spendable = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) || (((mine & ISMINE_WATCH_ONLY) != ISMINE_NO) && (coinControl && coinControl->fAllowWatchOnly && solvable));
 
-                if (nTotal >= nMinimumSumAmount) {
-                    return;
-                }
-            }
+        vCoins.push_back(COutput(pcoin, i, nDepth, spendable, solvable, safeTx, (coinControl && coinControl->fAllowWatchOnly)));
+
+        // Checks the sum amount of all UTXO's.
+        if (nMinimumSumAmount != MAX_MONEY) {
+            nTotal += outValue;
 
-            // Checks the maximum number of UTXO's.
-            if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+            if (nTotal >= nMinimumSumAmount) {
                 return;
             }
         }
+
+        // Checks the maximum number of UTXO's.
+        if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+            return;
+        }
     }
 }
 
@@ -3932,6 +4083,8 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
         wtxOrdered.erase(it->second.m_it_wtxOrdered);
         mapWallet.erase(it);
     }
+    m_spendable_outputs_valid = false;
+    m_spendable_outputs.clear();
 
     if (nZapSelectTxRet == DBErrors::NEED_REWRITE)
     {
@@ -4809,6 +4962,9 @@ std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(interfaces::Chain& chain,
     // TODO: Can't use std::make_shared because we need a custom deleter but
     // should be possible to use std::allocate_shared.
     std::shared_ptr<CWallet> walletInstance(new CWallet(chain, location, WalletDatabase::Create(location.GetPath())), ReleaseWallet);
+    // The wallet may rescan while it is loaded, so unblinding runs on the
+    // same number of threads as script verification from the start.
+    walletInstance->StartUnblindThreads(nScriptCheckThreads);
     DBErrors nLoadWalletRet = walletInstance->LoadWallet(fFirstRun);
     if (nLoadWalletRet != DBErrors::LOAD_OK)
     {
@@ -5321,6 +5477,15 @@ void CWalletTx::SetBlindingData(const unsigned int map_index, const CPubKey& bli
     blindingData[map_index].blinding_pubkey = blinding_pubkey.IsFullyValid() ? blinding_pubkey : CPubKey();
 }
 
+void CWalletTx::SeedBlindingData(const std::vector<BlindingDataInfo>& output_data)
+{
+    for (unsigned int n = 0; n < output_data.size() && n < tx->vout.size(); n++) {
+        if (output_data[n].computed == 1 && (blindingData.size() <= n || blindingData[n].computed == 0 || blindingData[n].value == -1)) {
+            SetBlindingData(n, output_data[n].blinding_pubkey, output_data[n].value, output_data[n].amount_blinding_factor, output_data[n].asset, output_data[n].asset_blinding_factor);
+        }
+    }
+}
+
 void CWalletTx::GetBlindingData(const unsigned int map_index, const std::vector<unsigned char>& vchRangeproof, const CConfidentialValue& conf_value, const CConfidentialAsset& conf_asset, const CConfidentialNonce nonce, const CScript& scriptPubKey, CPubKey* blinding_pubkey_out, CAmount* value_out, uint256* value_factor_out, CAsset* asset_out, uint256* asset_factor_out) const
 {
     // Blinding data is cached in blindingData.
@@ -5504,6 +5669,116 @@ void CWallet::ComputeBlindingData(const CConfidentialValue& conf_value, const CC
     asset_factor.SetNull();
 }
 
+bool CUnblindCheck::operator()()
+{
+    CAmount value;
+    uint256 value_factor;
+    CAsset asset;
+    uint256 asset_factor;
+    if (blinding_key.IsValid() && UnblindConfidentialPair(blinding_key, txout->nValueCA, txout->nAsset, txout->nNonce, txout->scriptPubKey, txout->vchRangeproof, value, value_factor, asset, asset_factor)) {
+        result->value = value;
+        result->amount_blinding_factor = value_factor;
+        result->asset = asset;
+        result->asset_blinding_factor = asset_factor;
+        const CPubKey blinding_pubkey = blinding_key.GetPubKey();
+        result->blinding_pubkey = blinding_pubkey.IsFullyValid() ? blinding_pubkey : CPubKey();
+    } else {
+        result->value = -1;
+        result->amount_blinding_factor.SetNull();
+        result->asset.SetNull();
+        result->asset_blinding_factor.SetNull();
+        result->blinding_pubkey = CPubKey();
+    }
+    result->computed = 1;
+    return true;
+}
+
+void CUnblindCheck::swap(CUnblindCheck& check)
+{
+    std::swap(blinding_key, check.blinding_key);
+    std::swap(txout, check.txout);
+    std::swap(result, check.result);
+}
+
+void CWallet::StartUnblindThreads(int threads)
+{
+    for (int i = 0; i < threads - 1; i++) {
+        m_unblind_threads.create_thread([this] {
+            RenameThread("bitcoin-unblind");
+            m_unblind_queue.Thread();
+        });
+    }
+}
+
+void CWallet::StopUnblindThreads()
+{
+    m_unblind_threads.interrupt_all();
+    m_unblind_threads.join_all();
+}
+
+/** Queue the confidential outputs of tx that are not unblinded in known_data yet. */
+static void AddUnblindChecks(const CWallet& wallet, const CTransaction& tx, const std::vector<BlindingDataInfo>& known_data,
+                             std::vector<BlindingDataInfo>& output_data, std::vector<CUnblindCheck>& checks)
+{
+    output_data.resize(tx.vout.size());
+    for (unsigned int n = 0; n < tx.vout.size(); n++) {
+        const CTxOut& txout = tx.vout[n];
+        if (!txout.IsCA() || (txout.nValueCA.IsExplicit() && txout.nAsset.IsExplicit())) {
+            continue;
+        }
+        if (n < known_data.size() && known_data[n].computed == 1 && known_data[n].value != -1) {
+            continue;
+        }
+        checks.emplace_back(wallet.GetBlindingKey(&txout.scriptPubKey), txout, output_data[n]);
+    }
+}
+
+void CWallet::PrecomputeBlindingData(const std::vector<CTransactionRef>& vtx, PrecomputedBlindingData& data_out)
+{
+    std::vector<CUnblindCheck> checks;
+    {
+        LOCK(cs_wallet);
+        for (const CTransactionRef& ptx : vtx) {
+            const CTransaction& tx = *ptx;
+            auto it = mapWallet.find(tx.GetHash());
+            if (it != mapWallet.end()) {
+                AddUnblindChecks(*this, tx, it->second.blindingData, data_out[tx.GetHash()], checks);
+            } else if (IsMine(tx) || IsFromMe(tx)) {
+                AddUnblindChecks(*this, tx, {}, data_out[tx.GetHash()], checks);
+            }
+        }
+    }
+    if (checks.empty()) {
+        return;
+    }
+    CCheckQueueControl<CUnblindCheck> control(&m_unblind_queue);
+    control.Add(checks);
+    control.Wait();
+}
+
+void CWallet::RecomputeUnknownBlindingData()
+{
+    std::vector<CTransactionRef> vtx;
+    {
+        LOCK(cs_wallet);
+        vtx.reserve(mapWallet.size());
+        for (const std::pair<const uint256, CWalletTx>& item : mapWallet) {
+            vtx.push_back(item.second.tx);
+        }
+    }
+
+    PrecomputedBlindingData blinding_data;
+    PrecomputeBlindingData(vtx, blinding_data);
+
+    LOCK(cs_wallet);
+    for (const std::pair<const uint256, std::vector<BlindingDataInfo>>& item : blinding_data) {
+        auto it = mapWallet.find(item.first);
+        if (it != mapWallet.end()) {
+            it->second.SeedBlindingData(item.second);
+        }
+    }
+}
+
 void CWalletTx::WipeUnknownBlindingData()
 {
     for (unsigned int n = 0; n < tx->vout.size(); n++) {
@@ -8,6 +8,7 @@
 
 #include <amount.h>
 #include <asset.h>
+#include <checkqueue.h>
 #include <interfaces/chain.h>
 #include <outputtype.h>
 #include <policy/feerate.h>
@@ -35,6 +36,8 @@
 #include <utility>
 #include <vector>
 
+#include <boost/thread/thread.hpp>
+
 //! Responsible for reading and validating the -wallet arguments and verifying the wallet database.
 //! This function will perform salvage on the wallet if requested, as long as only one wallet is
 //! being loaded (WalletParameterInteraction forbids -salvagewallet, -zapwallettxes or -upgradewallet with multiwallet).
@@ -250,6 +253,32 @@ struct BlindingDataInfo {
     }
 };
 
+//! Output blinding data of a batch of transactions, keyed by txid and indexed by output.
+typedef std::map<uint256, std::vector<BlindingDataInfo>> PrecomputedBlindingData;
+
+/**
+ * Closure representing one confidential output to be unblinded on the
+ * unblinding worker threads of a wallet. Results are written in the same form
+ * CWallet::ComputeBlindingData produces them, including value -1 for outputs
+ * that could not be unblinded.
+ */
+class CUnblindCheck
+{
+private:
+    CKey blinding_key;
+    const CTxOut* txout;
+    BlindingDataInfo* result;
+
+public:
+    CUnblindCheck() : txout(nullptr), result(nullptr) {}
+    CUnblindCheck(const CKey& blinding_key_in, const CTxOut& txout_in, BlindingDataInfo& result_in) :
+        blinding_key(blinding_key_in), txout(&txout_in), result(&result_in) {}
+
+    bool operator()();
+
+    void swap(CUnblindCheck& check);
+};
+
 static inline void ReadOrderPos(int64_t& nOrderPos, mapValue_t& mapValue)
 {
     if (!mapValue.count("n"))
@@ -596,6 +625,8 @@ public:
     // For use in wallet transaction creation to remember 3rd party values
     // Unneeded for issuance.
     void SetBlindingData(const unsigned int output_index, const CPubKey& blinding_pubkey, const CAmount value, const uint256& value_factor, const CAsset& asset, const uint256& asset_factor);
+    // Fill the outputs that are not cached yet from data computed ahead of time by CWallet::PrecomputeBlindingData
+    void SeedBlindingData(const std::vector<BlindingDataInfo>& output_data);
 
     // Convenience method to retrieve all blinding data at once, for an ordinary non-issuance tx
     void GetNonIssuanceBlindingData(const unsigned int output_index, CPubKey* blinding_pubkey_out, CAmount* value_out, uint256* value_factor_out, CAsset* asset_out, uint256* asset_factor_out) const;
@@ -783,6 +814,22 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void AddToSpends(const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /**
+     * Outputs AvailableCoins considers, by asset: the outputs of wallet
+     * transactions that are ours and not spent by a wallet transaction that
+     * is neither abandoned nor conflicted. Whether they are spendable right
+     * now (depth, trust, locks) is still checked by AvailableCoins. Built on
+     * first use, updated as transactions are added or change state and
+     * rebuilt after MarkDirty(), e.g. when keys are imported.
+     */
+    mutable std::map<CAsset, std::set<COutPoint>> m_spendable_outputs GUARDED_BY(cs_wallet);
+    mutable bool m_spendable_outputs_valid GUARDED_BY(cs_wallet) = false;
+    void BuildSpendableOutputs() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UpdateSpendableOutput(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    /* Update the outputs of wtx and the outputs it spends in m_spendable_outputs. */
+    void UpdateSpendableOutputs(const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    bool IsSpentByActiveTx(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /**
      * Add a transaction to the wallet, or update it.  pIndex and posInBlock should
      * be set when the transaction was known to be included in a block.  When
@@ -796,7 +843,7 @@ private:
      * Abandoned state should probably be more carefully tracked via different
      * posInBlock signals or by checking mempool presence when necessary.
      */
-    bool AddToWalletIfInvolvingMe(const CTransactionRef& tx, const uint256& block_hash, int posInBlock, bool fUpdate) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    bool AddToWalletIfInvolvingMe(const CTransactionRef& tx, const uint256& block_hash, int posInBlock, bool fUpdate, const std::vector<BlindingDataInfo>* blinding_data = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
@@ -808,7 +855,16 @@ private:
 
     /* Used by TransactionAddedToMemorypool/BlockConnected/Disconnected/ScanForWalletTransactions.
      * Should be called with non-zero block_hash and posInBlock if this is for a transaction that is included in a block. */
-    void SyncTransaction(const CTransactionRef& tx, const uint256& block_hash, int posInBlock = 0, bool update_tx = true) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void SyncTransaction(const CTransactionRef& tx, const uint256& block_hash, int posInBlock = 0, bool update_tx = true, const std::vector<BlindingDataInfo>* blinding_data = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /* Trial-unblind the confidential outputs of the transactions in vtx that involve this wallet
+     * on the unblinding worker threads. cs_wallet is only held while the candidates are collected,
+     * so that the expensive rangeproof rewinds do not block other wallet users. */
+    void PrecomputeBlindingData(const std::vector<CTransactionRef>& vtx, PrecomputedBlindingData& data_out) LOCKS_EXCLUDED(cs_wallet);
+
+    /* Queue and worker threads of PrecomputeBlindingData, the threads are started by CreateWalletFromFile. */
+    CCheckQueue<CUnblindCheck> m_unblind_queue{16, "Unblind"};
+    boost::thread_group m_unblind_threads;
 
     /* the HD chain data model (external chain counters) */
     CHDChain hdChain;
@@ -906,6 +962,7 @@ public:
 
     ~CWallet()
     {
+        StopUnblindThreads();
         // Should not have slots connected at this point.
         assert(NotifyUnload.empty());
         delete encrypted_batch;
@@ -947,6 +1004,12 @@ public:
      */
     std::map<CTxDestination, std::vector<COutput>> ListCoins(interfaces::Chain::Lock& locked_chain) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /**
+     * Check that the outputs AvailableCoins considers match a rebuild from
+     * mapWallet and include every output of ours that is not spent.
+     */
+    bool CheckSpendableOutputs(interfaces::Chain::Lock& locked_chain) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /**
      * Find non-change parent output.
      */
@@ -1269,6 +1332,16 @@ public:
      */
     void postInitProcess();
 
+    /* Start threads-1 worker threads unblinding confidential outputs, the thread calling PrecomputeBlindingData is the last one. */
+    void StartUnblindThreads(int threads);
+    /* Interrupt and join the unblinding worker threads. */
+    void StopUnblindThreads();
+
+    /* Retry, on the unblinding worker threads, the confidential outputs of wallet transactions
+     * that could not be unblinded so far, e.g. after a blinding key was imported. The results
+     * are only committed under cs_wallet, which must not be held by the caller. */
+    void RecomputeUnknownBlindingData() LOCKS_EXCLUDED(cs_wallet);
+
     bool BackupWallet(const std::string& strDest);
 
     /* Set the HD chain model (chain child index counters) */
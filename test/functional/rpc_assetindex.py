@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Lava Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getassetinfo and listassetissuances RPCs.
+
+- issue an explicit and a blinded asset and check both RPCs against them
+- reissue the explicit asset and check it is added to its history
+- replace the block of the reissuance with a reorg and check it is listed in its new block only
+- check the index survives a restart and that the RPCs require -assetindex
+"""
+
+from decimal import Decimal
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_raises_rpc_error
+
+class AssetIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [["-assetindex"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def run_test(self):
+        node = self.nodes[0]
+        # generatepoc advances the mock time to the deadline of every block
+        node.setmocktime(node.getblockheader(node.getbestblockhash())['time'])
+        miner = node.getnewaddress("", "legacy")
+        node.generatepoc(40, miner)
+        assert_equal(node.listassetissuances(), [])
+
+        self.log.info("Issuances are listed once they are in a block")
+        issued = node.issueasset(100, 1, False)
+        blinded = node.issueasset(50, 1)
+        assert_equal(node.listassetissuances(), [])
+        issue_hash = node.generatepoc(1, miner)[0]
+        issue_height = node.getblockcount()
+
+        issuances = node.listassetissuances()
+        assert_equal(len(issuances), 2)
+        by_asset = {i['asset']: i for i in issuances}
+        record = by_asset[issued['asset']]
+        assert_equal(record['token'], issued['token'])
+        assert_equal(record['entropy'], issued['entropy'])
+        assert_equal(record['txid'], issued['txid'])
+        assert_equal(record['vin'], issued['vin'])
+        assert_equal(record['height'], issue_height)
+        assert_equal(record['blockhash'], issue_hash)
+        assert_equal(record['isreissuance'], False)
+        assert_equal(record['assetamount'], Decimal('100'))
+        assert_equal(record['tokenamount'], Decimal('1'))
+        record = by_asset[blinded['asset']]
+        assert_equal(record['token'], blinded['token'])
+        assert_equal(record['assetamount'], -1)
+        assert_equal(record['tokenamount'], -1)
+
+        info = node.getassetinfo(issued['asset'])
+        assert_equal(info['token'], issued['token'])
+        assert_equal(info['height'], issue_height)
+        assert_equal(info['assetamount'], Decimal('100'))
+        assert_equal(len(info['issuances']), 1)
+        assert_equal(node.getassetinfo(blinded['asset'])['assetamount'], -1)
+
+        self.log.info("Reissuances are added to the history of the asset")
+        reissued = node.reissueasset(issued['asset'], 25)
+        reissue_hash = node.generatepoc(1, miner)[0]
+        info = node.getassetinfo(issued['asset'])
+        assert_equal(info['assetamount'], Decimal('125'))
+        assert_equal(info['tokenamount'], Decimal('1'))
+        assert_equal(len(info['issuances']), 2)
+        record = info['issuances'][1]
+        assert_equal(record['isreissuance'], True)
+        assert_equal(record['txid'], reissued['txid'])
+        assert_equal(record['blockhash'], reissue_hash)
+        assert 'token' not in record
+        assert_equal(node.listassetissuances(issue_height + 1), info['issuances'][1:])
+        assert_equal(node.listassetissuances(0, issue_height), issuances)
+
+        self.log.info("Issuances of blocks replaced by a reorg are no longer listed")
+        node.invalidateblock(reissue_hash)
+        info = node.getassetinfo(issued['asset'])
+        assert_equal(info['assetamount'], Decimal('100'))
+        assert_equal(len(info['issuances']), 1)
+        # The reissuance went back to the mempool and is mined again on the new branch
+        new_hashes = node.generatepoc(2, node.getnewaddress("", "legacy"))
+        info = node.getassetinfo(issued['asset'])
+        assert_equal(len(info['issuances']), 2)
+        assert_equal(info['issuances'][1]['txid'], reissued['txid'])
+        assert_equal(info['issuances'][1]['blockhash'], new_hashes[0])
+        assert all(i['blockhash'] != reissue_hash for i in node.listassetissuances())
+        assert_raises_rpc_error(-5, "Asset not issued in the active chain", node.getassetinfo, reissued['txid'])
+        assert_raises_rpc_error(-8, "Invalid height range", node.listassetissuances, 10, 9)
+
+        self.log.info("The index is kept across restarts")
+        self.restart_node(0)
+        assert_equal(node.getassetinfo(issued['asset'])['issuances'], info['issuances'])
+        assert_equal(node.listassetissuances(0, issue_height), issuances)
+
+        self.log.info("Both RPCs require -assetindex")
+        self.restart_node(0, extra_args=[])
+        assert_raises_rpc_error(-1, "Requires -assetindex", node.listassetissuances)
+        assert_raises_rpc_error(-1, "Requires -assetindex", node.getassetinfo, issued['asset'])
+
+if __name__ == '__main__':
+    AssetIndexTest().main()
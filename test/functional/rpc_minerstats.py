@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Lava Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getminerstats and listforgedblocks RPCs.
+
+- forge blocks with one generator and check both RPCs against them
+- replace some of them with a reorg and check they are no longer attributed
+- check the index survives a restart and that the RPCs require -minerstatsindex
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_raises_rpc_error
+
+class MinerStatsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [["-minerstatsindex"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def run_test(self):
+        node = self.nodes[0]
+        # generatepoc advances the mock time to the deadline of every block
+        node.setmocktime(node.getblockheader(node.getbestblockhash())['time'])
+        miner = node.getnewaddress("", "legacy")
+        other = node.getnewaddress("", "legacy")
+        hashes = node.generatepoc(20, miner)
+
+        self.log.info("listforgedblocks lists the blocks of the generator")
+        forged = node.listforgedblocks(miner)
+        assert_equal([b['hash'] for b in forged], hashes)
+        assert_equal([b['height'] for b in forged], list(range(1, 21)))
+        for b in forged:
+            header = node.getblockheader(b['hash'])
+            assert_equal(b['time'], header['time'])
+            assert 'firestone' not in b
+        assert_equal([b['height'] for b in node.listforgedblocks(miner, 5, 9)], list(range(5, 10)))
+        assert_equal(node.listforgedblocks(other), [])
+        assert_raises_rpc_error(-8, "Invalid height range", node.listforgedblocks, miner, 10, 9)
+
+        self.log.info("getminerstats reports the window ending at the tip")
+        stats = node.getminerstats(miner, 10)
+        assert_equal(stats['startheight'], 11)
+        assert_equal(stats['endheight'], 20)
+        assert_equal(stats['blocks'], 10)
+        assert_equal(stats['forged'], 10)
+        assert_equal(stats['firestones'], 0)
+        assert_equal(stats['winrate'], 1)
+        assert_equal(stats['bestdeadline'], min(b['deadline'] for b in forged[10:]))
+        stats = node.getminerstats(other, 10)
+        assert_equal(stats['forged'], 0)
+        assert_equal(stats['winrate'], 0)
+        assert_raises_rpc_error(-8, "Invalid nblocks", node.getminerstats, miner, 0)
+
+        self.log.info("Blocks replaced by a reorg are no longer attributed to their generator")
+        node.invalidateblock(hashes[15])
+        replaced = node.generatepoc(6, other)
+        assert_equal([b['hash'] for b in node.listforgedblocks(miner)], hashes[:15])
+        assert_equal([b['hash'] for b in node.listforgedblocks(other)], replaced)
+        assert_equal([b['height'] for b in node.listforgedblocks(other)], list(range(16, 22)))
+        stats = node.getminerstats(miner, 21)
+        assert_equal(stats['blocks'], 21)
+        assert_equal(stats['forged'], 15)
+        assert_equal(node.getminerstats(other, 21)['forged'], 6)
+
+        self.log.info("The index is kept across restarts")
+        self.restart_node(0)
+        assert_equal([b['hash'] for b in node.listforgedblocks(miner)], hashes[:15])
+        assert_equal([b['hash'] for b in node.listforgedblocks(other)], replaced)
+
+        self.log.info("Both RPCs require -minerstatsindex")
+        self.restart_node(0, extra_args=[])
+        assert_raises_rpc_error(-1, "Requires -minerstatsindex", node.listforgedblocks, miner)
+        assert_raises_rpc_error(-1, "Requires -minerstatsindex", node.getminerstats, miner)
+
+if __name__ == '__main__':
+    MinerStatsTest().main()
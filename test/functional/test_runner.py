@@ -110,6 +110,9 @@ BASE_SCRIPTS = [
     'wallet_txn_clone.py',
     'wallet_txn_clone.py --segwit',
     'rpc_getchaintips.py',
+    'rpc_assetindex.py',
+    'p2p_blockfilters.py',
+    'rpc_minerstats.py',
     'rpc_misc.py',
     'interface_rest.py',
     'mempool_spend_coinbase.py',